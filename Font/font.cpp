@@ -11,7 +11,7 @@ Font::Font()
 	}
 }
 
-void Font::write(char* sentence, float drawX, float drawY) {
+void Font::write(char* sentence, float drawX, float drawY, LinearAllocator& scratch) {
 	// Get the number of letters in the sentence.
 	const int iNumLetters = (int) strlen(sentence);
 	const int iNumVerts = iNumLetters * 6;
@@ -21,8 +21,12 @@ void Font::write(char* sentence, float drawX, float drawY) {
 	const float textHeight = 1.0f;
 	float textWidth = 0.0f;
 
-	Vertex1P1UV* pVertices = new Vertex1P1UV[iNumVerts];
-	unsigned int* pIndices = new unsigned int[iNumIndices];
+	Vertex1P1UV* pVertices = scratch.AllocateArray<Vertex1P1UV>(iNumVerts);
+	unsigned int* pIndices = scratch.AllocateArray<unsigned int>(iNumIndices);
+	if (!pVertices || !pIndices) {
+		OutputDebugStringW(L"Font scratch memory exhausted");
+		return;
+	}
 
 	// Draw each letter onto a quad.
 	for (int i = 0, letter = 0, index = 0; i < iNumLetters; i++)
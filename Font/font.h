@@ -1,6 +1,7 @@
 #pragma once
 #include <d3d11.h>
 #include "../Graphics/VertexFormat.h"
+#include "../Memory/LinearAllocator.h"
 
 struct FontType
 {
@@ -14,7 +15,8 @@ class Font
 		Font();
 		~Font();
 
-		void write(char* sentence, float drawX, float drawY);
+		// The vertex data only lives until the mesh is created, so it is taken from scratch
+		void write(char* sentence, float drawX, float drawY, LinearAllocator& scratch);
 
 	private:
 		bool LoadFontData(char*);
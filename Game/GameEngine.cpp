@@ -2,6 +2,7 @@
 #include "..\Timer\Timer.h"
 #include "..\Graphics\D3D11Renderer.h"
 #include "..\Memory\MemoryManager.h"
+#include "..\Memory\DoubleBufferedAllocator.h"
 #include "..\Debug\Debug.h"
 #include "..\Font\Font.h"
 #include "..\Object\ObjectLoader.h"
@@ -94,6 +95,8 @@ void GameEngine::KeyboardEventHandeler(HWND hWnd, UINT msg, WPARAM wParam, LPARA
 			D3D11Renderer::GetInstance()->SetCamera(CameraType::FRONT_VIEW_CAMERA);
 		} else if (GetAsyncKeyState(VK_8)) {
 			D3D11Renderer::GetInstance()->SetCamera(CameraType::BACK_VIEW_CAMERA);
+		} else if (GetAsyncKeyState(VK_F9)) {
+			MemoryManager::GetInstance()->DumpJson("memory.json");
 		}
 
 		if (D3D11Renderer::GetInstance()->GetCameraType() == CameraType::MOVE_CAMERA) {
@@ -123,6 +126,9 @@ void GameEngine::Start(HINSTANCE hInst)
 {
 	UNREFERENCED_PARAMETER(hInst);
 
+	// Memory, before anything puts a pooled container on it
+	MemoryManager::GetInstance()->Construct();
+
 	// Register the window class
 	WNDCLASSEX wc =
 	{
@@ -224,6 +230,10 @@ void GameEngine::Start(HINSTANCE hInst)
 	GameObject gameObj3(&Sphere(origin3, radius), nullptr, nullptr, transform2, 2);
 	GameObject gameObj4(&Sphere(origin4, radius+0.5f), nullptr, nullptr, transform3, 2);
 
+	// Scratch memory for the frame, released wholesale at the end of the next frame
+	DoubleBufferedAllocator frameAllocator;
+	frameAllocator.Construct(MEMORY_FRAME_ALLOCATOR_SIZE);
+
 	Font show;
 
 	// Show the window
@@ -242,11 +252,10 @@ void GameEngine::Start(HINSTANCE hInst)
 	MeshInstance* m3 = D3D11Renderer::GetInstance()->GetMeshInstanceList().at(3);
 
 	if (GameWorld::GetInstance()->GetGameObjectList().size() == 4)
-		show.write("four", -2.0f, -2.0f);
+		show.write("four", -2.0f, -2.0f, frameAllocator.GetCurrent());
 
-
-	// Memory
-	//MemoryManager::GetInstance()->Construct();
+	const float scale = 1.0f;
+	const Vector3 rotation(0.0f, 0.0f, 0.0f);
 	// enter the main game loop
 	bool bQuit = false;
 	while (!bQuit)
@@ -255,8 +264,8 @@ void GameEngine::Start(HINSTANCE hInst)
 		if (elaspedTime >= 1.0 / FPS)
 		{
 			m0->Transform(
-				new float(1.0f),						//scaling
-				&(Vector3(0.0f, 0.0f, 0.0f)),			//rotation
+				&scale,									//scaling
+				&rotation,								//rotation
 				&(velocity1)			//translation
 			);
 			//sphere1.translate(Vector3(-0.5f, 0.0f, 0.0f));
@@ -264,8 +273,8 @@ void GameEngine::Start(HINSTANCE hInst)
 
 			
 			m1->Transform(
-				new float(1.0f),						//scaling
-				&(Vector3(0.0f, 0.0f, 0.0f)),			//rotation
+				&scale,									//scaling
+				&rotation,								//rotation
 				&(velocity2)			//translation
 			);
 			//sphere2.translate(Vector3(0.5f, 0.0f, 0.0f));
@@ -273,22 +282,22 @@ void GameEngine::Start(HINSTANCE hInst)
 		
 
 			m2->Transform(
-				new float(1.0f),						//scaling
-				&(Vector3(0.0f, 0.0f, 0.0f)),			//rotation
+				&scale,									//scaling
+				&rotation,								//rotation
 				&(velocity3)			//translation
 				);
 			gameObj3.Update(1.0f);
 
 			m3->Transform(
-				new float(1.0f),						//scaling
-				&(Vector3(0.0f, 0.0f, 0.0f)),			//rotation
+				&scale,									//scaling
+				&rotation,								//rotation
 				&(velocity4)			//translation
 				);
 			gameObj4.Update(1.0f);
 
 			if (gameObj3.isCollided(&gameObj4))
 			{
-				show.write("spheres collided", 5.0f, 5.0f);
+				show.write("spheres collided", 5.0f, 5.0f, frameAllocator.GetCurrent());
 				transform2.setTranslate(0.0f, 0.5f, 0.0f);
 				transform3.setTranslate(0.0f, -0.5f, 0.0f);
 				gameObj3.setTransform(transform2);
@@ -300,7 +309,7 @@ void GameEngine::Start(HINSTANCE hInst)
 
 			if (gameObj1.isCollided(&gameObj2))
 			{
-				show.write("boxes collided", 5.0f, 0.0f);
+				show.write("boxes collided", 5.0f, 0.0f, frameAllocator.GetCurrent());
 				transform.setTranslate(0.5f, 0.0f, 0.0f);
 				transform1.setTranslate(-0.5f, 0.0f, 0.0f);
 				gameObj1.setTransform(transform1);
@@ -312,7 +321,7 @@ void GameEngine::Start(HINSTANCE hInst)
 			}
 
 			if (gameObj1.isCollided(&gameObj4))
-				show.write("sphere2 and box1 collided", 5.0f, 2.5f);
+				show.write("sphere2 and box1 collided", 5.0f, 2.5f, frameAllocator.GetCurrent());
 
 			// Update the game world based on delta time
 //			D3D11Renderer::GetInstance()->Update();
@@ -321,10 +330,17 @@ void GameEngine::Start(HINSTANCE hInst)
 			D3D11Renderer::GetInstance()->Render();
 
 			// Debug text
-			std::stringstream str;
-			str << "FPS: " << 1.0f / elaspedTime;
-			SetWindowText(hWnd, str.str().c_str());
+			const size_t titleSize = 32;
+			char* title = (char*) frameAllocator.Allocate(titleSize, 1);
+			if (title)
+			{
+				snprintf(title, titleSize, "FPS: %g", 1.0f / elaspedTime);
+				SetWindowText(hWnd, title);
+			}
 			elaspedTime = 0.0f;
+
+			frameAllocator.SwapBuffers();
+			MemoryManager::GetInstance()->EndFrame();
 		}
 
 		MSG msg;
@@ -343,6 +359,8 @@ void GameEngine::Start(HINSTANCE hInst)
 		elaspedTime += m_Timer.getDeltaTime();
 	}
 
+	frameAllocator.Destruct();
+
 	// Cleanup the GameWorld and GraphicsDevice singletons
 	D3D11Renderer::GetInstance()->DestructandCleanUp();
 	MemoryManager::GetInstance()->DestructandCleanUp();
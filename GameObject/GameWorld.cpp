@@ -9,7 +9,7 @@ GameWorld * GameWorld::GetInstance()
 	return m_pGameWorld;
 }
 
-std::vector<GameObject*>& GameWorld::GetGameObjectList()
+PoolVector<GameObject*>& GameWorld::GetGameObjectList()
 {
 	return m_GameObjectList;
 }
@@ -2,7 +2,7 @@
 #ifndef GAMEWORLD_H
 #define GAMEWORLD_H
 
-#include <vector>
+#include "..\Memory\PoolAllocator.h"
 #include "GameObject.h"
 class GameObject;
 
@@ -13,12 +13,12 @@ public:
 
 	static GameWorld*					GetInstance();
 
-	std::vector<GameObject*>&	GetGameObjectList();
+	PoolVector<GameObject*>&	GetGameObjectList();
 
 private:
 	static GameWorld*					m_pGameWorld;
 
-	std::vector<GameObject*>		m_GameObjectList;
+	PoolVector<GameObject*>			m_GameObjectList;
 };
 
 
@@ -24,7 +24,8 @@ struct VS_CONSTANT_BUFFER
 MeshData::MeshData(void* pVertexData, const int iNumVerts, unsigned int* pIndexData, const int iNumIndics, const RenderType renderType, const D3D_PRIMITIVE_TOPOLOGY typology, const char* texture) :
 	m_pVertexBuffer(nullptr),
 	m_pIndexBuffer(nullptr),
-	TransformationMat(Matrix4::Identity)
+	TransformationMat(Matrix4::Identity),
+	m_transform(SIMDTransform::Identity)
 {
 	SetUpEnvironment(renderType, typology, texture);
 
@@ -43,6 +44,9 @@ MeshData::MeshData(void* pVertexData, const int iNumVerts, unsigned int* pIndexD
 		break;
 	}
 
+	// Compute bounding volumes, the position is the first member of every vertex format
+	ComputeBounds((const SIMDVector3*) pVertexData, m_stride, iNumVerts, m_bounds);
+
 	// Create vertex buffer
 	m_pVertexBuffer = VertexBufferEngine::GetInstance()->CreateBufferFromRawData(pVertexData, iNumVerts, m_stride);
 	// Create index buffer
@@ -166,45 +170,23 @@ void MeshData::SetUpEnvironment(const RenderType renderType, const D3D_PRIMITIVE
 }
 
 void MeshData::Transform(const float* scalar, const Vector3* rotation, const Vector3* translation) {
-	Matrix4 Transform;
-	Vector3 objectOrigin(0.0f, 0.0f, 0.0f);
-	objectOrigin.TransformAsVector(TransformationMat);
-
+	// Scale and rotation are local to the object, translation is in world space
 	if (scalar) {
-		Transform.CreateScale(*scalar);
-		TransformationMat.Multiply(Transform);
+		m_transform.Scale(*scalar);
 	}
 	if (rotation) {
-		bool is_rotation_about_objectOrigin = fabs(rotation->GetW() - 1.0f) < 0.005f;
-
-		if (is_rotation_about_objectOrigin) {
-			Vector3 translationOrigin(-objectOrigin.GetX(), -objectOrigin.GetY(), -objectOrigin.GetZ());
-			Transform.CreateTranslation(translationOrigin);
-			TransformationMat.Multiply(Transform);
-
-			Transform.CreateRotationX(rotation->GetX());
-			TransformationMat.Multiply(Transform);
-			Transform.CreateRotationY(rotation->GetY());
-			TransformationMat.Multiply(Transform);
-			Transform.CreateRotationZ(rotation->GetZ());
-			TransformationMat.Multiply(Transform);
-
-			Transform.CreateTranslation(objectOrigin);
-			TransformationMat.Multiply(Transform);
-		} else {
-			Transform.CreateRotationX(rotation->GetX());
-			TransformationMat.Multiply(Transform);
-			Transform.CreateRotationY(rotation->GetY());
-			TransformationMat.Multiply(Transform);
-			Transform.CreateRotationZ(rotation->GetZ());
-			TransformationMat.Multiply(Transform);
-		}
+		Quaternion rotationX, rotationY, rotationZ;
+		rotationX.CreateRotationX(rotation->GetX());
+		rotationY.CreateRotationY(rotation->GetY());
+		rotationZ.CreateRotationZ(rotation->GetZ());
+		rotationX.Multiply(rotationY);
+		rotationX.Multiply(rotationZ);
+		m_transform.Rotate(rotationX);
 	}
 	if (translation) {
-		Transform.CreateTranslation(*translation);	
-		Transform.Multiply(TransformationMat);
-		TransformationMat = Transform;
+		m_transform.Translate(*translation);
 	}
+	TransformationMat = m_transform.ToMatrix4();
 
 	Matrix4 ProjectionMat;
 	ProjectionMat.CreatePerspectiveFOV(
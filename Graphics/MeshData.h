@@ -6,6 +6,8 @@
 #include <d3d11.h>
 #include "../Object/Camera.h"
 #include "VertexFormat.h"
+#include "../Math/simdtransform.h"
+#include "../Math/simdbounds.h"
 
 enum RenderType
 {
@@ -38,6 +40,12 @@ public:
 		return m_iNumVerts;
 	}
 
+	// Bounding volumes of the vertices, in the space of the mesh before m_transform
+	inline const SIMDBounds& GetBounds() const
+	{
+		return m_bounds;
+	}
+
 	// Destructor
 	~MeshData();
 
@@ -91,7 +99,14 @@ private:
 	//Start Index Location
 	unsigned int							m_iStartIndexLocation;
 
+	// Matrix of m_transform for the constant buffer
 	Matrix4									TransformationMat;
+
+	// Scale, rotation and translation of the mesh
+	SIMDTransform							m_transform;
+
+	// Bounding volumes computed from the vertices at load time
+	SIMDBounds								m_bounds;
 };
 
 #endif
\ No newline at end of file
@@ -6,8 +6,8 @@ ShaderManager* ShaderManager::m_pInstance;
 
 void* ShaderManager::GetShader(const char* filename, D3D11_SHADER_VERSION_TYPE type)
 {
-	std::string name(filename);
-	std::unordered_map<std::string, void*>::iterator result = m_mapShaders.find(name);
+	PoolString name(filename);
+	PoolUnorderedMap<PoolString, void*>::iterator result = m_mapShaders.find(name);
 	if (result == m_mapShaders.end())
 	{
 		LoadShader(filename, type);
@@ -5,9 +5,8 @@
 
 
 #include <stdio.h>
-#include <unordered_map>
-#include <string>
 #include "D3D11Renderer.h"
+#include "../Memory/PoolAllocator.h"
 #include <d3d11shader.h>
 
 class ShaderManager
@@ -49,7 +48,7 @@ public:
 
 	~ShaderManager()
 	{
-		std::unordered_map<std::string, void*>::iterator itr;
+		PoolUnorderedMap<PoolString, void*>::iterator itr;
 		for (itr = m_mapShaders.begin(); itr != m_mapShaders.end(); ++itr)
 		{
 			ID3D11DeviceChild* pS = (ID3D11DeviceChild*) itr->second;
@@ -64,9 +63,9 @@ private:
 	// Singleton instance
 	static ShaderManager*									m_pInstance;
 
-	std::unordered_map<std::string, void*>					m_mapShaders;
+	PoolUnorderedMap<PoolString, void*>						m_mapShaders;
 	
-	std::unordered_map<std::string, ID3D11InputLayout*>		m_mapInputLayouts;
+	PoolUnorderedMap<PoolString, ID3D11InputLayout*>			m_mapInputLayouts;
 };
 
 #endif // !SHADERMANAGER_H_
\ No newline at end of file
@@ -5,8 +5,8 @@ TextureManager* TextureManager::m_pInstance;
 
 void* TextureManager::GetTexture(const char* filename)
 {
-	std::string name(filename);
-	std::unordered_map<std::string, void*>::iterator result = m_mapTexture.find(name);
+	PoolString name(filename);
+	PoolUnorderedMap<PoolString, void*>::iterator result = m_mapTexture.find(name);
 	if (result == m_mapTexture.end())
 	{
 		LoadTexture(filename);
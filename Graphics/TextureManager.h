@@ -4,9 +4,8 @@
 #define TEXTUREMANAGER_H_
 
 #include <stdio.h>
-#include <unordered_map>
-#include <string>
 #include "D3D11Renderer.h"
+#include "../Memory/PoolAllocator.h"
 #include <d3d11shader.h>
 
 enum eSamplerState
@@ -85,7 +84,7 @@ public:
 
 	~TextureManager()
 	{
-		std::unordered_map<std::string, void*>::iterator itr;
+		PoolUnorderedMap<PoolString, void*>::iterator itr;
 		for (itr = m_mapTexture.begin(); itr != m_mapTexture.end(); ++itr)
 		{
 			ID3D11ShaderResourceView* pSRView = (ID3D11ShaderResourceView*)itr->second;
@@ -104,7 +103,7 @@ private:
 	// Singleton instance
 	static TextureManager*									m_pInstance;
 
-	std::unordered_map<std::string, void*>					m_mapTexture;
+	PoolUnorderedMap<PoolString, void*>						m_mapTexture;
 
 	void*													m_pSamplerState;
 
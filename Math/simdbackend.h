@@ -0,0 +1,662 @@
+#pragma once
+
+/** Thin layer over the SIMD instruction sets used by the maths library, one backend is selected at compile time */
+// SIMD_FORCE_SCALAR or SIMD_FORCE_SSE41 override the selection, otherwise the widest instruction set the compiler targets is used
+// Every backend exposes the same static functions on a 4 float vector, so they can be tested against each other
+// SIMDBackend8 exposes the same functions on 8 floats, natively with AVX2 and as two 4 float vectors otherwise
+
+#include <math.h>
+#include <string.h> // memcpy
+
+#if defined(_MSC_VER)
+#define SIMD_ALIGN(n) __declspec(align(n))
+#define SIMD_INLINE __forceinline
+#else
+#define SIMD_ALIGN(n) __attribute__((aligned(n)))
+#define SIMD_INLINE inline __attribute__((always_inline))
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define SIMD_HAS_SSE41 // MSVC has no macro for SSE4.1, the engine has always required it on Windows
+#elif defined(__SSE4_1__)
+#define SIMD_HAS_SSE41
+#endif
+
+#if defined(__AVX2__) && (defined(_MSC_VER) || defined(__FMA__))
+#define SIMD_HAS_AVX2
+#endif
+
+#if defined(SIMD_FORCE_SCALAR)
+#define SIMD_BACKEND_SCALAR
+#elif defined(SIMD_FORCE_SSE41) && defined(SIMD_HAS_SSE41)
+#define SIMD_BACKEND_SSE41
+#elif defined(SIMD_HAS_AVX2)
+#define SIMD_BACKEND_AVX2
+#elif defined(SIMD_HAS_SSE41)
+#define SIMD_BACKEND_SSE41
+#else
+#define SIMD_BACKEND_SCALAR
+#endif
+
+#ifdef SIMD_HAS_SSE41
+#include <xmmintrin.h> // intrinics
+#include <smmintrin.h> // intrinics
+#endif
+#ifdef SIMD_HAS_AVX2
+#include <immintrin.h> // intrinics
+#endif
+
+// Reference backend in plain C++, also used on CPUs without SSE4.1
+struct SIMDScalar
+{
+	struct SIMD_ALIGN(16) Vec4
+	{
+		float f[4];
+	};
+
+	static const int Width = 4;
+
+	static const char* Name()
+	{
+		return "Scalar";
+	}
+
+	static SIMD_INLINE Vec4 Set(float x, float y, float z, float w)
+	{
+		Vec4 v = { { x, y, z, w } };
+		return v;
+	}
+
+	static SIMD_INLINE Vec4 Splat(float s)
+	{
+		return Set(s, s, s, s);
+	}
+
+	// p must be 16-byte aligned
+	static SIMD_INLINE Vec4 Load(const float* p)
+	{
+		return Set(p[0], p[1], p[2], p[3]);
+	}
+
+	static SIMD_INLINE Vec4 LoadUnaligned(const float* p)
+	{
+		return Set(p[0], p[1], p[2], p[3]);
+	}
+
+	// p must be 16-byte aligned
+	static SIMD_INLINE void Store(float* p, Vec4 v)
+	{
+		p[0] = v.f[0]; p[1] = v.f[1]; p[2] = v.f[2]; p[3] = v.f[3];
+	}
+
+	static SIMD_INLINE void StoreUnaligned(float* p, Vec4 v)
+	{
+		Store(p, v);
+	}
+
+	static SIMD_INLINE float GetX(Vec4 v) { return v.f[0]; }
+	static SIMD_INLINE float GetY(Vec4 v) { return v.f[1]; }
+	static SIMD_INLINE float GetZ(Vec4 v) { return v.f[2]; }
+	static SIMD_INLINE float GetW(Vec4 v) { return v.f[3]; }
+
+	static SIMD_INLINE Vec4 SetX(Vec4 v, float s) { v.f[0] = s; return v; }
+	static SIMD_INLINE Vec4 SetY(Vec4 v, float s) { v.f[1] = s; return v; }
+	static SIMD_INLINE Vec4 SetZ(Vec4 v, float s) { v.f[2] = s; return v; }
+	static SIMD_INLINE Vec4 SetW(Vec4 v, float s) { v.f[3] = s; return v; }
+
+	static SIMD_INLINE Vec4 Add(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]);
+	}
+
+	static SIMD_INLINE Vec4 Sub(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]);
+	}
+
+	static SIMD_INLINE Vec4 Mul(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]);
+	}
+
+	static SIMD_INLINE Vec4 Div(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]);
+	}
+
+	// a * b + c
+	static SIMD_INLINE Vec4 MulAdd(Vec4 a, Vec4 b, Vec4 c)
+	{
+		return Add(Mul(a, b), c);
+	}
+
+	static SIMD_INLINE Vec4 Min(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] < b.f[0] ? a.f[0] : b.f[0], a.f[1] < b.f[1] ? a.f[1] : b.f[1],
+			a.f[2] < b.f[2] ? a.f[2] : b.f[2], a.f[3] < b.f[3] ? a.f[3] : b.f[3]);
+	}
+
+	static SIMD_INLINE Vec4 Max(Vec4 a, Vec4 b)
+	{
+		return Set(a.f[0] > b.f[0] ? a.f[0] : b.f[0], a.f[1] > b.f[1] ? a.f[1] : b.f[1],
+			a.f[2] > b.f[2] ? a.f[2] : b.f[2], a.f[3] > b.f[3] ? a.f[3] : b.f[3]);
+	}
+
+	static SIMD_INLINE Vec4 Sqrt(Vec4 v)
+	{
+		return Set(sqrtf(v.f[0]), sqrtf(v.f[1]), sqrtf(v.f[2]), sqrtf(v.f[3]));
+	}
+
+	// 1 / sqrt(v), the SIMD backends only guarantee 12 bits of precision
+	static SIMD_INLINE Vec4 Rsqrt(Vec4 v)
+	{
+		return Set(1.0f / sqrtf(v.f[0]), 1.0f / sqrtf(v.f[1]), 1.0f / sqrtf(v.f[2]), 1.0f / sqrtf(v.f[3]));
+	}
+
+	static SIMD_INLINE Vec4 Abs(Vec4 v)
+	{
+		return Set(fabsf(v.f[0]), fabsf(v.f[1]), fabsf(v.f[2]), fabsf(v.f[3]));
+	}
+
+	// Round to the nearest integer, halfway cases to even
+	static SIMD_INLINE Vec4 Round(Vec4 v)
+	{
+		return Set(rintf(v.f[0]), rintf(v.f[1]), rintf(v.f[2]), rintf(v.f[3]));
+	}
+
+	// 2^n for whole numbers n in [-126, 127]
+	static SIMD_INLINE Vec4 Pow2(Vec4 n)
+	{
+		return Set(pow2(n.f[0]), pow2(n.f[1]), pow2(n.f[2]), pow2(n.f[3]));
+	}
+
+	// The exponent and the mantissa in [1, 2) of normal floats, v = +-mantissa * 2^exponent
+	static SIMD_INLINE Vec4 Exponent(Vec4 v)
+	{
+		return Set(exponent(v.f[0]), exponent(v.f[1]), exponent(v.f[2]), exponent(v.f[3]));
+	}
+
+	static SIMD_INLINE Vec4 Mantissa(Vec4 v)
+	{
+		return Set(mantissa(v.f[0]), mantissa(v.f[1]), mantissa(v.f[2]), mantissa(v.f[3]));
+	}
+
+	// Comparisons give a mask, a lane is all ones where true and zero where false
+	static SIMD_INLINE Vec4 CmpLT(Vec4 a, Vec4 b)
+	{
+		return Set(maskLane(a.f[0] < b.f[0]), maskLane(a.f[1] < b.f[1]), maskLane(a.f[2] < b.f[2]), maskLane(a.f[3] < b.f[3]));
+	}
+
+	static SIMD_INLINE Vec4 CmpLE(Vec4 a, Vec4 b)
+	{
+		return Set(maskLane(a.f[0] <= b.f[0]), maskLane(a.f[1] <= b.f[1]), maskLane(a.f[2] <= b.f[2]), maskLane(a.f[3] <= b.f[3]));
+	}
+
+	static SIMD_INLINE Vec4 CmpGT(Vec4 a, Vec4 b) { return CmpLT(b, a); }
+	static SIMD_INLINE Vec4 CmpGE(Vec4 a, Vec4 b) { return CmpLE(b, a); }
+
+	static SIMD_INLINE Vec4 CmpEQ(Vec4 a, Vec4 b)
+	{
+		return Set(maskLane(a.f[0] == b.f[0]), maskLane(a.f[1] == b.f[1]), maskLane(a.f[2] == b.f[2]), maskLane(a.f[3] == b.f[3]));
+	}
+
+	static SIMD_INLINE Vec4 And(Vec4 a, Vec4 b)
+	{
+		return Set(fromBits(bits(a.f[0]) & bits(b.f[0])), fromBits(bits(a.f[1]) & bits(b.f[1])),
+			fromBits(bits(a.f[2]) & bits(b.f[2])), fromBits(bits(a.f[3]) & bits(b.f[3])));
+	}
+
+	static SIMD_INLINE Vec4 Or(Vec4 a, Vec4 b)
+	{
+		return Set(fromBits(bits(a.f[0]) | bits(b.f[0])), fromBits(bits(a.f[1]) | bits(b.f[1])),
+			fromBits(bits(a.f[2]) | bits(b.f[2])), fromBits(bits(a.f[3]) | bits(b.f[3])));
+	}
+
+	static SIMD_INLINE Vec4 Xor(Vec4 a, Vec4 b)
+	{
+		return Set(fromBits(bits(a.f[0]) ^ bits(b.f[0])), fromBits(bits(a.f[1]) ^ bits(b.f[1])),
+			fromBits(bits(a.f[2]) ^ bits(b.f[2])), fromBits(bits(a.f[3]) ^ bits(b.f[3])));
+	}
+
+	// Lanes of a where mask is set, lanes of b elsewhere
+	static SIMD_INLINE Vec4 Select(Vec4 mask, Vec4 a, Vec4 b)
+	{
+		return Set(bits(mask.f[0]) ? a.f[0] : b.f[0], bits(mask.f[1]) ? a.f[1] : b.f[1],
+			bits(mask.f[2]) ? a.f[2] : b.f[2], bits(mask.f[3]) ? a.f[3] : b.f[3]);
+	}
+
+	// Bit i is set if lane i of the mask is set
+	static SIMD_INLINE int MoveMask(Vec4 mask)
+	{
+		return (bits(mask.f[0]) ? 1 : 0) | (bits(mask.f[1]) ? 2 : 0) | (bits(mask.f[2]) ? 4 : 0) | (bits(mask.f[3]) ? 8 : 0);
+	}
+
+	// Dot product of x, y and z in every lane
+	static SIMD_INLINE Vec4 Dot3(Vec4 a, Vec4 b)
+	{
+		return Splat(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]);
+	}
+
+	// Dot product of all four lanes in every lane
+	static SIMD_INLINE Vec4 Dot4(Vec4 a, Vec4 b)
+	{
+		return Splat(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2] + a.f[3] * b.f[3]);
+	}
+
+	// Reorder the lanes, lane i of the result is lane I of v
+	template <int X, int Y, int Z, int W>
+	static SIMD_INLINE Vec4 Swizzle(Vec4 v)
+	{
+		return Set(v.f[X], v.f[Y], v.f[Z], v.f[W]);
+	}
+
+	static SIMD_INLINE void Transpose(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+	{
+		Vec4 t0 = Set(r0.f[0], r1.f[0], r2.f[0], r3.f[0]);
+		Vec4 t1 = Set(r0.f[1], r1.f[1], r2.f[1], r3.f[1]);
+		Vec4 t2 = Set(r0.f[2], r1.f[2], r2.f[2], r3.f[2]);
+		Vec4 t3 = Set(r0.f[3], r1.f[3], r2.f[3], r3.f[3]);
+		r0 = t0; r1 = t1; r2 = t2; r3 = t3;
+	}
+
+private:
+	static SIMD_INLINE unsigned int bits(float f)
+	{
+		unsigned int u;
+		memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	static SIMD_INLINE float fromBits(unsigned int u)
+	{
+		float f;
+		memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	static SIMD_INLINE float maskLane(bool set)
+	{
+		return fromBits(set ? 0xFFFFFFFFu : 0u);
+	}
+
+	static SIMD_INLINE float pow2(float n)
+	{
+		return fromBits((unsigned int) ((int) n + 127) << 23);
+	}
+
+	static SIMD_INLINE float exponent(float f)
+	{
+		return (float) ((int) ((bits(f) >> 23) & 0xFF) - 127);
+	}
+
+	static SIMD_INLINE float mantissa(float f)
+	{
+		return fromBits((bits(f) & 0x007FFFFFu) | 0x3F800000u);
+	}
+};
+
+#ifdef SIMD_HAS_SSE41
+// SSE4.1, the instruction set the engine was written for
+struct SIMDSSE41
+{
+	typedef __m128 Vec4;
+
+	static const int Width = 4;
+
+	static const char* Name()
+	{
+		return "SSE4.1";
+	}
+
+	static SIMD_INLINE Vec4 Set(float x, float y, float z, float w)
+	{
+		return _mm_setr_ps(x, y, z, w);
+	}
+
+	static SIMD_INLINE Vec4 Splat(float s)
+	{
+		return _mm_set_ps1(s);
+	}
+
+	static SIMD_INLINE Vec4 Load(const float* p)
+	{
+		return _mm_load_ps(p);
+	}
+
+	static SIMD_INLINE Vec4 LoadUnaligned(const float* p)
+	{
+		return _mm_loadu_ps(p);
+	}
+
+	static SIMD_INLINE void Store(float* p, Vec4 v)
+	{
+		_mm_store_ps(p, v);
+	}
+
+	static SIMD_INLINE void StoreUnaligned(float* p, Vec4 v)
+	{
+		_mm_storeu_ps(p, v);
+	}
+
+	static SIMD_INLINE float GetX(Vec4 v) { return _mm_cvtss_f32(v); }
+	static SIMD_INLINE float GetY(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+	static SIMD_INLINE float GetZ(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+	static SIMD_INLINE float GetW(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+	static SIMD_INLINE Vec4 SetX(Vec4 v, float s) { return _mm_insert_ps(v, _mm_set_ss(s), 0x00); }
+	static SIMD_INLINE Vec4 SetY(Vec4 v, float s) { return _mm_insert_ps(v, _mm_set_ss(s), 0x10); }
+	static SIMD_INLINE Vec4 SetZ(Vec4 v, float s) { return _mm_insert_ps(v, _mm_set_ss(s), 0x20); }
+	static SIMD_INLINE Vec4 SetW(Vec4 v, float s) { return _mm_insert_ps(v, _mm_set_ss(s), 0x30); }
+
+	static SIMD_INLINE Vec4 Add(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+	static SIMD_INLINE Vec4 Sub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+	static SIMD_INLINE Vec4 Mul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+	static SIMD_INLINE Vec4 Div(Vec4 a, Vec4 b) { return _mm_div_ps(a, b); }
+
+	static SIMD_INLINE Vec4 MulAdd(Vec4 a, Vec4 b, Vec4 c)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+	}
+
+	static SIMD_INLINE Vec4 Min(Vec4 a, Vec4 b) { return _mm_min_ps(a, b); }
+	static SIMD_INLINE Vec4 Max(Vec4 a, Vec4 b) { return _mm_max_ps(a, b); }
+	static SIMD_INLINE Vec4 Sqrt(Vec4 v) { return _mm_sqrt_ps(v); }
+	static SIMD_INLINE Vec4 Rsqrt(Vec4 v) { return _mm_rsqrt_ps(v); }
+	static SIMD_INLINE Vec4 Abs(Vec4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	static SIMD_INLINE Vec4 Round(Vec4 v) { return _mm_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+	static SIMD_INLINE Vec4 Pow2(Vec4 n)
+	{
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+	}
+
+	static SIMD_INLINE Vec4 Exponent(Vec4 v)
+	{
+		__m128i biased = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(v), 23), _mm_set1_epi32(0xFF));
+		return _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(127)));
+	}
+
+	static SIMD_INLINE Vec4 Mantissa(Vec4 v)
+	{
+		__m128i fraction = _mm_and_si128(_mm_castps_si128(v), _mm_set1_epi32(0x007FFFFF));
+		return _mm_castsi128_ps(_mm_or_si128(fraction, _mm_set1_epi32(0x3F800000)));
+	}
+
+	static SIMD_INLINE Vec4 CmpLT(Vec4 a, Vec4 b) { return _mm_cmplt_ps(a, b); }
+	static SIMD_INLINE Vec4 CmpLE(Vec4 a, Vec4 b) { return _mm_cmple_ps(a, b); }
+	static SIMD_INLINE Vec4 CmpGT(Vec4 a, Vec4 b) { return _mm_cmpgt_ps(a, b); }
+	static SIMD_INLINE Vec4 CmpGE(Vec4 a, Vec4 b) { return _mm_cmpge_ps(a, b); }
+	static SIMD_INLINE Vec4 CmpEQ(Vec4 a, Vec4 b) { return _mm_cmpeq_ps(a, b); }
+	static SIMD_INLINE Vec4 And(Vec4 a, Vec4 b) { return _mm_and_ps(a, b); }
+	static SIMD_INLINE Vec4 Or(Vec4 a, Vec4 b) { return _mm_or_ps(a, b); }
+	static SIMD_INLINE Vec4 Xor(Vec4 a, Vec4 b) { return _mm_xor_ps(a, b); }
+	static SIMD_INLINE Vec4 Select(Vec4 mask, Vec4 a, Vec4 b) { return _mm_blendv_ps(b, a, mask); }
+	static SIMD_INLINE int MoveMask(Vec4 mask) { return _mm_movemask_ps(mask); }
+
+	static SIMD_INLINE Vec4 Dot3(Vec4 a, Vec4 b)
+	{
+		return _mm_dp_ps(a, b, 0x7F);
+	}
+
+	static SIMD_INLINE Vec4 Dot4(Vec4 a, Vec4 b)
+	{
+		return _mm_dp_ps(a, b, 0xFF);
+	}
+
+	template <int X, int Y, int Z, int W>
+	static SIMD_INLINE Vec4 Swizzle(Vec4 v)
+	{
+		return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X));
+	}
+
+	static SIMD_INLINE void Transpose(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+	{
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	}
+};
+#endif
+
+#ifdef SIMD_HAS_AVX2
+// AVX2 with FMA, fused multiply-add on top of the SSE4.1 backend
+struct SIMDAVX2 : public SIMDSSE41
+{
+	static const char* Name()
+	{
+		return "AVX2";
+	}
+
+	static SIMD_INLINE Vec4 MulAdd(Vec4 a, Vec4 b, Vec4 c)
+	{
+		return _mm_fmadd_ps(a, b, c);
+	}
+};
+#endif
+
+#if defined(SIMD_BACKEND_AVX2)
+typedef SIMDAVX2 SIMDBackend;
+#elif defined(SIMD_BACKEND_SSE41)
+typedef SIMDSSE41 SIMDBackend;
+#else
+typedef SIMDScalar SIMDBackend;
+#endif
+
+// 8 lanes as two vectors of a 4 lane backend
+template <typename B>
+struct SIMDPair
+{
+	struct Vec8
+	{
+		typename B::Vec4 lo;
+		typename B::Vec4 hi;
+	};
+
+	static const int Width = 8;
+
+	static const char* Name()
+	{
+		return B::Name();
+	}
+
+	static SIMD_INLINE Vec8 Combine(typename B::Vec4 lo, typename B::Vec4 hi)
+	{
+		Vec8 v = { lo, hi };
+		return v;
+	}
+
+	static SIMD_INLINE Vec8 Splat(float s)
+	{
+		return Combine(B::Splat(s), B::Splat(s));
+	}
+
+	static SIMD_INLINE typename B::Vec4 Low(Vec8 v)
+	{
+		return v.lo;
+	}
+
+	static SIMD_INLINE typename B::Vec4 High(Vec8 v)
+	{
+		return v.hi;
+	}
+
+	// p must be 32-byte aligned
+	static SIMD_INLINE Vec8 Load(const float* p)
+	{
+		return Combine(B::Load(p), B::Load(p + 4));
+	}
+
+	static SIMD_INLINE Vec8 LoadUnaligned(const float* p)
+	{
+		return Combine(B::LoadUnaligned(p), B::LoadUnaligned(p + 4));
+	}
+
+	// p must be 32-byte aligned
+	static SIMD_INLINE void Store(float* p, Vec8 v)
+	{
+		B::Store(p, v.lo);
+		B::Store(p + 4, v.hi);
+	}
+
+	static SIMD_INLINE void StoreUnaligned(float* p, Vec8 v)
+	{
+		B::StoreUnaligned(p, v.lo);
+		B::StoreUnaligned(p + 4, v.hi);
+	}
+
+	static SIMD_INLINE Vec8 Add(Vec8 a, Vec8 b) { return Combine(B::Add(a.lo, b.lo), B::Add(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Sub(Vec8 a, Vec8 b) { return Combine(B::Sub(a.lo, b.lo), B::Sub(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Mul(Vec8 a, Vec8 b) { return Combine(B::Mul(a.lo, b.lo), B::Mul(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Div(Vec8 a, Vec8 b) { return Combine(B::Div(a.lo, b.lo), B::Div(a.hi, b.hi)); }
+
+	static SIMD_INLINE Vec8 MulAdd(Vec8 a, Vec8 b, Vec8 c)
+	{
+		return Combine(B::MulAdd(a.lo, b.lo, c.lo), B::MulAdd(a.hi, b.hi, c.hi));
+	}
+
+	static SIMD_INLINE Vec8 Min(Vec8 a, Vec8 b) { return Combine(B::Min(a.lo, b.lo), B::Min(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Max(Vec8 a, Vec8 b) { return Combine(B::Max(a.lo, b.lo), B::Max(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Sqrt(Vec8 v) { return Combine(B::Sqrt(v.lo), B::Sqrt(v.hi)); }
+	static SIMD_INLINE Vec8 Rsqrt(Vec8 v) { return Combine(B::Rsqrt(v.lo), B::Rsqrt(v.hi)); }
+	static SIMD_INLINE Vec8 Abs(Vec8 v) { return Combine(B::Abs(v.lo), B::Abs(v.hi)); }
+	static SIMD_INLINE Vec8 Round(Vec8 v) { return Combine(B::Round(v.lo), B::Round(v.hi)); }
+	static SIMD_INLINE Vec8 Pow2(Vec8 n) { return Combine(B::Pow2(n.lo), B::Pow2(n.hi)); }
+	static SIMD_INLINE Vec8 Exponent(Vec8 v) { return Combine(B::Exponent(v.lo), B::Exponent(v.hi)); }
+	static SIMD_INLINE Vec8 Mantissa(Vec8 v) { return Combine(B::Mantissa(v.lo), B::Mantissa(v.hi)); }
+
+	static SIMD_INLINE Vec8 CmpLT(Vec8 a, Vec8 b) { return Combine(B::CmpLT(a.lo, b.lo), B::CmpLT(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 CmpLE(Vec8 a, Vec8 b) { return Combine(B::CmpLE(a.lo, b.lo), B::CmpLE(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 CmpGT(Vec8 a, Vec8 b) { return Combine(B::CmpGT(a.lo, b.lo), B::CmpGT(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 CmpGE(Vec8 a, Vec8 b) { return Combine(B::CmpGE(a.lo, b.lo), B::CmpGE(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 CmpEQ(Vec8 a, Vec8 b) { return Combine(B::CmpEQ(a.lo, b.lo), B::CmpEQ(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 And(Vec8 a, Vec8 b) { return Combine(B::And(a.lo, b.lo), B::And(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Or(Vec8 a, Vec8 b) { return Combine(B::Or(a.lo, b.lo), B::Or(a.hi, b.hi)); }
+	static SIMD_INLINE Vec8 Xor(Vec8 a, Vec8 b) { return Combine(B::Xor(a.lo, b.lo), B::Xor(a.hi, b.hi)); }
+
+	static SIMD_INLINE Vec8 Select(Vec8 mask, Vec8 a, Vec8 b)
+	{
+		return Combine(B::Select(mask.lo, a.lo, b.lo), B::Select(mask.hi, a.hi, b.hi));
+	}
+
+	static SIMD_INLINE int MoveMask(Vec8 mask)
+	{
+		return B::MoveMask(mask.lo) | (B::MoveMask(mask.hi) << 4);
+	}
+
+	// Reorder the lanes within each half
+	template <int X, int Y, int Z, int W>
+	static SIMD_INLINE Vec8 Swizzle(Vec8 v)
+	{
+		return Combine(B::template Swizzle<X, Y, Z, W>(v.lo), B::template Swizzle<X, Y, Z, W>(v.hi));
+	}
+};
+
+#ifdef SIMD_HAS_AVX2
+// 8 lanes in one AVX register
+struct SIMDAVX2x8
+{
+	typedef __m256 Vec8;
+
+	static const int Width = 8;
+
+	static const char* Name()
+	{
+		return "AVX2";
+	}
+
+	static SIMD_INLINE Vec8 Combine(__m128 lo, __m128 hi)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+
+	static SIMD_INLINE Vec8 Splat(float s)
+	{
+		return _mm256_set1_ps(s);
+	}
+
+	static SIMD_INLINE __m128 Low(Vec8 v)
+	{
+		return _mm256_castps256_ps128(v);
+	}
+
+	static SIMD_INLINE __m128 High(Vec8 v)
+	{
+		return _mm256_extractf128_ps(v, 1);
+	}
+
+	static SIMD_INLINE Vec8 Load(const float* p)
+	{
+		return _mm256_load_ps(p);
+	}
+
+	static SIMD_INLINE Vec8 LoadUnaligned(const float* p)
+	{
+		return _mm256_loadu_ps(p);
+	}
+
+	static SIMD_INLINE void Store(float* p, Vec8 v)
+	{
+		_mm256_store_ps(p, v);
+	}
+
+	static SIMD_INLINE void StoreUnaligned(float* p, Vec8 v)
+	{
+		_mm256_storeu_ps(p, v);
+	}
+
+	static SIMD_INLINE Vec8 Add(Vec8 a, Vec8 b) { return _mm256_add_ps(a, b); }
+	static SIMD_INLINE Vec8 Sub(Vec8 a, Vec8 b) { return _mm256_sub_ps(a, b); }
+	static SIMD_INLINE Vec8 Mul(Vec8 a, Vec8 b) { return _mm256_mul_ps(a, b); }
+	static SIMD_INLINE Vec8 Div(Vec8 a, Vec8 b) { return _mm256_div_ps(a, b); }
+
+	static SIMD_INLINE Vec8 MulAdd(Vec8 a, Vec8 b, Vec8 c)
+	{
+		return _mm256_fmadd_ps(a, b, c);
+	}
+
+	static SIMD_INLINE Vec8 Min(Vec8 a, Vec8 b) { return _mm256_min_ps(a, b); }
+	static SIMD_INLINE Vec8 Max(Vec8 a, Vec8 b) { return _mm256_max_ps(a, b); }
+	static SIMD_INLINE Vec8 Sqrt(Vec8 v) { return _mm256_sqrt_ps(v); }
+	static SIMD_INLINE Vec8 Rsqrt(Vec8 v) { return _mm256_rsqrt_ps(v); }
+	static SIMD_INLINE Vec8 Abs(Vec8 v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+	static SIMD_INLINE Vec8 Round(Vec8 v) { return _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+	static SIMD_INLINE Vec8 Pow2(Vec8 n)
+	{
+		return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+	}
+
+	static SIMD_INLINE Vec8 Exponent(Vec8 v)
+	{
+		__m256i biased = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(v), 23), _mm256_set1_epi32(0xFF));
+		return _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)));
+	}
+
+	static SIMD_INLINE Vec8 Mantissa(Vec8 v)
+	{
+		__m256i fraction = _mm256_and_si256(_mm256_castps_si256(v), _mm256_set1_epi32(0x007FFFFF));
+		return _mm256_castsi256_ps(_mm256_or_si256(fraction, _mm256_set1_epi32(0x3F800000)));
+	}
+
+	static SIMD_INLINE Vec8 CmpLT(Vec8 a, Vec8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static SIMD_INLINE Vec8 CmpLE(Vec8 a, Vec8 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static SIMD_INLINE Vec8 CmpGT(Vec8 a, Vec8 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static SIMD_INLINE Vec8 CmpGE(Vec8 a, Vec8 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static SIMD_INLINE Vec8 CmpEQ(Vec8 a, Vec8 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static SIMD_INLINE Vec8 And(Vec8 a, Vec8 b) { return _mm256_and_ps(a, b); }
+	static SIMD_INLINE Vec8 Or(Vec8 a, Vec8 b) { return _mm256_or_ps(a, b); }
+	static SIMD_INLINE Vec8 Xor(Vec8 a, Vec8 b) { return _mm256_xor_ps(a, b); }
+	static SIMD_INLINE Vec8 Select(Vec8 mask, Vec8 a, Vec8 b) { return _mm256_blendv_ps(b, a, mask); }
+	static SIMD_INLINE int MoveMask(Vec8 mask) { return _mm256_movemask_ps(mask); }
+
+	template <int X, int Y, int Z, int W>
+	static SIMD_INLINE Vec8 Swizzle(Vec8 v)
+	{
+		return _mm256_permute_ps(v, _MM_SHUFFLE(W, Z, Y, X));
+	}
+};
+#endif
+
+#if defined(SIMD_BACKEND_AVX2)
+typedef SIMDAVX2x8 SIMDBackend8;
+#else
+typedef SIMDPair<SIMDBackend> SIMDBackend8;
+#endif
@@ -0,0 +1,355 @@
+#include "simdbounds.h"
+#include "simdwide.h"
+
+namespace
+{
+	typedef SIMDBackend8 B;
+
+	const int Width = SIMDBackend8::Width;
+
+	inline const SIMDVector3& pointAt(const SIMDVector3* points, size_t stride, size_t i)
+	{
+		return *(const SIMDVector3*) ((const char*) points + i * stride);
+	}
+
+	// Load a batch of points from first, past the end the last point is repeated
+	inline SIMDVector3x8 loadPoints(const SIMDVector3* points, size_t stride, size_t first, size_t count)
+	{
+		if (first + Width <= count)
+			return SIMDVector3x8::Gather(&pointAt(points, stride, first), stride);
+
+		SIMD_ALIGN(32) float x[Width];
+		SIMD_ALIGN(32) float y[Width];
+		SIMD_ALIGN(32) float z[Width];
+		for (int i = 0; i < Width; ++i)
+		{
+			const SIMDVector3& point = pointAt(points, stride, first + i < count ? first + i : count - 1);
+			x[i] = point.GetX();
+			y[i] = point.GetY();
+			z[i] = point.GetZ();
+		}
+		return SIMDVector3x8::Load(x, y, z);
+	}
+
+	// 1 for the lanes of a batch that hold a point, 0 for the repeats
+	inline SIMDVec8 batchWeights(size_t first, size_t count)
+	{
+		SIMD_ALIGN(32) float weights[Width];
+		for (int i = 0; i < Width; ++i)
+		{
+			weights[i] = first + i < count ? 1.0f : 0.0f;
+		}
+		return B::Load(weights);
+	}
+
+	inline SIMDVec8 laneIndices(size_t first)
+	{
+		SIMD_ALIGN(32) float indices[Width];
+		for (int i = 0; i < Width; ++i)
+		{
+			indices[i] = (float) (first + i);
+		}
+		return B::Load(indices);
+	}
+
+	inline float minLane(SIMDVec8 v)
+	{
+		SIMD_ALIGN(32) float lanes[Width];
+		B::Store(lanes, v);
+		float result = lanes[0];
+		for (int i = 1; i < Width; ++i)
+		{
+			result = lanes[i] < result ? lanes[i] : result;
+		}
+		return result;
+	}
+
+	inline float maxLane(SIMDVec8 v)
+	{
+		SIMD_ALIGN(32) float lanes[Width];
+		B::Store(lanes, v);
+		float result = lanes[0];
+		for (int i = 1; i < Width; ++i)
+		{
+			result = lanes[i] > result ? lanes[i] : result;
+		}
+		return result;
+	}
+
+	inline float sumLanes(SIMDVec8 v)
+	{
+		SIMD_ALIGN(32) float lanes[Width];
+		B::Store(lanes, v);
+		float result = 0.0f;
+		for (int i = 0; i < Width; ++i)
+		{
+			result += lanes[i];
+		}
+		return result;
+	}
+
+	inline float distance(const SIMDVector3& a, const SIMDVector3& b)
+	{
+		SIMDVector3 d = a - b;
+		return sqrtf(d.Dot(d));
+	}
+
+	// The point farthest from a point, the first of them if several are equally far
+	size_t farthestPoint(const SIMDVector3* points, size_t stride, size_t count, const SIMDVector3& from)
+	{
+		SIMDVector3x8 origin(from);
+		SIMDVec8 farthest = B::Splat(-1.0f);
+		SIMDVec8 farthestIndex = B::Splat(0.0f);
+		for (size_t first = 0; first < count; first += Width)
+		{
+			SIMDVec8 distanceSquared = (loadPoints(points, stride, first, count) - origin).LengthSquared();
+			SIMDVec8 farther = B::CmpGT(distanceSquared, farthest);
+			farthest = B::Select(farther, distanceSquared, farthest);
+			farthestIndex = B::Select(farther, laneIndices(first), farthestIndex);
+		}
+
+		SIMD_ALIGN(32) float distances[Width];
+		SIMD_ALIGN(32) float indices[Width];
+		B::Store(distances, farthest);
+		B::Store(indices, farthestIndex);
+		int best = 0;
+		for (int i = 1; i < Width; ++i)
+		{
+			if (distances[i] > distances[best] || (distances[i] == distances[best] && indices[i] < indices[best]))
+				best = i;
+		}
+		return (size_t) indices[best];
+	}
+
+	// Grow the sphere to take in every point, visiting the batches from the one at start
+	void growSphere(const SIMDVector3* points, size_t stride, size_t count, size_t start, SIMDVector3& center, float& radius)
+	{
+		size_t batches = (count + Width - 1) / Width;
+		for (size_t batch = 0; batch < batches; ++batch)
+		{
+			size_t first = ((start + batch) % batches) * Width;
+			SIMDVec8 distanceSquared = (loadPoints(points, stride, first, count) - SIMDVector3x8(center)).LengthSquared();
+			int outside = B::MoveMask(B::CmpGT(distanceSquared, B::Splat(radius * radius)));
+			// The sphere moves as it grows, so the points outside are checked again one at a time
+			for (int i = 0; outside; ++i, outside >>= 1)
+			{
+				if (!(outside & 1) || first + i >= count)
+					continue;
+				const SIMDVector3& point = pointAt(points, stride, first + i);
+				float d = distance(point, center);
+				if (d > radius)
+				{
+					float grownRadius = (radius + d) * 0.5f;
+					SIMDVector3 offset = point - center;
+					offset.Multiply((grownRadius - radius) / d);
+					center += offset;
+					radius = grownRadius;
+				}
+			}
+		}
+	}
+
+	// Eigenvectors of a symmetric 3x3 matrix by Jacobi rotations, returned as the columns of v
+	void jacobiEigenvectors(float a[3][3], float v[3][3])
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				v[i][j] = i == j ? 1.0f : 0.0f;
+			}
+		}
+
+		for (int sweep = 0; sweep < 16; ++sweep)
+		{
+			// Zero the largest off-diagonal element
+			int p = 0, q = 1;
+			if (fabsf(a[0][2]) > fabsf(a[p][q]))
+			{
+				p = 0; q = 2;
+			}
+			if (fabsf(a[1][2]) > fabsf(a[p][q]))
+			{
+				p = 1; q = 2;
+			}
+			if (fabsf(a[p][q]) <= 1e-9f * (fabsf(a[p][p]) + fabsf(a[q][q])) + 1e-30f)
+				break;
+
+			float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+			float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+			float c = 1.0f / sqrtf(t * t + 1.0f);
+			float s = t * c;
+			for (int k = 0; k < 3; ++k)
+			{
+				float akp = a[k][p], akq = a[k][q];
+				a[k][p] = c * akp - s * akq;
+				a[k][q] = s * akp + c * akq;
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				float apk = a[p][k], aqk = a[q][k];
+				a[p][k] = c * apk - s * aqk;
+				a[q][k] = s * apk + c * aqk;
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				float vkp = v[k][p], vkq = v[k][q];
+				v[k][p] = c * vkp - s * vkq;
+				v[k][q] = s * vkp + c * vkq;
+			}
+		}
+	}
+
+	inline SIMDVector3 exactNormalize(const SIMDVector3& v)
+	{
+		float invLength = 1.0f / sqrtf(v.Dot(v));
+		return SIMDVector3(v.GetX() * invLength, v.GetY() * invLength, v.GetZ() * invLength, 0.0f);
+	}
+}
+
+void ComputeAABB(const SIMDVector3* points, size_t stride, size_t count, SIMDVector3& min, SIMDVector3& max)
+{
+	if (count == 0)
+	{
+		min = SIMDVector3(0.0f, 0.0f, 0.0f);
+		max = SIMDVector3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	SIMDVector3x8 lower = loadPoints(points, stride, 0, count);
+	SIMDVector3x8 upper = lower;
+	for (size_t first = Width; first < count; first += Width)
+	{
+		SIMDVector3x8 batch = loadPoints(points, stride, first, count);
+		lower = Min(lower, batch);
+		upper = Max(upper, batch);
+	}
+	min = SIMDVector3(minLane(lower.GetX()), minLane(lower.GetY()), minLane(lower.GetZ()));
+	max = SIMDVector3(maxLane(upper.GetX()), maxLane(upper.GetY()), maxLane(upper.GetZ()));
+}
+
+void ComputeBoundingSphere(const SIMDVector3* points, size_t stride, size_t count, SIMDVector3& center, float& radius)
+{
+	center = SIMDVector3(0.0f, 0.0f, 0.0f);
+	radius = 0.0f;
+	if (count == 0)
+		return;
+
+	// Start from two points far apart, the farthest from the first point and the farthest from that
+	size_t a = farthestPoint(points, stride, count, pointAt(points, stride, 0));
+	size_t b = farthestPoint(points, stride, count, pointAt(points, stride, a));
+	center = (pointAt(points, stride, a) + pointAt(points, stride, b)) * 0.5f;
+	radius = distance(pointAt(points, stride, a), center);
+	growSphere(points, stride, count, 0, center, radius);
+
+	// Shrinking the sphere and growing it from other points often finds a smaller one
+	const int iterations = 8;
+	size_t batches = (count + Width - 1) / Width;
+	SIMDVector3 trialCenter = center;
+	float trialRadius = radius;
+	for (int k = 1; k <= iterations; ++k)
+	{
+		trialRadius *= 0.95f;
+		growSphere(points, stride, count, k * batches / (iterations + 1), trialCenter, trialRadius);
+		if (trialRadius < radius)
+		{
+			center = trialCenter;
+			radius = trialRadius;
+		}
+	}
+
+	// The radius to the farthest point, so rounding in the growth steps cannot leave a point outside
+	radius = distance(pointAt(points, stride, farthestPoint(points, stride, count, center)), center);
+	center = SIMDVector3(center.GetX(), center.GetY(), center.GetZ());
+}
+
+void ComputeOrientedBox(const SIMDVector3* points, size_t stride, size_t count,
+	SIMDVector3& center, SIMDVector3 axes[3], SIMDVector3& halfExtents)
+{
+	SIMDVector3 min, max;
+	ComputeAABB(points, stride, count, min, max);
+	axes[0] = SIMDVector3(1.0f, 0.0f, 0.0f, 0.0f);
+	axes[1] = SIMDVector3(0.0f, 1.0f, 0.0f, 0.0f);
+	axes[2] = SIMDVector3(0.0f, 0.0f, 1.0f, 0.0f);
+	center = SIMDVector3((min.GetX() + max.GetX()) * 0.5f, (min.GetY() + max.GetY()) * 0.5f, (min.GetZ() + max.GetZ()) * 0.5f);
+	halfExtents = SIMDVector3((max.GetX() - min.GetX()) * 0.5f, (max.GetY() - min.GetY()) * 0.5f,
+		(max.GetZ() - min.GetZ()) * 0.5f, 0.0f);
+	if (count < 3)
+		return;
+
+	// Mean, then the covariance of the points about it
+	SIMDVector3x8 sum(0.0f, 0.0f, 0.0f);
+	for (size_t first = 0; first < count; first += Width)
+	{
+		SIMDVector3x8 batch = loadPoints(points, stride, first, count);
+		sum += batch * batchWeights(first, count);
+	}
+	float invCount = 1.0f / (float) count;
+	SIMDVector3x8 mean(sumLanes(sum.GetX()) * invCount, sumLanes(sum.GetY()) * invCount, sumLanes(sum.GetZ()) * invCount);
+
+	SIMDVec8 xx = B::Splat(0.0f), xy = xx, xz = xx, yy = xx, yz = xx, zz = xx;
+	for (size_t first = 0; first < count; first += Width)
+	{
+		SIMDVector3x8 d = (loadPoints(points, stride, first, count) - mean) * batchWeights(first, count);
+		xx = B::MulAdd(d.GetX(), d.GetX(), xx);
+		xy = B::MulAdd(d.GetX(), d.GetY(), xy);
+		xz = B::MulAdd(d.GetX(), d.GetZ(), xz);
+		yy = B::MulAdd(d.GetY(), d.GetY(), yy);
+		yz = B::MulAdd(d.GetY(), d.GetZ(), yz);
+		zz = B::MulAdd(d.GetZ(), d.GetZ(), zz);
+	}
+	float covariance[3][3] = {
+		{ sumLanes(xx), sumLanes(xy), sumLanes(xz) },
+		{ sumLanes(xy), sumLanes(yy), sumLanes(yz) },
+		{ sumLanes(xz), sumLanes(yz), sumLanes(zz) }
+	};
+	float eigenvectors[3][3];
+	jacobiEigenvectors(covariance, eigenvectors);
+
+	// A right-handed orthonormal basis from the eigenvectors
+	SIMDVector3 principal[3];
+	principal[0] = exactNormalize(SIMDVector3(eigenvectors[0][0], eigenvectors[1][0], eigenvectors[2][0], 0.0f));
+	principal[1] = SIMDVector3(eigenvectors[0][1], eigenvectors[1][1], eigenvectors[2][1], 0.0f);
+	principal[1] = exactNormalize(principal[1] - principal[0] * principal[0].Dot(principal[1]));
+	principal[2] = exactNormalize(CrossProduct(principal[0], principal[1]));
+
+	// The extents along the axes
+	SIMDVector3x8 axis[3] = { SIMDVector3x8(principal[0]), SIMDVector3x8(principal[1]), SIMDVector3x8(principal[2]) };
+	SIMDVec8 lower[3], upper[3];
+	for (size_t first = 0; first < count; first += Width)
+	{
+		SIMDVector3x8 batch = loadPoints(points, stride, first, count);
+		for (int i = 0; i < 3; ++i)
+		{
+			SIMDVec8 projection = batch.Dot(axis[i]);
+			lower[i] = first ? B::Min(lower[i], projection) : projection;
+			upper[i] = first ? B::Max(upper[i], projection) : projection;
+		}
+	}
+
+	float boxMin[3], boxMax[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		boxMin[i] = minLane(lower[i]);
+		boxMax[i] = maxLane(upper[i]);
+	}
+	float boxVolume = (boxMax[0] - boxMin[0]) * (boxMax[1] - boxMin[1]) * (boxMax[2] - boxMin[2]);
+	float aabbVolume = 8.0f * halfExtents.GetX() * halfExtents.GetY() * halfExtents.GetZ();
+	if (boxVolume >= aabbVolume)
+		return;
+
+	center = SIMDVector3(0.0f, 0.0f, 0.0f, 1.0f);
+	for (int i = 0; i < 3; ++i)
+	{
+		axes[i] = principal[i];
+		center += principal[i] * ((boxMin[i] + boxMax[i]) * 0.5f);
+	}
+	halfExtents = SIMDVector3((boxMax[0] - boxMin[0]) * 0.5f, (boxMax[1] - boxMin[1]) * 0.5f, (boxMax[2] - boxMin[2]) * 0.5f, 0.0f);
+}
+
+void ComputeBounds(const SIMDVector3* points, size_t stride, size_t count, SIMDBounds& bounds)
+{
+	ComputeAABB(points, stride, count, bounds.m_min, bounds.m_max);
+	ComputeBoundingSphere(points, stride, count, bounds.m_center, bounds.m_radius);
+	ComputeOrientedBox(points, stride, count, bounds.m_boxCenter, bounds.m_boxAxes, bounds.m_boxHalfExtents);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/** Bounding volumes of point sets such as the positions of a vertex buffer, 8 points at a time */
+// Points are given as SIMDVector3 members of structures, strides are in bytes,
+// e.g. ComputeAABB(&v[0].m_pos, sizeof(Vertex1P1UV), count, min, max)
+// Meant for load time, each volume takes a few passes over the points
+
+#include <stddef.h>
+#include "simdmath.h"
+
+// Every bounding volume of a mesh, in the space of its vertices
+struct SIMDBounds
+{
+	// Axis-aligned box
+	SIMDVector3							m_min;
+	SIMDVector3							m_max;
+
+	// Sphere
+	SIMDVector3							m_center;
+	float								m_radius;
+
+	// Oriented box, the axes are orthonormal and the half extents are along them
+	SIMDVector3							m_boxCenter;
+	SIMDVector3							m_boxAxes[3];
+	SIMDVector3							m_boxHalfExtents;
+};
+
+// Smallest axis-aligned box of the points
+void ComputeAABB(const SIMDVector3* points, size_t stride, size_t count, SIMDVector3& min, SIMDVector3& max);
+
+// Sphere around the points by Ritter's method, then shrunk and regrown a few times
+// Usually within a few percent of the smallest sphere, the points must be fewer than 2^24
+void ComputeBoundingSphere(const SIMDVector3* points, size_t stride, size_t count, SIMDVector3& center, float& radius);
+
+// Box along the principal axes of the points, or the axis-aligned box if that is smaller
+void ComputeOrientedBox(const SIMDVector3* points, size_t stride, size_t count,
+	SIMDVector3& center, SIMDVector3 axes[3], SIMDVector3& halfExtents);
+
+// All of the above, an empty set of points gives volumes of zero size at the origin
+void ComputeBounds(const SIMDVector3* points, size_t stride, size_t count, SIMDBounds& bounds);
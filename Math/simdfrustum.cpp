@@ -0,0 +1,180 @@
+#include "simdfrustum.h"
+#include <float.h>
+
+namespace
+{
+	enum Row
+	{
+		ROW_A,
+		ROW_B,
+		ROW_C,
+		ROW_D,
+		ROW_ABS_A,
+		ROW_ABS_B,
+		ROW_ABS_C
+	};
+
+	// Signed distances of the centers from one plane
+	template <typename Backend>
+	SIMD_INLINE typename SIMDVector3xN<Backend>::Lanes planeDistance(const float planes[7][8], int plane,
+		const SIMDVector3xN<Backend>& centers)
+	{
+		typename SIMDVector3xN<Backend>::Lanes distance = Backend::MulAdd(centers.GetX(), Backend::Splat(planes[ROW_A][plane]),
+			Backend::Splat(planes[ROW_D][plane]));
+		distance = Backend::MulAdd(centers.GetY(), Backend::Splat(planes[ROW_B][plane]), distance);
+		return Backend::MulAdd(centers.GetZ(), Backend::Splat(planes[ROW_C][plane]), distance);
+	}
+
+	// The radius of a box of half extents e along the normal of one plane
+	template <typename Backend>
+	SIMD_INLINE typename SIMDVector3xN<Backend>::Lanes projectedRadius(const float planes[7][8], int plane,
+		const SIMDVector3xN<Backend>& extents)
+	{
+		typename SIMDVector3xN<Backend>::Lanes radius = Backend::Mul(extents.GetX(), Backend::Splat(planes[ROW_ABS_A][plane]));
+		radius = Backend::MulAdd(extents.GetY(), Backend::Splat(planes[ROW_ABS_B][plane]), radius);
+		return Backend::MulAdd(extents.GetZ(), Backend::Splat(planes[ROW_ABS_C][plane]), radius);
+	}
+
+	// A volume is outside if it is wholly behind any plane and inside if it is in front of all of them
+	template <typename Backend>
+	int testSpheres(const float planes[7][8], const SIMDVector3xN<Backend>& centers,
+		typename SIMDVector3xN<Backend>::Lanes radii, int* insideMask)
+	{
+		typedef typename SIMDVector3xN<Backend>::Lanes Lanes;
+
+		Lanes negatedRadii = Backend::Sub(Backend::Splat(0.0f), radii);
+		Lanes distance = planeDistance<Backend>(planes, 0, centers);
+		Lanes visible = Backend::CmpGE(distance, negatedRadii);
+		Lanes inside = Backend::CmpGE(distance, radii);
+		for (int i = 1; i < SIMDFrustum::PLANE_COUNT; ++i)
+		{
+			distance = planeDistance<Backend>(planes, i, centers);
+			visible = Backend::And(visible, Backend::CmpGE(distance, negatedRadii));
+			inside = Backend::And(inside, Backend::CmpGE(distance, radii));
+		}
+
+		if (insideMask)
+			*insideMask = Backend::MoveMask(inside);
+		return Backend::MoveMask(visible);
+	}
+
+	template <typename Backend>
+	int testAABBs(const float planes[7][8], const SIMDVector3xN<Backend>& mins, const SIMDVector3xN<Backend>& maxs,
+		int* insideMask)
+	{
+		typedef typename SIMDVector3xN<Backend>::Lanes Lanes;
+
+		SIMDVector3xN<Backend> centers = (mins + maxs) * 0.5f;
+		SIMDVector3xN<Backend> extents = (maxs - mins) * 0.5f;
+		Lanes visible = Backend::CmpEQ(Backend::Splat(0.0f), Backend::Splat(0.0f));
+		Lanes inside = visible;
+		for (int i = 0; i < SIMDFrustum::PLANE_COUNT; ++i)
+		{
+			Lanes distance = planeDistance<Backend>(planes, i, centers);
+			Lanes radius = projectedRadius<Backend>(planes, i, extents);
+			visible = Backend::And(visible, Backend::CmpGE(distance, Backend::Sub(Backend::Splat(0.0f), radius)));
+			inside = Backend::And(inside, Backend::CmpGE(distance, radius));
+		}
+
+		if (insideMask)
+			*insideMask = Backend::MoveMask(inside);
+		return Backend::MoveMask(visible);
+	}
+
+	// The planes are the lanes, every lane has to pass for INSIDE
+	SIMDFrustum::Containment classify(const float planes[7][8], const SIMDVector3& center, SIMDVec8 radius)
+	{
+		typedef SIMDBackend8 Backend;
+
+		SIMDVec8 distance = Backend::MulAdd(Backend::Load(planes[ROW_A]), Backend::Splat(center.GetX()), Backend::Load(planes[ROW_D]));
+		distance = Backend::MulAdd(Backend::Load(planes[ROW_B]), Backend::Splat(center.GetY()), distance);
+		distance = Backend::MulAdd(Backend::Load(planes[ROW_C]), Backend::Splat(center.GetZ()), distance);
+
+		if (Backend::MoveMask(Backend::CmpLT(distance, Backend::Sub(Backend::Splat(0.0f), radius))))
+			return SIMDFrustum::OUTSIDE;
+		if (Backend::MoveMask(Backend::CmpGE(distance, radius)) == (1 << Backend::Width) - 1)
+			return SIMDFrustum::INSIDE;
+		return SIMDFrustum::INTERSECT;
+	}
+}
+
+// Gribb and Hartmann, each plane is the w row plus or minus another row of the matrix
+void SIMDFrustum::Extract(const SIMDMatrix4& viewProjection)
+{
+	float m[4][4];
+	viewProjection.Get(m);
+
+	// The near plane is z >= 0 on its own, not z >= -w
+	const int row[PLANE_COUNT] = { 0, 0, 1, 1, 2, 2 };
+	const float sign[PLANE_COUNT] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+	const float w[PLANE_COUNT] = { 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+	for (int i = 0; i < PLANE_COUNT; ++i)
+	{
+		float plane[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			plane[j] = w[i] * m[3][j] + sign[i] * m[row[i]][j];
+		}
+
+		float invLength = 1.0f / sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (int j = 0; j < 4; ++j)
+		{
+			_planes[j][i] = plane[j] * invLength;
+		}
+		for (int j = 0; j < 3; ++j)
+		{
+			_planes[ROW_ABS_A + j][i] = fabsf(_planes[j][i]);
+		}
+	}
+
+	for (int i = PLANE_COUNT; i < 8; ++i)
+	{
+		for (int j = 0; j < 7; ++j)
+		{
+			_planes[j][i] = 0.0f;
+		}
+		_planes[ROW_D][i] = FLT_MAX;
+	}
+}
+
+SIMDVector3 SIMDFrustum::GetPlane(Plane plane) const
+{
+	return SIMDVector3(_planes[ROW_A][plane], _planes[ROW_B][plane], _planes[ROW_C][plane], _planes[ROW_D][plane]);
+}
+
+SIMDFrustum::Containment SIMDFrustum::ClassifySphere(const SIMDVector3& center, float radius) const
+{
+	return classify(_planes, center, SIMDBackend8::Splat(radius));
+}
+
+SIMDFrustum::Containment SIMDFrustum::ClassifyAABB(const SIMDVector3& min, const SIMDVector3& max) const
+{
+	typedef SIMDBackend8 Backend;
+
+	SIMDVector3 center = (min + max) * 0.5f;
+	SIMDVector3 extent = (max - min) * 0.5f;
+	SIMDVec8 radius = Backend::Mul(Backend::Load(_planes[ROW_ABS_A]), Backend::Splat(extent.GetX()));
+	radius = Backend::MulAdd(Backend::Load(_planes[ROW_ABS_B]), Backend::Splat(extent.GetY()), radius);
+	radius = Backend::MulAdd(Backend::Load(_planes[ROW_ABS_C]), Backend::Splat(extent.GetZ()), radius);
+	return classify(_planes, center, radius);
+}
+
+int SIMDFrustum::TestSpheres(const SIMDVector3x4& centers, SIMDVec4 radii, int* insideMask) const
+{
+	return testSpheres<SIMDBackend>(_planes, centers, radii, insideMask);
+}
+
+int SIMDFrustum::TestSpheres(const SIMDVector3x8& centers, SIMDVec8 radii, int* insideMask) const
+{
+	return testSpheres<SIMDBackend8>(_planes, centers, radii, insideMask);
+}
+
+int SIMDFrustum::TestAABBs(const SIMDVector3x4& mins, const SIMDVector3x4& maxs, int* insideMask) const
+{
+	return testAABBs<SIMDBackend>(_planes, mins, maxs, insideMask);
+}
+
+int SIMDFrustum::TestAABBs(const SIMDVector3x8& mins, const SIMDVector3x8& maxs, int* insideMask) const
+{
+	return testAABBs<SIMDBackend8>(_planes, mins, maxs, insideMask);
+}
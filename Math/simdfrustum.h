@@ -0,0 +1,63 @@
+#pragma once
+
+/** View frustum as six planes, for culling spheres and AABBs 4 or 8 at a time */
+
+#include "simdwide.h"
+
+// The planes are stored as structure of arrays, the a, b, c and d of every plane in one row
+// A point p is on the inner side of a plane when a * x + b * y + c * z + d >= 0
+class SIMD_ALIGN(32) SIMDFrustum
+{
+public:
+	enum Containment
+	{
+		OUTSIDE,
+		INTERSECT,
+		INSIDE
+	};
+
+	enum Plane
+	{
+		LEFT,
+		RIGHT,
+		BOTTOM,
+		TOP,
+		NEAR_PLANE,
+		FAR_PLANE,
+		PLANE_COUNT
+	};
+
+	// Default constructor
+	inline SIMDFrustum(){};
+
+	// Construct from a view-projection matrix
+	inline explicit SIMDFrustum(const SIMDMatrix4& viewProjection)
+	{
+		Extract(viewProjection);
+	}
+
+	// Extract the planes of a view-projection matrix such as CreatePerspectiveFOV times getViewMatrix
+	// Clip space z is in [0, w] as in Direct3D, the planes are in the space the matrix transforms from
+	void Extract(const SIMDMatrix4& viewProjection);
+
+	// Return a plane as (a, b, c, d) with (a, b, c) normalized
+	SIMDVector3 GetPlane(Plane plane) const;
+
+	// Classify one sphere or AABB, the six planes are tested at once
+	// INTERSECT is conservative, a volume near an edge of the frustum may be outside it
+	Containment ClassifySphere(const SIMDVector3& center, float radius) const;
+	Containment ClassifyAABB(const SIMDVector3& min, const SIMDVector3& max) const;
+
+	// Test 4 or 8 spheres, return a mask with bit i set if sphere i is at least partly inside
+	// insideMask, if not null, is set to a mask of the spheres fully inside, for skipping the tests of their children
+	int TestSpheres(const SIMDVector3x4& centers, SIMDVec4 radii, int* insideMask = NULL) const;
+	int TestSpheres(const SIMDVector3x8& centers, SIMDVec8 radii, int* insideMask = NULL) const;
+
+	// Test 4 or 8 AABBs given by their corners, the result is as for TestSpheres
+	int TestAABBs(const SIMDVector3x4& mins, const SIMDVector3x4& maxs, int* insideMask = NULL) const;
+	int TestAABBs(const SIMDVector3x8& mins, const SIMDVector3x8& maxs, int* insideMask = NULL) const;
+
+private:
+	// Rows a, b, c and d then |a|, |b| and |c|, lanes past PLANE_COUNT are planes every point is inside
+	SIMD_ALIGN(32) float _planes[7][8];
+};
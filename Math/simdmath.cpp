@@ -18,31 +18,36 @@ const SIMDVector3 SIMDVector3::NegativeUnitX(-1.0f, 0.0f, 0.0f);
 const SIMDVector3 SIMDVector3::NegativeUnitY(0.0f, -1.0f, 0.0f);
 const SIMDVector3 SIMDVector3::NegativeUnitZ(0.0f, 0.0f, -1.0f);
 
+// Quaternion constant declaration
+const SIMDQuaternion SIMDQuaternion::Identity(0.0f, 0.0f, 0.0f, 1.0f);
+
 // Matrix4 methods
 void SIMDMatrix4::CreateTranslation(const SIMDVector3& translation)
 {
-	_rows[0] = _mm_setr_ps(1.0f, 0.0f, 0.0f, translation.GetX());
-	_rows[1] = _mm_setr_ps(0.0f, 1.0f, 0.0f, translation.GetY());
-	_rows[2] = _mm_setr_ps(0.0f, 0.0f, 1.0f, translation.GetZ());
-	_rows[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	_rows[0] = SIMDBackend::Set(1.0f, 0.0f, 0.0f, translation.GetX());
+	_rows[1] = SIMDBackend::Set(0.0f, 1.0f, 0.0f, translation.GetY());
+	_rows[2] = SIMDBackend::Set(0.0f, 0.0f, 1.0f, translation.GetZ());
+	_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
+// Left-handed look-at, the transpose of XMMatrixLookAtLH for column vectors
 void SIMDMatrix4::CreateLookAt(const SIMDVector3& vEye, const SIMDVector3& vAt, const SIMDVector3& vUp)
 {
-	SIMDVector3 x = vEye;
-	SIMDVector3 y = vAt;
-	SIMDVector3 z = vUp;
-	__m128 temp = _mm_set_ss(0.0f); //
-	x._data = _mm_insert_ps(x._data, temp, 0x30); //
-	y._data = _mm_insert_ps(y._data, temp, 0x30); //
-	z._data = _mm_insert_ps(z._data, temp, 0x30); //
+	SIMDVec4 eye = SIMDBackend::SetW(vEye._data, 0.0f);
+	SIMDVec4 at = SIMDBackend::SetW(vAt._data, 0.0f);
+	SIMDVec4 up = SIMDBackend::SetW(vUp._data, 0.0f);
+
+	// The view basis is normalized exactly, the approximate Normalize would skew the view
+	SIMDVector3 zAxis(SIMDBackend::Sub(at, eye));
+	zAxis._data = SIMDBackend::Div(zAxis._data, SIMDBackend::Sqrt(SIMDBackend::Dot3(zAxis._data, zAxis._data)));
+	SIMDVector3 xAxis = CrossProduct(SIMDVector3(up), zAxis);
+	xAxis._data = SIMDBackend::Div(xAxis._data, SIMDBackend::Sqrt(SIMDBackend::Dot3(xAxis._data, xAxis._data)));
+	SIMDVector3 yAxis = CrossProduct(zAxis, xAxis);
 
-	DirectX::XMMATRIX result = DirectX::XMMatrixLookAtLH(x._data, y._data, z._data);
-	_rows[0] = result.r[0];
-	_rows[1] = result.r[1];
-	_rows[2] = result.r[2];
-	_rows[3] = result.r[3];
-	_MM_TRANSPOSE4_PS(_rows[0], _rows[1], _rows[2], _rows[3]);
+	_rows[0] = SIMDBackend::SetW(xAxis._data, -xAxis.Dot(SIMDVector3(eye)));
+	_rows[1] = SIMDBackend::SetW(yAxis._data, -yAxis.Dot(SIMDVector3(eye)));
+	_rows[2] = SIMDBackend::SetW(zAxis._data, -zAxis.Dot(SIMDVector3(eye)));
+	_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
 void SIMDMatrix4::CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fNear, float fFar)
@@ -50,8 +55,135 @@ void SIMDMatrix4::CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fN
 	float fYScale = tanf(1.57079633f - (fFOVy / 2)); // cot(x) is the same as tan(pi/2 - x)
 	float fXScale = fYScale / fAspectRatio;
 
-	_rows[0] = _mm_setr_ps(fXScale, 0.0f, 0.0f, 0.0f);
-	_rows[1] = _mm_setr_ps(0.0f, fYScale, 0.0f, 0.0f);
-	_rows[2] = _mm_setr_ps(0.0f, 0.0f, fFar / (fFar - fNear), -fNear*fFar / (fFar - fNear));
-	_rows[3] = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
-}
\ No newline at end of file
+	_rows[0] = SIMDBackend::Set(fXScale, 0.0f, 0.0f, 0.0f);
+	_rows[1] = SIMDBackend::Set(0.0f, fYScale, 0.0f, 0.0f);
+	_rows[2] = SIMDBackend::Set(0.0f, 0.0f, fFar / (fFar - fNear), -fNear*fFar / (fFar - fNear));
+	_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 1.0f, 0.0f);
+}
+// Column-vector rotation matrix of q, the diagonal and the sums and differences of the products off it
+void SIMDMatrix4::CreateRotationFromQuaternion(const SIMDQuaternion& q)
+{
+	SIMDVec4 q2 = SIMDBackend::Add(q._data, q._data);
+	SIMDVec4 squares = SIMDBackend::Mul(q._data, q2); // 2xx, 2yy, 2zz
+	SIMDVec4 diagonal = SIMDBackend::Sub(SIMDBackend::Splat(1.0f),
+		SIMDBackend::Add(SIMDBackend::Swizzle<1, 0, 0, 3>(squares), SIMDBackend::Swizzle<2, 2, 1, 3>(squares)));
+	SIMDVec4 products = SIMDBackend::Mul(SIMDBackend::Swizzle<0, 0, 1, 3>(q._data), SIMDBackend::Swizzle<1, 2, 2, 3>(q2)); // 2xy, 2xz, 2yz
+	SIMDVec4 wProducts = SIMDBackend::Mul(SIMDBackend::Swizzle<3, 3, 3, 3>(q._data), SIMDBackend::Swizzle<2, 1, 0, 3>(q2)); // 2wz, 2wy, 2wx
+	SIMDVec4 sums = SIMDBackend::Add(products, wProducts);
+	SIMDVec4 differences = SIMDBackend::Sub(products, wProducts);
+
+	_rows[0] = SIMDBackend::Set(SIMDBackend::GetX(diagonal), SIMDBackend::GetX(differences), SIMDBackend::GetY(sums), 0.0f);
+	_rows[1] = SIMDBackend::Set(SIMDBackend::GetX(sums), SIMDBackend::GetY(diagonal), SIMDBackend::GetZ(differences), 0.0f);
+	_rows[2] = SIMDBackend::Set(SIMDBackend::GetY(differences), SIMDBackend::GetZ(sums), SIMDBackend::GetZ(diagonal), 0.0f);
+	_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// Adjugate from the 2x2 minors of the top and bottom halves, divided by the determinant
+bool SIMDMatrix4::Invert()
+{
+	float m[4][4];
+	Get(m);
+
+	float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+	float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+	float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (fabsf(det) < 1e-20f)
+		return false;
+	float invDet = 1.0f / det;
+
+	float inv[4][4];
+	inv[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * invDet;
+	inv[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * invDet;
+	inv[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * invDet;
+	inv[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * invDet;
+
+	inv[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * invDet;
+	inv[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * invDet;
+	inv[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * invDet;
+	inv[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * invDet;
+
+	inv[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * invDet;
+	inv[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * invDet;
+	inv[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * invDet;
+	inv[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * invDet;
+
+	inv[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * invDet;
+	inv[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * invDet;
+	inv[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * invDet;
+	inv[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * invDet;
+
+	Set(inv);
+	return true;
+}
+
+// Quaternion methods
+// Shepperd's method, the largest of w, x, y and z is found from the trace first to keep the square root well conditioned
+void SIMDQuaternion::CreateFromMatrix(const SIMDMatrix4& mat)
+{
+	float m[4][4];
+	mat.Get(m);
+
+	float trace = m[0][0] + m[1][1] + m[2][2];
+	if (trace > 0.0f)
+	{
+		float s = 0.5f / sqrtf(trace + 1.0f);
+		_data = SIMDBackend::Set((m[2][1] - m[1][2]) * s, (m[0][2] - m[2][0]) * s, (m[1][0] - m[0][1]) * s, 0.25f / s);
+	}
+	else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+	{
+		float s = 0.5f / sqrtf(1.0f + m[0][0] - m[1][1] - m[2][2]);
+		_data = SIMDBackend::Set(0.25f / s, (m[0][1] + m[1][0]) * s, (m[0][2] + m[2][0]) * s, (m[2][1] - m[1][2]) * s);
+	}
+	else if (m[1][1] > m[2][2])
+	{
+		float s = 0.5f / sqrtf(1.0f + m[1][1] - m[0][0] - m[2][2]);
+		_data = SIMDBackend::Set((m[0][1] + m[1][0]) * s, 0.25f / s, (m[1][2] + m[2][1]) * s, (m[0][2] - m[2][0]) * s);
+	}
+	else
+	{
+		float s = 0.5f / sqrtf(1.0f + m[2][2] - m[0][0] - m[1][1]);
+		_data = SIMDBackend::Set((m[0][2] + m[2][0]) * s, (m[1][2] + m[2][1]) * s, 0.25f / s, (m[1][0] - m[0][1]) * s);
+	}
+}
+
+SIMDQuaternion Nlerp(const SIMDQuaternion& a, const SIMDQuaternion& b, float t)
+{
+	// q and -q are the same rotation, flip b onto the shorter arc
+	float weightB = a.Dot(b) < 0.0f ? -t : t;
+	SIMDVec4 result = SIMDBackend::MulAdd(b._data, SIMDBackend::Splat(weightB), SIMDBackend::Mul(a._data, SIMDBackend::Splat(1.0f - t)));
+	SIMDQuaternion q;
+	q._data = SIMDBackend::Div(result, SIMDBackend::Sqrt(SIMDBackend::Dot4(result, result)));
+	return q;
+}
+
+SIMDQuaternion Slerp(const SIMDQuaternion& a, const SIMDQuaternion& b, float t)
+{
+	float cosTheta = a.Dot(b);
+	float sign = cosTheta < 0.0f ? -1.0f : 1.0f;
+	cosTheta *= sign;
+
+	// Nearly parallel, sin(theta) is too small to divide by and the arc is a line
+	if (cosTheta > 0.9995f)
+		return Nlerp(a, b, t);
+
+	float theta = acosf(cosTheta);
+	float invSinTheta = 1.0f / sinf(theta);
+	float weightA = sinf((1.0f - t) * theta) * invSinTheta;
+	float weightB = sinf(t * theta) * invSinTheta * sign;
+
+	SIMDQuaternion q;
+	q._data = SIMDBackend::MulAdd(b._data, SIMDBackend::Splat(weightB), SIMDBackend::Mul(a._data, SIMDBackend::Splat(weightA)));
+	return q;
+}
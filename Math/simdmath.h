@@ -1,23 +1,27 @@
 #pragma once
 
-/** Maths Libraray, defining vector, matrix and quaternion, with Intel SSE4.1 extensions and MSVC++ */
+/** Maths Libraray, defining vector, matrix and quaternion, on top of the SIMD backend selected in simdbackend.h */
 
-#include <xmmintrin.h> // intrinics
-#include <smmintrin.h> // intrinics
 #include <math.h> // sin cos
-#include <DirectXMath.h> // DirectX helper methods
-#include "..\Memory\MemoryManager.h"
+#include "simdbackend.h"
+#include "../Memory/MemoryManager.h"
 
 #define PI 3.1415926535f
 
+typedef SIMDBackend::Vec4 SIMDVec4;
+
+class SIMDVector3;
+class SIMDQuaternion;
+
 // 4x4 Matrix with SIMD
-__declspec(align(16)) class SIMDMatrix4
+class SIMD_ALIGN(16) SIMDMatrix4
 {
 private:
-	__m128 _rows[4];
+	SIMDVec4 _rows[4];
 	// row-major matrix
 public:
 	friend class SIMDVector3;
+	friend class SIMDAffine;
 
 	static const SIMDMatrix4 Identity;
 
@@ -27,14 +31,11 @@ public:
 	// Construct with given value
 	inline SIMDMatrix4(float other[4][4])
 	{
-		_rows[0] = _mm_setr_ps(other[0][0], other[0][1], other[0][2], other[0][3]);
-		_rows[1] = _mm_setr_ps(other[1][0], other[1][1], other[1][2], other[1][3]);
-		_rows[2] = _mm_setr_ps(other[2][0], other[2][1], other[2][2], other[2][3]);
-		_rows[3] = _mm_setr_ps(other[3][0], other[3][1], other[3][2], other[3][3]);
+		Set(other);
 	}
 
-	// Construct with given m128 data
-	inline SIMDMatrix4(__m128 data[4])
+	// Construct with given SIMD rows
+	inline SIMDMatrix4(SIMDVec4 data[4])
 	{
 		_rows[0] = data[0];
 		_rows[1] = data[1];
@@ -45,26 +46,26 @@ public:
 	// Set the translation
 	inline void setTranslate(const float& x, const float& y, const float& z)
 	{
-		_rows[0].m128_f32[3] = x;
-		_rows[1].m128_f32[3] = y;
-		_rows[2].m128_f32[3] = z;
+		_rows[0] = SIMDBackend::SetW(_rows[0], x);
+		_rows[1] = SIMDBackend::SetW(_rows[1], y);
+		_rows[2] = SIMDBackend::SetW(_rows[2], z);
 	}
 
 
 	// get translate vector x, y, z
 	inline float getTranslateX() const
 	{
-		return _rows[0].m128_f32[3];
+		return SIMDBackend::GetW(_rows[0]);
 	}
 
 	inline float getTranslateY() const
 	{
-		return _rows[1].m128_f32[3];
+		return SIMDBackend::GetW(_rows[1]);
 	}
 
 	inline float getTranslateZ() const
 	{
-		return _rows[2].m128_f32[3];
+		return SIMDBackend::GetW(_rows[2]);
 	}
 
 	// Copy constructor
@@ -89,145 +90,98 @@ public:
 	// Set data values
 	inline void Set(float other[4][4])
 	{
-		_rows[0] = _mm_setr_ps(other[0][0], other[0][1], other[0][2], other[0][3]);
-		_rows[1] = _mm_setr_ps(other[1][0], other[1][1], other[1][2], other[1][3]);
-		_rows[2] = _mm_setr_ps(other[2][0], other[2][1], other[2][2], other[2][3]);
-		_rows[3] = _mm_setr_ps(other[3][0], other[3][1], other[3][2], other[3][3]);
+		_rows[0] = SIMDBackend::Set(other[0][0], other[0][1], other[0][2], other[0][3]);
+		_rows[1] = SIMDBackend::Set(other[1][0], other[1][1], other[1][2], other[1][3]);
+		_rows[2] = SIMDBackend::Set(other[2][0], other[2][1], other[2][2], other[2][3]);
+		_rows[3] = SIMDBackend::Set(other[3][0], other[3][1], other[3][2], other[3][3]);
+	}
+
+	// Get data values
+	inline void Get(float other[4][4]) const
+	{
+		SIMDBackend::StoreUnaligned(other[0], _rows[0]);
+		SIMDBackend::StoreUnaligned(other[1], _rows[1]);
+		SIMDBackend::StoreUnaligned(other[2], _rows[2]);
+		SIMDBackend::StoreUnaligned(other[3], _rows[3]);
 	}
 
 	// Add another matrix to the matrix, store the result back to this
 	inline void Add(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_add_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_add_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_add_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_add_ps(_rows[3], other._rows[3]);
+		_rows[0] = SIMDBackend::Add(_rows[0], other._rows[0]);
+		_rows[1] = SIMDBackend::Add(_rows[1], other._rows[1]);
+		_rows[2] = SIMDBackend::Add(_rows[2], other._rows[2]);
+		_rows[3] = SIMDBackend::Add(_rows[3], other._rows[3]);
 	}
 
 	// Overload + operator
 	inline SIMDMatrix4& operator+(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_add_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_add_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_add_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_add_ps(_rows[3], other._rows[3]);
+		Add(other);
 		return *this;
 	}
 
 	// Overload += operator
 	inline void operator+=(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_add_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_add_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_add_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_add_ps(_rows[3], other._rows[3]);
+		Add(other);
 	}
 
 	// Subtract the matrix by another matrix, store the result back to this
 	inline void Sub(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_sub_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_sub_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_sub_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_sub_ps(_rows[3], other._rows[3]);
+		_rows[0] = SIMDBackend::Sub(_rows[0], other._rows[0]);
+		_rows[1] = SIMDBackend::Sub(_rows[1], other._rows[1]);
+		_rows[2] = SIMDBackend::Sub(_rows[2], other._rows[2]);
+		_rows[3] = SIMDBackend::Sub(_rows[3], other._rows[3]);
 	}
 
 	// Overload - operator
 	inline SIMDMatrix4& operator-(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_sub_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_sub_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_sub_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_sub_ps(_rows[3], other._rows[3]);
+		Sub(other);
 		return *this;
 	}
 
 	// Overload -= operator
 	inline void operator-=(SIMDMatrix4& other)
 	{
-		_rows[0] = _mm_sub_ps(_rows[0], other._rows[0]);
-		_rows[1] = _mm_sub_ps(_rows[1], other._rows[1]);
-		_rows[2] = _mm_sub_ps(_rows[2], other._rows[2]);
-		_rows[3] = _mm_sub_ps(_rows[3], other._rows[3]);
+		Sub(other);
 	}
 
 	// Multiply by another matrix, store the result back to this
+	// Each row of the result is the rows of mat weighted by the elements of the row of this
 	inline void Multiply(const SIMDMatrix4& mat)
 	{
-		__m128 mat_rows0 = mat._rows[0];
-		__m128 mat_rows1 = mat._rows[1];
-		__m128 mat_rows2 = mat._rows[2];
-		__m128 mat_rows3 = mat._rows[3];
-		_MM_TRANSPOSE4_PS(mat_rows0, mat_rows1, mat_rows2, mat_rows3);
-
 		for (int i = 0; i < 4; ++i)
 		{
-			__m128 x = _mm_dp_ps(_rows[i], mat_rows0, 0xF1);
-			__m128 y = _mm_dp_ps(_rows[i], mat_rows1, 0xF2);
-			__m128 z = _mm_dp_ps(_rows[i], mat_rows2, 0xF4);
-			__m128 w = _mm_dp_ps(_rows[i], mat_rows3, 0xF8);
-
-			_rows[i] = _mm_add_ps(x, y);
-			_rows[i] = _mm_add_ps(_rows[i], z);
-			_rows[i] = _mm_add_ps(_rows[i], w);
+			SIMDVec4 row = SIMDBackend::Mul(SIMDBackend::Swizzle<0, 0, 0, 0>(_rows[i]), mat._rows[0]);
+			row = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(_rows[i]), mat._rows[1], row);
+			row = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(_rows[i]), mat._rows[2], row);
+			_rows[i] = SIMDBackend::MulAdd(SIMDBackend::Swizzle<3, 3, 3, 3>(_rows[i]), mat._rows[3], row);
 		}
 	}
 
 	// Overload * operator
 	inline SIMDMatrix4& operator*(const SIMDMatrix4& mat)
 	{
-		__m128 mat_rows0 = mat._rows[0];
-		__m128 mat_rows1 = mat._rows[1];
-		__m128 mat_rows2 = mat._rows[2];
-		__m128 mat_rows3 = mat._rows[3];
-		_MM_TRANSPOSE4_PS(mat_rows0, mat_rows1, mat_rows2, mat_rows3);
-
-		for (int i = 0; i < 4; ++i)
-		{
-			__m128 x = _mm_dp_ps(_rows[i], mat_rows0, 0xF1);
-			__m128 y = _mm_dp_ps(_rows[i], mat_rows1, 0xF2);
-			__m128 z = _mm_dp_ps(_rows[i], mat_rows2, 0xF4);
-			__m128 w = _mm_dp_ps(_rows[i], mat_rows3, 0xF8);
-
-			_rows[i] = _mm_add_ps(x, y);
-			_rows[i] = _mm_add_ps(_rows[i], z);
-			_rows[i] = _mm_add_ps(_rows[i], w);
-		}
+		Multiply(mat);
 		return *this;
 	}
 
 	// Overload *= operator
 	inline void operator*=(const SIMDMatrix4& mat)
 	{
-		__m128 mat_rows0 = mat._rows[0];
-		__m128 mat_rows1 = mat._rows[1];
-		__m128 mat_rows2 = mat._rows[2];
-		__m128 mat_rows3 = mat._rows[3];
-		_MM_TRANSPOSE4_PS(mat_rows0, mat_rows1, mat_rows2, mat_rows3);
-
-		for (int i = 0; i < 4; ++i)
-		{
-			__m128 x = _mm_dp_ps(_rows[i], mat_rows0, 0xF1);
-			__m128 y = _mm_dp_ps(_rows[i], mat_rows1, 0xF2);
-			__m128 z = _mm_dp_ps(_rows[i], mat_rows2, 0xF4);
-			__m128 w = _mm_dp_ps(_rows[i], mat_rows3, 0xF8);
-
-			_rows[i] = _mm_add_ps(x, y);
-			_rows[i] = _mm_add_ps(_rows[i], z);
-			_rows[i] = _mm_add_ps(_rows[i], w);
-		}
+		Multiply(mat);
 	}
 
 	// Set a scale transformation given a uniform scale
 	inline void CreateScale(float scalar)
 	{
-		__m128 scale = _mm_set_ps1(scalar);
-
-		_rows[0] = _mm_insert_ps(_rows[0], scale, 0x0E);
-		_rows[1] = _mm_insert_ps(_rows[1], scale, 0x5D);
-		_rows[2] = _mm_insert_ps(_rows[2], scale, 0xAB);
-		_rows[3] = _mm_set_ps1(1.0f);
-		_rows[3] = _mm_insert_ps(_rows[3], _rows[3], 0x07);
+		_rows[0] = SIMDBackend::Set(scalar, 0.0f, 0.0f, 0.0f);
+		_rows[1] = SIMDBackend::Set(0.0f, scalar, 0.0f, 0.0f);
+		_rows[2] = SIMDBackend::Set(0.0f, 0.0f, scalar, 0.0f);
+		_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 
 	// Set a rotation transformation about the X axis given an angle in radian
@@ -236,12 +190,10 @@ public:
 		float cosTheta = cosf(radian);
 		float sinTheta = sinf(radian);
 
-		_rows[0] = _mm_set_ps1(1.0f);
-		_rows[0] = _mm_insert_ps(_rows[0], _rows[0], 0x0E);
-		_rows[1] = _mm_setr_ps(0.0f, cosTheta, -sinTheta, 0.0f);
-		_rows[2] = _mm_setr_ps(0.0f, sinTheta, cosTheta, 0.0f);
-		_rows[3] = _mm_set_ps1(1.0f);
-		_rows[3] = _mm_insert_ps(_rows[3], _rows[3], 0x07);
+		_rows[0] = SIMDBackend::Set(1.0f, 0.0f, 0.0f, 0.0f);
+		_rows[1] = SIMDBackend::Set(0.0f, cosTheta, -sinTheta, 0.0f);
+		_rows[2] = SIMDBackend::Set(0.0f, sinTheta, cosTheta, 0.0f);
+		_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 
 	// Set a rotation transformation about the Y axis given an angle in radian
@@ -250,12 +202,10 @@ public:
 		float cosTheta = cosf(radian);
 		float sinTheta = sinf(radian);
 
-		_rows[0] = _mm_setr_ps(cosTheta, 0.0f, sinTheta, 0.0f);
-		_rows[1] = _mm_set_ps1(1.0f);
-		_rows[1] = _mm_insert_ps(_rows[1], _rows[1], 0x0D);
-		_rows[2] = _mm_setr_ps(-sinTheta, 0.0f, cosTheta, 0.0f);
-		_rows[3] = _mm_set_ps1(1.0f);
-		_rows[3] = _mm_insert_ps(_rows[3], _rows[3], 0x07);
+		_rows[0] = SIMDBackend::Set(cosTheta, 0.0f, sinTheta, 0.0f);
+		_rows[1] = SIMDBackend::Set(0.0f, 1.0f, 0.0f, 0.0f);
+		_rows[2] = SIMDBackend::Set(-sinTheta, 0.0f, cosTheta, 0.0f);
+		_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 
 	// Set a rotation transformation about the Z axis given an angle in radian
@@ -264,30 +214,24 @@ public:
 		float cosTheta = cosf(radian);
 		float sinTheta = sinf(radian);
 
-		_rows[0] = _mm_setr_ps(cosTheta, -sinTheta, 0.0f, 0.0f);
-		_rows[1] = _mm_setr_ps(sinTheta, cosTheta, 0.0f, 0.0f);
-		_rows[2] = _mm_set_ps1(1.0f);
-		_rows[2] = _mm_insert_ps(_rows[2], _rows[2], 0x0B);
-		_rows[3] = _mm_set_ps1(1.0f);
-		_rows[3] = _mm_insert_ps(_rows[3], _rows[3], 0x07);
+		_rows[0] = SIMDBackend::Set(cosTheta, -sinTheta, 0.0f, 0.0f);
+		_rows[1] = SIMDBackend::Set(sinTheta, cosTheta, 0.0f, 0.0f);
+		_rows[2] = SIMDBackend::Set(0.0f, 0.0f, 1.0f, 0.0f);
+		_rows[3] = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 
 	// Interpolate between two matrices with float t, return the resultant matrix
 	// i.e. result = a * (1 - t) + b * t
 	inline friend SIMDMatrix4 Lerp(const SIMDMatrix4& a, const SIMDMatrix4& b, float t)
 	{
-		__m128 resultRows[4];
-		__m128 oneMinusT = _mm_set_ps1(1.0f - t);
-		__m128 oneT = _mm_set_ps1(t);
+		SIMDVec4 resultRows[4];
+		SIMDVec4 oneMinusT = SIMDBackend::Splat(1.0f - t);
+		SIMDVec4 oneT = SIMDBackend::Splat(t);
 
-		resultRows[0] = _mm_mul_ps(a._rows[0], oneMinusT);
-		resultRows[0] = _mm_add_ps(resultRows[0], _mm_mul_ps(b._rows[0], oneT));
-		resultRows[1] = _mm_mul_ps(a._rows[1], oneMinusT);
-		resultRows[1] = _mm_add_ps(resultRows[1], _mm_mul_ps(b._rows[1], oneT));
-		resultRows[2] = _mm_mul_ps(a._rows[2], oneMinusT);
-		resultRows[2] = _mm_add_ps(resultRows[2], _mm_mul_ps(b._rows[2], oneT));
-		resultRows[3] = _mm_mul_ps(a._rows[3], oneMinusT);
-		resultRows[3] = _mm_add_ps(resultRows[3], _mm_mul_ps(b._rows[3], oneT));
+		for (int i = 0; i < 4; ++i)
+		{
+			resultRows[i] = SIMDBackend::MulAdd(b._rows[i], oneT, SIMDBackend::Mul(a._rows[i], oneMinusT));
+		}
 
 		return SIMDMatrix4(resultRows);
 	}
@@ -295,8 +239,8 @@ public:
 	// Set a translation transformation given a vector
 	void CreateTranslation(const SIMDVector3& translation);
 
-	// Set a rotation transformation given a quaternion
-	// void CreateRotationFromQuaternion(const SIMDQuaternion& q);
+	// Set a rotation transformation given a unit quaternion
+	void CreateRotationFromQuaternion(const SIMDQuaternion& q);
 
 	// Set a look-at matrix
 	// vUp MUST be normalized or bad things will happen
@@ -306,22 +250,22 @@ public:
 	void CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fNear, float fFar);
 
 	// Inverts the matrix, store the result back to this
-	void Invert();
+	// Return false and leave the matrix unchanged if it is singular
+	bool Invert();
 };
 
 // 3D Vector with SIMD
-__declspec(align(16)) class SIMDVector3
+class SIMD_ALIGN(16) SIMDVector3
 {
 private:
-	__m128 _data;
-	// _data.m128_f32[0] = x
-	// _data.m128_f32[1] = y
-	// _data.m128_f32[2] = z
-	// _data.m128_f32[3] = w
+	SIMDVec4 _data;
+	// lanes are x, y, z, w
 	// row-vector
 public:
 	friend class SIMDMatrix4;
 	friend class SIMDQuaternion;
+	friend class SIMDAffine;
+	friend class SIMDTransform;
 
 	static const SIMDVector3 Zero;
 	static const SIMDVector3 UnitX;
@@ -346,11 +290,11 @@ public:
 	// Construct with given float values
 	inline SIMDVector3(float x, float y, float z, float w = 1.0f)
 	{
-		_data = _mm_setr_ps(x, y, z, w);
+		_data = SIMDBackend::Set(x, y, z, w);
 	};
 
-	// Construct with given m128 data
-	inline SIMDVector3(__m128 value)
+	// Construct with given SIMD data
+	inline SIMDVector3(SIMDVec4 value)
 	{
 		_data = value;
 	}
@@ -371,230 +315,189 @@ public:
 	// Set data values
 	inline void Set(float x, float y, float z)
 	{
-		_data = _mm_setr_ps(x, y, z, 1.0f);
+		_data = SIMDBackend::Set(x, y, z, 1.0f);
 	}
 
 	inline void SetX(float x)
 	{
-		__m128 temp = _mm_set_ss(x);
-		_data = _mm_insert_ps(_data, temp, 0x00);
+		_data = SIMDBackend::SetX(_data, x);
 	}
 
 	inline void SetY(float y)
 	{
-		__m128 temp = _mm_set_ss(y);
-		_data = _mm_insert_ps(_data, temp, 0x10);
+		_data = SIMDBackend::SetY(_data, y);
 	}
 
 	inline void SetZ(float z)
 	{
-		__m128 temp = _mm_set_ss(z);
-		_data = _mm_insert_ps(_data, temp, 0x20);
+		_data = SIMDBackend::SetZ(_data, z);
 	}
 
 	inline float GetX() const
 	{
-		return _data.m128_f32[0];
+		return SIMDBackend::GetX(_data);
 	}
 
 	inline float GetY() const
 	{
-		return _data.m128_f32[1];
+		return SIMDBackend::GetY(_data);
 	}
 
 	inline float GetZ() const
 	{
-		return _data.m128_f32[2];
+		return SIMDBackend::GetZ(_data);
 	}
 
 	inline float GetW() const
 	{
-		return _data.m128_f32[3];
+		return SIMDBackend::GetW(_data);
 	}
 
 	// Dot product, return a float
-	inline float Dot(const SIMDVector3& other)
+	inline float Dot(const SIMDVector3& other) const
 	{
-		__m128 temp = _mm_dp_ps(_data, other._data, 0x78);
-		return	temp.m128_f32[3];
+		return SIMDBackend::GetX(SIMDBackend::Dot3(_data, other._data));
 	}
 
 	// Add two vector, store result back to this
 	inline void Add(const SIMDVector3& other)
 	{
-		_data = _mm_add_ps(_data, other._data);
+		_data = SIMDBackend::Add(_data, other._data);
 	}
 
 	// Overload + operator
-	inline SIMDVector3 operator+(const SIMDVector3& other)
+	inline SIMDVector3 operator+(const SIMDVector3& other) const
 	{
-		SIMDVector3 result(_data);
-		result._data = _mm_add_ps(_data, other._data);
-		return result;
+		return SIMDVector3(SIMDBackend::Add(_data, other._data));
 	}
 
 	// Overload += operator
 	inline void operator+=(const SIMDVector3& other)
 	{
-		_data = _mm_add_ps(_data, other._data);
+		_data = SIMDBackend::Add(_data, other._data);
 	}
 
 	// Substract the other vector from this, store result back to this
 	inline void Substract(const SIMDVector3& other)
 	{
-		_data = _mm_sub_ps(_data, other._data);
+		_data = SIMDBackend::Sub(_data, other._data);
 	}
 
 	// Overload - operator
-	inline SIMDVector3 operator-(const SIMDVector3& other)
+	inline SIMDVector3 operator-(const SIMDVector3& other) const
 	{
-		SIMDVector3 result(_data);
-		result._data = _mm_sub_ps(_data, other._data);
-		return result;
+		return SIMDVector3(SIMDBackend::Sub(_data, other._data));
 	}
 
 	// Overload -= operator
 	inline void operator-=(const SIMDVector3& other)
 	{
-		_data = _mm_sub_ps(_data, other._data);
+		_data = SIMDBackend::Sub(_data, other._data);
 	}
 
 	// Multiple the vector by a scalar, stire result back to this
 	inline void Multiply(float scalar)
 	{
-		__m128 temp = _mm_set_ps1(scalar);
-		_data = _mm_mul_ps(_data, temp);
+		_data = SIMDBackend::Mul(_data, SIMDBackend::Splat(scalar));
 	}
 
 	// Overload * operator
-	inline SIMDVector3 operator*(float scalar)
+	inline SIMDVector3 operator*(float scalar) const
 	{
-		SIMDVector3 result(_data);
-		__m128 slr = _mm_set_ps1(scalar);
-		result._data = _mm_mul_ps(_data, slr);
-		return result;
+		return SIMDVector3(SIMDBackend::Mul(_data, SIMDBackend::Splat(scalar)));
 	}
 
-	// Normalize the vector, store result back to this
-	/*
-	inline void Normalize()
-	{
-		__m128 length = _mm_dp_ps(_data, _data, 0x77);
-		length = _mm_rsqrt_ps(length);
-		_data = _mm_mul_ps(_data, length);
-	}
-	*/
-
+	// Normalize the vector with the approximate reciprocal square root, store result back to this
+	// w is left unchanged
 	inline SIMDVector3& Normalize()
 	{
-		__m128 length = _mm_dp_ps(_data, _data, 0x77);
-		length = _mm_rsqrt_ps(length);
-		_data = _mm_mul_ps(_data, length);
+		SIMDVec4 length = SIMDBackend::Rsqrt(SIMDBackend::Dot3(_data, _data));
+		_data = SIMDBackend::Mul(_data, SIMDBackend::SetW(length, 1.0f));
 		return *this;
 	}
 
 	// Return the square of the length of vector
 	inline float LengthSquared() const
 	{
-		__m128 length = _mm_dp_ps(_data, _data, 0x78);
-		return length.m128_f32[3];
+		return SIMDBackend::GetX(SIMDBackend::Dot3(_data, _data));
 	}
 
 	// Return the length of vector
 	inline float Length() const
 	{
-		__m128 length = _mm_dp_ps(_data, _data, 0x78);
-		return sqrtf(length.m128_f32[3]);
+		return sqrtf(LengthSquared());
 	}
 
 	// Return the cross product as SIMDVector3 of two vectors
 	inline friend SIMDVector3 CrossProduct(const SIMDVector3& a, const SIMDVector3& b)
 	{
-		__m128 te = _mm_shuffle_ps(a._data, a._data, _MM_SHUFFLE(3, 0, 2, 1));
-		__m128 result = _mm_mul_ps(_mm_shuffle_ps(a._data, a._data, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b. _data, b._data, _MM_SHUFFLE(3, 1, 0, 2)));
-		__m128 temp = _mm_mul_ps(_mm_shuffle_ps(a._data, a._data, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b._data, b._data, _MM_SHUFFLE(3, 0, 2, 1)));
-		result = _mm_sub_ps(result, temp);
-		return SIMDVector3(result);
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<1, 2, 0, 3>(a._data), SIMDBackend::Swizzle<2, 0, 1, 3>(b._data));
+		SIMDVec4 temp = SIMDBackend::Mul(SIMDBackend::Swizzle<2, 0, 1, 3>(a._data), SIMDBackend::Swizzle<1, 2, 0, 3>(b._data));
+		return SIMDVector3(SIMDBackend::Sub(result, temp));
 	}
 
 	// Interpolate between two vectors with float t, return the resultant vector
 	// i.e. result = a * (1 - t) + b * t
 	inline friend SIMDVector3 Lerp(const SIMDVector3& a, const SIMDVector3& b, float t)
 	{
-		__m128 tempA = _mm_set_ps1(1.0f - t);
-		tempA = _mm_mul_ps(a._data, tempA); 
-		__m128 tempB = _mm_set_ps1(t);
-		tempB = _mm_mul_ps(b._data, tempA);
-		__m128 result = _mm_add_ps(tempA, tempB);
-		return SIMDVector3(result);
+		SIMDVec4 tempA = SIMDBackend::Mul(a._data, SIMDBackend::Splat(1.0f - t));
+		return SIMDVector3(SIMDBackend::MulAdd(b._data, SIMDBackend::Splat(t), tempA));
 	}
 
 	// 4-way blend of vectors(colors), return the resultant vector
 	// i.e. result = a * t1 + b * t2 + c * t3 + d * (1 - t1 -t2 - t3)
 	inline friend SIMDVector3 Blend(const SIMDVector3& a, const SIMDVector3& b, const SIMDVector3& c, const SIMDVector3& d, float t1, float t2, float t3)
 	{
-		__m128 tempA = _mm_set_ps1(t1);
-		tempA = _mm_mul_ps(a._data, tempA);
-		__m128 tempB = _mm_set_ps1(t2);
-		tempB = _mm_mul_ps(b._data, tempB);
-		__m128 tempC = _mm_set_ps1(t3);
-		tempC = _mm_mul_ps(c._data, tempC);
-		__m128 tempD = _mm_set_ps1(1.0f - t1 - t2 - t3);
-		tempD = _mm_mul_ps(d._data, tempD);
-
-		__m128 result = _mm_add_ps(tempA, tempB);
-		result = _mm_add_ps(result, tempC);
-		result = _mm_add_ps(result, tempD);
+		SIMDVec4 result = SIMDBackend::Mul(d._data, SIMDBackend::Splat(1.0f - t1 - t2 - t3));
+		result = SIMDBackend::MulAdd(a._data, SIMDBackend::Splat(t1), result);
+		result = SIMDBackend::MulAdd(b._data, SIMDBackend::Splat(t2), result);
+		result = SIMDBackend::MulAdd(c._data, SIMDBackend::Splat(t3), result);
 		return SIMDVector3(result);
 	}
 
 	// Transform the vector as a point by a 4x4 Matrix, store result back to this
 	inline void Transform(const SIMDMatrix4& mat)
 	{
-		// set w to 1.0f
-		__m128 one = _mm_set_ss(1.0f);
-		_data = _mm_insert_ps(_data, one, 0x30);
+		SIMDVec4 col0 = mat._rows[0];
+		SIMDVec4 col1 = mat._rows[1];
+		SIMDVec4 col2 = mat._rows[2];
+		SIMDVec4 col3 = mat._rows[3];
+		SIMDBackend::Transpose(col0, col1, col2, col3);
 
-		__m128 x = _mm_dp_ps(_data, mat._rows[0], 0xF1);
-		__m128 y = _mm_dp_ps(_data, mat._rows[1], 0xF2);
-		__m128 z = _mm_dp_ps(_data, mat._rows[2], 0xF4);
-		__m128 w = _mm_dp_ps(_data, mat._rows[3], 0xF8);
-
-		_data = _mm_insert_ps(_data, x, 0x00);
-		_data = _mm_insert_ps(_data, y, 0x50);
-		_data = _mm_insert_ps(_data, z, 0xA0);
-		_data = _mm_insert_ps(_data, w, 0xF0);
+		// w is taken as 1.0f
+		SIMDVec4 result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<0, 0, 0, 0>(_data), col0, col3);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(_data), col1, result);
+		_data = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(_data), col2, result);
 	}
 
 	// Transform the vector by a 4x4 Matrix, store result back to this
 	inline void TransformAsVector(const SIMDMatrix4& mat)
 	{
-		// Set w to 0.0f
-		_data = _mm_insert_ps(_data, _data, 0x08);
-
-		__m128 x = _mm_dp_ps(_data, mat._rows[0], 0xF1);
-		__m128 y = _mm_dp_ps(_data, mat._rows[1], 0xF2);
-		__m128 z = _mm_dp_ps(_data, mat._rows[2], 0xF4);
-		__m128 w = _mm_dp_ps(_data, mat._rows[3], 0xF8);
+		SIMDVec4 col0 = mat._rows[0];
+		SIMDVec4 col1 = mat._rows[1];
+		SIMDVec4 col2 = mat._rows[2];
+		SIMDVec4 col3 = mat._rows[3];
+		SIMDBackend::Transpose(col0, col1, col2, col3);
 
-		_data = _mm_insert_ps(_data, x, 0x00);
-		_data = _mm_insert_ps(_data, y, 0x50);
-		_data = _mm_insert_ps(_data, z, 0xA0);
-		_data = _mm_insert_ps(_data, w, 0xF0);
+		// w is taken as 0.0f
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<0, 0, 0, 0>(_data), col0);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(_data), col1, result);
+		_data = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(_data), col2, result);
 	}
+
+	// Rotate the vector by a unit quaternion, store result back to this
+	inline void Rotate(const SIMDQuaternion& q);
 };
 
-__declspec(align(16)) class SIMDQuaternion
+class SIMD_ALIGN(16) SIMDQuaternion
 {
 private:
-	__m128 _data;
-	// _data.m128_f32[0] = x
-	// _data.m128_f32[1] = y
-	// _data.m128_f32[2] = z
-	// _data.m128_f32[3] = w
+	SIMDVec4 _data;
+	// lanes are x, y, z, w
 public:
 	friend class SIMDMatrix4;
 	friend class SIMDVector3;
+	friend class SIMDTransform;
 
 	static const SIMDQuaternion Identity;
 
@@ -604,11 +507,15 @@ public:
 	// Construct with given axis and angle in radian
 	SIMDQuaternion(SIMDVector3& axis, float radian)
 	{
-		__m128 sinTheta = _mm_set_ps1(sinf(radian / 2.0f));
-		__m128 cosTheta = _mm_set_ps1(cosf(radian / 2.0f));
 		axis.Normalize();
-		_data = _mm_mul_ps(axis._data, sinTheta);
-		_data = _mm_insert_ps(_data, cosTheta, 0xF0);
+		_data = SIMDBackend::Mul(axis._data, SIMDBackend::Splat(sinf(radian / 2.0f)));
+		_data = SIMDBackend::SetW(_data, cosf(radian / 2.0f));
+	}
+
+	// Construct with given x, y, z, w
+	SIMDQuaternion(float x, float y, float z, float w)
+	{
+		_data = SIMDBackend::Set(x, y, z, w);
 	}
 
 	// Copy constructor
@@ -626,56 +533,92 @@ public:
 
 	inline float GetX() const
 	{
-		return _data.m128_f32[0];
+		return SIMDBackend::GetX(_data);
 	}
 
 	inline float GetY() const
 	{
-		return _data.m128_f32[1];
+		return SIMDBackend::GetY(_data);
 	}
 
 	inline float GetZ() const
 	{
-		return _data.m128_f32[2];
+		return SIMDBackend::GetZ(_data);
 	}
 
 	inline float GetW() const
 	{
-		return _data.m128_f32[3];
+		return SIMDBackend::GetW(_data);
 	}
 
 	// Multiply this quaternion with another quaternion, store result back to this
+	// i.e. this = this * other, the rotation of other is applied first
 	inline void Multiply(const SIMDQuaternion& other)
 	{
-		__m128 result;
-		__m128 q2X = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(0, 0, 0, 0));
-		__m128 q2Y = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(1, 1, 1, 1));
-		__m128 q2Z = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(2, 2, 2, 2));
-		__m128 q2W = _mm_shuffle_ps(other._data, other._data, _MM_SHUFFLE(3, 3, 3, 3));
-
-		q2X = _mm_mul_ps(q2X, _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(0, 1, 2, 3)));
-		q2Y = _mm_mul_ps(q2X, _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(1, 0, 3, 2)));
-		q2Z = _mm_mul_ps(q2X, _mm_shuffle_ps(_data, _data, _MM_SHUFFLE(2, 3, 0, 1)));
-		q2W = _mm_mul_ps(q2W, _data);
-
-		result = _mm_addsub_ps(_mm_shuffle_ps(q2W, q2W, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(q2X, q2X, _MM_SHUFFLE(2, 3, 0, 1)));
-		result = _mm_addsub_ps(_mm_shuffle_ps(result, result, _MM_SHUFFLE(2, 0, 3, 1)), _mm_shuffle_ps(q2Y, q2Y, _MM_SHUFFLE(3, 1, 2, 0)));
-		result = _mm_addsub_ps(_mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(q2Z, q2Z, _MM_SHUFFLE(2, 3, 1, 0)));
-		result = _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 2, 0, 1));
+		// Each lane of this scales a signed permutation of other
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<3, 3, 3, 3>(_data), other._data);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<0, 0, 0, 0>(_data),
+			SIMDBackend::Mul(SIMDBackend::Swizzle<3, 2, 1, 0>(other._data), SIMDBackend::Set(1.0f, -1.0f, 1.0f, -1.0f)), result);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(_data),
+			SIMDBackend::Mul(SIMDBackend::Swizzle<2, 3, 0, 1>(other._data), SIMDBackend::Set(1.0f, 1.0f, -1.0f, -1.0f)), result);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(_data),
+			SIMDBackend::Mul(SIMDBackend::Swizzle<1, 0, 3, 2>(other._data), SIMDBackend::Set(-1.0f, 1.0f, 1.0f, -1.0f)), result);
 		_data = result;
 	}
 
-	inline void MultiplyDX(const SIMDQuaternion& other)
+	// Normalize the quaternion, store the result to this
+	inline void Normalize()
 	{
-		_data = DirectX::XMQuaternionMultiply(_data, other._data);
+		_data = SIMDBackend::Mul(_data, SIMDBackend::Rsqrt(SIMDBackend::Dot4(_data, _data)));
 	}
 
-	// Normalize the quaternion, store the result to this
-	inline void Normalize()
+	// Dot product, return a float
+	inline float Dot(const SIMDQuaternion& other) const
+	{
+		return SIMDBackend::GetX(SIMDBackend::Dot4(_data, other._data));
+	}
+
+	// Conjugate the quaternion, the inverse rotation of a unit quaternion
+	inline void Conjugate()
 	{
-		__m128 length = _mm_dp_ps(_data, _data, 0x77);
-		length = _mm_rsqrt_ps(length);
-		_data = _mm_mul_ps(_data, length);
+		_data = SIMDBackend::Mul(_data, SIMDBackend::Set(-1.0f, -1.0f, -1.0f, 1.0f));
 	}
+
+	// Set a rotation about the X axis given an angle in radian
+	inline void CreateRotationX(float radian)
+	{
+		_data = SIMDBackend::Set(sinf(radian / 2.0f), 0.0f, 0.0f, cosf(radian / 2.0f));
+	}
+
+	// Set a rotation about the Y axis given an angle in radian
+	inline void CreateRotationY(float radian)
+	{
+		_data = SIMDBackend::Set(0.0f, sinf(radian / 2.0f), 0.0f, cosf(radian / 2.0f));
+	}
+
+	// Set a rotation about the Z axis given an angle in radian
+	inline void CreateRotationZ(float radian)
+	{
+		_data = SIMDBackend::Set(0.0f, 0.0f, sinf(radian / 2.0f), cosf(radian / 2.0f));
+	}
+
+	// Set the rotation of a matrix, the upper 3x3 must be a rotation
+	void CreateFromMatrix(const SIMDMatrix4& mat);
+
+	// Interpolate between two unit quaternions along the shorter arc and normalize, return the resultant quaternion
+	// Cheaper than Slerp, the angular speed is not constant
+	friend SIMDQuaternion Nlerp(const SIMDQuaternion& a, const SIMDQuaternion& b, float t);
+
+	// Interpolate between two unit quaternions along the shorter arc at constant angular speed, return the resultant quaternion
+	friend SIMDQuaternion Slerp(const SIMDQuaternion& a, const SIMDQuaternion& b, float t);
 };
 
+// v' = v + w * t + u x t with t = 2 * (u x v), where u is the vector part of q
+inline void SIMDVector3::Rotate(const SIMDQuaternion& q)
+{
+	SIMDVector3 u(q._data);
+	SIMDVector3 t = CrossProduct(u, *this);
+	t._data = SIMDBackend::Add(t._data, t._data);
+	SIMDVec4 result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<3, 3, 3, 3>(q._data), t._data, _data);
+	_data = SIMDBackend::Add(result, CrossProduct(u, t)._data);
+}
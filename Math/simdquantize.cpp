@@ -0,0 +1,463 @@
+#include "simdquantize.h"
+
+#if defined(SIMD_BACKEND_AVX2) && (defined(__F16C__) || defined(_MSC_VER))
+#define SIMD_HAS_F16C // Every processor with AVX2 has F16C, GCC and Clang want it enabled on its own
+#endif
+
+namespace
+{
+	typedef SIMDBackend8 B;
+	typedef B::Vec8 Vec8;
+
+	const int BatchSize = SIMDBackend8::Width;
+
+	// One batch of values as x, y, z and w arrays
+	struct Batch
+	{
+		SIMD_ALIGN(32) float m_x[BatchSize];
+		SIMD_ALIGN(32) float m_y[BatchSize];
+		SIMD_ALIGN(32) float m_z[BatchSize];
+		SIMD_ALIGN(32) float m_w[BatchSize];
+	};
+
+	inline size_t batchCount(size_t first, size_t count)
+	{
+		return count - first < (size_t) BatchSize ? count - first : BatchSize;
+	}
+
+	inline const SIMDVector3& vectorAt(const SIMDVector3* v, size_t stride, size_t i)
+	{
+		return *(const SIMDVector3*) ((const char*) v + i * stride);
+	}
+
+	inline SIMDVector3& vectorAt(SIMDVector3* v, size_t stride, size_t i)
+	{
+		return *(SIMDVector3*) ((char*) v + i * stride);
+	}
+
+	// Load n vectors, past n the lanes are zero
+	void loadBatch(const SIMDVector3* in, size_t stride, size_t first, size_t n, Batch& batch)
+	{
+		for (size_t i = 0; i < (size_t) BatchSize; ++i)
+		{
+			const SIMDVector3& v = vectorAt(in, stride, first + (i < n ? i : 0));
+			batch.m_x[i] = i < n ? v.GetX() : 0.0f;
+			batch.m_y[i] = i < n ? v.GetY() : 0.0f;
+			batch.m_z[i] = i < n ? v.GetZ() : 0.0f;
+			batch.m_w[i] = i < n ? v.GetW() : 0.0f;
+		}
+	}
+
+	void storeBatch(const Batch& batch, SIMDVector3* out, size_t stride, size_t first, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			vectorAt(out, stride, first + i) = SIMDVector3(batch.m_x[i], batch.m_y[i], batch.m_z[i], batch.m_w[i]);
+		}
+	}
+
+	inline Vec8 clamp(Vec8 v, float min, float max)
+	{
+		return B::Min(B::Max(v, B::Splat(min)), B::Splat(max));
+	}
+
+	// Signed normalized values in [-1, 1] to integers in [-scale, scale] and back
+	inline Vec8 quantizeSnorm(Vec8 v, float scale)
+	{
+		return B::Round(B::Mul(clamp(v, -1.0f, 1.0f), B::Splat(scale)));
+	}
+
+	inline Vec8 dequantizeSnorm(Vec8 q, float scale)
+	{
+		return B::Max(B::Mul(q, B::Splat(1.0f / scale)), B::Splat(-1.0f));
+	}
+
+	// Values in [min, max] to integers in [0, scale] and back
+	inline Vec8 quantizeUnorm(Vec8 v, float min, float max, float scale)
+	{
+		Vec8 unit = B::Mul(B::Sub(clamp(v, min, max), B::Splat(min)), B::Splat(1.0f / (max - min)));
+		return B::Round(B::Mul(unit, B::Splat(scale)));
+	}
+
+	inline Vec8 dequantizeUnorm(Vec8 q, float min, float max, float scale)
+	{
+		return B::MulAdd(q, B::Splat((max - min) / scale), B::Splat(min));
+	}
+
+	// 1 where v >= 0, -1 elsewhere
+	inline Vec8 signNotZero(Vec8 v)
+	{
+		return B::Select(B::CmpGE(v, B::Splat(0.0f)), B::Splat(1.0f), B::Splat(-1.0f));
+	}
+
+#ifndef SIMD_HAS_F16C
+	inline uint32_t floatBits(float f)
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+
+	inline float bitsFloat(uint32_t bits)
+	{
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	// Round to the nearest half, halfway cases to even, denormals are kept and NaN stays NaN
+	uint16_t floatToHalf(float f)
+	{
+		uint32_t bits = floatBits(f);
+		uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+		if (bits >= (143u << 23))
+		{
+			// Too large for a half, or infinity or NaN
+			half = bits > (255u << 23) ? 0x7E00u : 0x7C00u;
+		}
+		else if (bits < (113u << 23))
+		{
+			// A denormal half, the addition rounds the mantissa into the low bits
+			const uint32_t denormMagic = 126u << 23;
+			half = floatBits(bitsFloat(bits) + bitsFloat(denormMagic)) - denormMagic;
+		}
+		else
+		{
+			uint32_t mantissaOdd = (bits >> 13) & 1;
+			bits += ((uint32_t) (15 - 127) << 23) + 0xFFFu + mantissaOdd;
+			half = bits >> 13;
+		}
+		return (uint16_t) (half | (sign >> 16));
+	}
+
+	float halfToFloat(uint16_t half)
+	{
+		const uint32_t exponentMask = 0x7C00u << 13;
+		uint32_t bits = (half & 0x7FFFu) << 13;
+		uint32_t exponent = bits & exponentMask;
+		bits += (127 - 15) << 23;
+		if (exponent == exponentMask)
+		{
+			// Infinity or NaN
+			bits += (128 - 16) << 23;
+		}
+		else if (exponent == 0)
+		{
+			// Zero or a denormal, renormalized by the subtraction
+			bits += 1 << 23;
+			bits = floatBits(bitsFloat(bits) - bitsFloat(113u << 23));
+		}
+		return bitsFloat(bits | ((half & 0x8000u) << 16));
+	}
+#endif
+
+	// Convert 3 batches of floats, the x, y and z of a batch of SIMDHalf3 in memory order
+	inline void floatsToHalves(const float* in, uint16_t* out)
+	{
+#ifdef SIMD_HAS_F16C
+		for (int i = 0; i < 3; ++i)
+		{
+			__m128i halves = _mm256_cvtps_ph(_mm256_load_ps(in + i * BatchSize), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128((__m128i*) (out + i * BatchSize), halves);
+		}
+#else
+		for (int i = 0; i < 3 * BatchSize; ++i)
+		{
+			out[i] = floatToHalf(in[i]);
+		}
+#endif
+	}
+
+	inline void halvesToFloats(const uint16_t* in, float* out)
+	{
+#ifdef SIMD_HAS_F16C
+		for (int i = 0; i < 3; ++i)
+		{
+			_mm256_store_ps(out + i * BatchSize, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (in + i * BatchSize))));
+		}
+#else
+		for (int i = 0; i < 3 * BatchSize; ++i)
+		{
+			out[i] = halfToFloat(in[i]);
+		}
+#endif
+	}
+
+	// The largest component of a quaternion can be rebuilt from the others, which are within +-1/sqrt(2)
+	// An even number of steps keeps 0 exact
+	const float QuaternionRange = 0.707106781f;
+	const float QuaternionScale = 1022.0f;
+}
+
+void PackHalf3(const SIMDVector3* in, size_t inStride, SIMDHalf3* out, size_t count)
+{
+	static_assert(sizeof(SIMDHalf3) == 3 * sizeof(uint16_t), "A batch of SIMDHalf3 is converted as one array of halves");
+
+	SIMD_ALIGN(32) float floats[3 * BatchSize] = {};
+	uint16_t halves[3 * BatchSize];
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const SIMDVector3& v = vectorAt(in, inStride, first + i);
+			floats[3 * i] = v.GetX();
+			floats[3 * i + 1] = v.GetY();
+			floats[3 * i + 2] = v.GetZ();
+		}
+		floatsToHalves(floats, halves);
+		memcpy(out + first, halves, n * sizeof(SIMDHalf3));
+	}
+}
+
+void UnpackHalf3(const SIMDHalf3* in, SIMDVector3* out, size_t outStride, size_t count)
+{
+	uint16_t halves[3 * BatchSize] = {};
+	SIMD_ALIGN(32) float floats[3 * BatchSize];
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		memcpy(halves, in + first, n * sizeof(SIMDHalf3));
+		halvesToFloats(halves, floats);
+		for (size_t i = 0; i < n; ++i)
+		{
+			vectorAt(out, outStride, first + i) = SIMDVector3(floats[3 * i], floats[3 * i + 1], floats[3 * i + 2]);
+		}
+	}
+}
+
+void PackSnorm16(const SIMDVector3* in, size_t inStride, SIMDSnorm16x3* out, size_t count)
+{
+	Batch batch;
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		loadBatch(in, inStride, first, n, batch);
+		B::Store(batch.m_x, quantizeSnorm(B::Load(batch.m_x), 32767.0f));
+		B::Store(batch.m_y, quantizeSnorm(B::Load(batch.m_y), 32767.0f));
+		B::Store(batch.m_z, quantizeSnorm(B::Load(batch.m_z), 32767.0f));
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i].m_x = (int16_t) batch.m_x[i];
+			out[first + i].m_y = (int16_t) batch.m_y[i];
+			out[first + i].m_z = (int16_t) batch.m_z[i];
+		}
+	}
+}
+
+void UnpackSnorm16(const SIMDSnorm16x3* in, SIMDVector3* out, size_t outStride, size_t count)
+{
+	Batch batch = {};
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			batch.m_x[i] = in[first + i].m_x;
+			batch.m_y[i] = in[first + i].m_y;
+			batch.m_z[i] = in[first + i].m_z;
+		}
+		B::Store(batch.m_x, dequantizeSnorm(B::Load(batch.m_x), 32767.0f));
+		B::Store(batch.m_y, dequantizeSnorm(B::Load(batch.m_y), 32767.0f));
+		B::Store(batch.m_z, dequantizeSnorm(B::Load(batch.m_z), 32767.0f));
+		storeBatch(batch, out, outStride, first, n);
+	}
+}
+
+// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper
+void PackOctNormals(const SIMDVector3* in, size_t inStride, SIMDOctNormal* out, size_t count)
+{
+	Batch batch;
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		loadBatch(in, inStride, first, n, batch);
+		Vec8 x = B::Load(batch.m_x);
+		Vec8 y = B::Load(batch.m_y);
+		Vec8 z = B::Load(batch.m_z);
+
+		// The padding lanes are zero, the minimum keeps them finite
+		Vec8 l1 = B::Max(B::Add(B::Add(B::Abs(x), B::Abs(y)), B::Abs(z)), B::Splat(1e-30f));
+		Vec8 invL1 = B::Div(B::Splat(1.0f), l1);
+		x = B::Mul(x, invL1);
+		y = B::Mul(y, invL1);
+		Vec8 lower = B::CmpLT(z, B::Splat(0.0f));
+		Vec8 foldedX = B::Mul(B::Sub(B::Splat(1.0f), B::Abs(y)), signNotZero(x));
+		Vec8 foldedY = B::Mul(B::Sub(B::Splat(1.0f), B::Abs(x)), signNotZero(y));
+		B::Store(batch.m_x, quantizeSnorm(B::Select(lower, foldedX, x), 32767.0f));
+		B::Store(batch.m_y, quantizeSnorm(B::Select(lower, foldedY, y), 32767.0f));
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i].m_x = (int16_t) batch.m_x[i];
+			out[first + i].m_y = (int16_t) batch.m_y[i];
+		}
+	}
+}
+
+void UnpackOctNormals(const SIMDOctNormal* in, SIMDVector3* out, size_t outStride, size_t count)
+{
+	Batch batch = {};
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			batch.m_x[i] = in[first + i].m_x;
+			batch.m_y[i] = in[first + i].m_y;
+		}
+		Vec8 x = dequantizeSnorm(B::Load(batch.m_x), 32767.0f);
+		Vec8 y = dequantizeSnorm(B::Load(batch.m_y), 32767.0f);
+
+		// Unfold, z is negative where the point is outside the diamond |x| + |y| <= 1
+		Vec8 z = B::Sub(B::Sub(B::Splat(1.0f), B::Abs(x)), B::Abs(y));
+		Vec8 t = B::Max(B::Sub(B::Splat(0.0f), z), B::Splat(0.0f));
+		x = B::Sub(x, B::Mul(t, signNotZero(x)));
+		y = B::Sub(y, B::Mul(t, signNotZero(y)));
+
+		// Exact normalization, the approximate reciprocal square root would cost more than the quantization
+		Vec8 length = B::Sqrt(B::MulAdd(x, x, B::MulAdd(y, y, B::Mul(z, z))));
+		Vec8 invLength = B::Div(B::Splat(1.0f), length);
+		B::Store(batch.m_x, B::Mul(x, invLength));
+		B::Store(batch.m_y, B::Mul(y, invLength));
+		B::Store(batch.m_z, B::Mul(z, invLength));
+		storeBatch(batch, out, outStride, first, n);
+	}
+}
+
+void Pack1010102(const SIMDVector3* in, size_t inStride, SIMDPacked1010102* out, size_t count)
+{
+	Batch batch;
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		loadBatch(in, inStride, first, n, batch);
+		B::Store(batch.m_x, quantizeUnorm(B::Load(batch.m_x), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_y, quantizeUnorm(B::Load(batch.m_y), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_z, quantizeUnorm(B::Load(batch.m_z), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_w, quantizeUnorm(B::Load(batch.m_w), -1.0f, 1.0f, 3.0f));
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i].m_value = (uint32_t) batch.m_x[i] | ((uint32_t) batch.m_y[i] << 10) |
+				((uint32_t) batch.m_z[i] << 20) | ((uint32_t) batch.m_w[i] << 30);
+		}
+	}
+}
+
+void Unpack1010102(const SIMDPacked1010102* in, SIMDVector3* out, size_t outStride, size_t count)
+{
+	Batch batch = {};
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint32_t value = in[first + i].m_value;
+			batch.m_x[i] = (float) (value & 0x3FF);
+			batch.m_y[i] = (float) ((value >> 10) & 0x3FF);
+			batch.m_z[i] = (float) ((value >> 20) & 0x3FF);
+			batch.m_w[i] = (float) (value >> 30);
+		}
+		B::Store(batch.m_x, dequantizeUnorm(B::Load(batch.m_x), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_y, dequantizeUnorm(B::Load(batch.m_y), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_z, dequantizeUnorm(B::Load(batch.m_z), -1.0f, 1.0f, 1023.0f));
+		B::Store(batch.m_w, dequantizeUnorm(B::Load(batch.m_w), -1.0f, 1.0f, 3.0f));
+		storeBatch(batch, out, outStride, first, n);
+	}
+}
+
+void PackQuaternions(const SIMDQuaternion* in, SIMDPackedQuaternion* out, size_t count)
+{
+	Batch batch = {};
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			batch.m_x[i] = in[first + i].GetX();
+			batch.m_y[i] = in[first + i].GetY();
+			batch.m_z[i] = in[first + i].GetZ();
+			batch.m_w[i] = in[first + i].GetW();
+		}
+		Vec8 x = B::Load(batch.m_x);
+		Vec8 y = B::Load(batch.m_y);
+		Vec8 z = B::Load(batch.m_z);
+		Vec8 w = B::Load(batch.m_w);
+
+		// Index of the largest component, the first of equal ones
+		Vec8 largest = B::Max(B::Max(B::Abs(x), B::Abs(y)), B::Max(B::Abs(z), B::Abs(w)));
+		Vec8 index = B::Splat(3.0f);
+		index = B::Select(B::CmpEQ(B::Abs(z), largest), B::Splat(2.0f), index);
+		index = B::Select(B::CmpEQ(B::Abs(y), largest), B::Splat(1.0f), index);
+		index = B::Select(B::CmpEQ(B::Abs(x), largest), B::Splat(0.0f), index);
+		Vec8 isX = B::CmpEQ(index, B::Splat(0.0f));
+		Vec8 upToY = B::CmpLE(index, B::Splat(1.0f));
+		Vec8 upToZ = B::CmpLE(index, B::Splat(2.0f));
+
+		// Negate the quaternion where the largest component is negative, so the rebuilt one is positive
+		Vec8 largestValue = B::Select(isX, x, B::Select(upToY, y, B::Select(upToZ, z, w)));
+		Vec8 sign = signNotZero(largestValue);
+
+		// The other three in order
+		Vec8 a = B::Mul(B::Select(isX, y, x), sign);
+		Vec8 b = B::Mul(B::Select(upToY, z, y), sign);
+		Vec8 c = B::Mul(B::Select(upToZ, w, z), sign);
+		B::Store(batch.m_x, quantizeUnorm(a, -QuaternionRange, QuaternionRange, QuaternionScale));
+		B::Store(batch.m_y, quantizeUnorm(b, -QuaternionRange, QuaternionRange, QuaternionScale));
+		B::Store(batch.m_z, quantizeUnorm(c, -QuaternionRange, QuaternionRange, QuaternionScale));
+		B::Store(batch.m_w, index);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i].m_value = ((uint32_t) batch.m_w[i] << 30) | ((uint32_t) batch.m_x[i] << 20) |
+				((uint32_t) batch.m_y[i] << 10) | (uint32_t) batch.m_z[i];
+		}
+	}
+}
+
+void UnpackQuaternions(const SIMDPackedQuaternion* in, SIMDQuaternion* out, size_t count)
+{
+	Batch batch = {};
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint32_t value = in[first + i].m_value;
+			batch.m_x[i] = (float) ((value >> 20) & 0x3FF);
+			batch.m_y[i] = (float) ((value >> 10) & 0x3FF);
+			batch.m_z[i] = (float) (value & 0x3FF);
+			batch.m_w[i] = (float) (value >> 30);
+		}
+		Vec8 a = dequantizeUnorm(B::Load(batch.m_x), -QuaternionRange, QuaternionRange, QuaternionScale);
+		Vec8 b = dequantizeUnorm(B::Load(batch.m_y), -QuaternionRange, QuaternionRange, QuaternionScale);
+		Vec8 c = dequantizeUnorm(B::Load(batch.m_z), -QuaternionRange, QuaternionRange, QuaternionScale);
+		Vec8 index = B::Load(batch.m_w);
+		Vec8 isX = B::CmpEQ(index, B::Splat(0.0f));
+		Vec8 isY = B::CmpEQ(index, B::Splat(1.0f));
+		Vec8 isZ = B::CmpEQ(index, B::Splat(2.0f));
+		Vec8 upToY = B::CmpLE(index, B::Splat(1.0f));
+		Vec8 upToZ = B::CmpLE(index, B::Splat(2.0f));
+
+		Vec8 rest = B::MulAdd(a, a, B::MulAdd(b, b, B::Mul(c, c)));
+		Vec8 largest = B::Sqrt(B::Max(B::Sub(B::Splat(1.0f), rest), B::Splat(0.0f)));
+		Vec8 x = B::Select(isX, largest, a);
+		Vec8 y = B::Select(isX, a, B::Select(isY, largest, b));
+		Vec8 z = B::Select(upToY, b, B::Select(isZ, largest, c));
+		Vec8 w = B::Select(upToZ, c, largest);
+
+		// Rounding can leave the three over 1 in length, normalize exactly
+		Vec8 invLength = B::Div(B::Splat(1.0f), B::Sqrt(B::Add(rest, B::Mul(largest, largest))));
+		B::Store(batch.m_x, B::Mul(x, invLength));
+		B::Store(batch.m_y, B::Mul(y, invLength));
+		B::Store(batch.m_z, B::Mul(z, invLength));
+		B::Store(batch.m_w, B::Mul(w, invLength));
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i] = SIMDQuaternion(batch.m_x[i], batch.m_y[i], batch.m_z[i], batch.m_w[i]);
+		}
+	}
+}
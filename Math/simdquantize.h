@@ -0,0 +1,69 @@
+#pragma once
+
+/** Compact storage formats for vectors, normals and rotations, packed and unpacked 8 at a time */
+// For vertex buffers and serialized state, the math is always done on SIMDVector3 and SIMDQuaternion
+// Strides of SIMDVector3 arrays are in bytes as in simdstream.h, e.g. PackHalf3(&v[0].m_pos, sizeof(Vertex1P1N), ...)
+
+#include <stddef.h>
+#include <stdint.h>
+#include "simdmath.h"
+
+// Half precision x, y and z, 6 bytes
+// About 3 significant digits, magnitudes above 65504 become infinity
+struct SIMDHalf3
+{
+	uint16_t							m_x;
+	uint16_t							m_y;
+	uint16_t							m_z;
+};
+
+// x, y and z in [-1, 1] as 16 bit signed normalized integers, 6 bytes
+struct SIMDSnorm16x3
+{
+	int16_t								m_x;
+	int16_t								m_y;
+	int16_t								m_z;
+};
+
+// Unit vector folded onto an octahedron, the 2 coordinates as 16 bit signed normalized integers, 4 bytes
+// The error in direction is below 0.0001 radians
+struct SIMDOctNormal
+{
+	int16_t								m_x;
+	int16_t								m_y;
+};
+
+// x, y and z in [-1, 1] as 10 bit unsigned normalized integers and w in 2 bits, 4 bytes
+// x is in the low bits, the layout of DXGI_FORMAT_R10G10B10A2_UNORM, w is one of -1, -1/3, 1/3 and 1
+struct SIMDPacked1010102
+{
+	uint32_t							m_value;
+};
+
+// Unit quaternion as its three smallest components, 4 bytes
+// The largest component is dropped and rebuilt from the others, its index is in the top 2 bits
+// and each other component takes 10 bits, the error of each component is below 0.0007
+struct SIMDPackedQuaternion
+{
+	uint32_t							m_value;
+};
+
+// Pack and unpack count values, unpacked SIMDVector3 have w = 1
+void PackHalf3(const SIMDVector3* in, size_t inStride, SIMDHalf3* out, size_t count);
+void UnpackHalf3(const SIMDHalf3* in, SIMDVector3* out, size_t outStride, size_t count);
+
+// Components outside [-1, 1] are clamped, unpacked SIMDVector3 have w = 0
+void PackSnorm16(const SIMDVector3* in, size_t inStride, SIMDSnorm16x3* out, size_t count);
+void UnpackSnorm16(const SIMDSnorm16x3* in, SIMDVector3* out, size_t outStride, size_t count);
+
+// The vectors need not be normalized but must not be zero, unpacked SIMDVector3 are unit length with w = 0
+void PackOctNormals(const SIMDVector3* in, size_t inStride, SIMDOctNormal* out, size_t count);
+void UnpackOctNormals(const SIMDOctNormal* in, SIMDVector3* out, size_t outStride, size_t count);
+
+// Components outside [-1, 1] are clamped, w included
+void Pack1010102(const SIMDVector3* in, size_t inStride, SIMDPacked1010102* out, size_t count);
+void Unpack1010102(const SIMDPacked1010102* in, SIMDVector3* out, size_t outStride, size_t count);
+
+// q and -q are the same rotation, a quaternion may unpack as either, unpacked quaternions are normalized
+void PackQuaternions(const SIMDQuaternion* in, SIMDPackedQuaternion* out, size_t count);
+void UnpackQuaternions(const SIMDPackedQuaternion* in, SIMDQuaternion* out, size_t count);
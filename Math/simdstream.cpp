@@ -0,0 +1,195 @@
+#include "simdstream.h"
+
+namespace
+{
+	// The top three rows of a matrix with every element splatted across a vector of backend B
+	template <typename B>
+	struct SplatMatrix
+	{
+		typedef decltype(B::Splat(0.0f)) Vec;
+
+		Vec m[3][4];
+
+		explicit SplatMatrix(const float mat[4][4])
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+				{
+					m[i][j] = B::Splat(mat[i][j]);
+				}
+			}
+		}
+
+		// Row i of the matrix times (x, y, z, 1) or (x, y, z, 0)
+		template <bool Point>
+		SIMD_INLINE Vec Row(int i, Vec x, Vec y, Vec z) const
+		{
+			Vec result = Point ? B::MulAdd(x, m[i][0], m[i][3]) : B::Mul(x, m[i][0]);
+			result = B::MulAdd(y, m[i][1], result);
+			return B::MulAdd(z, m[i][2], result);
+		}
+	};
+
+	template <typename B, bool Aligned>
+	SIMD_INLINE typename SplatMatrix<B>::Vec load(const float* p)
+	{
+		return Aligned ? B::Load(p) : B::LoadUnaligned(p);
+	}
+
+	template <typename B, bool Aligned>
+	SIMD_INLINE void store(float* p, typename SplatMatrix<B>::Vec v)
+	{
+		if (Aligned)
+			B::Store(p, v);
+		else
+			B::StoreUnaligned(p, v);
+	}
+
+	inline bool isAligned(const void* p, size_t alignment)
+	{
+		return ((size_t) p & (alignment - 1)) == 0;
+	}
+
+	// Transform the whole batches of B::Width from first, return the index of the first element left over
+	template <typename B, bool Aligned, bool Point>
+	size_t transformSoA(const SplatMatrix<B>& mat, const float* inX, const float* inY, const float* inZ,
+		float* outX, float* outY, float* outZ, size_t first, size_t count)
+	{
+		typedef typename SplatMatrix<B>::Vec Vec;
+
+		size_t i = first;
+		for (; i + B::Width <= count; i += B::Width)
+		{
+			Vec x = load<B, Aligned>(inX + i);
+			Vec y = load<B, Aligned>(inY + i);
+			Vec z = load<B, Aligned>(inZ + i);
+			store<B, Aligned>(outX + i, mat.template Row<Point>(0, x, y, z));
+			store<B, Aligned>(outY + i, mat.template Row<Point>(1, x, y, z));
+			store<B, Aligned>(outZ + i, mat.template Row<Point>(2, x, y, z));
+		}
+		return i;
+	}
+
+	template <bool Point>
+	void transformSoAStream(const SIMDMatrix4& mat, const float* inX, const float* inY, const float* inZ,
+		float* outX, float* outY, float* outZ, size_t count)
+	{
+		float m[4][4];
+		mat.Get(m);
+
+		// Aligned at the start means aligned at every batch, a batch of SIMDBackend8 spans 32 bytes
+		bool aligned = isAligned(inX, 32) && isAligned(inY, 32) && isAligned(inZ, 32)
+			&& isAligned(outX, 32) && isAligned(outY, 32) && isAligned(outZ, 32);
+
+		size_t i = 0;
+		if (count >= SIMDBackend8::Width)
+		{
+			SplatMatrix<SIMDBackend8> wide(m);
+			i = aligned ? transformSoA<SIMDBackend8, true, Point>(wide, inX, inY, inZ, outX, outY, outZ, i, count)
+				: transformSoA<SIMDBackend8, false, Point>(wide, inX, inY, inZ, outX, outY, outZ, i, count);
+		}
+		if (count - i >= SIMDBackend::Width)
+		{
+			SplatMatrix<SIMDBackend> narrow(m);
+			i = aligned ? transformSoA<SIMDBackend, true, Point>(narrow, inX, inY, inZ, outX, outY, outZ, i, count)
+				: transformSoA<SIMDBackend, false, Point>(narrow, inX, inY, inZ, outX, outY, outZ, i, count);
+		}
+
+		float w = Point ? 1.0f : 0.0f;
+		for (; i < count; ++i)
+		{
+			float x = inX[i], y = inY[i], z = inZ[i];
+			outX[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3] * w;
+			outY[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3] * w;
+			outZ[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3] * w;
+		}
+	}
+
+	// Transform the elements in the halves of v by the columns of a matrix, w is carried through by unitW
+	template <typename B, typename Vec>
+	SIMD_INLINE Vec transformColumns(Vec v, const Vec columns[4], Vec unitW)
+	{
+		Vec result = B::MulAdd(v, unitW, columns[3]);
+		result = B::MulAdd(B::template Swizzle<0, 0, 0, 0>(v), columns[0], result);
+		result = B::MulAdd(B::template Swizzle<1, 1, 1, 1>(v), columns[1], result);
+		return B::MulAdd(B::template Swizzle<2, 2, 2, 2>(v), columns[2], result);
+	}
+
+	// Elements are transformed in pairs, one per half of a SIMDBackend8 vector
+	template <bool Aligned>
+	void transformAoS(const float m[4][4], bool point, const char* in, size_t inStride,
+		char* out, size_t outStride, size_t count)
+	{
+		// The w lanes are cleared so the result has the w of the input
+		SIMDVec4 columns[4];
+		for (int j = 0; j < 3; ++j)
+		{
+			columns[j] = SIMDBackend::Set(m[0][j], m[1][j], m[2][j], 0.0f);
+		}
+		columns[3] = point ? SIMDBackend::Set(m[0][3], m[1][3], m[2][3], 0.0f) : SIMDBackend::Splat(0.0f);
+		SIMDVec4 unitW = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
+
+		SIMDBackend8::Vec8 wideColumns[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			wideColumns[j] = SIMDBackend8::Combine(columns[j], columns[j]);
+		}
+		SIMDBackend8::Vec8 wideUnitW = SIMDBackend8::Combine(unitW, unitW);
+
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2)
+		{
+			const char* src = in + i * inStride;
+			SIMDBackend8::Vec8 v = SIMDBackend8::Combine(load<SIMDBackend, Aligned>((const float*) src),
+				load<SIMDBackend, Aligned>((const float*) (src + inStride)));
+			v = transformColumns<SIMDBackend8>(v, wideColumns, wideUnitW);
+
+			char* dst = out + i * outStride;
+			store<SIMDBackend, Aligned>((float*) dst, SIMDBackend8::Low(v));
+			store<SIMDBackend, Aligned>((float*) (dst + outStride), SIMDBackend8::High(v));
+		}
+		if (i < count)
+		{
+			SIMDVec4 v = load<SIMDBackend, Aligned>((const float*) (in + i * inStride));
+			store<SIMDBackend, Aligned>((float*) (out + i * outStride), transformColumns<SIMDBackend>(v, columns, unitW));
+		}
+	}
+
+	void transformAoSStream(const SIMDMatrix4& mat, bool point, const SIMDVector3* in, size_t inStride,
+		SIMDVector3* out, size_t outStride, size_t count)
+	{
+		float m[4][4];
+		mat.Get(m);
+
+		bool aligned = isAligned(in, 16) && isAligned(out, 16) && inStride % 16 == 0 && outStride % 16 == 0;
+		if (aligned)
+			transformAoS<true>(m, point, (const char*) in, inStride, (char*) out, outStride, count);
+		else
+			transformAoS<false>(m, point, (const char*) in, inStride, (char*) out, outStride, count);
+	}
+}
+
+void TransformPoints(const SIMDMatrix4& mat, const float* inX, const float* inY, const float* inZ,
+	float* outX, float* outY, float* outZ, size_t count)
+{
+	transformSoAStream<true>(mat, inX, inY, inZ, outX, outY, outZ, count);
+}
+
+void TransformVectors(const SIMDMatrix4& mat, const float* inX, const float* inY, const float* inZ,
+	float* outX, float* outY, float* outZ, size_t count)
+{
+	transformSoAStream<false>(mat, inX, inY, inZ, outX, outY, outZ, count);
+}
+
+void TransformPoints(const SIMDMatrix4& mat, const SIMDVector3* in, size_t inStride,
+	SIMDVector3* out, size_t outStride, size_t count)
+{
+	transformAoSStream(mat, true, in, inStride, out, outStride, count);
+}
+
+void TransformVectors(const SIMDMatrix4& mat, const SIMDVector3* in, size_t inStride,
+	SIMDVector3* out, size_t outStride, size_t count)
+{
+	transformAoSStream(mat, false, in, inStride, out, outStride, count);
+}
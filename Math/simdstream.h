@@ -0,0 +1,27 @@
+#pragma once
+
+/** Transform arrays of points and vectors by one matrix, 8 and 4 lanes at a time with a scalar loop for the tail */
+// SoA streams are separate x, y and z arrays, AoS streams are SIMDVector3 members of structures such as the vertex formats
+// Output may be the same arrays as input but must not partially overlap them
+
+#include <stddef.h>
+#include "simdmath.h"
+
+// Transform count points (w = 1) given as x, y and z arrays
+void TransformPoints(const SIMDMatrix4& mat, const float* inX, const float* inY, const float* inZ,
+	float* outX, float* outY, float* outZ, size_t count);
+
+// Transform count vectors (w = 0) given as x, y and z arrays
+// Normals need the inverse transpose of the matrix unless it has a uniform scale
+void TransformVectors(const SIMDMatrix4& mat, const float* inX, const float* inY, const float* inZ,
+	float* outX, float* outY, float* outZ, size_t count);
+
+// Transform count points (w = 1), strides are in bytes, e.g. TransformPoints(mat, &v[0].m_pos, sizeof(Vertex1P), ...)
+// The w of each output is copied from its input
+void TransformPoints(const SIMDMatrix4& mat, const SIMDVector3* in, size_t inStride,
+	SIMDVector3* out, size_t outStride, size_t count);
+
+// Transform count vectors (w = 0), strides are in bytes
+// The w of each output is copied from its input
+void TransformVectors(const SIMDMatrix4& mat, const SIMDVector3* in, size_t inStride,
+	SIMDVector3* out, size_t outStride, size_t count);
@@ -0,0 +1,190 @@
+#include "simdtranscendental.h"
+
+namespace
+{
+	const int BatchSize = SIMDBackend8::Width;
+
+	// Sines and cosines of up to one batch of angles times scale, the tail of a batch is padded with zero
+	inline void sinCosBatch(const float* radians, float scale, size_t count, SIMDBackend8::Vec8& sines, SIMDBackend8::Vec8& cosines)
+	{
+		SIMDBackend8::Vec8 angles;
+		if (count == BatchSize)
+		{
+			angles = SIMDBackend8::LoadUnaligned(radians);
+		}
+		else
+		{
+			SIMD_ALIGN(32) float padded[BatchSize] = {};
+			memcpy(padded, radians, count * sizeof(float));
+			angles = SIMDBackend8::Load(padded);
+		}
+		SIMDTranscendental8::SinCos(SIMDBackend8::Mul(angles, SIMDBackend8::Splat(scale)), sines, cosines);
+	}
+
+	inline void sinCosBatch(const float* radians, float scale, size_t count, float sines[BatchSize], float cosines[BatchSize])
+	{
+		SIMDBackend8::Vec8 s, c;
+		sinCosBatch(radians, scale, count, s, c);
+		SIMDBackend8::Store(sines, s);
+		SIMDBackend8::Store(cosines, c);
+	}
+
+	inline size_t batchCount(size_t first, size_t count)
+	{
+		return count - first < (size_t) BatchSize ? count - first : BatchSize;
+	}
+
+	// Build one element from the sine and cosine of each angle
+	template <typename T, typename Build>
+	void createFromAngles(const float* radians, float scale, T* out, size_t count, Build build)
+	{
+		SIMD_ALIGN(32) float sines[BatchSize];
+		SIMD_ALIGN(32) float cosines[BatchSize];
+		for (size_t first = 0; first < count; first += BatchSize)
+		{
+			size_t n = batchCount(first, count);
+			sinCosBatch(radians + first, scale, n, sines, cosines);
+			for (size_t i = 0; i < n; ++i)
+			{
+				out[first + i] = build(sines[i], cosines[i]);
+			}
+		}
+	}
+
+	inline SIMDMatrix4 matrixFromRows(SIMDVec4 r0, SIMDVec4 r1, SIMDVec4 r2)
+	{
+		SIMDVec4 rows[4] = { r0, r1, r2, SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f) };
+		return SIMDMatrix4(rows);
+	}
+
+	struct BuildRotationX
+	{
+		SIMDMatrix4 operator()(float s, float c) const
+		{
+			return matrixFromRows(SIMDBackend::Set(1.0f, 0.0f, 0.0f, 0.0f), SIMDBackend::Set(0.0f, c, -s, 0.0f),
+				SIMDBackend::Set(0.0f, s, c, 0.0f));
+		}
+	};
+
+	struct BuildRotationY
+	{
+		SIMDMatrix4 operator()(float s, float c) const
+		{
+			return matrixFromRows(SIMDBackend::Set(c, 0.0f, s, 0.0f), SIMDBackend::Set(0.0f, 1.0f, 0.0f, 0.0f),
+				SIMDBackend::Set(-s, 0.0f, c, 0.0f));
+		}
+	};
+
+	struct BuildRotationZ
+	{
+		SIMDMatrix4 operator()(float s, float c) const
+		{
+			return matrixFromRows(SIMDBackend::Set(c, -s, 0.0f, 0.0f), SIMDBackend::Set(s, c, 0.0f, 0.0f),
+				SIMDBackend::Set(0.0f, 0.0f, 1.0f, 0.0f));
+		}
+	};
+
+	// The quaternion builders are given the sine and cosine of half the angle
+	struct BuildQuaternionX
+	{
+		SIMDQuaternion operator()(float s, float c) const { return SIMDQuaternion(s, 0.0f, 0.0f, c); }
+	};
+
+	struct BuildQuaternionY
+	{
+		SIMDQuaternion operator()(float s, float c) const { return SIMDQuaternion(0.0f, s, 0.0f, c); }
+	};
+
+	struct BuildQuaternionZ
+	{
+		SIMDQuaternion operator()(float s, float c) const { return SIMDQuaternion(0.0f, 0.0f, s, c); }
+	};
+}
+
+void SinCos(const float* radians, float* sines, float* cosines, size_t count)
+{
+	size_t first = 0;
+	for (; first + BatchSize <= count; first += BatchSize)
+	{
+		SIMDBackend8::Vec8 s, c;
+		sinCosBatch(radians + first, 1.0f, BatchSize, s, c);
+		if (sines)
+			SIMDBackend8::StoreUnaligned(sines + first, s);
+		if (cosines)
+			SIMDBackend8::StoreUnaligned(cosines + first, c);
+	}
+	if (first < count)
+	{
+		SIMD_ALIGN(32) float s[BatchSize];
+		SIMD_ALIGN(32) float c[BatchSize];
+		size_t n = count - first;
+		sinCosBatch(radians + first, 1.0f, n, s, c);
+		if (sines)
+			memcpy(sines + first, s, n * sizeof(float));
+		if (cosines)
+			memcpy(cosines + first, c, n * sizeof(float));
+	}
+}
+
+void CreateRotationsX(const float* radians, SIMDMatrix4* out, size_t count)
+{
+	createFromAngles(radians, 1.0f, out, count, BuildRotationX());
+}
+
+void CreateRotationsY(const float* radians, SIMDMatrix4* out, size_t count)
+{
+	createFromAngles(radians, 1.0f, out, count, BuildRotationY());
+}
+
+void CreateRotationsZ(const float* radians, SIMDMatrix4* out, size_t count)
+{
+	createFromAngles(radians, 1.0f, out, count, BuildRotationZ());
+}
+
+void CreateQuaternionsX(const float* radians, SIMDQuaternion* out, size_t count)
+{
+	createFromAngles(radians, 0.5f, out, count, BuildQuaternionX());
+}
+
+void CreateQuaternionsY(const float* radians, SIMDQuaternion* out, size_t count)
+{
+	createFromAngles(radians, 0.5f, out, count, BuildQuaternionY());
+}
+
+void CreateQuaternionsZ(const float* radians, SIMDQuaternion* out, size_t count)
+{
+	createFromAngles(radians, 0.5f, out, count, BuildQuaternionZ());
+}
+
+void CreateQuaternionsFromEuler(const float* x, const float* y, const float* z, SIMDQuaternion* out, size_t count)
+{
+	typedef SIMDBackend8 B;
+
+	SIMD_ALIGN(32) float qx[BatchSize];
+	SIMD_ALIGN(32) float qy[BatchSize];
+	SIMD_ALIGN(32) float qz[BatchSize];
+	SIMD_ALIGN(32) float qw[BatchSize];
+	for (size_t first = 0; first < count; first += BatchSize)
+	{
+		size_t n = batchCount(first, count);
+		B::Vec8 sx, cx, sy, cy, sz, cz;
+		sinCosBatch(x + first, 0.5f, n, sx, cx);
+		sinCosBatch(y + first, 0.5f, n, sy, cy);
+		sinCosBatch(z + first, 0.5f, n, sz, cz);
+
+		// qx * qy * qz expanded, the quaternions about one axis have two non-zero components each
+		B::Vec8 cxcy = B::Mul(cx, cy);
+		B::Vec8 sxsy = B::Mul(sx, sy);
+		B::Vec8 sxcy = B::Mul(sx, cy);
+		B::Vec8 cxsy = B::Mul(cx, sy);
+		B::Store(qx, B::MulAdd(sxcy, cz, B::Mul(cxsy, sz)));
+		B::Store(qy, B::Sub(B::Mul(cxsy, cz), B::Mul(sxcy, sz)));
+		B::Store(qz, B::MulAdd(cxcy, sz, B::Mul(sxsy, cz)));
+		B::Store(qw, B::Sub(B::Mul(cxcy, cz), B::Mul(sxsy, sz)));
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[first + i] = SIMDQuaternion(qx[i], qy[i], qz[i], qw[i]);
+		}
+	}
+}
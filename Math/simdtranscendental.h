@@ -0,0 +1,155 @@
+#pragma once
+
+/** Polynomial approximations of sin, cos, atan2, exp and log on 4 or 8 floats, and rotations built from arrays of angles */
+// The errors are the largest measured against double precision on the ranges given, with or without FMA
+// Single matrices and quaternions still use the C library, these are for many angles at once
+
+#include <stddef.h>
+#include "simdmath.h"
+
+template <typename B>
+struct SIMDTranscendental
+{
+	typedef B Backend;
+	typedef decltype(B::Splat(0.0f)) Vec;
+
+	// Absolute error below 1.5e-7 for |x| <= 8192, the error grows with |x| beyond that
+	static inline Vec Sin(Vec x)
+	{
+		Vec s, c;
+		SinCos(x, s, c);
+		return s;
+	}
+
+	static inline Vec Cos(Vec x)
+	{
+		Vec s, c;
+		SinCos(x, s, c);
+		return c;
+	}
+
+	// Both at the cost of one, the range reduction and both polynomials are shared
+	static inline void SinCos(Vec x, Vec& sine, Vec& cosine)
+	{
+		// x = j * pi / 2 + r with |r| <= pi / 4, pi / 2 is split in three so the reduction is exact for small j
+		Vec j = B::Round(B::Mul(x, B::Splat(0.636619772f)));
+		Vec r = B::MulAdd(j, B::Splat(-1.5703125f), x);
+		r = B::MulAdd(j, B::Splat(-4.837512969970703125e-4f), r);
+		r = B::MulAdd(j, B::Splat(-7.54978995489188216e-8f), r);
+
+		Vec r2 = B::Mul(r, r);
+		Vec s = B::MulAdd(B::Splat(-1.9515295891e-4f), r2, B::Splat(8.3321608736e-3f));
+		s = B::MulAdd(s, r2, B::Splat(-1.6666654611e-1f));
+		s = B::MulAdd(B::Mul(s, r2), r, r);
+		Vec c = B::MulAdd(B::Splat(2.443315711809948e-5f), r2, B::Splat(-1.388731625493765e-3f));
+		c = B::MulAdd(c, r2, B::Splat(4.166664568298827e-2f));
+		c = B::MulAdd(B::Mul(c, r2), r2, B::MulAdd(r2, B::Splat(-0.5f), B::Splat(1.0f)));
+
+		// The quadrant j mod 4 as q in [-2, 2], odd quadrants swap sin and cos
+		Vec q = B::Sub(j, B::Mul(B::Round(B::Mul(j, B::Splat(0.25f))), B::Splat(4.0f)));
+		Vec absQ = B::Abs(q);
+		Vec odd = B::CmpEQ(absQ, B::Splat(1.0f));
+		Vec signBit = B::Splat(-0.0f);
+		// sin is negative in quadrants 2 and 3 (q = +-2 or -1), cos in quadrants 1 and 2 (q = 1 or +-2)
+		Vec negateSin = B::Or(B::CmpLT(q, B::Splat(0.0f)), B::CmpGT(q, B::Splat(1.5f)));
+		Vec negateCos = B::Or(B::CmpGT(q, B::Splat(0.5f)), B::CmpLT(q, B::Splat(-1.5f)));
+		sine = B::Xor(B::Select(odd, c, s), B::And(negateSin, signBit));
+		cosine = B::Xor(B::Select(odd, s, c), B::And(negateCos, signBit));
+	}
+
+	// Angle of (x, y) in [-pi, pi], absolute error below 3e-7, atan2(0, 0) is 0
+	static inline Vec Atan2(Vec y, Vec x)
+	{
+		Vec absY = B::Abs(y);
+		Vec absX = B::Abs(x);
+		Vec zero = B::Splat(0.0f);
+		Vec larger = B::Max(absX, absY);
+		Vec t = B::Div(B::Min(absX, absY), B::Select(B::CmpEQ(larger, zero), B::Splat(1.0f), larger));
+
+		// atan(t) = pi / 4 + atan((t - 1) / (t + 1)) above tan(pi / 8)
+		Vec reduce = B::CmpGT(t, B::Splat(0.414213562f));
+		t = B::Select(reduce, B::Div(B::Sub(t, B::Splat(1.0f)), B::Add(t, B::Splat(1.0f))), t);
+		Vec z = B::Mul(t, t);
+		Vec p = B::MulAdd(B::Splat(8.05374449538e-2f), z, B::Splat(-1.38776856032e-1f));
+		p = B::MulAdd(p, z, B::Splat(1.99777106478e-1f));
+		p = B::MulAdd(p, z, B::Splat(-3.33329491539e-1f));
+		Vec angle = B::MulAdd(B::Mul(p, z), t, t);
+		angle = B::Add(angle, B::And(reduce, B::Splat(0.785398163f)));
+
+		// Back from the first octant to the full circle
+		angle = B::Select(B::CmpGT(absY, absX), B::Sub(B::Splat(1.57079633f), angle), angle);
+		angle = B::Select(B::CmpLT(x, zero), B::Sub(B::Splat(3.14159265f), angle), angle);
+		return B::Xor(angle, B::And(y, B::Splat(-0.0f)));
+	}
+
+	// Relative error below 2e-7, x is clamped to [-87.3, 88] so the result is a normal float
+	static inline Vec Exp(Vec x)
+	{
+		x = B::Min(B::Max(x, B::Splat(-87.3365479f)), B::Splat(88.0f));
+
+		// e^x = 2^n * e^r with |r| <= ln(2) / 2, ln(2) is split in two so n * ln(2) is exact
+		Vec n = B::Round(B::Mul(x, B::Splat(1.44269504f)));
+		Vec r = B::MulAdd(n, B::Splat(-0.693359375f), x);
+		r = B::MulAdd(n, B::Splat(2.12194440e-4f), r);
+
+		Vec p = B::MulAdd(B::Splat(1.9875691500e-4f), r, B::Splat(1.3981999507e-3f));
+		p = B::MulAdd(p, r, B::Splat(8.3334519073e-3f));
+		p = B::MulAdd(p, r, B::Splat(4.1665795894e-2f));
+		p = B::MulAdd(p, r, B::Splat(1.6666665459e-1f));
+		p = B::MulAdd(p, r, B::Splat(5.0000001201e-1f));
+		p = B::MulAdd(B::Mul(p, r), r, B::Add(r, B::Splat(1.0f)));
+		return B::Mul(p, B::Pow2(n));
+	}
+
+	// Error below 1.5e-7, relative to the result where it is larger than 1, for normal positive x
+	// log(0) is -infinity and a negative x gives NaN
+	static inline Vec Log(Vec x)
+	{
+		// x = m * 2^e with m in [sqrt(2) / 2, sqrt(2)]
+		Vec e = B::Exponent(x);
+		Vec m = B::Mantissa(x);
+		Vec high = B::CmpGT(m, B::Splat(1.41421356f));
+		m = B::Select(high, B::Mul(m, B::Splat(0.5f)), m);
+		e = B::Add(e, B::And(high, B::Splat(1.0f)));
+
+		Vec f = B::Sub(m, B::Splat(1.0f));
+		Vec f2 = B::Mul(f, f);
+		Vec p = B::MulAdd(B::Splat(7.0376836292e-2f), f, B::Splat(-1.1514610310e-1f));
+		p = B::MulAdd(p, f, B::Splat(1.1676998740e-1f));
+		p = B::MulAdd(p, f, B::Splat(-1.2420140846e-1f));
+		p = B::MulAdd(p, f, B::Splat(1.4249322787e-1f));
+		p = B::MulAdd(p, f, B::Splat(-1.6668057665e-1f));
+		p = B::MulAdd(p, f, B::Splat(2.0000714765e-1f));
+		p = B::MulAdd(p, f, B::Splat(-2.4999993993e-1f));
+		p = B::MulAdd(p, f, B::Splat(3.3333331174e-1f));
+
+		// log(x) = log(m) + e * ln(2), ln(2) is split in two as in Exp
+		Vec y = B::Mul(B::Mul(p, f2), f);
+		y = B::MulAdd(e, B::Splat(-2.12194440e-4f), y);
+		y = B::MulAdd(f2, B::Splat(-0.5f), y);
+		Vec result = B::MulAdd(e, B::Splat(0.693359375f), B::Add(f, y));
+
+		Vec zero = B::Splat(0.0f);
+		result = B::Select(B::CmpEQ(x, zero), B::Splat(-INFINITY), result);
+		return B::Select(B::CmpLT(x, zero), B::Splat(NAN), result);
+	}
+};
+
+typedef SIMDTranscendental<SIMDBackend> SIMDTranscendental4;
+typedef SIMDTranscendental<SIMDBackend8> SIMDTranscendental8;
+
+// Sines and cosines of count angles, sines or cosines may be null when only the other is needed
+void SinCos(const float* radians, float* sines, float* cosines, size_t count);
+
+// Rotation matrices about the X, Y or Z axis, one per angle, the same as SIMDMatrix4::CreateRotationX/Y/Z
+void CreateRotationsX(const float* radians, SIMDMatrix4* out, size_t count);
+void CreateRotationsY(const float* radians, SIMDMatrix4* out, size_t count);
+void CreateRotationsZ(const float* radians, SIMDMatrix4* out, size_t count);
+
+// Quaternions about the X, Y or Z axis, one per angle, the same as SIMDQuaternion::CreateRotationX/Y/Z
+void CreateQuaternionsX(const float* radians, SIMDQuaternion* out, size_t count);
+void CreateQuaternionsY(const float* radians, SIMDQuaternion* out, size_t count);
+void CreateQuaternionsZ(const float* radians, SIMDQuaternion* out, size_t count);
+
+// Quaternions from Euler angles, qx * qy * qz as in MeshData, so the Z rotation is applied first
+void CreateQuaternionsFromEuler(const float* x, const float* y, const float* z, SIMDQuaternion* out, size_t count);
@@ -0,0 +1,146 @@
+#include "simdtransform.h"
+
+namespace
+{
+	float identityRows[4][4] = {
+		{1.0f, 0.0f, 0.0f, 0.0f},
+		{0.0f, 1.0f, 0.0f, 0.0f},
+		{0.0f, 0.0f, 1.0f, 0.0f},
+		{0.0f, 0.0f, 0.0f, 1.0f}
+	};
+
+	// Cross product of x, y and z, w is 0
+	inline SIMDVec4 cross(SIMDVec4 a, SIMDVec4 b)
+	{
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<1, 2, 0, 3>(a), SIMDBackend::Swizzle<2, 0, 1, 3>(b));
+		return SIMDBackend::Sub(result, SIMDBackend::Mul(SIMDBackend::Swizzle<2, 0, 1, 3>(a), SIMDBackend::Swizzle<1, 2, 0, 3>(b)));
+	}
+
+	// -(x * c0 + y * c1 + z * c2) where x, y and z are the translation in the w of the rows
+	inline SIMDVec4 negatedTranslation(const SIMDVec4 rows[3], SIMDVec4 c0, SIMDVec4 c1, SIMDVec4 c2)
+	{
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<3, 3, 3, 3>(rows[0]), c0);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<3, 3, 3, 3>(rows[1]), c1, result);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<3, 3, 3, 3>(rows[2]), c2, result);
+		return SIMDBackend::Sub(SIMDBackend::Splat(0.0f), result);
+	}
+}
+
+// Affine constant declaration
+const SIMDAffine SIMDAffine::Identity = SIMDAffine(SIMDMatrix4(identityRows));
+
+// Transform constant declaration
+const SIMDTransform SIMDTransform::Identity(SIMDVector3(0.0f, 0.0f, 0.0f), SIMDQuaternion(0.0f, 0.0f, 0.0f, 1.0f), SIMDVector3(1.0f, 1.0f, 1.0f));
+
+// Affine methods
+SIMDAffine::SIMDAffine(const SIMDVector3& translation, const SIMDQuaternion& rotation, const SIMDVector3& scale)
+{
+	SIMDMatrix4 rotationMat;
+	rotationMat.CreateRotationFromQuaternion(rotation);
+
+	// Scaling first scales the columns of the rotation
+	SIMDVec4 columnScale = SIMDBackend::SetW(scale._data, 0.0f);
+	_rows[0] = SIMDBackend::SetW(SIMDBackend::Mul(rotationMat._rows[0], columnScale), translation.GetX());
+	_rows[1] = SIMDBackend::SetW(SIMDBackend::Mul(rotationMat._rows[1], columnScale), translation.GetY());
+	_rows[2] = SIMDBackend::SetW(SIMDBackend::Mul(rotationMat._rows[2], columnScale), translation.GetZ());
+}
+
+// The inverse is [R^T | -R^T t], R^T t is the rows of R weighted by t
+void SIMDAffine::InvertRigid()
+{
+	SIMDVec4 r0 = _rows[0];
+	SIMDVec4 r1 = _rows[1];
+	SIMDVec4 r2 = _rows[2];
+	SIMDVec4 t = negatedTranslation(_rows, r0, r1, r2);
+
+	// The transpose moves the new translation into the w of the rows
+	SIMDBackend::Transpose(r0, r1, r2, t);
+	_rows[0] = r0;
+	_rows[1] = r1;
+	_rows[2] = r2;
+}
+
+// The columns of the inverse of the upper 3x3 are the cross products of its rows over the determinant
+bool SIMDAffine::Invert()
+{
+	SIMDVec4 c0 = cross(_rows[1], _rows[2]);
+	SIMDVec4 c1 = cross(_rows[2], _rows[0]);
+	SIMDVec4 c2 = cross(_rows[0], _rows[1]);
+
+	float det = SIMDBackend::GetX(SIMDBackend::Dot3(_rows[0], c0));
+	if (fabsf(det) < 1e-20f)
+		return false;
+
+	SIMDVec4 invDet = SIMDBackend::Splat(1.0f / det);
+	c0 = SIMDBackend::Mul(c0, invDet);
+	c1 = SIMDBackend::Mul(c1, invDet);
+	c2 = SIMDBackend::Mul(c2, invDet);
+	SIMDVec4 t = negatedTranslation(_rows, c0, c1, c2);
+
+	SIMDBackend::Transpose(c0, c1, c2, t);
+	_rows[0] = c0;
+	_rows[1] = c1;
+	_rows[2] = c2;
+	return true;
+}
+
+bool SIMDAffine::Decompose(SIMDVector3& translation, SIMDQuaternion& rotation, SIMDVector3& scale) const
+{
+	translation = GetTranslation();
+
+	SIMDVec4 c0 = _rows[0];
+	SIMDVec4 c1 = _rows[1];
+	SIMDVec4 c2 = _rows[2];
+	SIMDVec4 c3 = SIMDBackend::Splat(0.0f);
+	SIMDBackend::Transpose(c0, c1, c2, c3);
+
+	// The scales are the lengths of the columns
+	SIMDVec4 lengths = SIMDBackend::Set(
+		SIMDBackend::GetX(SIMDBackend::Dot3(c0, c0)),
+		SIMDBackend::GetX(SIMDBackend::Dot3(c1, c1)),
+		SIMDBackend::GetX(SIMDBackend::Dot3(c2, c2)),
+		1.0f);
+	lengths = SIMDBackend::Sqrt(lengths);
+	if (SIMDBackend::GetX(lengths) < 1e-6f || SIMDBackend::GetY(lengths) < 1e-6f || SIMDBackend::GetZ(lengths) < 1e-6f)
+		return false;
+	if (SIMDBackend::GetX(SIMDBackend::Dot3(c0, cross(c1, c2))) < 0.0f)
+		lengths = SIMDBackend::SetX(lengths, -SIMDBackend::GetX(lengths));
+	scale = SIMDVector3(lengths);
+
+	// Dividing the columns by the scales divides the rows lane by lane
+	SIMDVec4 invScale = SIMDBackend::Div(SIMDBackend::Splat(1.0f), lengths);
+	SIMDVec4 rows[4] = {
+		SIMDBackend::SetW(SIMDBackend::Mul(_rows[0], invScale), 0.0f),
+		SIMDBackend::SetW(SIMDBackend::Mul(_rows[1], invScale), 0.0f),
+		SIMDBackend::SetW(SIMDBackend::Mul(_rows[2], invScale), 0.0f),
+		SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f)
+	};
+	rotation.CreateFromMatrix(SIMDMatrix4(rows));
+	return true;
+}
+
+// Transform methods
+void SIMDTransform::Multiply(const SIMDTransform& other)
+{
+	SIMDVector3 offset = other._translation;
+	TransformVector(offset);
+	Translate(offset);
+	_rotation.Multiply(other._rotation);
+	_scale._data = SIMDBackend::Mul(_scale._data, other._scale._data);
+}
+
+// The inverse of T R S is S^-1 R^-1 T^-1, as a transform its translation is -S^-1 R^-1 t
+void SIMDTransform::Invert()
+{
+	_scale._data = SIMDBackend::Div(SIMDBackend::Splat(1.0f), _scale._data);
+	_rotation.Conjugate();
+
+	SIMDVector3 translation(SIMDBackend::Sub(SIMDBackend::Splat(0.0f), _translation._data));
+	translation.Rotate(_rotation);
+	_translation._data = SIMDBackend::SetW(SIMDBackend::Mul(translation._data, _scale._data), SIMDBackend::GetW(_translation._data));
+}
+
+SIMDTransform Lerp(const SIMDTransform& a, const SIMDTransform& b, float t)
+{
+	return SIMDTransform(Lerp(a._translation, b._translation, t), Slerp(a._rotation, b._rotation, t), Lerp(a._scale, b._scale, t));
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+/** Affine transforms, as a 3x4 matrix or as translation, rotation and scale */
+
+#include "simdmath.h"
+
+// Affine transform with SIMD, the top three rows of a 4x4 matrix whose last row is (0, 0, 0, 1)
+class SIMD_ALIGN(16) SIMDAffine
+{
+private:
+	SIMDVec4 _rows[3];
+	// row-major matrix, the translation is in w
+public:
+	static const SIMDAffine Identity;
+
+	// Default constructor
+	inline SIMDAffine(){};
+
+	// Construct from the top three rows of a 4x4 matrix
+	inline explicit SIMDAffine(const SIMDMatrix4& mat)
+	{
+		_rows[0] = mat._rows[0];
+		_rows[1] = mat._rows[1];
+		_rows[2] = mat._rows[2];
+	}
+
+	// Construct from translation, rotation and scale, applied to a point as scale first and translation last
+	SIMDAffine(const SIMDVector3& translation, const SIMDQuaternion& rotation, const SIMDVector3& scale);
+
+	// Return the 4x4 matrix
+	inline SIMDMatrix4 ToMatrix4() const
+	{
+		SIMDVec4 rows[4] = { _rows[0], _rows[1], _rows[2], SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f) };
+		return SIMDMatrix4(rows);
+	}
+
+	inline SIMDVector3 GetTranslation() const
+	{
+		return SIMDVector3(SIMDBackend::GetW(_rows[0]), SIMDBackend::GetW(_rows[1]), SIMDBackend::GetW(_rows[2]));
+	}
+
+	// Multiply by another transform, store the result back to this
+	// i.e. this = this * other, other is applied first
+	inline void Multiply(const SIMDAffine& other)
+	{
+		SIMDVec4 unitW = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
+		for (int i = 0; i < 3; ++i)
+		{
+			SIMDVec4 row = SIMDBackend::Mul(_rows[i], unitW);
+			row = SIMDBackend::MulAdd(SIMDBackend::Swizzle<0, 0, 0, 0>(_rows[i]), other._rows[0], row);
+			row = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(_rows[i]), other._rows[1], row);
+			_rows[i] = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(_rows[i]), other._rows[2], row);
+		}
+	}
+
+	// Transform a point, w is left unchanged
+	inline void TransformPoint(SIMDVector3& v) const
+	{
+		SIMDVec4 col0 = _rows[0];
+		SIMDVec4 col1 = _rows[1];
+		SIMDVec4 col2 = _rows[2];
+		SIMDVec4 col3 = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
+		SIMDBackend::Transpose(col0, col1, col2, col3);
+
+		SIMDVec4 result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<0, 0, 0, 0>(v._data), col0, col3);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(v._data), col1, result);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(v._data), col2, result);
+		v._data = SIMDBackend::SetW(result, SIMDBackend::GetW(v._data));
+	}
+
+	// Transform a vector, the translation is ignored and w is left unchanged
+	inline void TransformVector(SIMDVector3& v) const
+	{
+		SIMDVec4 col0 = _rows[0];
+		SIMDVec4 col1 = _rows[1];
+		SIMDVec4 col2 = _rows[2];
+		SIMDVec4 col3 = SIMDBackend::Set(0.0f, 0.0f, 0.0f, 1.0f);
+		SIMDBackend::Transpose(col0, col1, col2, col3);
+
+		SIMDVec4 result = SIMDBackend::Mul(SIMDBackend::Swizzle<0, 0, 0, 0>(v._data), col0);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<1, 1, 1, 1>(v._data), col1, result);
+		result = SIMDBackend::MulAdd(SIMDBackend::Swizzle<2, 2, 2, 2>(v._data), col2, result);
+		v._data = SIMDBackend::SetW(result, SIMDBackend::GetW(v._data));
+	}
+
+	// Invert a rotation and translation, store the result back to this
+	// The upper 3x3 must be a rotation, use Invert when it has scale
+	void InvertRigid();
+
+	// Invert any affine transform, store the result back to this
+	// Return false and leave the transform unchanged if it is singular
+	bool Invert();
+
+	// Split into translation, rotation and scale, a reflection is returned as a negative x scale
+	// Return false if a scale is zero, shear is lost
+	bool Decompose(SIMDVector3& translation, SIMDQuaternion& rotation, SIMDVector3& scale) const;
+};
+
+// Translation, rotation and scale, applied to a point as scale first and translation last
+// Cheaper to compose and invert than a matrix and it does not drift away from a rotation,
+// composition and inversion are exact when the scale is uniform
+class SIMD_ALIGN(16) SIMDTransform
+{
+private:
+	SIMDVector3 _translation;
+	SIMDQuaternion _rotation;
+	SIMDVector3 _scale;
+public:
+	static const SIMDTransform Identity;
+
+	// Default constructor
+	inline SIMDTransform(){};
+
+	// Construct with given translation, rotation and scale
+	inline SIMDTransform(const SIMDVector3& translation, const SIMDQuaternion& rotation, const SIMDVector3& scale)
+		: _translation(translation)
+		, _rotation(rotation)
+		, _scale(scale)
+	{}
+
+	inline const SIMDVector3& GetTranslation() const
+	{
+		return _translation;
+	}
+
+	inline const SIMDQuaternion& GetRotation() const
+	{
+		return _rotation;
+	}
+
+	inline const SIMDVector3& GetScale() const
+	{
+		return _scale;
+	}
+
+	inline void SetTranslation(const SIMDVector3& translation)
+	{
+		_translation = translation;
+	}
+
+	inline void SetRotation(const SIMDQuaternion& rotation)
+	{
+		_rotation = rotation;
+	}
+
+	inline void SetScale(const SIMDVector3& scale)
+	{
+		_scale = scale;
+	}
+
+	// Move by an offset in world space
+	inline void Translate(const SIMDVector3& offset)
+	{
+		_translation._data = SIMDBackend::Add(_translation._data, SIMDBackend::SetW(offset._data, 0.0f));
+	}
+
+	// Rotate in local space, q is applied before the current rotation
+	inline void Rotate(const SIMDQuaternion& q)
+	{
+		_rotation.Multiply(q);
+	}
+
+	// Scale uniformly
+	inline void Scale(float scalar)
+	{
+		_scale._data = SIMDBackend::Mul(_scale._data, SIMDBackend::Set(scalar, scalar, scalar, 1.0f));
+	}
+
+	// Multiply by another transform, store the result back to this
+	// i.e. this = this * other, other is applied first
+	void Multiply(const SIMDTransform& other);
+
+	// Invert the transform, store the result back to this
+	void Invert();
+
+	// Transform a point
+	inline void TransformPoint(SIMDVector3& v) const
+	{
+		TransformVector(v);
+		v._data = SIMDBackend::Add(v._data, SIMDBackend::SetW(_translation._data, 0.0f));
+	}
+
+	// Transform a vector, the translation is ignored
+	inline void TransformVector(SIMDVector3& v) const
+	{
+		v._data = SIMDBackend::Mul(v._data, SIMDBackend::SetW(_scale._data, 1.0f));
+		v.Rotate(_rotation);
+	}
+
+	// Return the affine matrix
+	inline SIMDAffine ToAffine() const
+	{
+		return SIMDAffine(_translation, _rotation, _scale);
+	}
+
+	// Return the 4x4 matrix
+	inline SIMDMatrix4 ToMatrix4() const
+	{
+		return ToAffine().ToMatrix4();
+	}
+
+	// Interpolate translation and scale linearly and rotation with Slerp, return the resultant transform
+	friend SIMDTransform Lerp(const SIMDTransform& a, const SIMDTransform& b, float t);
+};
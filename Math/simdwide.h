@@ -0,0 +1,255 @@
+#pragma once
+
+/** Structure of arrays 3D vectors, x, y and z of 4 or 8 vectors are each held in one register */
+// Lane i of every register belongs to vector i, so every operation works on all the vectors at once
+// Comparisons return a mask with a lane set for each vector that passes, for Select or MoveMask
+
+#include "simdmath.h"
+
+typedef SIMDBackend8::Vec8 SIMDVec8;
+
+template <typename B>
+class SIMDVector3xN
+{
+public:
+	// One float per vector
+	typedef decltype(B::Splat(0.0f)) Lanes;
+
+	static const int Width = B::Width;
+
+	// Default constructor
+	inline SIMDVector3xN(){};
+
+	// Construct with given lanes of x, y and z
+	inline SIMDVector3xN(Lanes x, Lanes y, Lanes z)
+		: _x(x)
+		, _y(y)
+		, _z(z)
+	{}
+
+	// Construct with the same vector in every lane
+	inline SIMDVector3xN(float x, float y, float z)
+		: _x(B::Splat(x))
+		, _y(B::Splat(y))
+		, _z(B::Splat(z))
+	{}
+
+	inline explicit SIMDVector3xN(const SIMDVector3& v)
+		: _x(B::Splat(v.GetX()))
+		, _y(B::Splat(v.GetY()))
+		, _z(B::Splat(v.GetZ()))
+	{}
+
+	// Load Width vectors from x, y and z arrays, which must be aligned to Width floats
+	static inline SIMDVector3xN Load(const float* x, const float* y, const float* z)
+	{
+		return SIMDVector3xN(B::Load(x), B::Load(y), B::Load(z));
+	}
+
+	static inline SIMDVector3xN LoadUnaligned(const float* x, const float* y, const float* z)
+	{
+		return SIMDVector3xN(B::LoadUnaligned(x), B::LoadUnaligned(y), B::LoadUnaligned(z));
+	}
+
+	// Load Width vectors from an array of SIMDVector3, the stride is in bytes
+	static inline SIMDVector3xN Gather(const SIMDVector3* v, size_t stride = sizeof(SIMDVector3))
+	{
+		SIMD_ALIGN(32) float x[Width];
+		SIMD_ALIGN(32) float y[Width];
+		SIMD_ALIGN(32) float z[Width];
+		for (int i = 0; i < Width; ++i)
+		{
+			const SIMDVector3& element = *(const SIMDVector3*) ((const char*) v + i * stride);
+			x[i] = element.GetX();
+			y[i] = element.GetY();
+			z[i] = element.GetZ();
+		}
+		return Load(x, y, z);
+	}
+
+	// Store the vectors to x, y and z arrays, which must be aligned to Width floats
+	inline void Store(float* x, float* y, float* z) const
+	{
+		B::Store(x, _x);
+		B::Store(y, _y);
+		B::Store(z, _z);
+	}
+
+	inline void StoreUnaligned(float* x, float* y, float* z) const
+	{
+		B::StoreUnaligned(x, _x);
+		B::StoreUnaligned(y, _y);
+		B::StoreUnaligned(z, _z);
+	}
+
+	// Return the vector in one lane
+	inline SIMDVector3 GetLane(int lane) const
+	{
+		SIMD_ALIGN(32) float x[Width];
+		SIMD_ALIGN(32) float y[Width];
+		SIMD_ALIGN(32) float z[Width];
+		Store(x, y, z);
+		return SIMDVector3(x[lane], y[lane], z[lane]);
+	}
+
+	inline Lanes GetX() const
+	{
+		return _x;
+	}
+
+	inline Lanes GetY() const
+	{
+		return _y;
+	}
+
+	inline Lanes GetZ() const
+	{
+		return _z;
+	}
+
+	// Dot products, one per lane
+	inline Lanes Dot(const SIMDVector3xN& other) const
+	{
+		return B::MulAdd(_z, other._z, B::MulAdd(_y, other._y, B::Mul(_x, other._x)));
+	}
+
+	// Add two vectors, store result back to this
+	inline void Add(const SIMDVector3xN& other)
+	{
+		_x = B::Add(_x, other._x);
+		_y = B::Add(_y, other._y);
+		_z = B::Add(_z, other._z);
+	}
+
+	// Overload + operator
+	inline SIMDVector3xN operator+(const SIMDVector3xN& other) const
+	{
+		return SIMDVector3xN(B::Add(_x, other._x), B::Add(_y, other._y), B::Add(_z, other._z));
+	}
+
+	// Overload += operator
+	inline void operator+=(const SIMDVector3xN& other)
+	{
+		Add(other);
+	}
+
+	// Substract the other vectors from this, store result back to this
+	inline void Substract(const SIMDVector3xN& other)
+	{
+		_x = B::Sub(_x, other._x);
+		_y = B::Sub(_y, other._y);
+		_z = B::Sub(_z, other._z);
+	}
+
+	// Overload - operator
+	inline SIMDVector3xN operator-(const SIMDVector3xN& other) const
+	{
+		return SIMDVector3xN(B::Sub(_x, other._x), B::Sub(_y, other._y), B::Sub(_z, other._z));
+	}
+
+	// Overload -= operator
+	inline void operator-=(const SIMDVector3xN& other)
+	{
+		Substract(other);
+	}
+
+	// Multiply each vector by the scalar in its lane, store result back to this
+	inline void Multiply(Lanes scalar)
+	{
+		_x = B::Mul(_x, scalar);
+		_y = B::Mul(_y, scalar);
+		_z = B::Mul(_z, scalar);
+	}
+
+	inline void Multiply(float scalar)
+	{
+		Multiply(B::Splat(scalar));
+	}
+
+	// Overload * operator
+	inline SIMDVector3xN operator*(Lanes scalar) const
+	{
+		return SIMDVector3xN(B::Mul(_x, scalar), B::Mul(_y, scalar), B::Mul(_z, scalar));
+	}
+
+	inline SIMDVector3xN operator*(float scalar) const
+	{
+		return *this * B::Splat(scalar);
+	}
+
+	// Normalize the vectors with the approximate reciprocal square root, store result back to this
+	inline SIMDVector3xN& Normalize()
+	{
+		Multiply(B::Rsqrt(LengthSquared()));
+		return *this;
+	}
+
+	// Return the squares of the lengths
+	inline Lanes LengthSquared() const
+	{
+		return Dot(*this);
+	}
+
+	// Return the lengths
+	inline Lanes Length() const
+	{
+		return B::Sqrt(LengthSquared());
+	}
+
+	// Return the cross products of two sets of vectors
+	inline friend SIMDVector3xN CrossProduct(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return SIMDVector3xN(B::Sub(B::Mul(a._y, b._z), B::Mul(a._z, b._y)),
+			B::Sub(B::Mul(a._z, b._x), B::Mul(a._x, b._z)),
+			B::Sub(B::Mul(a._x, b._y), B::Mul(a._y, b._x)));
+	}
+
+	// Componentwise minimum and maximum
+	inline friend SIMDVector3xN Min(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return SIMDVector3xN(B::Min(a._x, b._x), B::Min(a._y, b._y), B::Min(a._z, b._z));
+	}
+
+	inline friend SIMDVector3xN Max(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return SIMDVector3xN(B::Max(a._x, b._x), B::Max(a._y, b._y), B::Max(a._z, b._z));
+	}
+
+	// The vectors of a where mask is set, the vectors of b elsewhere
+	inline friend SIMDVector3xN Select(Lanes mask, const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return SIMDVector3xN(B::Select(mask, a._x, b._x), B::Select(mask, a._y, b._y), B::Select(mask, a._z, b._z));
+	}
+
+	// Bit i is set if lane i of the mask is set
+	static inline int MoveMask(Lanes mask)
+	{
+		return B::MoveMask(mask);
+	}
+
+	// Mask of the lanes where every component of a is less than that of b
+	inline friend Lanes AllLess(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return B::And(B::And(B::CmpLT(a._x, b._x), B::CmpLT(a._y, b._y)), B::CmpLT(a._z, b._z));
+	}
+
+	// Mask of the lanes where every component of a is less than or equal to that of b
+	inline friend Lanes AllLessEqual(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return B::And(B::And(B::CmpLE(a._x, b._x), B::CmpLE(a._y, b._y)), B::CmpLE(a._z, b._z));
+	}
+
+	// Mask of the lanes where a and b are the same vector
+	inline friend Lanes Equal(const SIMDVector3xN& a, const SIMDVector3xN& b)
+	{
+		return B::And(B::And(B::CmpEQ(a._x, b._x), B::CmpEQ(a._y, b._y)), B::CmpEQ(a._z, b._z));
+	}
+
+private:
+	Lanes _x;
+	Lanes _y;
+	Lanes _z;
+};
+
+typedef SIMDVector3xN<SIMDBackend> SIMDVector3x4;
+typedef SIMDVector3xN<SIMDBackend8> SIMDVector3x8;
@@ -0,0 +1,60 @@
+// DoubleBufferedAllocator.h: two linear allocators used in alternate frames
+// Memory allocated in a frame stays valid until the end of the next frame
+#ifndef DOUBLEBUFFEREDALLOCATOR_H_
+#define DOUBLEBUFFEREDALLOCATOR_H_
+
+#include "LinearAllocator.h"
+
+class DoubleBufferedAllocator
+{
+public:
+	DoubleBufferedAllocator()
+		: m_iCurrent(0)
+	{}
+
+	// Reserve size bytes for each buffer
+	void Construct(size_t size)
+	{
+		m_Buffers[0].Construct(size);
+		m_Buffers[1].Construct(size);
+		m_iCurrent = 0;
+	}
+
+	void Destruct()
+	{
+		m_Buffers[0].Destruct();
+		m_Buffers[1].Destruct();
+	}
+
+	// Call at the end of every frame, frees what was allocated two frames ago
+	inline void SwapBuffers()
+	{
+		m_iCurrent ^= 1;
+		m_Buffers[m_iCurrent].Reset();
+	}
+
+	// Allocate from the current frame's buffer, return NULL if the buffer is full
+	inline void* Allocate(size_t size, size_t alignment = MEMORY_ALIGNMENT)
+	{
+		return m_Buffers[m_iCurrent].Allocate(size, alignment);
+	}
+
+	// Allocate an uninitialized array of count elements
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return m_Buffers[m_iCurrent].AllocateArray<T>(count);
+	}
+
+	// Buffer of the current frame
+	inline LinearAllocator& GetCurrent()
+	{
+		return m_Buffers[m_iCurrent];
+	}
+
+private:
+	LinearAllocator							m_Buffers[2];
+	unsigned int							m_iCurrent;
+};
+
+#endif
@@ -1,22 +1,42 @@
 // Handle.h: the struct for a handle (array index) to reference memory location
+#ifndef HANDLE_H_
+#define HANDLE_H_
 
 #include <stdint.h>
 
+// Largest generation value that fits in m_counter, generation 0 is reserved for invalid handles
+const uint32_t HANDLE_MAX_GENERATION = (1 << 11) - 1;
+
 struct Handle
 {
+	// Default constructor, creates an invalid handle
+	Handle()
+		: m_poolIndex(0)
+		, m_blockIndex(0)
+		, m_counter(0)
+	{}
+
 	// Constructor
-	Handle(uint32_t poolIndex, uint32_t blockIndex)
+	Handle(uint32_t poolIndex, uint32_t blockIndex, uint32_t counter = 0)
 		: m_poolIndex(poolIndex)
 		, m_blockIndex(blockIndex)
-		, m_counter(0)
+		, m_counter(counter)
 	{}
 
 	uint32_t							m_poolIndex : 5;
 	uint32_t							m_blockIndex : 16;
-	uint32_t							m_counter : 11;
+	uint32_t							m_counter : 11; // generation of the block when the handle was issued
+
+	// Return true if the handle was issued by an allocation
+	inline bool IsValid() const
+	{
+		return m_counter != 0;
+	}
 
 	operator uint32_t() const
 	{
-		return m_counter << 21 || m_blockIndex << 5 || m_poolIndex;
+		return m_counter << 21 | m_blockIndex << 5 | m_poolIndex;
 	}
 };
+
+#endif
@@ -0,0 +1,38 @@
+// LinearAllocator.cpp
+
+#include "LinearAllocator.h"
+#include <stdlib.h>
+
+void LinearAllocator::Construct(size_t size)
+{
+	Destruct();
+	m_pStart = (char*) malloc(size);
+	m_iSize = m_pStart ? size : 0;
+	m_iOffset = 0;
+}
+
+void LinearAllocator::Destruct()
+{
+	free(m_pStart);
+	m_pStart = NULL;
+	m_iSize = 0;
+	m_iOffset = 0;
+}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment)
+{
+	assert((alignment & (alignment - 1)) == 0);
+
+	// Align the address rather than the offset, the backing memory is only as aligned as malloc
+	uintptr_t current = (uintptr_t) (m_pStart + m_iOffset);
+	uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t) (alignment - 1);
+	size_t offset = m_iOffset + (size_t) (aligned - current);
+
+	if (!m_pStart || offset + size > m_iSize)
+	{
+		return NULL; // out of space
+	}
+
+	m_iOffset = offset + size;
+	return m_pStart + offset;
+}
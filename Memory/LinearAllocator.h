@@ -0,0 +1,76 @@
+// LinearAllocator.h: bump allocator for short lived memory, freed all at once
+#ifndef LINEARALLOCATOR_H_
+#define LINEARALLOCATOR_H_
+
+#include "MemoryPool.h"
+
+// Size of each buffer of the frame allocator
+const size_t MEMORY_FRAME_ALLOCATOR_SIZE = 1 << 20;
+
+// Not thread safe, each thread should own its own allocator
+class LinearAllocator
+{
+public:
+	LinearAllocator()
+		: m_pStart(NULL)
+		, m_iSize(0)
+		, m_iOffset(0)
+	{}
+
+	~LinearAllocator() {
+		Destruct();
+	}
+
+	// Reserve size bytes of backing memory
+	void Construct(size_t size);
+
+	void Destruct();
+
+	// Allocate size bytes aligned to alignment (a power of two), return NULL if the allocator is full
+	void* Allocate(size_t size, size_t alignment = MEMORY_ALIGNMENT);
+
+	// Allocate an uninitialized array of count elements
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return (T*) Allocate(sizeof(T) * count);
+	}
+
+	// Free every allocation at once
+	inline void Reset()
+	{
+		m_iOffset = 0;
+	}
+
+	// Return the current top, FreeToMarker frees everything allocated after it
+	inline size_t GetMarker() const
+	{
+		return m_iOffset;
+	}
+
+	inline void FreeToMarker(size_t marker)
+	{
+		assert(marker <= m_iOffset);
+		m_iOffset = marker;
+	}
+
+	inline size_t GetUsedSize() const
+	{
+		return m_iOffset;
+	}
+
+	inline size_t GetSize() const
+	{
+		return m_iSize;
+	}
+
+private:
+	LinearAllocator(const LinearAllocator&);
+	LinearAllocator& operator=(const LinearAllocator&);
+
+	char*									m_pStart;
+	size_t									m_iSize;
+	size_t									m_iOffset;
+};
+
+#endif
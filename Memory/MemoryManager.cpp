@@ -1,71 +1,592 @@
 // MemoryManager.cpp
 
 #include "MemoryManager.h"
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define MEMORY_THREAD_LOCAL __declspec(thread)
+#else
+#define MEMORY_THREAD_LOCAL thread_local
+#define MEMORY_HAS_THREAD_EXIT_FLUSH
+#endif
+
+namespace
+{
+	// Stack of free block indices owned by one thread for one pool
+	struct Magazine
+	{
+		unsigned int						m_iCount;
+		unsigned int						m_pIndices[MEMORY_CACHE_CAPACITY];
+	};
+
+	// Blocks cached by one thread for every pool, zero initialized
+	struct ThreadCache
+	{
+		unsigned int						m_iEpoch;
+		Magazine							m_Magazines[MEMORY_POOL_MAX];
+	};
+
+	MEMORY_THREAD_LOCAL ThreadCache			t_Cache;
+
+#ifdef MEMORY_HAS_THREAD_EXIT_FLUSH
+	// Return the cached blocks to the pools when the thread exits
+	struct ThreadCacheFlusher
+	{
+		~ThreadCacheFlusher()
+		{
+			if (MemoryManager::HasInstance())
+				MemoryManager::GetInstance()->FlushThreadCache();
+		}
+	};
+
+	thread_local ThreadCacheFlusher			t_Flusher;
+#endif
+
+	std::atomic<unsigned int>				g_iNextEpoch(1);
+
+	// Index of the highest set bit, value must not be 0
+	inline unsigned int floorLog2(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+#ifdef _WIN64
+		_BitScanReverse64(&index, value);
+#else
+		if (value >> 32)
+		{
+			_BitScanReverse(&index, (unsigned long) (value >> 32));
+			return index + 32;
+		}
+		_BitScanReverse(&index, (unsigned long) value);
+#endif
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	// System heap memory with the alignment of pool blocks
+	void* alignedMalloc(size_t size)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, MEMORY_ALIGNMENT);
+#else
+		void* ptr;
+		return posix_memalign(&ptr, MEMORY_ALIGNMENT, size) == 0 ? ptr : NULL;
+#endif
+	}
+
+	void alignedFree(void* ptr)
+	{
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	// Key of a slot in the relocation callback table
+	inline uint32_t relocationKey(unsigned int poolIndex, unsigned int slot)
+	{
+		return poolIndex << 16 | slot;
+	}
+
+	// Return the calling thread's cache, emptied if it belongs to another heap
+	ThreadCache& getThreadCache(unsigned int epoch)
+	{
+		ThreadCache& cache = t_Cache;
+		if (cache.m_iEpoch != epoch)
+		{
+			for (unsigned int i = 0; i < MEMORY_POOL_MAX; ++i)
+			{
+				cache.m_Magazines[i].m_iCount = 0;
+			}
+			cache.m_iEpoch = epoch;
+#ifdef MEMORY_HAS_THREAD_EXIT_FLUSH
+			(void) &t_Flusher; // construct the flusher for this thread
+#endif
+		}
+		return cache;
+	}
+}
 
 MemoryManager* MemoryManager::m_pInstance;
 
-void MemoryManager::Construct()
+bool MemoryManager::Construct(bool useHugePages)
+{
+	m_iPoolNum = MEMORY_POOL_NUM;
+	memcpy(m_PoolConfig, MEMORY_POOL_CONFIG, sizeof(MEMORY_POOL_CONFIG));
+	return constructPools(useHugePages);
+}
+
+bool MemoryManager::Construct(const char* configFile, bool useHugePages)
 {
-	unsigned int heapSize = 0;
+	m_iPoolNum = MemoryProfile::LoadPoolConfig(configFile, m_PoolConfig, MEMORY_POOL_MAX);
+	if (m_iPoolNum == 0)
+		return false;
+	return constructPools(useHugePages);
+}
+
+bool MemoryManager::constructPools(bool useHugePages)
+{
+	bool hugePages[MEMORY_POOL_MAX];
+	size_t heapSize = MEMORY_COMMIT_SIZE; // room to align the first pool
+
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
+	{
+		hugePages[i] = useHugePages && m_PoolConfig[i][0] >= MEMORY_HUGE_PAGE_MIN_BLOCK_SIZE;
+		heapSize += MemoryPool::RequiredSize(m_PoolConfig[i][0], m_PoolConfig[i][1], hugePages[i]);
+	}
+
+	// Address space only, nothing is backed by memory yet
+	m_pRawHeapStart = VirtualMemory::Reserve(heapSize);
+	if (!m_pRawHeapStart)
+		return false;
+	m_iHeapSize = heapSize;
 
-	for (unsigned int i = 0; i < MEMORY_POOL_NUM; ++i)
+	// The new heap has its own range, so the range of the last one is no longer needed
+	VirtualMemory::Release(m_pRetiredHeapStart, m_iRetiredHeapSize);
+	m_pRetiredHeapStart = NULL;
+	m_iRetiredHeapSize = 0;
+
+	void* heapStart = m_pRawHeapStart;
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
 	{
-		heapSize += MEMORY_POOL_CONFIG[i][0] * MEMORY_POOL_CONFIG[i][1] + sizeof(unsigned int) * 3;
+		m_pPool[i] = MemoryPool::Construct(m_PoolConfig[i][0], m_PoolConfig[i][1], hugePages[i], heapStart);
+		if (!m_pPool[i])
+		{
+			Destruct();
+			return false;
+		}
 	}
-	m_pRawHeapStart = malloc(heapSize);
-	void* heapStart = alignedAddress(m_pRawHeapStart); // align the start of memory pool
 
-	for (unsigned int i = 0; i < MEMORY_POOL_NUM; ++i)
+#ifdef MEMORY_TELEMETRY
+	unsigned int blockNum[MEMORY_POOL_MAX];
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
 	{
-		m_pPool[i] = MemoryPool::Construct(MEMORY_POOL_CONFIG[i][0], MEMORY_POOL_CONFIG[i][1], heapStart);
+		blockNum[i] = m_PoolConfig[i][1];
 	}
+	m_Telemetry.Construct(m_iPoolNum, blockNum);
+#endif
+
+	buildSizeClasses();
+	m_iEpoch = g_iNextEpoch.fetch_add(1);
+	m_iDefragmentPool = 0;
+	return true;
+}
+
+void MemoryManager::buildSizeClasses()
+{
+	unsigned int pool = 0;
+	for (unsigned int i = 0; i < sizeof(m_SmallSizeClass); ++i)
+	{
+		while (pool < m_iPoolNum && i * MEMORY_ALIGNMENT > m_PoolConfig[pool][0])
+			++pool;
+		m_SmallSizeClass[i] = (uint8_t) pool;
+	}
+
+	pool = 0;
+	for (unsigned int k = 0; k < sizeof(m_LargeSizeClass); ++k)
+	{
+		while (pool < m_iPoolNum && ((uint64_t) 1 << k) >= m_PoolConfig[pool][0])
+			++pool;
+		m_LargeSizeClass[k] = (uint8_t) pool;
+	}
+}
+
+unsigned int MemoryManager::GetSizeClass(size_t size) const
+{
+	// Block sizes are multiples of the bucket size, so the table is exact
+	if (size <= MEMORY_SIZE_CLASS_SMALL_MAX)
+		return m_SmallSizeClass[(size + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT];
+
+	// Only pools inside the power of two range of size are compared
+	unsigned int i = m_LargeSizeClass[floorLog2(size - 1)];
+	while (i < m_iPoolNum && size > m_PoolConfig[i][0])
+		++i;
+	return i;
 }
 
 void MemoryManager::Destruct()
 {
+	for (unsigned int i = 0; i < MEMORY_POOL_MAX; ++i)
+	{
+		if (m_pPool[i])
+			m_pPool[i]->Destruct();
+		m_pPool[i] = NULL;
+	}
+
+	// Keep the range reserved so no later allocation lands in it and pointers into it stay recognizable
+	if (m_pRawHeapStart)
+	{
+		VirtualMemory::Release(m_pRetiredHeapStart, m_iRetiredHeapSize);
+		VirtualMemory::Decommit(m_pRawHeapStart, m_iHeapSize);
+		m_pRetiredHeapStart = m_pRawHeapStart;
+		m_iRetiredHeapSize = m_iHeapSize;
+	}
+	m_pRawHeapStart = NULL;
+	m_iHeapSize = 0;
+	m_iPoolNum = 0;
+	buildSizeClasses();
+	m_iEpoch = 0;
+	m_RelocationCallbacks.clear();
+
+#ifdef MEMORY_TELEMETRY
+	m_Telemetry.StopRecording();
+	m_Telemetry.Destruct();
+#endif
+}
+
+void MemoryManager::EndFrame()
+{
+#ifdef MEMORY_TELEMETRY
+	m_Telemetry.EndFrame();
+#endif
+}
+
+void MemoryManager::Print()
+{
+	if (!m_pRawHeapStart)
+	{
+		std::cout << "Memory manager is not constructed\n";
+		return;
+	}
+
+	std::cout << "Pool  Block size  Blocks  Free  Committed";
+#ifdef MEMORY_TELEMETRY
+	std::cout << "  Live  Peak  Failed  Requested  Frame allocs";
+#endif
+	std::cout << "\n";
+
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
+	{
+		const MemoryPool* pool = m_pPool[i];
+		std::cout << i << "  " << pool->m_iBlockSize << "  " << pool->m_iBlockNum << "  " << pool->m_iFreeBlockNum.load() << "  " << pool->m_iCommittedSize;
+#ifdef MEMORY_TELEMETRY
+		MemoryPoolStats stats = m_Telemetry.GetPoolStats(i);
+		std::cout << "  " << stats.m_iLiveBlocks << "  " << stats.m_iPeakBlocks << "  " << stats.m_iFailedAllocations
+			<< "  " << stats.m_iRequestedBytes << "  " << stats.m_iFrameAllocations;
+#endif
+		std::cout << "\n";
+	}
+
+#ifdef MEMORY_TELEMETRY
+	for (unsigned int i = 0; i < MEMORY_TAG_NUM; ++i)
+	{
+		MemoryTagStats stats = m_Telemetry.GetTagStats((MemoryTag) i);
+		std::cout << MEMORY_TAG_NAMES[i] << ": live " << stats.m_iLiveBlocks << " blocks, " << stats.m_iLiveBytes << " bytes, "
+			<< stats.m_iFrameAllocations << " allocations last frame\n";
+	}
+	std::cout << "Oversize failed: " << m_Telemetry.GetOversizeFailed() << "\n";
+#endif
+}
+
+void MemoryManager::DumpJson(std::ostream& out)
+{
+	out << "{\n\t\"telemetry\": ";
+#ifdef MEMORY_TELEMETRY
+	out << "true,\n\t\"oversizeFailed\": " << m_Telemetry.GetOversizeFailed();
+#else
+	out << "false";
+#endif
+	out << ",\n\t\"committedBytes\": " << GetCommittedSize() << ",\n\t\"pools\": [";
+
+	for (unsigned int i = 0; m_pRawHeapStart && i < m_iPoolNum; ++i)
+	{
+		const MemoryPool* pool = m_pPool[i];
+		out << (i ? ",\n" : "\n") << "\t\t{ \"blockSize\": " << pool->m_iBlockSize << ", \"blocks\": " << pool->m_iBlockNum
+			<< ", \"free\": " << pool->m_iFreeBlockNum.load() << ", \"committedBytes\": " << pool->m_iCommittedSize;
+#ifdef MEMORY_TELEMETRY
+		// Internal fragmentation is the share of the live block bytes that was not asked for
+		MemoryPoolStats stats = m_Telemetry.GetPoolStats(i);
+		uint64_t liveBytes = (uint64_t) stats.m_iLiveBlocks * pool->m_iBlockSize;
+		double fragmentation = liveBytes ? 1.0 - (double) stats.m_iRequestedBytes / liveBytes : 0.0;
+		out << ", \"live\": " << stats.m_iLiveBlocks << ", \"peak\": " << stats.m_iPeakBlocks
+			<< ", \"failed\": " << stats.m_iFailedAllocations << ", \"requestedBytes\": " << stats.m_iRequestedBytes
+			<< ", \"fragmentation\": " << fragmentation << ", \"frameAllocations\": " << stats.m_iFrameAllocations
+			<< ", \"peakFrameAllocations\": " << stats.m_iPeakFrameAllocations;
+#endif
+		out << " }";
+	}
+	out << "\n\t]";
 
+#ifdef MEMORY_TELEMETRY
+	out << ",\n\t\"tags\": {";
+	for (unsigned int i = 0; i < MEMORY_TAG_NUM; ++i)
+	{
+		MemoryTagStats stats = m_Telemetry.GetTagStats((MemoryTag) i);
+		out << (i ? ",\n" : "\n") << "\t\t\"" << MEMORY_TAG_NAMES[i] << "\": { \"live\": " << stats.m_iLiveBlocks
+			<< ", \"liveBytes\": " << stats.m_iLiveBytes << ", \"frameAllocations\": " << stats.m_iFrameAllocations
+			<< ", \"peakFrameAllocations\": " << stats.m_iPeakFrameAllocations << " }";
+	}
+	out << "\n\t}";
+#endif
+	out << "\n}\n";
 }
 
-void MemoryManager::Defragment()
+bool MemoryManager::DumpJson(const char* filename)
 {
+	std::ofstream file(filename);
+	if (!file)
+		return false;
+	DumpJson(file);
+	return true;
 }
 
-Handle MemoryManager::Allocate(size_t size)
+void MemoryManager::Defragment(float budgetMs)
 {
-	for (unsigned int i = 0; i < MEMORY_POOL_NUM; ++i) 
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(budgetMs));
+	unsigned int steps = 0;
+
+	// The calling thread's cached slots are not live, they are moved like any other free slot
+	for (unsigned int n = 0; n < m_iPoolNum; ++n)
 	{
-		if (size <= MEMORY_POOL_CONFIG[i][0])
+		MemoryPool* pool = m_pPool[m_iDefragmentPool];
+		if (!pool)
+			return;
+
+		// Only blocks carved so far can be live
+		if (!pool->m_bCompacting)
+		{
+			pool->m_iCompactLow = 0;
+			pool->m_iCompactHigh = pool->m_iCarvedNum ? pool->m_iCarvedNum - 1 : 0;
+			pool->m_iCompactMoves = 0;
+			pool->m_bCompacting = true;
+		}
+
+		// Two fingers: fill the lowest hole with the highest live block, pinned blocks stay
+		while (pool->m_iCompactLow < pool->m_iCompactHigh)
 		{
-			if (!m_pPool[i]->m_pFreeList)
+			bool moved = false;
+			unsigned int lowSlot = pool->m_pBlockSlot[pool->m_iCompactLow];
+			unsigned int highSlot = pool->m_pBlockSlot[pool->m_iCompactHigh];
+
+			if (pool->m_pSlotFlags[lowSlot] & MEMORY_SLOT_LIVE)
+			{
+				++pool->m_iCompactLow;
+			}
+			else if (!(pool->m_pSlotFlags[highSlot] & MEMORY_SLOT_LIVE) || (pool->m_pSlotFlags[highSlot] & MEMORY_SLOT_PINNED))
+			{
+				--pool->m_iCompactHigh;
+			}
+			else
 			{
-				assert(false || "no block left");
+				void* oldAddress = pool->GetBlock(pool->m_iCompactHigh);
+				pool->Relocate(highSlot, lowSlot);
+				pool->m_iCompactMoves++;
+				if (pool->m_pSlotFlags[highSlot] & MEMORY_SLOT_RELOCATION_CALLBACK)
+				{
+					notifyRelocation(m_iDefragmentPool, highSlot, oldAddress, pool->GetBlock(pool->m_iCompactLow));
+				}
+				++pool->m_iCompactLow;
+				--pool->m_iCompactHigh;
+				moved = true;
 			}
 
-			m_pPool[i]->m_iFreeBlockNum--;
-			return Handle(i, m_pPool[i]->m_iFreeBlockIndex++);
+			// Copying a block may be slow, scanning is not
+			if ((moved || (++steps & 63) == 0) && Clock::now() >= deadline)
+				return;
 		}
+
+		// Pass complete, hand out the front blocks first so the pool stays compact
+		if (pool->m_iCompactMoves)
+		{
+			pool->SortFreeList();
+		}
+		pool->m_bCompacting = false;
+
+		m_iDefragmentPool = (m_iDefragmentPool + 1) % m_iPoolNum;
+		if (Clock::now() >= deadline)
+			return;
+	}
+}
+
+void MemoryManager::SetRelocationCallback(Handle hle, RelocationCallback callback, void* userData)
+{
+	if (!IsValidHandle(hle))
+		return;
+
+	MemoryPool* pool = m_pPool[hle.m_poolIndex];
+	std::lock_guard<std::mutex> lock(m_RelocationMutex);
+	if (callback)
+	{
+		RelocationEntry entry = { callback, userData };
+		m_RelocationCallbacks[relocationKey(hle.m_poolIndex, hle.m_blockIndex)] = entry;
+		pool->m_pSlotFlags[hle.m_blockIndex] |= MEMORY_SLOT_RELOCATION_CALLBACK;
 	}
+	else
+	{
+		m_RelocationCallbacks.erase(relocationKey(hle.m_poolIndex, hle.m_blockIndex));
+		pool->m_pSlotFlags[hle.m_blockIndex] &= ~MEMORY_SLOT_RELOCATION_CALLBACK;
+	}
+}
 
-	assert(false || "no block fits");
+void MemoryManager::notifyRelocation(unsigned int poolIndex, unsigned int slot, void* oldAddress, void* newAddress)
+{
+	RelocationEntry entry;
+	{
+		std::lock_guard<std::mutex> lock(m_RelocationMutex);
+		std::unordered_map<uint32_t, RelocationEntry>::iterator itr = m_RelocationCallbacks.find(relocationKey(poolIndex, slot));
+		if (itr == m_RelocationCallbacks.end())
+			return;
+		entry = itr->second;
+	}
+	entry.m_Callback(oldAddress, newAddress, entry.m_pUserData);
 }
 
-void MemoryManager::Free(Handle hle)
+Handle MemoryManager::Allocate(size_t size, MemoryTag tag)
 {
-	unsigned int index = m_pPool[hle.m_poolIndex]->m_iFreeBlockNum++;
+	// Not constructed, AllocateRaw falls back to the system heap and no pool failed
+	if (!m_pRawHeapStart)
+		return Handle();
+
+	const unsigned int i = GetSizeClass(size);
+	if (i >= m_iPoolNum)
+	{
+#ifdef MEMORY_TELEMETRY
+		m_Telemetry.OnFailedAllocate(0, size, true);
+#endif
+		return Handle(); // no block fits
+	}
+
+	MemoryPool* pool = m_pPool[i];
+	unsigned int index;
+
+	if (pool->m_iCacheCapacity)
+	{
+		// Refill half a magazine at a time so alloc/free at the boundary does not hit the pool
+		Magazine& magazine = getThreadCache(m_iEpoch).m_Magazines[i];
+		if (magazine.m_iCount == 0)
+		{
+			magazine.m_iCount = pool->PopBatch(magazine.m_pIndices, pool->m_iCacheCapacity / 2);
+		}
+		if (magazine.m_iCount == 0)
+		{
+#ifdef MEMORY_TELEMETRY
+			m_Telemetry.OnFailedAllocate(i, size, false);
+#endif
+			return Handle(); // no block left
+		}
+		index = magazine.m_pIndices[--magazine.m_iCount];
+	}
+	else
+	{
+		index = pool->Pop();
+		if (index == MEMORY_POOL_INVALID_INDEX)
+		{
+#ifdef MEMORY_TELEMETRY
+			m_Telemetry.OnFailedAllocate(i, size, false);
+#endif
+			return Handle(); // no block left
+		}
+	}
+
+	pool->m_pSlotFlags[index] = MEMORY_SLOT_LIVE;
+#ifdef MEMORY_TELEMETRY
+	m_Telemetry.OnAllocate(i, index, size, pool->m_iBlockSize, tag);
+#else
+	(void) tag;
+#endif
+	return Handle(i, index, pool->m_pGeneration[index]);
 }
 
-// Return a aligned address according to the alignment
-void* MemoryManager::alignedAddress(void* ptr)
+void MemoryManager::Free(Handle hle)
 {
-	unsigned int adjustment = (unsigned int) ptr % MEMORY_ALIGNMENT;
-	if (adjustment)
+	if (!IsValidHandle(hle))
 	{
-		//unsigned int* intptr = (unsigned int*) ptr;
-		//intptr[0] = adjustment;
-		return (void *)((unsigned int) ptr + MEMORY_ALIGNMENT - adjustment);
+		return; // stale or double free
+	}
+
+	MemoryPool* pool = m_pPool[hle.m_poolIndex];
+	pool->Retire(hle.m_blockIndex);
+#ifdef MEMORY_TELEMETRY
+	m_Telemetry.OnFree(hle.m_poolIndex, hle.m_blockIndex, pool->m_iBlockSize);
+#endif
+	if (pool->m_pSlotFlags[hle.m_blockIndex] & MEMORY_SLOT_RELOCATION_CALLBACK)
+	{
+		std::lock_guard<std::mutex> lock(m_RelocationMutex);
+		m_RelocationCallbacks.erase(relocationKey(hle.m_poolIndex, hle.m_blockIndex));
+	}
+	pool->m_pSlotFlags[hle.m_blockIndex] = 0;
+
+	if (pool->m_iCacheCapacity)
+	{
+		Magazine& magazine = getThreadCache(m_iEpoch).m_Magazines[hle.m_poolIndex];
+		if (magazine.m_iCount == pool->m_iCacheCapacity)
+		{
+			// Drain the older half, keep the recently freed blocks which are still warm
+			unsigned int half = pool->m_iCacheCapacity / 2;
+			pool->PushBatch(magazine.m_pIndices, half);
+			memmove(magazine.m_pIndices, magazine.m_pIndices + half, sizeof(unsigned int) * (magazine.m_iCount - half));
+			magazine.m_iCount -= half;
+		}
+		magazine.m_pIndices[magazine.m_iCount++] = hle.m_blockIndex;
 	}
 	else
 	{
-		return ptr;
+		pool->Push(hle.m_blockIndex);
+	}
+}
+
+void* MemoryManager::AllocateRaw(size_t size, MemoryTag tag)
+{
+	Handle hle = Allocate(size, tag);
+	if (!hle.IsValid())
+	{
+		return alignedMalloc(size);
+	}
+
+	m_pPool[hle.m_poolIndex]->m_pSlotFlags[hle.m_blockIndex] |= MEMORY_SLOT_PINNED;
+	return GetMemoryAddressFromHandle(hle);
+}
+
+void MemoryManager::FreeRaw(void* ptr)
+{
+	// A block of a destructed heap has no pool left to go back to
+	if (m_pRetiredHeapStart && ptr >= m_pRetiredHeapStart && ptr < (const char*) m_pRetiredHeapStart + m_iRetiredHeapSize)
+		return;
+
+	if (!OwnsAddress(ptr))
+	{
+		alignedFree(ptr);
+		return;
+	}
+
+	// A pinned block keeps its slot, so the slot can be found from the address
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
+	{
+		MemoryPool* pool = m_pPool[i];
+		if (ptr >= pool->m_pBlockStart && ptr < pool->GetBlock(pool->m_iBlockNum))
+		{
+			unsigned int block = (unsigned int) (((char*) ptr - pool->m_pBlockStart) / pool->m_iBlockSize);
+			unsigned int slot = pool->m_pBlockSlot[block];
+			assert(pool->m_pSlotFlags[slot] & MEMORY_SLOT_PINNED);
+			Free(Handle(i, slot, pool->m_pGeneration[slot]));
+			return;
+		}
+	}
+}
+
+void MemoryManager::FlushThreadCache()
+{
+	ThreadCache& cache = getThreadCache(m_iEpoch);
+	for (unsigned int i = 0; i < m_iPoolNum; ++i)
+	{
+		Magazine& magazine = cache.m_Magazines[i];
+		if (magazine.m_iCount && m_pPool[i])
+		{
+			m_pPool[i]->PushBatch(magazine.m_pIndices, magazine.m_iCount);
+		}
+		magazine.m_iCount = 0;
 	}
 }
@@ -1,11 +1,18 @@
 // MemoryManager.h: singleton class of memory manager
+// Allocate and Free may be called from any thread, small blocks go through a per-thread cache
+// Defragment moves blocks, it must be called at a sync point where no other thread uses the manager
 #ifndef MEMORYMANAGER_H_
 #define MEMORYMANAGER_H_
 
 #include "MemoryPool.h"
 #include "Handle.h"
+#include "MemoryTelemetry.h"
+#include "MemoryProfile.h"
 #include <iostream>
+#include <unordered_map>
+#include <mutex>
 
+// Default pool table, used when no table is loaded from a file
 const unsigned int MEMORY_POOL_NUM = 23;
 const unsigned int MEMORY_POOL_CONFIG[][2] = 
 {
@@ -36,32 +43,140 @@ const unsigned int MEMORY_POOL_CONFIG[][2] =
 	{ 4194304,  1 },     //
 };
 
+// Pools with blocks at least this large use transparent huge pages when enabled
+const unsigned int MEMORY_HUGE_PAGE_MIN_BLOCK_SIZE = 65536;
+
+// Sizes up to this find their pool in a table of MEMORY_ALIGNMENT byte buckets, larger sizes start from their power of two
+const unsigned int MEMORY_SIZE_CLASS_SMALL_MAX = 1024;
+
+// Default time a Defragment call may spend per frame
+const float MEMORY_DEFRAGMENT_BUDGET_MS = 1.0f;
+
+// Called after a block was moved, for objects holding pointers into their own block
+typedef void (*RelocationCallback)(void* oldAddress, void* newAddress, void* userData);
+
 class MemoryManager
 {
 public:
-	MemoryManager() {};
+	MemoryManager()
+		: m_pRawHeapStart(NULL)
+		, m_iHeapSize(0)
+		, m_pRetiredHeapStart(NULL)
+		, m_iRetiredHeapSize(0)
+		, m_iPoolNum(0)
+		, m_iEpoch(0)
+		, m_iDefragmentPool(0)
+	{
+		for (unsigned int i = 0; i < MEMORY_POOL_MAX; ++i)
+			m_pPool[i] = NULL;
+		buildSizeClasses();
+	}
+
 	~MemoryManager() {
-		free(m_pRawHeapStart);
-		*m_pPool = NULL;
+		Destruct();
+		VirtualMemory::Release(m_pRetiredHeapStart, m_iRetiredHeapSize);
 	}
 
 
-	void Construct();
+	// Reserve address space for every pool, memory is committed as the pools grow
+	// Return false if the address space can not be reserved
+	bool Construct(bool useHugePages = false);
+
+	// Construct with the pool table of a file written by MemoryProfile::SavePoolConfig
+	// Return false if the file can not be read or the table is invalid
+	bool Construct(const char* configFile, bool useHugePages = false);
 	
-	void Defragment();
+	// Move live blocks toward the front of each pool until the time budget runs out
+	// Handles stay valid, raw addresses obtained before the call do not
+	// Continues where the previous call stopped
+	void Defragment(float budgetMs = MEMORY_DEFRAGMENT_BUDGET_MS);
 
+	// Give the pools back to the system, their address range stays reserved until the next Construct
+	// so pool memory freed by containers that outlive the pools is recognized and dropped
 	void Destruct();
 
 	// Allocate a memory block of size from the pool, return the handle
-	Handle Allocate(size_t size);
+	// Return an invalid handle if no pool can serve the size
+	// The tag is recorded for telemetry
+	Handle Allocate(size_t size, MemoryTag tag = MEMORY_TAG_UNTAGGED);
 
-	// Free the memory block back to the pool
+	// Free the memory block back to the pool, stale handles are ignored
 	void Free(Handle hle);
 
-	// Get the raw address stored with reference to handle
+	// Allocate a pinned block that is addressed by pointer and never moved by Defragment
+	// Falls back to the system heap when no pool can serve the size, return NULL only if both fail
+	void* AllocateRaw(size_t size, MemoryTag tag = MEMORY_TAG_UNTAGGED);
+
+	// Free memory returned by AllocateRaw, memory of pools already destructed is ignored
+	void FreeRaw(void* ptr);
+
+	// Return true if the address lies in the block memory of a pool
+	inline bool OwnsAddress(const void* ptr) const
+	{
+		return m_pRawHeapStart && ptr >= m_pRawHeapStart && ptr < (const char*) m_pRawHeapStart + m_iHeapSize;
+	}
+
+	// Register a callback invoked when Defragment moves the block of a handle, NULL removes it
+	// The callback is removed when the block is freed
+	void SetRelocationCallback(Handle hle, RelocationCallback callback, void* userData = NULL);
+
+	// Return every block cached by the calling thread to the pools
+	// Called automatically when a thread exits
+	void FlushThreadCache();
+
+	// Return true if the handle refers to a block that is still allocated
+	inline bool IsValidHandle(Handle hle) const
+	{
+		return hle.IsValid()
+			&& hle.m_poolIndex < m_iPoolNum
+			&& m_pPool[hle.m_poolIndex]
+			&& hle.m_blockIndex < m_pPool[hle.m_poolIndex]->m_iBlockNum
+			&& m_pPool[hle.m_poolIndex]->m_pGeneration[hle.m_blockIndex] == hle.m_counter;
+	}
+
+	// Get the raw address stored with reference to handle, return NULL for a stale handle
 	inline void* GetMemoryAddressFromHandle(Handle hle)
 	{
-		return (void*) ((uint32_t) m_pPool[hle.m_poolIndex] + sizeof(unsigned int) * 3 + m_pPool[hle.m_poolIndex]->m_iBlockSize * hle.m_blockIndex);
+		if (!IsValidHandle(hle))
+			return NULL;
+		return m_pPool[hle.m_poolIndex]->GetSlotBlock(hle.m_blockIndex);
+	}
+
+	// Return the number of blocks on the free list of a pool, blocks cached by threads are not included
+	inline unsigned int GetFreeBlockNum(unsigned int poolIndex) const
+	{
+		return m_pPool[poolIndex]->m_iFreeBlockNum.load();
+	}
+
+	// Return the bytes of block memory committed by all pools
+	size_t GetCommittedSize() const
+	{
+		size_t size = 0;
+		for (unsigned int i = 0; i < m_iPoolNum; ++i)
+		{
+			if (m_pPool[i])
+				size += m_pPool[i]->m_iCommittedSize;
+		}
+		return size;
+	}
+
+	// Return the pool that serves allocations of size bytes, GetPoolNum() if no pool fits
+	unsigned int GetSizeClass(size_t size) const;
+
+	// Number of pools and their block size and count
+	inline unsigned int GetPoolNum() const
+	{
+		return m_iPoolNum;
+	}
+
+	inline unsigned int GetPoolBlockSize(unsigned int poolIndex) const
+	{
+		return m_PoolConfig[poolIndex][0];
+	}
+
+	inline unsigned int GetPoolBlockNum(unsigned int poolIndex) const
+	{
+		return m_PoolConfig[poolIndex][1];
 	}
 
 	// Return singleton instance
@@ -72,6 +187,12 @@ public:
 		return m_pInstance;
 	};
 
+	// Return true if the singleton exists, without creating it
+	static bool HasInstance()
+	{
+		return m_pInstance != NULL;
+	}
+
 	static void DestructandCleanUp()
 	{
 		if (m_pInstance) {
@@ -80,11 +201,54 @@ public:
 		}
 	}
 
-	void Print()
+	// Call once per frame to close the per-frame allocation counters
+	void EndFrame();
+
+	// Print the state of every pool, with telemetry counters when enabled
+	void Print();
+
+	// Write a JSON snapshot of the pools and telemetry counters
+	void DumpJson(std::ostream& out);
+
+	// Write the JSON snapshot to a file, return false if it can not be opened
+	bool DumpJson(const char* filename);
+
+#ifdef MEMORY_TELEMETRY
+	inline MemoryPoolStats GetPoolStats(unsigned int poolIndex) const
+	{
+		return m_Telemetry.GetPoolStats(poolIndex);
+	}
+
+	inline MemoryTagStats GetTagStats(MemoryTag tag) const
+	{
+		return m_Telemetry.GetTagStats(tag);
+	}
+
+	// Record the allocation size histogram and peak live blocks per size, call at a sync point
+	void StartRecording()
+	{
+		m_Profile.Construct();
+		m_Telemetry.StartRecording(&m_Profile);
+	}
+
+	// Stop recording and write the histogram for MemoryProfile::GeneratePoolConfig, return false if it can not be written
+	bool StopRecording(const char* profileFile)
+	{
+		m_Telemetry.StopRecording();
+		return m_Profile.Save(profileFile);
+	}
+
+	inline const MemoryProfile& GetProfile() const
+	{
+		return m_Profile;
+	}
+
+	// Tag the block of a live handle was allocated with
+	inline MemoryTag GetTag(Handle hle) const
 	{
-		std::cout << "Num of free:" << m_pPool[0]->m_iFreeBlockNum << "\n";
-		std::cout << "Index of free:" << m_pPool[0]->m_iFreeBlockIndex << "\n";
+		return m_Telemetry.GetTag(hle.m_poolIndex, hle.m_blockIndex);
 	}
+#endif
 
 private:
 	// Singleton instance
@@ -92,11 +256,56 @@ private:
 
 	// Raw heap start address
 	void*									m_pRawHeapStart;
+
+	// Bytes of address space reserved for the heap
+	size_t									m_iHeapSize;
+
+	// Heap of the last Destruct, reserved but without memory
+	void*									m_pRetiredHeapStart;
+	size_t									m_iRetiredHeapSize;
 	
 	// All memory blocks' pools
-	MemoryPool*								m_pPool[MEMORY_POOL_NUM];
+	MemoryPool*								m_pPool[MEMORY_POOL_MAX];
+
+	// Pool table in use, block size and number of block
+	unsigned int							m_iPoolNum;
+	unsigned int							m_PoolConfig[MEMORY_POOL_MAX][2];
+
+	// Pool of each bucket up to MEMORY_SIZE_CLASS_SMALL_MAX, m_iPoolNum if no pool fits
+	uint8_t									m_SmallSizeClass[MEMORY_SIZE_CLASS_SMALL_MAX / MEMORY_ALIGNMENT + 1];
+
+	// First pool with blocks larger than 1 << k, where sizes in (1 << k, 2 << k] start their search
+	uint8_t									m_LargeSizeClass[64];
+
+	// Changes on every Construct so thread caches drop blocks of an old heap
+	unsigned int							m_iEpoch;
+
+	struct RelocationEntry
+	{
+		RelocationCallback					m_Callback;
+		void*								m_pUserData;
+	};
+
+	// Relocation callbacks by pool and slot
+	std::unordered_map<uint32_t, RelocationEntry>	m_RelocationCallbacks;
+	std::mutex								m_RelocationMutex;
+
+	// Pool the next Defragment call continues with
+	unsigned int							m_iDefragmentPool;
+
+#ifdef MEMORY_TELEMETRY
+	MemoryTelemetry							m_Telemetry;
+	MemoryProfile							m_Profile;
+#endif
+
+	// Reserve and construct the pools of m_PoolConfig
+	bool constructPools(bool useHugePages);
+
+	// Fill the size class tables from m_PoolConfig
+	void buildSizeClasses();
 
-	void* alignedAddress(void* ptr);
+	// Run the callback registered for a slot whose block was moved
+	void notifyRelocation(unsigned int poolIndex, unsigned int slot, void* oldAddress, void* newAddress);
 };
 
 #endif
@@ -1,43 +1,347 @@
-// MemoryPool.h: 
+// MemoryPool.h: a pool of fixed size memory blocks with a free list of slots
+// Handles refer to slots, each slot is paired with a block so blocks can be moved by compaction
+// Blocks are carved from the untouched end of the pool when the free list is empty, their pages are committed on first use
+#ifndef MEMORYPOOL_H_
+#define MEMORYPOOL_H_
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include "Handle.h"
+#include "VirtualMemory.h"
 
 const unsigned int MEMORY_ALIGNMENT = 16;
 
+// Marks the end of the free list
+const unsigned int MEMORY_POOL_INVALID_INDEX = 0xFFFFFFFF;
+
+// Largest number of blocks a thread cache keeps for one pool
+const unsigned int MEMORY_CACHE_CAPACITY = 64;
+
+// Slot flags
+const uint8_t MEMORY_SLOT_LIVE = 1 << 0; // the slot is allocated
+const uint8_t MEMORY_SLOT_RELOCATION_CALLBACK = 1 << 1; // a callback is registered for the slot
+const uint8_t MEMORY_SLOT_ON_FREE_LIST = 1 << 2; // used while rebuilding the free list
+const uint8_t MEMORY_SLOT_PINNED = 1 << 3; // the block is referenced by raw pointer and must not move
+
+// The free list is a lock-free stack, any thread may pop or push blocks in batches
 class MemoryPool
 {
 public:
 
 	unsigned int							m_iBlockSize;
-	unsigned int							m_iFreeBlockNum;
-	unsigned int							m_iFreeBlockIndex;
-	unsigned int							m_pFreeList[63356]; // indices
+	unsigned int							m_iBlockNum;
+	unsigned int							m_iCacheCapacity; // blocks a thread cache may hold, 0 bypasses the cache
+	std::atomic<unsigned int>				m_iFreeBlockNum;
+	std::atomic<uint64_t>					m_FreeHead; // head of the free list, tag << 32 | index
+	uint16_t*								m_pGeneration; // generation of each slot
+	unsigned int*							m_pSlotBlock; // block paired with each slot
+	unsigned int*							m_pBlockSlot; // slot paired with each block
+	uint8_t*								m_pSlotFlags;
+	std::atomic<uint32_t>*					m_pNextFree; // next free slot of each free slot
+	unsigned int							m_iCarvedNum; // blocks ever handed out, the rest have never been touched
+	size_t									m_iCommittedSize; // bytes of the block region backed by memory
+	size_t									m_iCommitChunk; // bytes committed at a time
+	bool									m_bHugePages;
+	std::mutex								m_CarveMutex;
+	unsigned int							m_iCompactLow; // blocks below are live during a compaction pass
+	unsigned int							m_iCompactHigh; // blocks above are free during a compaction pass
+	unsigned int							m_iCompactMoves; // blocks moved in the current compaction pass
+	bool									m_bCompacting; // a compaction pass is in progress
+	char*									m_pBlockStart;
+
+	// Return the bytes of address space a pool may need, including its header and alignment padding
+	static size_t RequiredSize(size_t size, unsigned int num, bool hugePages)
+	{
+		size_t chunk = commitChunk(hugePages);
+		return alignedSize(headerSize(num), MEMORY_COMMIT_SIZE) + chunk + alignedSize(size * num, chunk);
+	}
+
+	// Construct a memory pool in reserved address space, only the header is committed
+	// Return NULL if the header can not be committed
+	static MemoryPool* Construct(size_t size, unsigned int num, bool hugePages, void* &heapStart)
+	{
+		assert(size % sizeof(unsigned int) == 0 && size >= sizeof(unsigned int)); // Blocks stay word aligned
+
+		// The header and the block region start on chunk boundaries so they can be committed separately
+		char* ptr = (char*) alignedAddress(heapStart, MEMORY_COMMIT_SIZE);
+		size_t committedHeader = alignedSize(headerSize(num), MEMORY_COMMIT_SIZE);
+		if (!VirtualMemory::Commit(ptr, committedHeader))
+			return NULL;
+
+		char* blockStart = (char*) alignedAddress(ptr + committedHeader, commitChunk(hugePages));
+
+		// Committed pages are zeroed, untouched slots read as generation 0 which no handle carries
+		MemoryPool* pool = new (ptr) MemoryPool();
+		ptr += alignedSize(sizeof(MemoryPool));
+
+		pool->m_iBlockSize = (unsigned int) size;
+		pool->m_iBlockNum = num;
+		pool->m_iCacheCapacity = cacheCapacity(size, num);
+		pool->m_pGeneration = (uint16_t*) ptr;
+		ptr += alignedSize(sizeof(uint16_t) * num);
+		pool->m_pSlotBlock = (unsigned int*) ptr;
+		ptr += alignedSize(sizeof(unsigned int) * num);
+		pool->m_pBlockSlot = (unsigned int*) ptr;
+		ptr += alignedSize(sizeof(unsigned int) * num);
+		pool->m_pSlotFlags = (uint8_t*) ptr;
+		ptr += alignedSize(sizeof(uint8_t) * num);
+		pool->m_pNextFree = (std::atomic<uint32_t>*) ptr;
+		pool->m_pBlockStart = blockStart;
+		pool->m_iCarvedNum = 0;
+		pool->m_iCommittedSize = 0;
+		pool->m_iCommitChunk = commitChunk(hugePages);
+		pool->m_bHugePages = hugePages;
+		pool->m_iCompactLow = 0;
+		pool->m_iCompactHigh = 0;
+		pool->m_iCompactMoves = 0;
+		pool->m_bCompacting = false;
+		pool->m_FreeHead.store(MEMORY_POOL_INVALID_INDEX);
+		pool->m_iFreeBlockNum.store(num);
+
+		heapStart = blockStart + alignedSize(size * num, commitChunk(hugePages));
+		return pool;
+	}
+
+	// Give the pages of the block region back to the system
+	void Destruct()
+	{
+		VirtualMemory::Decommit(m_pBlockStart, m_iCommittedSize);
+		m_iCommittedSize = 0;
+		this->~MemoryPool();
+	}
+
+	// Return the address of a block
+	inline void* GetBlock(unsigned int index) const
+	{
+		return m_pBlockStart + (size_t) m_iBlockSize * index;
+	}
+
+	// Return the address of the block paired with a slot
+	inline void* GetSlotBlock(unsigned int slot) const
+	{
+		return GetBlock(m_pSlotBlock[slot]);
+	}
+
+	// Index of the first slot on the free list
+	inline unsigned int GetFreeHead() const
+	{
+		return (unsigned int) m_FreeHead.load(std::memory_order_relaxed);
+	}
+
+	// Take a slot off the free list, return MEMORY_POOL_INVALID_INDEX if the pool is exhausted
+	inline unsigned int Pop()
+	{
+		unsigned int index;
+		return PopBatch(&index, 1) ? index : MEMORY_POOL_INVALID_INDEX;
+	}
+
+	// Put a slot back on the free list
+	inline void Push(unsigned int index)
+	{
+		PushBatch(&index, 1);
+	}
+
+	// Take up to max slots off the free list with a single CAS, return the number taken
+	unsigned int PopBatch(unsigned int* indices, unsigned int max)
+	{
+		uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+		for (;;)
+		{
+			unsigned int index = (unsigned int) head;
+			unsigned int count = 0;
+			while (index != MEMORY_POOL_INVALID_INDEX && index < m_iBlockNum && count < max)
+			{
+				indices[count++] = index;
+				index = LoadNextFree(index);
+			}
+
+			// A link out of range means the chain was popped and reused while walking it
+			if (index != MEMORY_POOL_INVALID_INDEX && index >= m_iBlockNum)
+			{
+				head = m_FreeHead.load(std::memory_order_acquire);
+				continue;
+			}
+			if (count == 0)
+				return carveBatch(indices, max);
+
+			// The tag changes on every update, so an unchanged head means the walked chain is intact
+			uint64_t newHead = (((head >> 32) + 1) << 32) | index;
+			if (m_FreeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				m_iFreeBlockNum.fetch_sub(count, std::memory_order_relaxed);
+				return count;
+			}
+		}
+	}
+
+	// Put count slots back on the free list with a single CAS
+	void PushBatch(const unsigned int* indices, unsigned int count)
+	{
+		if (count == 0)
+			return;
+
+		for (unsigned int i = 0; i + 1 < count; ++i)
+		{
+			StoreNextFree(indices[i], indices[i + 1]);
+		}
+
+		uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+		uint64_t newHead;
+		do
+		{
+			StoreNextFree(indices[count - 1], (unsigned int) head);
+			newHead = (((head >> 32) + 1) << 32) | indices[0];
+		} while (!m_FreeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+
+		m_iFreeBlockNum.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	// Advance the generation of a slot so outstanding handles to it become stale
+	inline void Retire(unsigned int index)
+	{
+		uint16_t gen = m_pGeneration[index] + 1;
+		m_pGeneration[index] = (gen > HANDLE_MAX_GENERATION) ? 1 : gen;
+	}
 
-	// Construct a memory pool with alignment at the beginning
-	static MemoryPool* Construct(size_t size, unsigned int num, void* &heapStart)
+	// Move the block of a live slot into the block of a free slot, the free slot takes the old block
+	// Must not run concurrently with any other operation on the pool
+	void Relocate(unsigned int liveSlot, unsigned int freeSlot)
 	{
-		assert(size % MEMORY_ALIGNMENT == 0); // Make sure the block size does not need alignment
+		unsigned int liveBlock = m_pSlotBlock[liveSlot];
+		unsigned int freeBlock = m_pSlotBlock[freeSlot];
 
-		MemoryPool* ptr = (MemoryPool*) heapStart;
-		ptr->m_iBlockSize = size;
-		ptr->m_iFreeBlockNum = num;
-		ptr->m_iFreeBlockIndex = 0;
+		// The free slot keeps its link to the next free slot, links are stored by slot and not in the block
+		memcpy(GetBlock(freeBlock), GetBlock(liveBlock), m_iBlockSize);
+		SwapBlocks(liveSlot, freeSlot);
+	}
 
-		heapStart = (void*) ((uint32_t) heapStart + sizeof(unsigned int) * 3);
+	// Exchange the blocks paired with two slots, the contents of the blocks stay where they are
+	// Must not run concurrently with any other operation on the pool
+	inline void SwapBlocks(unsigned int slotA, unsigned int slotB)
+	{
+		unsigned int blockA = m_pSlotBlock[slotA];
+		unsigned int blockB = m_pSlotBlock[slotB];
+		m_pSlotBlock[slotA] = blockB;
+		m_pSlotBlock[slotB] = blockA;
+		m_pBlockSlot[blockB] = slotA;
+		m_pBlockSlot[blockA] = slotB;
+	}
 
-		for (unsigned int i = 0; i < num; ++i)
+	// Relink the free list so the slots paired with the lowest blocks are handed out first
+	// Slots held by thread caches stay where they are
+	// Must not run concurrently with any other operation on the pool
+	void SortFreeList()
+	{
+		unsigned int slot = GetFreeHead();
+		while (slot != MEMORY_POOL_INVALID_INDEX)
 		{
-			ptr->m_pFreeList[i] = i;
+			m_pSlotFlags[slot] |= MEMORY_SLOT_ON_FREE_LIST;
+			slot = LoadNextFree(slot);
 		}
 
-		heapStart = (void*)((uint32_t) heapStart + (size * num));
-		return ptr;
+		unsigned int head = MEMORY_POOL_INVALID_INDEX;
+		for (unsigned int block = m_iCarvedNum; block-- > 0;)
+		{
+			slot = m_pBlockSlot[block];
+			if (m_pSlotFlags[slot] & MEMORY_SLOT_ON_FREE_LIST)
+			{
+				m_pSlotFlags[slot] &= ~MEMORY_SLOT_ON_FREE_LIST;
+				StoreNextFree(slot, head);
+				head = slot;
+			}
+		}
+
+		uint64_t oldHead = m_FreeHead.load(std::memory_order_relaxed);
+		m_FreeHead.store((((oldHead >> 32) + 1) << 32) | head);
 	}
 
 private:
 
 	// Constructor
 	MemoryPool(){}
+
+	// The links of the free list are kept beside the blocks, a thread walking a chain that another
+	// thread popped meanwhile reads a stale link instead of the user data of a block in use
+	// The tag check on the head discards such a walk, so relaxed loads and stores are enough
+	inline unsigned int LoadNextFree(unsigned int slot) const
+	{
+		return m_pNextFree[slot].load(std::memory_order_relaxed);
+	}
+
+	inline void StoreNextFree(unsigned int slot, unsigned int next)
+	{
+		m_pNextFree[slot].store(next, std::memory_order_relaxed);
+	}
+
+	// Hand out up to max never used blocks, committing their pages first
+	unsigned int carveBatch(unsigned int* indices, unsigned int max)
+	{
+		std::lock_guard<std::mutex> lock(m_CarveMutex);
+		unsigned int count = m_iBlockNum - m_iCarvedNum < max ? m_iBlockNum - m_iCarvedNum : max;
+		if (count == 0)
+			return 0;
+
+		size_t end = (size_t) m_iBlockSize * (m_iCarvedNum + count);
+		if (end > m_iCommittedSize)
+		{
+			size_t committed = alignedSize(end, m_iCommitChunk);
+			if (!VirtualMemory::Commit(m_pBlockStart + m_iCommittedSize, committed - m_iCommittedSize, m_bHugePages))
+				return 0;
+			m_iCommittedSize = committed;
+		}
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			unsigned int index = m_iCarvedNum + i;
+			m_pGeneration[index] = 1;
+			m_pSlotBlock[index] = index;
+			m_pBlockSlot[index] = index;
+			indices[i] = index;
+		}
+		m_iCarvedNum += count;
+		m_iFreeBlockNum.fetch_sub(count, std::memory_order_relaxed);
+		return count;
+	}
+
+	// Bytes used by the pool object and its slot tables
+	static size_t headerSize(unsigned int num)
+	{
+		return alignedSize(sizeof(MemoryPool)) + alignedSize(sizeof(uint16_t) * num) + 2 * alignedSize(sizeof(unsigned int) * num)
+			+ alignedSize(sizeof(uint8_t) * num) + alignedSize(sizeof(std::atomic<uint32_t>) * num);
+	}
+
+	static size_t commitChunk(bool hugePages)
+	{
+		return hugePages ? MEMORY_HUGE_PAGE_SIZE : MEMORY_COMMIT_SIZE;
+	}
+
+	static size_t alignedSize(size_t size, size_t alignment = MEMORY_ALIGNMENT)
+	{
+		return (size + alignment - 1) & ~(size_t) (alignment - 1);
+	}
+
+	static void* alignedAddress(void* ptr, size_t alignment)
+	{
+		return (void*) (((uintptr_t) ptr + alignment - 1) & ~(uintptr_t) (alignment - 1));
+	}
+
+	// Small blocks are cached per thread, large blocks are too few to hold back from other threads
+	static unsigned int cacheCapacity(size_t size, unsigned int num)
+	{
+		unsigned int capacity = 0;
+		if (size <= 1024)
+			capacity = MEMORY_CACHE_CAPACITY;
+		else if (size <= 16384)
+			capacity = MEMORY_CACHE_CAPACITY / 4;
+
+		while (capacity && capacity * 8 > num)
+			capacity /= 2;
+		return capacity < 2 ? 0 : capacity;
+	}
 };
+
+#endif
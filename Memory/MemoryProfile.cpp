@@ -0,0 +1,281 @@
+// MemoryProfile.cpp
+
+#include "MemoryProfile.h"
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// Optimizing over more distinct sizes than this merges neighbouring sizes first
+	const unsigned int MEMORY_PROFILE_MAX_CANDIDATES = 1024;
+
+	std::atomic<unsigned int>* newCounters()
+	{
+		std::atomic<unsigned int>* counters = new std::atomic<unsigned int>[MEMORY_PROFILE_BUCKET_NUM];
+		for (unsigned int i = 0; i < MEMORY_PROFILE_BUCKET_NUM; ++i)
+		{
+			counters[i].store(0, std::memory_order_relaxed);
+		}
+		return counters;
+	}
+}
+
+MemoryProfile::MemoryProfile()
+	: m_pAllocations(NULL)
+	, m_pLive(NULL)
+	, m_pPeakLive(NULL)
+{
+	m_iOversize.store(0);
+}
+
+void MemoryProfile::Construct()
+{
+	Destruct();
+	m_pAllocations = newCounters();
+	m_pLive = newCounters();
+	m_pPeakLive = newCounters();
+	m_iOversize.store(0);
+}
+
+void MemoryProfile::Destruct()
+{
+	delete[] m_pAllocations;
+	delete[] m_pLive;
+	delete[] m_pPeakLive;
+	m_pAllocations = NULL;
+	m_pLive = NULL;
+	m_pPeakLive = NULL;
+}
+
+void MemoryProfile::OnAllocate(size_t size)
+{
+	if (size > MEMORY_PROFILE_MAX_SIZE)
+	{
+		m_iOversize.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	unsigned int bucket = bucketOf(size);
+	m_pAllocations[bucket].fetch_add(1, std::memory_order_relaxed);
+	unsigned int live = m_pLive[bucket].fetch_add(1, std::memory_order_relaxed) + 1;
+	unsigned int peak = m_pPeakLive[bucket].load(std::memory_order_relaxed);
+	while (live > peak && !m_pPeakLive[bucket].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MemoryProfile::OnFailedAllocate(size_t size)
+{
+	if (size > MEMORY_PROFILE_MAX_SIZE)
+	{
+		m_iOversize.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// The block was never live, but the demand was one block above the current live count
+	unsigned int bucket = bucketOf(size);
+	m_pAllocations[bucket].fetch_add(1, std::memory_order_relaxed);
+	unsigned int live = m_pLive[bucket].load(std::memory_order_relaxed) + 1;
+	unsigned int peak = m_pPeakLive[bucket].load(std::memory_order_relaxed);
+	while (live > peak && !m_pPeakLive[bucket].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MemoryProfile::OnFree(size_t size)
+{
+	if (size <= MEMORY_PROFILE_MAX_SIZE)
+		m_pLive[bucketOf(size)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+unsigned int MemoryProfile::GetAllocations(unsigned int bucket) const
+{
+	return m_pAllocations ? m_pAllocations[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+unsigned int MemoryProfile::GetPeakLive(unsigned int bucket) const
+{
+	return m_pPeakLive ? m_pPeakLive[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+bool MemoryProfile::Save(const char* filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+		return false;
+
+	file << "# size allocations peak\n";
+	for (unsigned int i = 0; i < MEMORY_PROFILE_BUCKET_NUM; ++i)
+	{
+		if (GetAllocations(i))
+			file << (i + 1) * MEMORY_PROFILE_BUCKET_SIZE << " " << GetAllocations(i) << " " << GetPeakLive(i) << "\n";
+	}
+	file << "# oversize " << GetOversize() << "\n";
+	return true;
+}
+
+bool MemoryProfile::Load(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+		return false;
+	if (!m_pAllocations)
+		Construct();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		size_t size;
+		unsigned int allocations, peak;
+		if (!(fields >> size >> allocations >> peak) || size == 0 || size > MEMORY_PROFILE_MAX_SIZE)
+			return false;
+
+		unsigned int bucket = bucketOf(size);
+		m_pAllocations[bucket].fetch_add(allocations, std::memory_order_relaxed);
+		if (peak > m_pPeakLive[bucket].load(std::memory_order_relaxed))
+			m_pPeakLive[bucket].store(peak, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+// Dynamic programming over the recorded sizes: the cost of a class is its block size times the peaks it serves,
+// best[k][j] is the cheapest way to serve the j smallest sizes with k classes, O(maxPools * sizes^2)
+unsigned int MemoryProfile::Optimize(unsigned int maxPools, float headroom, unsigned int config[][2]) const
+{
+	// Candidate class sizes with the peak they have to hold
+	std::vector<uint64_t> sizes;
+	std::vector<uint64_t> peaks;
+	for (unsigned int i = 0; i < MEMORY_PROFILE_BUCKET_NUM; ++i)
+	{
+		if (GetAllocations(i))
+		{
+			sizes.push_back((uint64_t) (i + 1) * MEMORY_PROFILE_BUCKET_SIZE);
+			peaks.push_back(GetPeakLive(i) ? GetPeakLive(i) : 1);
+		}
+	}
+
+	// Too many distinct sizes, merge runs of neighbours into their largest size
+	if (sizes.size() > MEMORY_PROFILE_MAX_CANDIDATES)
+	{
+		size_t group = (sizes.size() + MEMORY_PROFILE_MAX_CANDIDATES - 1) / MEMORY_PROFILE_MAX_CANDIDATES;
+		std::vector<uint64_t> mergedSizes;
+		std::vector<uint64_t> mergedPeaks;
+		for (size_t i = 0; i < sizes.size(); i += group)
+		{
+			size_t end = i + group < sizes.size() ? i + group : sizes.size();
+			uint64_t peak = 0;
+			for (size_t j = i; j < end; ++j)
+				peak += peaks[j];
+			mergedSizes.push_back(sizes[end - 1]);
+			mergedPeaks.push_back(peak);
+		}
+		sizes.swap(mergedSizes);
+		peaks.swap(mergedPeaks);
+	}
+
+	const unsigned int n = (unsigned int) sizes.size();
+	if (n == 0 || maxPools == 0)
+		return 0;
+	unsigned int k = maxPools < n ? maxPools : n;
+	if (k > MEMORY_POOL_MAX)
+		k = MEMORY_POOL_MAX;
+
+	std::vector<uint64_t> prefix(n + 1, 0);
+	for (unsigned int i = 0; i < n; ++i)
+		prefix[i + 1] = prefix[i] + peaks[i];
+
+	// best[c][j]: c classes covering sizes [0, j), split[c][j]: start of the last class
+	const uint64_t infinite = ~(uint64_t) 0;
+	std::vector<std::vector<uint64_t> > best(k + 1, std::vector<uint64_t>(n + 1, infinite));
+	std::vector<std::vector<unsigned int> > split(k + 1, std::vector<unsigned int>(n + 1, 0));
+	best[0][0] = 0;
+	for (unsigned int c = 1; c <= k; ++c)
+	{
+		for (unsigned int j = c; j <= n; ++j)
+		{
+			for (unsigned int i = c - 1; i < j; ++i)
+			{
+				if (best[c - 1][i] == infinite)
+					continue;
+				uint64_t cost = best[c - 1][i] + sizes[j - 1] * (prefix[j] - prefix[i]);
+				if (cost < best[c][j])
+				{
+					best[c][j] = cost;
+					split[c][j] = i;
+				}
+			}
+		}
+	}
+
+	// Walk the splits back from the largest size
+	unsigned int j = n;
+	for (unsigned int c = k; c > 0; --c)
+	{
+		unsigned int i = split[c][j];
+		uint64_t blocks = (uint64_t) ((prefix[j] - prefix[i]) * headroom + 0.999);
+		config[c - 1][0] = (unsigned int) sizes[j - 1];
+		config[c - 1][1] = (unsigned int) (blocks < 1 ? 1 : (blocks > MEMORY_POOL_MAX_BLOCKS ? MEMORY_POOL_MAX_BLOCKS : blocks));
+		j = i;
+	}
+	return k;
+}
+
+bool MemoryProfile::SavePoolConfig(const char* filename, const unsigned int config[][2], unsigned int poolNum)
+{
+	std::ofstream file(filename);
+	if (!file)
+		return false;
+
+	file << "# block size, number of block\n";
+	for (unsigned int i = 0; i < poolNum; ++i)
+	{
+		file << config[i][0] << " " << config[i][1] << "\n";
+	}
+	return true;
+}
+
+unsigned int MemoryProfile::LoadPoolConfig(const char* filename, unsigned int config[][2], unsigned int maxPools)
+{
+	std::ifstream file(filename);
+	if (!file)
+		return 0;
+
+	unsigned int poolNum = 0;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		// Block sizes must be aligned and ascending, Allocate takes the first pool that fits
+		std::istringstream fields(line);
+		unsigned int size, num;
+		if (!(fields >> size >> num) || poolNum == maxPools
+			|| size == 0 || size % MEMORY_PROFILE_BUCKET_SIZE != 0 || num == 0 || num > MEMORY_POOL_MAX_BLOCKS
+			|| (poolNum && size <= config[poolNum - 1][0]))
+		{
+			return 0;
+		}
+		config[poolNum][0] = size;
+		config[poolNum][1] = num;
+		++poolNum;
+	}
+	return poolNum;
+}
+
+bool MemoryProfile::GeneratePoolConfig(const char* profileFile, const char* configFile, unsigned int maxPools, float headroom)
+{
+	MemoryProfile profile;
+	if (!profile.Load(profileFile))
+		return false;
+
+	unsigned int config[MEMORY_POOL_MAX][2];
+	unsigned int poolNum = profile.Optimize(maxPools, headroom, config);
+	return poolNum && SavePoolConfig(configFile, config, poolNum);
+}
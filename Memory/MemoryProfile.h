@@ -0,0 +1,83 @@
+// MemoryProfile.h: allocation size histogram recorded over a session, used to generate the pool configuration
+#ifndef MEMORYPROFILE_H_
+#define MEMORYPROFILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Handles have 5 bits for the pool index
+const unsigned int MEMORY_POOL_MAX = 32;
+
+// Handles have 16 bits for the block index
+const unsigned int MEMORY_POOL_MAX_BLOCKS = 65536;
+
+// Requested sizes are rounded up to buckets of this size, which is also the block alignment
+const unsigned int MEMORY_PROFILE_BUCKET_SIZE = 16;
+
+// Largest size recorded in the histogram, larger requests are only counted
+const unsigned int MEMORY_PROFILE_MAX_SIZE = 4194304;
+const unsigned int MEMORY_PROFILE_BUCKET_NUM = MEMORY_PROFILE_MAX_SIZE / MEMORY_PROFILE_BUCKET_SIZE;
+
+class MemoryProfile
+{
+public:
+	MemoryProfile();
+
+	~MemoryProfile() {
+		Destruct();
+	}
+
+	// Allocate an empty histogram
+	void Construct();
+
+	void Destruct();
+
+	// Record an allocation or free of a block requested with size bytes, may be called from any thread
+	void OnAllocate(size_t size);
+	void OnFailedAllocate(size_t size);
+	void OnFree(size_t size);
+
+	// Number of allocations and largest number of live blocks of a bucket
+	unsigned int GetAllocations(unsigned int bucket) const;
+	unsigned int GetPeakLive(unsigned int bucket) const;
+
+	// Requests larger than MEMORY_PROFILE_MAX_SIZE
+	unsigned int GetOversize() const
+	{
+		return m_iOversize.load(std::memory_order_relaxed);
+	}
+
+	// Write the non-empty buckets as "size allocations peak" lines
+	bool Save(const char* filename) const;
+
+	// Read a histogram written by Save, the histogram is constructed if needed
+	bool Load(const char* filename);
+
+	// Fill config with at most maxPools size classes that minimize the bytes reserved for the recorded peaks
+	// Each class gets its peak times headroom blocks, return the number of classes
+	unsigned int Optimize(unsigned int maxPools, float headroom, unsigned int config[][2]) const;
+
+	// Write or read a pool table as "blockSize blockCount" lines, Load returns the number of pools or 0 on error
+	static bool SavePoolConfig(const char* filename, const unsigned int config[][2], unsigned int poolNum);
+	static unsigned int LoadPoolConfig(const char* filename, unsigned int config[][2], unsigned int maxPools);
+
+	// Generate a pool table file from a profile file, the offline step between recording and loading
+	static bool GeneratePoolConfig(const char* profileFile, const char* configFile, unsigned int maxPools = MEMORY_POOL_MAX, float headroom = 1.25f);
+
+private:
+	MemoryProfile(const MemoryProfile&);
+	MemoryProfile& operator=(const MemoryProfile&);
+
+	static unsigned int bucketOf(size_t size)
+	{
+		return size ? (unsigned int) ((size - 1) / MEMORY_PROFILE_BUCKET_SIZE) : 0;
+	}
+
+	std::atomic<unsigned int>*				m_pAllocations;
+	std::atomic<unsigned int>*				m_pLive;
+	std::atomic<unsigned int>*				m_pPeakLive;
+	std::atomic<unsigned int>				m_iOversize;
+};
+
+#endif
@@ -0,0 +1,154 @@
+// MemoryTelemetry.cpp
+
+#include "MemoryTelemetry.h"
+#include <stdlib.h>
+
+const char* MEMORY_TAG_NAMES[MEMORY_TAG_NUM] =
+{
+	"UNTAGGED",
+	"PHYSICS",
+	"RENDER",
+	"LOADER",
+	"GAMEPLAY",
+};
+
+namespace
+{
+	// Raise peak to value if it is higher
+	void updatePeak(std::atomic<unsigned int>& peak, unsigned int value)
+	{
+		unsigned int current = peak.load(std::memory_order_relaxed);
+		while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+void MemoryTelemetry::Counters::Reset()
+{
+	m_iLiveBlocks.store(0);
+	m_iPeakBlocks.store(0);
+	m_iFailedAllocations.store(0);
+	m_iBytes.store(0);
+	m_iFrameAllocations.store(0);
+	m_iLastFrameAllocations = 0;
+	m_iPeakFrameAllocations = 0;
+}
+
+void MemoryTelemetry::Construct(unsigned int poolNum, const unsigned int* blockNum)
+{
+	Destruct();
+
+	m_iPoolNum = poolNum;
+	m_pPools = new Counters[poolNum];
+	m_pSlots = new SlotRecord*[poolNum];
+	for (unsigned int i = 0; i < poolNum; ++i)
+	{
+		m_pPools[i].Reset();
+		m_pSlots[i] = (SlotRecord*) calloc(blockNum[i], sizeof(SlotRecord));
+	}
+	for (unsigned int i = 0; i < MEMORY_TAG_NUM; ++i)
+	{
+		m_Tags[i].Reset();
+	}
+	m_iOversizeFailed.store(0);
+}
+
+void MemoryTelemetry::Destruct()
+{
+	for (unsigned int i = 0; m_pSlots && i < m_iPoolNum; ++i)
+	{
+		free(m_pSlots[i]);
+	}
+	delete[] m_pSlots;
+	delete[] m_pPools;
+	m_pSlots = NULL;
+	m_pPools = NULL;
+	m_iPoolNum = 0;
+}
+
+void MemoryTelemetry::OnAllocate(unsigned int poolIndex, unsigned int slot, size_t size, size_t blockSize, MemoryTag tag)
+{
+	SlotRecord& record = m_pSlots[poolIndex][slot];
+	record.m_iRequestedSize = (uint32_t) size;
+	record.m_iTag = (uint8_t) tag;
+	record.m_bRecorded = m_pProfile != NULL;
+	if (m_pProfile)
+		m_pProfile->OnAllocate(size);
+
+	Counters& pool = m_pPools[poolIndex];
+	updatePeak(pool.m_iPeakBlocks, pool.m_iLiveBlocks.fetch_add(1, std::memory_order_relaxed) + 1);
+	pool.m_iBytes.fetch_add(size, std::memory_order_relaxed);
+	pool.m_iFrameAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	Counters& counters = m_Tags[tag];
+	updatePeak(counters.m_iPeakBlocks, counters.m_iLiveBlocks.fetch_add(1, std::memory_order_relaxed) + 1);
+	counters.m_iBytes.fetch_add(blockSize, std::memory_order_relaxed);
+	counters.m_iFrameAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::OnFailedAllocate(unsigned int poolIndex, size_t size, bool noPoolFits)
+{
+	if (m_pProfile)
+		m_pProfile->OnFailedAllocate(size);
+
+	if (noPoolFits)
+		m_iOversizeFailed.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_pPools[poolIndex].m_iFailedAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::OnFree(unsigned int poolIndex, unsigned int slot, size_t blockSize)
+{
+	const SlotRecord& record = m_pSlots[poolIndex][slot];
+	if (record.m_bRecorded && m_pProfile)
+		m_pProfile->OnFree(record.m_iRequestedSize);
+
+	Counters& pool = m_pPools[poolIndex];
+	pool.m_iLiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+	pool.m_iBytes.fetch_sub(record.m_iRequestedSize, std::memory_order_relaxed);
+
+	Counters& counters = m_Tags[record.m_iTag];
+	counters.m_iLiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+	counters.m_iBytes.fetch_sub(blockSize, std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::EndFrame()
+{
+	for (unsigned int i = 0; i < m_iPoolNum + MEMORY_TAG_NUM; ++i)
+	{
+		Counters& counters = i < m_iPoolNum ? m_pPools[i] : m_Tags[i - m_iPoolNum];
+		counters.m_iLastFrameAllocations = counters.m_iFrameAllocations.exchange(0, std::memory_order_relaxed);
+		if (counters.m_iLastFrameAllocations > counters.m_iPeakFrameAllocations)
+			counters.m_iPeakFrameAllocations = counters.m_iLastFrameAllocations;
+	}
+}
+
+MemoryPoolStats MemoryTelemetry::GetPoolStats(unsigned int poolIndex) const
+{
+	const Counters& pool = m_pPools[poolIndex];
+	MemoryPoolStats stats;
+	stats.m_iLiveBlocks = pool.m_iLiveBlocks.load(std::memory_order_relaxed);
+	stats.m_iPeakBlocks = pool.m_iPeakBlocks.load(std::memory_order_relaxed);
+	stats.m_iFailedAllocations = pool.m_iFailedAllocations.load(std::memory_order_relaxed);
+	stats.m_iRequestedBytes = pool.m_iBytes.load(std::memory_order_relaxed);
+	stats.m_iFrameAllocations = pool.m_iLastFrameAllocations;
+	stats.m_iPeakFrameAllocations = pool.m_iPeakFrameAllocations;
+	return stats;
+}
+
+MemoryTagStats MemoryTelemetry::GetTagStats(MemoryTag tag) const
+{
+	const Counters& counters = m_Tags[tag];
+	MemoryTagStats stats;
+	stats.m_iLiveBlocks = counters.m_iLiveBlocks.load(std::memory_order_relaxed);
+	stats.m_iLiveBytes = counters.m_iBytes.load(std::memory_order_relaxed);
+	stats.m_iFrameAllocations = counters.m_iLastFrameAllocations;
+	stats.m_iPeakFrameAllocations = counters.m_iPeakFrameAllocations;
+	return stats;
+}
+
+MemoryTag MemoryTelemetry::GetTag(unsigned int poolIndex, unsigned int slot) const
+{
+	return (MemoryTag) m_pSlots[poolIndex][slot].m_iTag;
+}
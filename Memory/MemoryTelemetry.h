@@ -0,0 +1,140 @@
+// MemoryTelemetry.h: allocation counters of the memory manager, per pool and per tag
+// Counters are only updated when MEMORY_TELEMETRY is defined, it is on by default in debug builds
+#ifndef MEMORYTELEMETRY_H_
+#define MEMORYTELEMETRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "MemoryProfile.h"
+
+#if !defined(MEMORY_TELEMETRY) && defined(_DEBUG)
+#define MEMORY_TELEMETRY
+#endif
+
+// Subsystem an allocation is made for
+enum MemoryTag
+{
+	MEMORY_TAG_UNTAGGED = 0,
+	MEMORY_TAG_PHYSICS,
+	MEMORY_TAG_RENDER,
+	MEMORY_TAG_LOADER,
+	MEMORY_TAG_GAMEPLAY,
+	MEMORY_TAG_NUM
+};
+
+extern const char* MEMORY_TAG_NAMES[MEMORY_TAG_NUM];
+
+// Snapshot of the counters of one pool
+struct MemoryPoolStats
+{
+	unsigned int							m_iLiveBlocks;
+	unsigned int							m_iPeakBlocks;
+	unsigned int							m_iFailedAllocations;
+	uint64_t								m_iRequestedBytes; // bytes asked for by the live blocks
+	unsigned int							m_iFrameAllocations; // allocations in the last completed frame
+	unsigned int							m_iPeakFrameAllocations;
+};
+
+// Snapshot of the counters of one tag
+struct MemoryTagStats
+{
+	unsigned int							m_iLiveBlocks;
+	uint64_t								m_iLiveBytes; // block bytes held by the tag
+	unsigned int							m_iFrameAllocations; // allocations in the last completed frame
+	unsigned int							m_iPeakFrameAllocations;
+};
+
+class MemoryTelemetry
+{
+public:
+	MemoryTelemetry()
+		: m_iPoolNum(0)
+		, m_pPools(NULL)
+		, m_pSlots(NULL)
+		, m_pProfile(NULL)
+	{
+		for (unsigned int i = 0; i < MEMORY_TAG_NUM; ++i)
+			m_Tags[i].Reset();
+		m_iOversizeFailed.store(0);
+	}
+
+	~MemoryTelemetry() {
+		Destruct();
+	}
+
+	// Allocate counters for poolNum pools, blockNum gives the number of slots of each pool
+	void Construct(unsigned int poolNum, const unsigned int* blockNum);
+
+	void Destruct();
+
+	// Record a successful allocation of size bytes from a slot
+	void OnAllocate(unsigned int poolIndex, unsigned int slot, size_t size, size_t blockSize, MemoryTag tag);
+
+	// Record an allocation the pool could not serve, poolIndex is ignored if no pool fits the size
+	void OnFailedAllocate(unsigned int poolIndex, size_t size, bool noPoolFits);
+
+	void OnFree(unsigned int poolIndex, unsigned int slot, size_t blockSize);
+
+	// Close the per-frame allocation counters
+	void EndFrame();
+
+	MemoryPoolStats GetPoolStats(unsigned int poolIndex) const;
+
+	MemoryTagStats GetTagStats(MemoryTag tag) const;
+
+	// Feed allocations into a size histogram until StopRecording, must be called at a sync point
+	// Blocks allocated before recording started are not counted when freed
+	void StartRecording(MemoryProfile* profile)
+	{
+		m_pProfile = profile;
+	}
+
+	void StopRecording()
+	{
+		m_pProfile = NULL;
+	}
+
+	// Tag of a live slot
+	MemoryTag GetTag(unsigned int poolIndex, unsigned int slot) const;
+
+	// Allocations larger than every pool
+	unsigned int GetOversizeFailed() const
+	{
+		return m_iOversizeFailed.load(std::memory_order_relaxed);
+	}
+
+private:
+	MemoryTelemetry(const MemoryTelemetry&);
+	MemoryTelemetry& operator=(const MemoryTelemetry&);
+
+	struct Counters
+	{
+		std::atomic<unsigned int>			m_iLiveBlocks;
+		std::atomic<unsigned int>			m_iPeakBlocks;
+		std::atomic<unsigned int>			m_iFailedAllocations;
+		std::atomic<uint64_t>				m_iBytes;
+		std::atomic<unsigned int>			m_iFrameAllocations;
+		unsigned int						m_iLastFrameAllocations;
+		unsigned int						m_iPeakFrameAllocations;
+
+		void Reset();
+	};
+
+	// What was requested for a live slot
+	struct SlotRecord
+	{
+		uint32_t							m_iRequestedSize;
+		uint8_t								m_iTag;
+		uint8_t								m_bRecorded; // allocated while recording
+	};
+
+	unsigned int							m_iPoolNum;
+	Counters*								m_pPools;
+	Counters								m_Tags[MEMORY_TAG_NUM];
+	SlotRecord**							m_pSlots; // per pool, indexed by slot
+	std::atomic<unsigned int>				m_iOversizeFailed;
+	MemoryProfile*							m_pProfile;
+};
+
+#endif
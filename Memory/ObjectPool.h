@@ -0,0 +1,182 @@
+// ObjectPool.h: a pool of objects of one type, live objects are kept packed at the front of the pool for iteration
+// Handles stay valid while objects move, pointers to objects are only valid until the next Destroy
+#ifndef OBJECTPOOL_H_
+#define OBJECTPOOL_H_
+
+#include <assert.h>
+#include <new>
+#include <utility>
+#include "MemoryPool.h"
+
+// Objects are constructed in the blocks of a MemoryPool, the object at dense index i lives in block i
+// The free list keeps the slots of the blocks past the live objects in ascending order, so the next slot handed out
+// is always paired with the first block past the live objects
+// Not thread safe, types must not need more than MEMORY_ALIGNMENT bytes of alignment and their size must be a multiple of 4
+template <typename T>
+class ObjectPool
+{
+public:
+	ObjectPool()
+		: m_pPool(NULL)
+		, m_pReserved(NULL)
+		, m_iReservedSize(0)
+		, m_iCount(0)
+	{}
+
+	~ObjectPool() {
+		Destruct();
+	}
+
+	// Reserve room for num objects, pages are committed as the pool grows
+	bool Construct(unsigned int num, bool hugePages = false)
+	{
+		assert(num <= (1 << 16)); // Handles have 16 bits for the slot
+		Destruct();
+
+		m_iReservedSize = MEMORY_COMMIT_SIZE + MemoryPool::RequiredSize(blockSize(), num, hugePages);
+		m_pReserved = VirtualMemory::Reserve(m_iReservedSize);
+		if (!m_pReserved)
+			return false;
+
+		void* heapStart = m_pReserved;
+		m_pPool = MemoryPool::Construct(blockSize(), num, hugePages, heapStart);
+		if (!m_pPool)
+		{
+			Destruct();
+			return false;
+		}
+		return true;
+	}
+
+	// Destroy every object and release the pool
+	void Destruct()
+	{
+		Clear();
+		if (m_pPool)
+			m_pPool->Destruct();
+		if (m_pReserved)
+			VirtualMemory::Release(m_pReserved, m_iReservedSize);
+		m_pPool = NULL;
+		m_pReserved = NULL;
+		m_iReservedSize = 0;
+	}
+
+	// Construct an object at the end of the live objects, return an invalid handle if the pool is full
+	template <typename... Args>
+	Handle Create(Args&&... args)
+	{
+		unsigned int slot = m_pPool ? m_pPool->Pop() : MEMORY_POOL_INVALID_INDEX;
+		if (slot == MEMORY_POOL_INVALID_INDEX)
+			return Handle();
+
+		assert(m_pPool->m_pSlotBlock[slot] == m_iCount);
+		new (m_pPool->GetBlock(m_iCount)) T(std::forward<Args>(args)...);
+		m_pPool->m_pSlotFlags[slot] |= MEMORY_SLOT_LIVE;
+		++m_iCount;
+		return Handle(0, slot, m_pPool->m_pGeneration[slot]);
+	}
+
+	// Destroy the object of a handle, the last object is moved into its place
+	// Return false if the handle is stale
+	bool Destroy(Handle hle)
+	{
+		T* object = Get(hle);
+		if (!object)
+			return false;
+
+		unsigned int slot = hle.m_blockIndex;
+		unsigned int last = m_iCount - 1;
+		T* lastObject = (T*) m_pPool->GetBlock(last);
+		object->~T();
+		if (object != lastObject)
+		{
+			new (object) T(std::move(*lastObject));
+			lastObject->~T();
+			m_pPool->SwapBlocks(slot, m_pPool->m_pBlockSlot[last]);
+		}
+
+		// The freed slot is now paired with the first block past the live objects
+		m_pPool->m_pSlotFlags[slot] &= ~MEMORY_SLOT_LIVE;
+		m_pPool->Retire(slot);
+		m_pPool->Push(slot);
+		--m_iCount;
+		return true;
+	}
+
+	// Destroy every object, the pool keeps its committed pages
+	void Clear()
+	{
+		// Slots are pushed from the last block down so the free list stays in block order
+		while (m_iCount)
+		{
+			unsigned int slot = m_pPool->m_pBlockSlot[--m_iCount];
+			((T*) m_pPool->GetBlock(m_iCount))->~T();
+			m_pPool->m_pSlotFlags[slot] &= ~MEMORY_SLOT_LIVE;
+			m_pPool->Retire(slot);
+			m_pPool->Push(slot);
+		}
+	}
+
+	// Return the object of a handle, NULL if the handle is stale
+	inline T* Get(Handle hle) const
+	{
+		if (!hle.IsValid() || !m_pPool || hle.m_blockIndex >= m_pPool->m_iBlockNum
+			|| m_pPool->m_pGeneration[hle.m_blockIndex] != hle.m_counter)
+		{
+			return NULL;
+		}
+		return (T*) m_pPool->GetSlotBlock(hle.m_blockIndex);
+	}
+
+	// Return the handle of the object at a dense index
+	inline Handle GetHandle(unsigned int index) const
+	{
+		unsigned int slot = m_pPool->m_pBlockSlot[index];
+		return Handle(0, slot, m_pPool->m_pGeneration[slot]);
+	}
+
+	// Live objects, packed in [begin(), end())
+	inline T* begin() const
+	{
+		return m_pPool ? (T*) m_pPool->GetBlock(0) : NULL;
+	}
+
+	inline T* end() const
+	{
+		return begin() + m_iCount;
+	}
+
+	inline T& operator[](unsigned int index) const
+	{
+		assert(index < m_iCount);
+		return begin()[index];
+	}
+
+	inline unsigned int GetCount() const
+	{
+		return m_iCount;
+	}
+
+	inline unsigned int GetCapacity() const
+	{
+		return m_pPool ? m_pPool->m_iBlockNum : 0;
+	}
+
+private:
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator=(const ObjectPool&);
+
+	// Blocks are exactly one object apart so the live objects form an array
+	static size_t blockSize()
+	{
+		static_assert(sizeof(T) % sizeof(unsigned int) == 0, "Blocks stay word aligned");
+		return sizeof(T);
+	}
+
+	MemoryPool*								m_pPool;
+	void*									m_pReserved;
+	size_t									m_iReservedSize;
+	unsigned int							m_iCount; // live objects, they occupy blocks [0, m_iCount)
+};
+
+#endif
@@ -0,0 +1,125 @@
+// PoolAllocator.h: standard allocator that takes memory from the MemoryManager pools or from an arena
+// Pool memory is pinned so Defragment never moves it
+// Containers that outlive MemoryManager::Destruct or the manager itself leave their pool memory behind instead of freeing it
+#ifndef POOLALLOCATOR_H_
+#define POOLALLOCATOR_H_
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include "MemoryManager.h"
+#include "LinearAllocator.h"
+
+template <typename T>
+class PoolAllocator
+{
+public:
+	typedef T								value_type;
+	typedef T*								pointer;
+	typedef const T*						const_pointer;
+	typedef T&								reference;
+	typedef const T&						const_reference;
+	typedef size_t							size_type;
+	typedef ptrdiff_t						difference_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef PoolAllocator<U> other;
+	};
+
+	// Allocate from the MemoryManager pools
+	PoolAllocator()
+		: m_pArena(NULL)
+		, m_Tag(MEMORY_TAG_UNTAGGED)
+	{}
+
+	// Allocate from the pools, recorded under tag in the telemetry
+	explicit PoolAllocator(MemoryTag tag)
+		: m_pArena(NULL)
+		, m_Tag(tag)
+	{}
+
+	// Allocate from an arena, deallocation is left to the arena's Reset
+	explicit PoolAllocator(LinearAllocator* arena)
+		: m_pArena(arena)
+		, m_Tag(MEMORY_TAG_UNTAGGED)
+	{}
+
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U>& other)
+		: m_pArena(other.m_pArena)
+		, m_Tag(other.m_Tag)
+	{}
+
+	T* allocate(size_t n)
+	{
+		void* ptr = m_pArena ? m_pArena->Allocate(sizeof(T) * n) : MemoryManager::GetInstance()->AllocateRaw(sizeof(T) * n, m_Tag);
+		if (!ptr)
+			throw std::bad_alloc();
+		return (T*) ptr;
+	}
+
+	void deallocate(T* ptr, size_t n)
+	{
+		(void) n;
+		// A manager already deleted is not created again just to free
+		if (!m_pArena && MemoryManager::HasInstance())
+			MemoryManager::GetInstance()->FreeRaw(ptr);
+	}
+
+	size_t max_size() const
+	{
+		return ((size_t) -1) / sizeof(T);
+	}
+
+	LinearAllocator*						m_pArena;
+	MemoryTag								m_Tag;
+};
+
+// Memory from one allocator can be freed by another unless they use different arenas
+template <typename T, typename U>
+inline bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+	return a.m_pArena == b.m_pArena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+	return a.m_pArena != b.m_pArena;
+}
+
+template <typename T>
+using PoolVector = std::vector<T, PoolAllocator<T> >;
+
+typedef std::basic_string<char, std::char_traits<char>, PoolAllocator<char> > PoolString;
+
+// std::hash has no specialization for strings with another allocator
+template <typename T>
+struct PoolHash : public std::hash<T>
+{
+};
+
+template <>
+struct PoolHash<PoolString>
+{
+	// FNV-1a
+	size_t operator()(const PoolString& str) const
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+template <typename K, typename V, typename Hash = PoolHash<K>, typename Equal = std::equal_to<K> >
+using PoolUnorderedMap = std::unordered_map<K, V, Hash, Equal, PoolAllocator<std::pair<const K, V> > >;
+
+#endif
@@ -0,0 +1,71 @@
+// VirtualMemory.cpp
+
+#include "VirtualMemory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN32
+
+void* VirtualMemory::Reserve(size_t size)
+{
+	return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+// Large pages on Windows need a privilege and must be committed with the reservation, so hugePages is ignored
+bool VirtualMemory::Commit(void* ptr, size_t size, bool hugePages)
+{
+	(void) hugePages;
+	return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void VirtualMemory::Decommit(void* ptr, size_t size)
+{
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+void VirtualMemory::Release(void* ptr, size_t size)
+{
+	(void) size;
+	if (ptr)
+		VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+#else
+
+void* VirtualMemory::Reserve(size_t size)
+{
+	void* ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+// Pages are only backed by memory when first touched
+bool VirtualMemory::Commit(void* ptr, size_t size, bool hugePages)
+{
+	if (mprotect(ptr, size, PROT_READ | PROT_WRITE) != 0)
+		return false;
+#ifdef MADV_HUGEPAGE
+	if (hugePages)
+		madvise(ptr, size, MADV_HUGEPAGE);
+#else
+	(void) hugePages;
+#endif
+	return true;
+}
+
+void VirtualMemory::Decommit(void* ptr, size_t size)
+{
+	madvise(ptr, size, MADV_DONTNEED);
+	mprotect(ptr, size, PROT_NONE);
+}
+
+void VirtualMemory::Release(void* ptr, size_t size)
+{
+	if (ptr)
+		munmap(ptr, size);
+}
+
+#endif
@@ -0,0 +1,30 @@
+// VirtualMemory.h: reserve address space and commit pages on demand
+#ifndef VIRTUALMEMORY_H_
+#define VIRTUALMEMORY_H_
+
+#include <stddef.h>
+
+// Pages are committed in chunks of this size, a multiple of the page size on every platform
+const size_t MEMORY_COMMIT_SIZE = 64 * 1024;
+
+// Chunk size for regions backed by transparent huge pages
+const size_t MEMORY_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+class VirtualMemory
+{
+public:
+	// Reserve address space without backing memory, return NULL on failure
+	static void* Reserve(size_t size);
+
+	// Make reserved pages usable, ptr and size must be page aligned
+	// hugePages asks for transparent huge pages where the platform supports them
+	static bool Commit(void* ptr, size_t size, bool hugePages = false);
+
+	// Give committed pages back to the system, the address range stays reserved
+	static void Decommit(void* ptr, size_t size);
+
+	// Release a whole reservation
+	static void Release(void* ptr, size_t size);
+};
+
+#endif
@@ -79,11 +79,12 @@ bool ObjectLoader::LoadWaveFrontObject(const float scale) {
 		return false;
 	}
 
-	std::vector<Vertex1P> tempVertices1P;
-	std::vector<Vertex1P1UV> tempVertices1P1UV;
-	std::vector<Vector3> tempVertices;
-	std::vector<Vector3> tempNormals;
-	std::vector<std::vector<float>> tempUVs;
+	PoolAllocator<char> loaderAllocator(MEMORY_TAG_LOADER);
+	PoolVector<Vertex1P> tempVertices1P(loaderAllocator);
+	PoolVector<Vertex1P1UV> tempVertices1P1UV(loaderAllocator);
+	PoolVector<Vector3> tempVertices(loaderAllocator);
+	PoolVector<Vector3> tempNormals(loaderAllocator);
+	PoolVector<PoolVector<float>> tempUVs(loaderAllocator);
 
 	char lineHeader[128], temps[128];
 	float tempf[3];
@@ -113,7 +114,7 @@ bool ObjectLoader::LoadWaveFrontObject(const float scale) {
 				}
 				else if (strcmp(lineHeader, "vt") == 0) {
 					fscanf(file, "%f %f %f\n", &tempf[0], &tempf[1], &tempf[2]);
-					std::vector<float> temp;
+					PoolVector<float> temp(loaderAllocator);
 					temp.push_back(tempf[0]);
 					temp.push_back(1.0f - tempf[1]);	//Transform the origin from bottom left to top left
 					tempUVs.push_back(temp);
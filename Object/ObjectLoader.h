@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include "../Graphics/D3D11Renderer.h"
+#include "../Memory/PoolAllocator.h"
 
 #define MODEL_PATH "../3DModel/"
 
@@ -30,7 +31,7 @@ public:
 		return m_vertices;
 	}
 
-	void setVertices(std::vector<Vertex1P>& vertices) {
+	void setVertices(PoolVector<Vertex1P>& vertices) {
 		m_vertices = new Vertex1P[vertices.size()];
 		for (int i = 0; i < vertices.size(); i++) {
 			((Vertex1P*) m_vertices)[i].m_pos = vertices.at(i).m_pos;
@@ -38,7 +39,7 @@ public:
 		m_numVertices = vertices.size();
 	}
 
-	void setVertices(std::vector<Vertex1P1UV>& vertices) {
+	void setVertices(PoolVector<Vertex1P1UV>& vertices) {
 		m_vertices = new Vertex1P1UV[vertices.size()];
 		for (int i = 0; i < vertices.size(); i++) {
 			((Vertex1P1UV*) m_vertices)[i].m_pos = vertices.at(i).m_pos;
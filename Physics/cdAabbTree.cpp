@@ -0,0 +1,566 @@
+#include "cdAabbTree.h"
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+	// deeper than any tree that fits in memory, a balanced tree of n leaves is about 1.44 log2 n high
+	const int TREE_STACK_SIZE = 256;
+
+	// moved proxies whose pairs one job queries
+	const int MOVE_JOB_SIZE = 256;
+
+	// m_State of a node
+	enum
+	{
+		LEAF_RESTING,
+		LEAF_MOVED,			// inserted again since the last updatePairs
+		LEAF_REMOVED		// out of the tree, freed by the next updatePairs
+	};
+
+	void getAxes(const Vector3& v, float axes[3])
+	{
+		axes[0] = v.GetX();
+		axes[1] = v.GetY();
+		axes[2] = v.GetZ();
+	}
+
+	void combine(float min[3], float max[3], const float min0[3], const float max0[3], const float min1[3], const float max1[3])
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			min[axis] = std::min(min0[axis], min1[axis]);
+			max[axis] = std::max(max0[axis], max1[axis]);
+		}
+	}
+
+	// half the surface area, the cost of a node is the chance a query touches it
+	float area(const float min[3], const float max[3])
+	{
+		float dx = max[0] - min[0];
+		float dy = max[1] - min[1];
+		float dz = max[2] - min[2];
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	float combinedArea(const float min0[3], const float max0[3], const float min1[3], const float max1[3])
+	{
+		float min[3], max[3];
+		combine(min, max, min0, max0, min1, max1);
+		return area(min, max);
+	}
+
+	bool overlap(const float min0[3], const float max0[3], const float min1[3], const float max1[3])
+	{
+		return min0[0] <= max1[0] && min1[0] <= max0[0] &&
+			min0[1] <= max1[1] && min1[1] <= max0[1] &&
+			min0[2] <= max1[2] && min1[2] <= max0[2];
+	}
+
+	bool contains(const float outerMin[3], const float outerMax[3], const float min[3], const float max[3])
+	{
+		return outerMin[0] <= min[0] && outerMin[1] <= min[1] && outerMin[2] <= min[2] &&
+			max[0] <= outerMax[0] && max[1] <= outerMax[1] && max[2] <= outerMax[2];
+	}
+
+	bool sphereOverlap(const float center[3], float radiusSquared, const float min[3], const float max[3])
+	{
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float d = center[axis] < min[axis] ? min[axis] - center[axis] : (center[axis] > max[axis] ? center[axis] - max[axis] : 0.0f);
+			distanceSquared += d * d;
+		}
+		return distanceSquared <= radiusSquared;
+	}
+}
+
+AabbTree::AabbTree(float margin)
+{
+	m_Root = -1;
+	m_FreeList = -1;
+	m_ProxyCount = 0;
+	m_Margin = margin;
+}
+
+int AabbTree::addProxy(const Vector3& min, const Vector3& max, void* pUserData)
+{
+	int proxy = allocateNode();
+	Node& leaf = m_NodeList[proxy];
+	getAxes(min, leaf.m_Min);
+	getAxes(max, leaf.m_Max);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		leaf.m_Min[axis] -= m_Margin;
+		leaf.m_Max[axis] += m_Margin;
+	}
+	leaf.m_pUserData = pUserData;
+	leaf.m_Height = 0;
+	leaf.m_State = LEAF_MOVED;
+	insertLeaf(proxy);
+
+	m_MoveBuffer.push_back(proxy);
+	m_ProxyCount++;
+	return proxy;
+}
+
+void AabbTree::removeProxy(int proxy)
+{
+	removeLeaf(proxy);
+	m_NodeList[proxy].m_State = LEAF_REMOVED;
+	m_RemovedProxies.push_back(proxy);
+	m_ProxyCount--;
+}
+
+void AabbTree::moveProxy(int proxy, const Vector3& min, const Vector3& max)
+{
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+
+	// keep the enlarged box while it holds the box and is not far larger, as after a fast move
+	Node& leaf = m_NodeList[proxy];
+	if (contains(leaf.m_Min, leaf.m_Max, minAxes, maxAxes))
+	{
+		float hugeMin[3], hugeMax[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			hugeMin[axis] = minAxes[axis] - 4.0f * m_Margin;
+			hugeMax[axis] = maxAxes[axis] + 4.0f * m_Margin;
+		}
+		if (contains(hugeMin, hugeMax, leaf.m_Min, leaf.m_Max))
+			return;
+	}
+
+	removeLeaf(proxy);
+	Node& moved = m_NodeList[proxy];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		moved.m_Min[axis] = minAxes[axis] - m_Margin;
+		moved.m_Max[axis] = maxAxes[axis] + m_Margin;
+	}
+	insertLeaf(proxy);
+
+	if (m_NodeList[proxy].m_State != LEAF_MOVED)
+	{
+		m_NodeList[proxy].m_State = LEAF_MOVED;
+		m_MoveBuffer.push_back(proxy);
+	}
+}
+
+void AabbTree::getAABB(int proxy, Vector3& min, Vector3& max) const
+{
+	const Node& leaf = m_NodeList[proxy];
+	min.Set(leaf.m_Min[0], leaf.m_Min[1], leaf.m_Min[2]);
+	max.Set(leaf.m_Max[0], leaf.m_Max[1], leaf.m_Max[2]);
+}
+
+void AabbTree::queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const
+{
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+	proxies.clear();
+	queryNode(minAxes, maxAxes, proxies);
+}
+
+void AabbTree::querySphere(const Vector3& center, float radius, PoolVector<int>& proxies) const
+{
+	float c[3];
+	getAxes(center, c);
+	float radiusSquared = radius * radius;
+	proxies.clear();
+	if (m_Root < 0)
+		return;
+
+	int stack[TREE_STACK_SIZE];
+	int count = 0;
+	stack[count++] = m_Root;
+	while (count > 0)
+	{
+		int index = stack[--count];
+		const Node& node = m_NodeList[index];
+		if (!sphereOverlap(c, radiusSquared, node.m_Min, node.m_Max))
+			continue;
+
+		if (node.m_Child1 < 0)
+		{
+			proxies.push_back(index);
+		}
+		else
+		{
+			assert(count + 2 <= TREE_STACK_SIZE);
+			stack[count++] = node.m_Child1;
+			stack[count++] = node.m_Child2;
+		}
+	}
+}
+
+void AabbTree::queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const
+{
+	float s[3], d[3], invDir[3];
+	getAxes(start, s);
+	getAxes(dir, d);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		invDir[axis] = 1.0f / d[axis];
+	}
+	proxies.clear();
+	if (m_Root < 0)
+		return;
+
+	PoolVector<RayHit> hits;
+	int stack[TREE_STACK_SIZE];
+	int count = 0;
+	stack[count++] = m_Root;
+	while (count > 0)
+	{
+		int index = stack[--count];
+		const Node& node = m_NodeList[index];
+		RayHit hit;
+		if (!rayHitsAABB(s, invDir, maxFraction, node.m_Min, node.m_Max, hit.m_T))
+			continue;
+
+		if (node.m_Child1 < 0)
+		{
+			hit.m_Proxy = index;
+			hits.push_back(hit);
+		}
+		else
+		{
+			assert(count + 2 <= TREE_STACK_SIZE);
+			stack[count++] = node.m_Child1;
+			stack[count++] = node.m_Child2;
+		}
+	}
+	sortRayHits(hits, proxies);
+}
+
+void AabbTree::updatePairs()
+{
+	if (!m_MoveBuffer.empty() || !m_RemovedProxies.empty())
+	{
+		// pairs that came apart or lost a proxy, only a moved box changed
+		listPairs(m_PairBuffer);
+		for (size_t i = 0; i < m_PairBuffer.size(); ++i)
+		{
+			const Node& node0 = m_NodeList[m_PairBuffer[i].m_ProxyA];
+			const Node& node1 = m_NodeList[m_PairBuffer[i].m_ProxyB];
+			if (node0.m_State == LEAF_REMOVED || node1.m_State == LEAF_REMOVED ||
+				((node0.m_State != LEAF_RESTING || node1.m_State != LEAF_RESTING) && !overlap(node0.m_Min, node0.m_Max, node1.m_Min, node1.m_Max)))
+				removePair(m_PairBuffer[i].m_ProxyA, m_PairBuffer[i].m_ProxyB);
+		}
+
+		// pairs of moved boxes, queried in jobs that each list their pairs, then added in job order
+		int jobCount = WorkerPool::getJobCount((int) m_MoveBuffer.size(), MOVE_JOB_SIZE);
+		if ((int) m_JobPairs.size() < jobCount)
+			m_JobPairs.resize(jobCount);
+		runJobs(queryMovedJob, this, jobCount);
+		for (int job = 0; job < jobCount; ++job)
+		{
+			const PoolVector<ProxyPair>& pairs = m_JobPairs[job];
+			for (size_t i = 0; i < pairs.size(); ++i)
+			{
+				addPair(pairs[i].m_ProxyA, pairs[i].m_ProxyB);
+			}
+		}
+
+		for (size_t i = 0; i < m_MoveBuffer.size(); ++i)
+		{
+			if (m_NodeList[m_MoveBuffer[i]].m_State == LEAF_MOVED)
+				m_NodeList[m_MoveBuffer[i]].m_State = LEAF_RESTING;
+		}
+		m_MoveBuffer.clear();
+	}
+
+	BroadPhase::updatePairs();
+
+	// the removed leaves have no pairs left to report
+	for (size_t i = 0; i < m_RemovedProxies.size(); ++i)
+	{
+		freeNode(m_RemovedProxies[i]);
+	}
+	m_RemovedProxies.clear();
+}
+
+// two moved boxes find each other and only the higher proxy lists the pair
+void AabbTree::queryMovedJob(void* pData, int job)
+{
+	AabbTree& tree = *(AabbTree*) pData;
+	PoolVector<ProxyPair>& pairs = tree.m_JobPairs[job];
+	pairs.clear();
+
+	PoolVector<int> proxies;
+	size_t first = (size_t) job * MOVE_JOB_SIZE;
+	size_t last = std::min(first + MOVE_JOB_SIZE, tree.m_MoveBuffer.size());
+	for (size_t i = first; i < last; ++i)
+	{
+		int proxy = tree.m_MoveBuffer[i];
+		const Node& node = tree.m_NodeList[proxy];
+		if (node.m_State != LEAF_MOVED)
+			continue;
+
+		proxies.clear();
+		tree.queryNode(node.m_Min, node.m_Max, proxies);
+		for (size_t j = 0; j < proxies.size(); ++j)
+		{
+			int other = proxies[j];
+			if (other != proxy && !(tree.m_NodeList[other].m_State == LEAF_MOVED && other > proxy))
+			{
+				ProxyPair pair;
+				pair.m_ProxyA = std::min(proxy, other);
+				pair.m_ProxyB = std::max(proxy, other);
+				pairs.push_back(pair);
+			}
+		}
+	}
+}
+
+float AabbTree::getAreaRatio() const
+{
+	if (m_Root < 0)
+		return 0.0f;
+
+	float totalArea = 0.0f;
+	int stack[TREE_STACK_SIZE];
+	int count = 0;
+	stack[count++] = m_Root;
+	while (count > 0)
+	{
+		const Node& node = m_NodeList[stack[--count]];
+		if (node.m_Child1 < 0)
+			continue;
+
+		totalArea += area(node.m_Min, node.m_Max);
+		stack[count++] = node.m_Child1;
+		stack[count++] = node.m_Child2;
+	}
+
+	float rootArea = area(m_NodeList[m_Root].m_Min, m_NodeList[m_Root].m_Max);
+	return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+int AabbTree::allocateNode()
+{
+	int node = m_FreeList;
+	if (node < 0)
+	{
+		node = (int) m_NodeList.size();
+		m_NodeList.push_back(Node());
+	}
+	else
+	{
+		m_FreeList = m_NodeList[node].m_Parent;
+	}
+
+	Node& allocated = m_NodeList[node];
+	allocated.m_pUserData = NULL;
+	allocated.m_Parent = -1;
+	allocated.m_Child1 = -1;
+	allocated.m_Child2 = -1;
+	allocated.m_Height = 0;
+	allocated.m_State = LEAF_RESTING;
+	return node;
+}
+
+void AabbTree::freeNode(int node)
+{
+	m_NodeList[node].m_Parent = m_FreeList;
+	m_NodeList[node].m_Height = -1;
+	m_FreeList = node;
+}
+
+// descend to the sibling whose new parent costs least, a new parent adds its area
+// and every node above grows by the area the leaf adds to it
+void AabbTree::insertLeaf(int leaf)
+{
+	if (m_Root < 0)
+	{
+		m_Root = leaf;
+		m_NodeList[leaf].m_Parent = -1;
+		return;
+	}
+
+	const float* leafMin = m_NodeList[leaf].m_Min;
+	const float* leafMax = m_NodeList[leaf].m_Max;
+	int index = m_Root;
+	while (!isLeaf(index))
+	{
+		const Node& node = m_NodeList[index];
+		const Node& child1 = m_NodeList[node.m_Child1];
+		const Node& child2 = m_NodeList[node.m_Child2];
+
+		float nodeArea = area(node.m_Min, node.m_Max);
+		float parentArea = combinedArea(node.m_Min, node.m_Max, leafMin, leafMax);
+
+		// a new parent of this node and the leaf, or the cost of descending
+		float cost = 2.0f * parentArea;
+		float inheritanceCost = 2.0f * (parentArea - nodeArea);
+
+		float cost1 = combinedArea(child1.m_Min, child1.m_Max, leafMin, leafMax) + inheritanceCost;
+		if (child1.m_Child1 >= 0)
+			cost1 -= area(child1.m_Min, child1.m_Max);
+		float cost2 = combinedArea(child2.m_Min, child2.m_Max, leafMin, leafMax) + inheritanceCost;
+		if (child2.m_Child1 >= 0)
+			cost2 -= area(child2.m_Min, child2.m_Max);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+		index = cost1 < cost2 ? node.m_Child1 : node.m_Child2;
+	}
+
+	int sibling = index;
+	int oldParent = m_NodeList[sibling].m_Parent;
+	int newParent = allocateNode();
+	Node& parent = m_NodeList[newParent];
+	parent.m_Parent = oldParent;
+	combine(parent.m_Min, parent.m_Max, m_NodeList[leaf].m_Min, m_NodeList[leaf].m_Max, m_NodeList[sibling].m_Min, m_NodeList[sibling].m_Max);
+	parent.m_Height = m_NodeList[sibling].m_Height + 1;
+	parent.m_Child1 = sibling;
+	parent.m_Child2 = leaf;
+	m_NodeList[sibling].m_Parent = newParent;
+	m_NodeList[leaf].m_Parent = newParent;
+
+	if (oldParent < 0)
+		m_Root = newParent;
+	else if (m_NodeList[oldParent].m_Child1 == sibling)
+		m_NodeList[oldParent].m_Child1 = newParent;
+	else
+		m_NodeList[oldParent].m_Child2 = newParent;
+
+	refit(m_NodeList[leaf].m_Parent);
+}
+
+void AabbTree::removeLeaf(int leaf)
+{
+	if (leaf == m_Root)
+	{
+		m_Root = -1;
+		return;
+	}
+
+	int parent = m_NodeList[leaf].m_Parent;
+	int grandParent = m_NodeList[parent].m_Parent;
+	int sibling = m_NodeList[parent].m_Child1 == leaf ? m_NodeList[parent].m_Child2 : m_NodeList[parent].m_Child1;
+
+	// the sibling takes the parent's place
+	m_NodeList[sibling].m_Parent = grandParent;
+	freeNode(parent);
+	if (grandParent < 0)
+	{
+		m_Root = sibling;
+		return;
+	}
+
+	if (m_NodeList[grandParent].m_Child1 == parent)
+		m_NodeList[grandParent].m_Child1 = sibling;
+	else
+		m_NodeList[grandParent].m_Child2 = sibling;
+	refit(grandParent);
+}
+
+// balance, then fix the boxes and heights from node up to the root
+void AabbTree::refit(int node)
+{
+	while (node >= 0)
+	{
+		node = balance(node);
+
+		Node& parent = m_NodeList[node];
+		const Node& child1 = m_NodeList[parent.m_Child1];
+		const Node& child2 = m_NodeList[parent.m_Child2];
+		parent.m_Height = 1 + std::max(child1.m_Height, child2.m_Height);
+		combine(parent.m_Min, parent.m_Max, child1.m_Min, child1.m_Max, child2.m_Min, child2.m_Max);
+
+		node = parent.m_Parent;
+	}
+}
+
+// If one child of a is more than one higher than the other, rotate the higher child up into
+// the place of a, a becomes its child and takes its lower child, return the node now in a's place
+int AabbTree::balance(int iA)
+{
+	Node* a = &m_NodeList[iA];
+	if (a->m_Child1 < 0 || a->m_Height < 2)
+		return iA;
+
+	int iB = a->m_Child1;
+	int iC = a->m_Child2;
+	Node* b = &m_NodeList[iB];
+	Node* c = &m_NodeList[iC];
+	int difference = c->m_Height - b->m_Height;
+	if (difference > 1 || difference < -1)
+	{
+		// the higher child and its children, the lower child stays under a
+		bool rotateC = difference > 1;
+		int iUp = rotateC ? iC : iB;
+		int iStay = rotateC ? iB : iC;
+		Node* up = &m_NodeList[iUp];
+		Node* stay = &m_NodeList[iStay];
+		int iF = up->m_Child1;
+		int iG = up->m_Child2;
+		Node* f = &m_NodeList[iF];
+		Node* g = &m_NodeList[iG];
+
+		// swap a and up
+		up->m_Child1 = iA;
+		up->m_Parent = a->m_Parent;
+		a->m_Parent = iUp;
+		if (up->m_Parent < 0)
+			m_Root = iUp;
+		else if (m_NodeList[up->m_Parent].m_Child1 == iA)
+			m_NodeList[up->m_Parent].m_Child1 = iUp;
+		else
+			m_NodeList[up->m_Parent].m_Child2 = iUp;
+
+		// the higher grandchild stays with up, the lower one goes to a in place of up
+		if (f->m_Height < g->m_Height)
+		{
+			std::swap(iF, iG);
+			std::swap(f, g);
+		}
+		up->m_Child2 = iF;
+		if (rotateC)
+			a->m_Child2 = iG;
+		else
+			a->m_Child1 = iG;
+		g->m_Parent = iA;
+
+		combine(a->m_Min, a->m_Max, stay->m_Min, stay->m_Max, g->m_Min, g->m_Max);
+		combine(up->m_Min, up->m_Max, a->m_Min, a->m_Max, f->m_Min, f->m_Max);
+		a->m_Height = 1 + std::max(stay->m_Height, g->m_Height);
+		up->m_Height = 1 + std::max(a->m_Height, f->m_Height);
+		return iUp;
+	}
+	return iA;
+}
+
+void AabbTree::queryNode(const float min[3], const float max[3], PoolVector<int>& proxies) const
+{
+	if (m_Root < 0)
+		return;
+
+	int stack[TREE_STACK_SIZE];
+	int count = 0;
+	stack[count++] = m_Root;
+	while (count > 0)
+	{
+		int index = stack[--count];
+		const Node& node = m_NodeList[index];
+		if (!overlap(min, max, node.m_Min, node.m_Max))
+			continue;
+
+		if (node.m_Child1 < 0)
+		{
+			proxies.push_back(index);
+		}
+		else
+		{
+			assert(count + 2 <= TREE_STACK_SIZE);
+			stack[count++] = node.m_Child1;
+			stack[count++] = node.m_Child2;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef CDAABBTREE_H
+#define CDAABBTREE_H
+
+#include "cdBroadPhase.h"
+
+// Dynamic bounding volume tree, incremental and balanced by rotations as it changes
+// Every box is kept enlarged by a margin, a box that moves within its enlarged box costs nothing,
+// one that leaves it is removed and inserted again. Pairs and queries are of the enlarged boxes,
+// so a pair may be found while the boxes given are up to twice the margin apart
+// Nodes are kept in one array and linked by index, a proxy is the index of its leaf
+class AabbTree : public BroadPhase
+{
+public:
+	explicit AabbTree(float margin = 0.1f);
+
+	virtual int addProxy(const Vector3& min, const Vector3& max, void* pUserData);
+	virtual void removeProxy(int proxy);
+	virtual void moveProxy(int proxy, const Vector3& min, const Vector3& max);
+
+	virtual void* getUserData(int proxy) const { return m_NodeList[proxy].m_pUserData; }
+	virtual int getProxyCount() const { return m_ProxyCount; }
+	virtual void getAABB(int proxy, Vector3& min, Vector3& max) const;
+
+	// descend only into nodes whose boxes the query touches
+	virtual void queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const;
+	virtual void querySphere(const Vector3& center, float radius, PoolVector<int>& proxies) const;
+	virtual void queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const;
+
+	// query the tree with the box of every proxy moved since the last call for its new pairs,
+	// and drop the pairs of moved proxies whose boxes no longer overlap
+	virtual void updatePairs();
+
+	// the longest path from the root to a leaf, 0 for a tree of one leaf
+	int getHeight() const { return m_Root < 0 ? 0 : m_NodeList[m_Root].m_Height; }
+
+	// the surface area of every internal node over that of the root, lower is better
+	float getAreaRatio() const;
+
+private:
+	// 64 bytes, m_Child1 < 0 for a leaf, m_Parent is the next free node of a free node
+	// and m_State says whether a leaf moved or was removed since the last updatePairs
+	struct Node
+	{
+		float				m_Min[3];
+		float				m_Max[3];
+		void*				m_pUserData;
+		int					m_Parent;
+		int					m_Child1;
+		int					m_Child2;
+		int					m_Height;
+		int					m_State;
+		int					m_Padding[3];
+	};
+
+	bool isLeaf(int node) const { return m_NodeList[node].m_Child1 < 0; }
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	void refit(int node);
+	void queryNode(const float min[3], const float max[3], PoolVector<int>& proxies) const;
+	static void queryMovedJob(void* pData, int job);
+
+	PoolVector<Node>					m_NodeList;
+	int									m_Root;
+	int									m_FreeList;
+	int									m_ProxyCount;
+	float								m_Margin;
+
+	// proxies inserted again since the last updatePairs
+	PoolVector<int>						m_MoveBuffer;
+	// removed leaves keep their nodes until updatePairs reports their pairs
+	PoolVector<int>						m_RemovedProxies;
+	PoolVector<ProxyPair>				m_PairBuffer;
+	// the pairs found by each job of updatePairs
+	PoolVector<PoolVector<ProxyPair> >	m_JobPairs;
+};
+
+#endif
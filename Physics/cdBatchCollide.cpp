@@ -0,0 +1,305 @@
+#include "cdBatchCollide.h"
+#include "cdSphere.h"
+#include "cdAabb.h"
+#include "../Math/simdwide.h"
+#include <algorithm>
+
+namespace
+{
+#if defined(SIMD_BACKEND_AVX2)
+	typedef SIMDBackend8 BatchBackend;
+#else
+	typedef SIMDBackend BatchBackend;
+#endif
+	typedef SIMDVector3xN<BatchBackend> BatchVector3;
+	typedef BatchVector3::Lanes Lanes;
+
+	const int BATCH_WIDTH = BatchBackend::Width;
+
+	// the shapes of one batch of pairs gathered by lane, a sphere is x, y, z and radius,
+	// a box its min then its max, lanes past m_Lanes repeat the last pair
+	struct SIMD_ALIGN(32) Batch
+	{
+		float				m_A[6][BATCH_WIDTH];
+		float				m_B[6][BATCH_WIDTH];
+		// -1 to turn the normal around
+		float				m_Sign[BATCH_WIDTH];
+		int					m_Pair[BATCH_WIDTH];
+		int					m_Lanes;
+	};
+
+	BatchVector3 loadVector(const float rows[][BATCH_WIDTH], int row)
+	{
+		return BatchVector3::Load(rows[row], rows[row + 1], rows[row + 2]);
+	}
+
+	// the lanes of the least of x, y and z, the first of equals wins so exactly one is set
+	void leastAxis(Lanes x, Lanes y, Lanes z, Lanes& xLeast, Lanes& yLeast)
+	{
+		xLeast = BatchBackend::And(BatchBackend::CmpLE(x, y), BatchBackend::CmpLE(x, z));
+		yLeast = BatchBackend::And(BatchBackend::CmpLT(y, x), BatchBackend::CmpLE(y, z));
+	}
+
+	// the unit vector along the least axis with the sign of that axis
+	BatchVector3 axisNormal(Lanes xLeast, Lanes yLeast, const BatchVector3& signs)
+	{
+		Lanes zero = BatchBackend::Splat(0.0f);
+		return BatchVector3(BatchBackend::Select(xLeast, signs.GetX(), zero),
+			BatchBackend::Select(yLeast, signs.GetY(), zero),
+			BatchBackend::Select(BatchBackend::Or(xLeast, yLeast), zero, signs.GetZ()));
+	}
+
+	// +1 where a <= b, -1 elsewhere
+	Lanes signOfOrder(Lanes a, Lanes b)
+	{
+		return BatchBackend::Select(BatchBackend::CmpLE(a, b), BatchBackend::Splat(1.0f), BatchBackend::Splat(-1.0f));
+	}
+
+	// every lane is written at the end of the contacts and only those that touch are kept
+	void writeContacts(int mask, const Batch& batch, const BatchVector3& point, const BatchVector3& normal, Lanes depth,
+		Contact* pContacts, int& count)
+	{
+		SIMD_ALIGN(32) float points[3][BATCH_WIDTH];
+		SIMD_ALIGN(32) float normals[3][BATCH_WIDTH];
+		SIMD_ALIGN(32) float depths[BATCH_WIDTH];
+		point.Store(points[0], points[1], points[2]);
+		normal.Store(normals[0], normals[1], normals[2]);
+		BatchBackend::Store(depths, depth);
+
+		for (int lane = 0; lane < batch.m_Lanes; ++lane)
+		{
+			Contact& contact = pContacts[count];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				contact.m_Point[axis] = points[axis][lane];
+				contact.m_Normal[axis] = normals[axis][lane];
+			}
+			contact.m_Depth = depths[lane];
+			contact.m_Pair = batch.m_Pair[lane];
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	// spheres touch when their centers are no further apart than the sum of their radii,
+	// the point is halfway through the overlap
+	void collideSpheres(const Batch& batch, Contact* pContacts, int& count)
+	{
+		BatchVector3 centerA = loadVector(batch.m_A, 0);
+		BatchVector3 centerB = loadVector(batch.m_B, 0);
+		Lanes radiusA = BatchBackend::Load(batch.m_A[3]);
+		Lanes radius = BatchBackend::Add(radiusA, BatchBackend::Load(batch.m_B[3]));
+
+		BatchVector3 offset = centerB - centerA;
+		Lanes distanceSquared = offset.LengthSquared();
+		int mask = BatchVector3::MoveMask(BatchBackend::CmpLE(distanceSquared, BatchBackend::Mul(radius, radius)));
+		if (!mask)
+			return;
+
+		// spheres at the same center are pushed apart along y
+		Lanes distance = BatchBackend::Sqrt(distanceSquared);
+		Lanes apart = BatchBackend::CmpGT(distance, BatchBackend::Splat(0.0f));
+		BatchVector3 normal = Select(apart, offset * BatchBackend::Div(BatchBackend::Splat(1.0f), distance), BatchVector3(0.0f, 1.0f, 0.0f));
+		Lanes depth = BatchBackend::Sub(radius, distance);
+		BatchVector3 point = centerA + normal * BatchBackend::Sub(radiusA, BatchBackend::Mul(depth, BatchBackend::Splat(0.5f)));
+		writeContacts(mask, batch, point, normal, depth, pContacts, count);
+	}
+
+	// the point of the box closest to the center, or for a center inside the box the nearest face
+	void collideSphereBoxes(const Batch& batch, Contact* pContacts, int& count)
+	{
+		BatchVector3 center = loadVector(batch.m_A, 0);
+		Lanes radius = BatchBackend::Load(batch.m_A[3]);
+		BatchVector3 boxMin = loadVector(batch.m_B, 0);
+		BatchVector3 boxMax = loadVector(batch.m_B, 3);
+
+		BatchVector3 closest = Min(Max(center, boxMin), boxMax);
+		BatchVector3 offset = closest - center;
+		Lanes distanceSquared = offset.LengthSquared();
+		int mask = BatchVector3::MoveMask(BatchBackend::CmpLE(distanceSquared, BatchBackend::Mul(radius, radius)));
+		if (!mask)
+			return;
+
+		Lanes distance = BatchBackend::Sqrt(distanceSquared);
+		BatchVector3 outsideNormal = offset * BatchBackend::Div(BatchBackend::Splat(1.0f), distance);
+		Lanes outsideDepth = BatchBackend::Sub(radius, distance);
+
+		// the sphere leaves through the nearest face, the normal points into the box
+		BatchVector3 toMin = center - boxMin;
+		BatchVector3 toMax = boxMax - center;
+		BatchVector3 faceDistance = Min(toMin, toMax);
+		BatchVector3 signs(signOfOrder(toMin.GetX(), toMax.GetX()), signOfOrder(toMin.GetY(), toMax.GetY()), signOfOrder(toMin.GetZ(), toMax.GetZ()));
+		Lanes xLeast, yLeast;
+		leastAxis(faceDistance.GetX(), faceDistance.GetY(), faceDistance.GetZ(), xLeast, yLeast);
+		BatchVector3 insideNormal = axisNormal(xLeast, yLeast, signs);
+		Lanes face = BatchBackend::Min(faceDistance.GetX(), BatchBackend::Min(faceDistance.GetY(), faceDistance.GetZ()));
+		Lanes insideDepth = BatchBackend::Add(radius, face);
+		BatchVector3 insidePoint = center - insideNormal * face;
+
+		Lanes inside = BatchBackend::CmpEQ(distanceSquared, BatchBackend::Splat(0.0f));
+		BatchVector3 normal = Select(inside, insideNormal, outsideNormal) * BatchBackend::Load(batch.m_Sign);
+		Lanes depth = BatchBackend::Select(inside, insideDepth, outsideDepth);
+		BatchVector3 point = Select(inside, insidePoint, closest);
+		writeContacts(mask, batch, point, normal, depth, pContacts, count);
+	}
+
+	// boxes touch when their overlap is not empty, the normal is along the axis of least overlap
+	// and the point is the center of the overlap
+	void collideBoxes(const Batch& batch, Contact* pContacts, int& count)
+	{
+		BatchVector3 minA = loadVector(batch.m_A, 0);
+		BatchVector3 maxA = loadVector(batch.m_A, 3);
+		BatchVector3 minB = loadVector(batch.m_B, 0);
+		BatchVector3 maxB = loadVector(batch.m_B, 3);
+
+		BatchVector3 lower = Max(minA, minB);
+		BatchVector3 upper = Min(maxA, maxB);
+		int mask = BatchVector3::MoveMask(AllLessEqual(lower, upper));
+		if (!mask)
+			return;
+
+		BatchVector3 overlap = upper - lower;
+		BatchVector3 centerA = minA + maxA;
+		BatchVector3 centerB = minB + maxB;
+		BatchVector3 signs(signOfOrder(centerA.GetX(), centerB.GetX()), signOfOrder(centerA.GetY(), centerB.GetY()), signOfOrder(centerA.GetZ(), centerB.GetZ()));
+		Lanes xLeast, yLeast;
+		leastAxis(overlap.GetX(), overlap.GetY(), overlap.GetZ(), xLeast, yLeast);
+		BatchVector3 normal = axisNormal(xLeast, yLeast, signs);
+		Lanes depth = BatchBackend::Min(overlap.GetX(), BatchBackend::Min(overlap.GetY(), overlap.GetZ()));
+		BatchVector3 point = (lower + upper) * 0.5f;
+		writeContacts(mask, batch, point, normal, depth, pContacts, count);
+	}
+}
+
+int BatchCollide::getBatchWidth()
+{
+	return BATCH_WIDTH;
+}
+
+void BatchCollide::groupPairs(const ColliderStorage& colliders, const ColliderPair* pPairs, int count)
+{
+	for (int group = 0; group < GROUP_COUNT; ++group)
+	{
+		m_Groups[group].clear();
+	}
+	m_OtherPairs.clear();
+
+	// the group of each pair of types by the type of A then of B, looked up so the types do not branch
+	static const int groupOf[typeCount][typeCount] =
+	{
+		{ GROUP_SPHERE_SPHERE, GROUP_SPHERE_BOX, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT },
+		{ GROUP_SPHERE_BOX, GROUP_BOX_BOX, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT },
+		{ GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT },
+		{ GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT },
+		{ GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT, GROUP_COUNT },
+	};
+
+	for (int i = 0; i < count; ++i)
+	{
+		int typeA = colliders.getType(pPairs[i].m_ColliderA);
+		int typeB = colliders.getType(pPairs[i].m_ColliderB);
+		int group = groupOf[typeA][typeB];
+		if (group == GROUP_COUNT)
+		{
+			m_OtherPairs.push_back(i);
+			continue;
+		}
+
+		// a sphere and box pair given box first is swapped
+		int flip = typeA > typeB;
+		int indexA = colliders.getIndex(pPairs[i].m_ColliderA);
+		int indexB = colliders.getIndex(pPairs[i].m_ColliderB);
+		ShapePair pair;
+		pair.m_IndexA = flip ? indexB : indexA;
+		pair.m_IndexB = flip ? indexA : indexB;
+		pair.m_Pair = i;
+		pair.m_Flip = flip;
+		m_Groups[group].push_back(pair);
+	}
+}
+
+void BatchCollide::collide(const ColliderStorage& colliders, PoolVector<Contact>& contacts) const
+{
+	// room for every pair to touch
+	size_t pairCount = 0;
+	for (int group = 0; group < GROUP_COUNT; ++group)
+	{
+		pairCount += m_Groups[group].size();
+	}
+	contacts.resize(pairCount);
+	int count = 0;
+	for (int group = 0; group < GROUP_COUNT; ++group)
+	{
+		count += collidePairs(colliders, (Group) group, 0, getGroupSize((Group) group), contacts.data() + count);
+	}
+	contacts.resize(count);
+}
+
+void BatchCollide::collide(const ColliderStorage& colliders, Group group, int first, int count, PoolVector<Contact>& contacts) const
+{
+	contacts.resize(count);
+	contacts.resize(collidePairs(colliders, group, first, count, contacts.data()));
+}
+
+int BatchCollide::collidePairs(const ColliderStorage& colliders, Group group, int first, int count, Contact* pContacts) const
+{
+	const ColliderStorage::SphereArrays& spheres = colliders.getSpheres();
+	const ColliderStorage::BoxArrays& boxes = colliders.getBoxes();
+	const ShapePair* pPairs = m_Groups[group].data() + first;
+
+	Batch batch;
+	int contactCount = 0;
+	for (int batchFirst = 0; batchFirst < count; batchFirst += BATCH_WIDTH)
+	{
+		batch.m_Lanes = std::min(count - batchFirst, BATCH_WIDTH);
+		for (int lane = 0; lane < BATCH_WIDTH; ++lane)
+		{
+			const ShapePair& pair = pPairs[batchFirst + std::min(lane, batch.m_Lanes - 1)];
+			int a = pair.m_IndexA;
+			int b = pair.m_IndexB;
+			batch.m_Pair[lane] = pair.m_Pair;
+			batch.m_Sign[lane] = pair.m_Flip ? -1.0f : 1.0f;
+
+			if (group == GROUP_BOX_BOX)
+			{
+				batch.m_A[0][lane] = boxes.m_MinX[a];
+				batch.m_A[1][lane] = boxes.m_MinY[a];
+				batch.m_A[2][lane] = boxes.m_MinZ[a];
+				batch.m_A[3][lane] = boxes.m_MaxX[a];
+				batch.m_A[4][lane] = boxes.m_MaxY[a];
+				batch.m_A[5][lane] = boxes.m_MaxZ[a];
+			}
+			else
+			{
+				batch.m_A[0][lane] = spheres.m_X[a];
+				batch.m_A[1][lane] = spheres.m_Y[a];
+				batch.m_A[2][lane] = spheres.m_Z[a];
+				batch.m_A[3][lane] = spheres.m_Radius[a];
+			}
+
+			if (group == GROUP_SPHERE_SPHERE)
+			{
+				batch.m_B[0][lane] = spheres.m_X[b];
+				batch.m_B[1][lane] = spheres.m_Y[b];
+				batch.m_B[2][lane] = spheres.m_Z[b];
+				batch.m_B[3][lane] = spheres.m_Radius[b];
+			}
+			else
+			{
+				batch.m_B[0][lane] = boxes.m_MinX[b];
+				batch.m_B[1][lane] = boxes.m_MinY[b];
+				batch.m_B[2][lane] = boxes.m_MinZ[b];
+				batch.m_B[3][lane] = boxes.m_MaxX[b];
+				batch.m_B[4][lane] = boxes.m_MaxY[b];
+				batch.m_B[5][lane] = boxes.m_MaxZ[b];
+			}
+		}
+
+		if (group == GROUP_SPHERE_SPHERE)
+			collideSpheres(batch, pContacts, contactCount);
+		else if (group == GROUP_SPHERE_BOX)
+			collideSphereBoxes(batch, pContacts, contactCount);
+		else
+			collideBoxes(batch, pContacts, contactCount);
+	}
+	return contactCount;
+}
@@ -0,0 +1,77 @@
+#ifndef CDBATCHCOLLIDE_H
+#define CDBATCHCOLLIDE_H
+
+#include "cdColliderStorage.h"
+
+// two colliders of a ColliderStorage the broad phase found near each other
+struct ColliderPair
+{
+	int					m_ColliderA;
+	int					m_ColliderB;
+};
+
+// where two colliders touch, the normal points from A to B and is the way to push B out of A
+struct Contact
+{
+	float				m_Point[3];
+	float				m_Normal[3];
+	// how far the shapes overlap, 0 for shapes that only touch
+	float				m_Depth;
+	// index of the pair in the list given to groupPairs
+	int					m_Pair;
+};
+
+// Narrow phase of sphere and AABB pairs, tested with SIMD a batch of pairs at a time
+// The pairs are grouped by the types of their shapes so a batch runs one test without branching,
+// the shapes of a batch are gathered from the structure of arrays in ColliderStorage
+// Pairs of other shapes are left for Collide
+class BatchCollide
+{
+public:
+	enum Group
+	{
+		GROUP_SPHERE_SPHERE,
+		GROUP_SPHERE_BOX,
+		GROUP_BOX_BOX,
+
+		GROUP_COUNT
+	};
+
+	// 8 pairs a batch with AVX2, 4 otherwise
+	static int getBatchWidth();
+
+	// sort the pairs into their groups, keeping their order
+	void groupPairs(const ColliderStorage& colliders, const ColliderPair* pPairs, int count);
+
+	// test every grouped pair and write a contact for each that touches,
+	// group after group and in the order of the pairs within a group
+	void collide(const ColliderStorage& colliders, PoolVector<Contact>& contacts) const;
+
+	// test count pairs of a group from first on, to split the narrow phase into jobs
+	// the contacts are those collide writes for the same pairs, however the group is split
+	void collide(const ColliderStorage& colliders, Group group, int first, int count, PoolVector<Contact>& contacts) const;
+
+	int getGroupSize(Group group) const { return (int) m_Groups[group].size(); }
+
+	// indices of the pairs with a shape other than a sphere or AABB, in order
+	const PoolVector<int>& getOtherPairs() const { return m_OtherPairs; }
+
+private:
+	// indices into the arrays of each shape, A is the sphere of a sphere and box pair
+	// and m_Flip is set when the pair was given box first, so the normal is turned around
+	struct ShapePair
+	{
+		int					m_IndexA;
+		int					m_IndexB;
+		int					m_Pair;
+		int					m_Flip;
+	};
+
+	// write the contacts of count pairs of a group to pContacts and return how many
+	int collidePairs(const ColliderStorage& colliders, Group group, int first, int count, Contact* pContacts) const;
+
+	PoolVector<ShapePair>				m_Groups[GROUP_COUNT];
+	PoolVector<int>						m_OtherPairs;
+};
+
+#endif
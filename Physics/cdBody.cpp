@@ -4,6 +4,8 @@
 #include "cdBody.h"
 #include "cdPoint.h"
 #include "cdRay.h"
+#include <float.h>
+#include <math.h>
 
 Vector3 Body::getCenter() const
 {
@@ -19,4 +21,51 @@ Vector3 Body::getCenter() const
 		center = (Vector3)self->getCenter();
 	}
 	return center;
-}
\ No newline at end of file
+}
+
+void Body::getBounds(Vector3& min, Vector3& max) const
+{
+	if (m_Type == typeAABB)
+	{
+		// the min and max of an AABB are not always ordered by component
+		AABB* self = (AABB*) this;
+		Vector3 a = self->getMin();
+		Vector3 b = self->getMax();
+		min.Set(fminf(a.GetX(), b.GetX()), fminf(a.GetY(), b.GetY()), fminf(a.GetZ(), b.GetZ()));
+		max.Set(fmaxf(a.GetX(), b.GetX()), fmaxf(a.GetY(), b.GetY()), fmaxf(a.GetZ(), b.GetZ()));
+	}
+	else if (m_Type == typeSPHERE)
+	{
+		Sphere* self = (Sphere*) this;
+		float radius = self->getRadius();
+		Vector3 center = self->getCenter();
+		min.Set(center.GetX() - radius, center.GetY() - radius, center.GetZ() - radius);
+		max.Set(center.GetX() + radius, center.GetY() + radius, center.GetZ() + radius);
+	}
+	else if (m_Type == typePOINT)
+	{
+		Point* self = (Point*) this;
+		min = self->getPoint();
+		max = self->getPoint();
+	}
+	else if (m_Type == typeRAY)
+	{
+		// a ray goes on forever along each axis its direction has a component in
+		Ray* self = (Ray*) this;
+		float start[3] = { self->getStart().GetX(), self->getStart().GetY(), self->getStart().GetZ() };
+		float dir[3] = { self->getDir().GetX(), self->getDir().GetY(), self->getDir().GetZ() };
+		float lower[3], upper[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			lower[i] = dir[i] < 0.0f ? -FLT_MAX : start[i];
+			upper[i] = dir[i] > 0.0f ? FLT_MAX : start[i];
+		}
+		min.Set(lower[0], lower[1], lower[2]);
+		max.Set(upper[0], upper[1], upper[2]);
+	}
+	else
+	{
+		min.Set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		max.Set(FLT_MAX, FLT_MAX, FLT_MAX);
+	}
+}
@@ -36,6 +36,8 @@ public:
 	int getType() const { return m_Type; }
 	void setType(const int type) { m_Type = type; }
 	Vector3 getCenter() const;
+	// the axis-aligned box around the body, for the broad phase
+	void getBounds(Vector3& min, Vector3& max) const;
 	virtual void computeAABB(const Matrix4& transform) {}
 
 	virtual void update(const float deltaTime, const Vector3& translate) {}
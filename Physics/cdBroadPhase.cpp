@@ -0,0 +1,304 @@
+#include "cdBroadPhase.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+	enum
+	{
+		PAIR_OVERLAP = 1,		// overlaps now
+		PAIR_REPORTED = 2,		// overlapped at the last updatePairs
+		PAIR_TOUCHED = 4		// in the touched list
+	};
+
+	uint64_t pairKey(uint32_t proxy0, uint32_t proxy1)
+	{
+		if (proxy0 > proxy1)
+			std::swap(proxy0, proxy1);
+		return ((uint64_t) proxy0 << 32) | proxy1;
+	}
+
+	ProxyPair keyPair(uint64_t key)
+	{
+		ProxyPair pair;
+		pair.m_ProxyA = (int) (key >> 32);
+		pair.m_ProxyB = (int) (key & 0xffffffff);
+		return pair;
+	}
+
+	bool pairLess(const ProxyPair& pair0, const ProxyPair& pair1)
+	{
+		return pair0.m_ProxyA < pair1.m_ProxyA || (pair0.m_ProxyA == pair1.m_ProxyA && pair0.m_ProxyB < pair1.m_ProxyB);
+	}
+
+	void getAxes(const Vector3& v, float axes[3])
+	{
+		axes[0] = v.GetX();
+		axes[1] = v.GetY();
+		axes[2] = v.GetZ();
+	}
+
+	// on a worker pool the pairs are sorted in runs of this many, then the runs are merged two at a time
+	const int SORT_JOB_SIZE = 16384;
+
+	struct SortJobs
+	{
+		ProxyPair*			m_pPairs;
+		ProxyPair*			m_pMerged;
+		int					m_Count;
+		// the length of the sorted runs being merged
+		int					m_RunSize;
+	};
+
+	void sortJob(void* pData, int job)
+	{
+		const SortJobs& jobs = *(const SortJobs*) pData;
+		int first = job * SORT_JOB_SIZE;
+		int last = std::min(first + SORT_JOB_SIZE, jobs.m_Count);
+		std::sort(jobs.m_pPairs + first, jobs.m_pPairs + last, pairLess);
+	}
+
+	void mergeJob(void* pData, int job)
+	{
+		const SortJobs& jobs = *(const SortJobs*) pData;
+		int first = job * 2 * jobs.m_RunSize;
+		int middle = std::min(first + jobs.m_RunSize, jobs.m_Count);
+		int last = std::min(middle + jobs.m_RunSize, jobs.m_Count);
+		std::merge(jobs.m_pPairs + first, jobs.m_pPairs + middle, jobs.m_pPairs + middle, jobs.m_pPairs + last,
+			jobs.m_pMerged + first, pairLess);
+	}
+}
+
+BroadPhase::BroadPhase()
+{
+	m_PairCount = 0;
+	m_pWorkerPool = NULL;
+}
+
+void BroadPhase::addProxies(const Vector3* pMins, const Vector3* pMaxs, void* const* ppUserData, int count, int* pProxies)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		pProxies[i] = addProxy(pMins[i], pMaxs[i], ppUserData[i]);
+	}
+}
+
+// the boxes around the sphere, then the distance from the center to each box
+void BroadPhase::querySphere(const Vector3& center, float radius, PoolVector<int>& proxies) const
+{
+	Vector3 extent(radius, radius, radius);
+	queryAABB(center - extent, center + extent, proxies);
+
+	float c[3];
+	getAxes(center, c);
+	size_t count = 0;
+	for (size_t i = 0; i < proxies.size(); ++i)
+	{
+		Vector3 min, max;
+		getAABB(proxies[i], min, max);
+		float boxMin[3], boxMax[3];
+		getAxes(min, boxMin);
+		getAxes(max, boxMax);
+
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float d = c[axis] < boxMin[axis] ? boxMin[axis] - c[axis] : (c[axis] > boxMax[axis] ? c[axis] - boxMax[axis] : 0.0f);
+			distanceSquared += d * d;
+		}
+		if (distanceSquared <= radius * radius)
+			proxies[count++] = proxies[i];
+	}
+	proxies.resize(count);
+}
+
+// the boxes around the ray, then a slab test of each, a ray without an end queries half of space
+void BroadPhase::queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const
+{
+	float s[3], d[3], invDir[3], lower[3], upper[3];
+	getAxes(start, s);
+	getAxes(dir, d);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		invDir[axis] = 1.0f / d[axis];
+		float end = d[axis] == 0.0f ? s[axis] : s[axis] + d[axis] * maxFraction;
+		if (!(fabsf(end) <= FLT_MAX))
+			end = d[axis] < 0.0f ? -FLT_MAX : FLT_MAX;
+		lower[axis] = std::min(s[axis], end);
+		upper[axis] = std::max(s[axis], end);
+	}
+	queryAABB(Vector3(lower[0], lower[1], lower[2]), Vector3(upper[0], upper[1], upper[2]), proxies);
+
+	PoolVector<RayHit> hits;
+	for (size_t i = 0; i < proxies.size(); ++i)
+	{
+		Vector3 min, max;
+		getAABB(proxies[i], min, max);
+		float boxMin[3], boxMax[3];
+		getAxes(min, boxMin);
+		getAxes(max, boxMax);
+
+		RayHit hit;
+		hit.m_Proxy = proxies[i];
+		if (rayHitsAABB(s, invDir, maxFraction, boxMin, boxMax, hit.m_T))
+			hits.push_back(hit);
+	}
+	sortRayHits(hits, proxies);
+}
+
+void BroadPhase::updatePairs()
+{
+	m_AddedPairs.clear();
+	m_RemovedPairs.clear();
+
+	for (size_t i = 0; i < m_TouchedPairs.size(); ++i)
+	{
+		PoolUnorderedMap<uint64_t, uint32_t>::iterator state = m_PairStates.find(m_TouchedPairs[i]);
+		bool overlap = (state->second & PAIR_OVERLAP) != 0;
+		bool reported = (state->second & PAIR_REPORTED) != 0;
+		if (overlap && !reported)
+		{
+			m_AddedPairs.push_back(keyPair(state->first));
+			m_PairCount++;
+		}
+		else if (!overlap && reported)
+		{
+			m_RemovedPairs.push_back(keyPair(state->first));
+			m_PairCount--;
+		}
+
+		if (overlap)
+			state->second = PAIR_OVERLAP | PAIR_REPORTED;
+		else
+			m_PairStates.erase(state);
+	}
+	m_TouchedPairs.clear();
+
+	std::sort(m_AddedPairs.begin(), m_AddedPairs.end(), pairLess);
+	std::sort(m_RemovedPairs.begin(), m_RemovedPairs.end(), pairLess);
+}
+
+// no two pairs are equal, so sorting in runs and merging gives the order std::sort does
+void BroadPhase::getPairs(PoolVector<ProxyPair>& pairs) const
+{
+	listPairs(pairs);
+	if (!m_pWorkerPool || m_pWorkerPool->getThreadCount() == 1 || pairs.size() <= (size_t) SORT_JOB_SIZE)
+	{
+		std::sort(pairs.begin(), pairs.end(), pairLess);
+		return;
+	}
+
+	SortJobs jobs;
+	jobs.m_pPairs = pairs.data();
+	jobs.m_Count = (int) pairs.size();
+	runJobs(sortJob, &jobs, WorkerPool::getJobCount(jobs.m_Count, SORT_JOB_SIZE));
+
+	m_MergeBuffer.resize(pairs.size());
+	jobs.m_pMerged = m_MergeBuffer.data();
+	for (jobs.m_RunSize = SORT_JOB_SIZE; jobs.m_RunSize < jobs.m_Count; jobs.m_RunSize *= 2)
+	{
+		runJobs(mergeJob, &jobs, WorkerPool::getJobCount(jobs.m_Count, 2 * jobs.m_RunSize));
+		std::swap(jobs.m_pPairs, jobs.m_pMerged);
+	}
+	if (jobs.m_pPairs != pairs.data())
+		std::copy(m_MergeBuffer.begin(), m_MergeBuffer.end(), pairs.begin());
+}
+
+void BroadPhase::listPairs(PoolVector<ProxyPair>& pairs) const
+{
+	pairs.clear();
+	for (PoolUnorderedMap<uint64_t, uint32_t>::const_iterator itr = m_PairStates.begin(); itr != m_PairStates.end(); ++itr)
+	{
+		if (itr->second & PAIR_REPORTED)
+			pairs.push_back(keyPair(itr->first));
+	}
+}
+
+void BroadPhase::addPair(uint32_t proxy0, uint32_t proxy1)
+{
+	uint64_t key = pairKey(proxy0, proxy1);
+	uint32_t& state = m_PairStates[key];
+	if (!(state & PAIR_OVERLAP))
+		touchPair(key, state, true);
+}
+
+// boxes that never overlapped are not in the states, only known pairs are touched
+void BroadPhase::removePair(uint32_t proxy0, uint32_t proxy1)
+{
+	PoolUnorderedMap<uint64_t, uint32_t>::iterator state = m_PairStates.find(pairKey(proxy0, proxy1));
+	if (state != m_PairStates.end() && (state->second & PAIR_OVERLAP))
+		touchPair(state->first, state->second, false);
+}
+
+void BroadPhase::touchPair(uint64_t key, uint32_t& state, bool overlap)
+{
+	if (!(state & PAIR_TOUCHED))
+	{
+		state |= PAIR_TOUCHED;
+		m_TouchedPairs.push_back(key);
+	}
+
+	if (overlap)
+		state |= PAIR_OVERLAP;
+	else
+		state &= ~PAIR_OVERLAP;
+}
+
+bool BroadPhase::rayHitsAABB(const float start[3], const float invDir[3], float maxFraction,
+	const float min[3], const float max[3], float& t)
+{
+	float tMin = 0.0f;
+	float tMax = maxFraction;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// parallel to the slab, 0 * infinity would be NaN
+		if (fabsf(invDir[axis]) > FLT_MAX)
+		{
+			if (start[axis] < min[axis] || start[axis] > max[axis])
+				return false;
+			continue;
+		}
+
+		float t1 = (min[axis] - start[axis]) * invDir[axis];
+		float t2 = (max[axis] - start[axis]) * invDir[axis];
+		if (t1 > t2)
+			std::swap(t1, t2);
+		tMin = std::max(tMin, t1);
+		tMax = std::min(tMax, t2);
+		if (tMin > tMax)
+			return false;
+	}
+	t = tMin;
+	return true;
+}
+
+void BroadPhase::sortRayHits(PoolVector<RayHit>& hits, PoolVector<int>& proxies)
+{
+	std::sort(hits.begin(), hits.end(), rayHitLess);
+
+	proxies.resize(hits.size());
+	for (size_t i = 0; i < hits.size(); ++i)
+	{
+		proxies[i] = hits[i].m_Proxy;
+	}
+}
+
+void BroadPhase::runJobs(WorkerPool::Job job, void* pData, int jobCount) const
+{
+	if (m_pWorkerPool)
+	{
+		m_pWorkerPool->run(job, pData, jobCount);
+		return;
+	}
+
+	for (int i = 0; i < jobCount; ++i)
+	{
+		job(pData, i);
+	}
+}
+
+bool BroadPhase::rayHitLess(const RayHit& hit0, const RayHit& hit1)
+{
+	return hit0.m_T < hit1.m_T || (hit0.m_T == hit1.m_T && hit0.m_Proxy < hit1.m_Proxy);
+}
@@ -0,0 +1,105 @@
+#ifndef CDBROADPHASE_H
+#define CDBROADPHASE_H
+
+#include <stdint.h>
+#include "../Memory/PoolAllocator.h"
+#include "../Math/simdmath.h"
+#include "cdWorkerPool.h"
+
+typedef SIMDVector3 Vector3;
+
+// two proxies whose boxes overlap, m_ProxyA < m_ProxyB
+struct ProxyPair
+{
+	int					m_ProxyA;
+	int					m_ProxyB;
+};
+
+// Finds the pairs of boxes that overlap and the boxes a query touches, the narrow phase tests the bodies
+// A box is added as a proxy, an int that names it until it is removed and the next updatePairs
+// reports its pairs as removed, after which the proxy may name another box
+class BroadPhase
+{
+public:
+	BroadPhase();
+	virtual ~BroadPhase() {}
+
+	// add a box and return its proxy
+	virtual int addProxy(const Vector3& min, const Vector3& max, void* pUserData) = 0;
+
+	// add count boxes and write their proxies to pProxies
+	virtual void addProxies(const Vector3* pMins, const Vector3* pMaxs, void* const* ppUserData, int count, int* pProxies);
+
+	// remove a box, its user data is kept until the next updatePairs
+	virtual void removeProxy(int proxy) = 0;
+
+	// move a box, boxes that touch overlap
+	virtual void moveProxy(int proxy, const Vector3& min, const Vector3& max) = 0;
+
+	virtual void* getUserData(int proxy) const = 0;
+	virtual int getProxyCount() const = 0;
+
+	// the box the broad phase keeps for a proxy, which may be larger than the one given
+	virtual void getAABB(int proxy, Vector3& min, Vector3& max) const = 0;
+
+	// proxies whose boxes overlap the box or the sphere
+	virtual void queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const = 0;
+	virtual void querySphere(const Vector3& center, float radius, PoolVector<int>& proxies) const;
+
+	// proxies whose boxes the ray start + t * dir for t in [0, maxFraction] hits, nearest first
+	virtual void queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const;
+
+	// sort the pairs that began or stopped overlapping since the last call into the added and
+	// removed lists, a pair that began and stopped in between is in neither
+	virtual void updatePairs();
+	const PoolVector<ProxyPair>& getAddedPairs() const { return m_AddedPairs; }
+	const PoolVector<ProxyPair>& getRemovedPairs() const { return m_RemovedPairs; }
+
+	// every overlapping pair as of the last updatePairs, sorted
+	void getPairs(PoolVector<ProxyPair>& pairs) const;
+	size_t getPairCount() const { return m_PairCount; }
+
+	// threads to search for pairs and sort them on, NULL for the calling thread only
+	// the pairs found are the same in the same order for any number of threads
+	void setWorkerPool(WorkerPool* pPool) { m_pWorkerPool = pPool; }
+	WorkerPool* getWorkerPool() const { return m_pWorkerPool; }
+
+protected:
+	// a ray hit of a proxy's box, t is where the ray enters it
+	struct RayHit
+	{
+		float				m_T;
+		int					m_Proxy;
+	};
+
+	// record that two proxies began or stopped overlapping, in any order and as often as found
+	void addPair(uint32_t proxy0, uint32_t proxy1);
+	void removePair(uint32_t proxy0, uint32_t proxy1);
+
+	// every overlapping pair as of the last updatePairs, unsorted
+	void listPairs(PoolVector<ProxyPair>& pairs) const;
+
+	// slab test, invDir is 1 / dir and t the entry, a ray that starts inside enters at 0
+	static bool rayHitsAABB(const float start[3], const float invDir[3], float maxFraction,
+		const float min[3], const float max[3], float& t);
+	static void sortRayHits(PoolVector<RayHit>& hits, PoolVector<int>& proxies);
+
+	// run the jobs on the worker pool, or one after another without one
+	void runJobs(WorkerPool::Job job, void* pData, int jobCount) const;
+
+private:
+	static bool rayHitLess(const RayHit& hit0, const RayHit& hit1);
+	void touchPair(uint64_t key, uint32_t& state, bool overlap);
+
+	// state of every pair that overlaps or changed since the last updatePairs
+	PoolUnorderedMap<uint64_t, uint32_t>	m_PairStates;
+	PoolVector<uint64_t>				m_TouchedPairs;
+	PoolVector<ProxyPair>				m_AddedPairs;
+	PoolVector<ProxyPair>				m_RemovedPairs;
+	size_t								m_PairCount;
+	WorkerPool*							m_pWorkerPool;
+	// the runs of pairs sorted by each job, merged two at a time
+	mutable PoolVector<ProxyPair>		m_MergeBuffer;
+};
+
+#endif
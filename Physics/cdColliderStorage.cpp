@@ -0,0 +1,123 @@
+#include "cdColliderStorage.h"
+#include "cdSphere.h"
+#include "cdBody.h"
+
+namespace
+{
+	// move the last element of an array into index and drop the last
+	template <typename T>
+	void removeSwap(PoolVector<T>& list, int index)
+	{
+		list[index] = list.back();
+		list.pop_back();
+	}
+}
+
+ColliderStorage::ColliderStorage()
+{
+	m_ColliderCount = 0;
+}
+
+int ColliderStorage::addCollider(const Body* body)
+{
+	int collider;
+	if (!m_FreeColliders.empty())
+	{
+		collider = m_FreeColliders.back();
+		m_FreeColliders.pop_back();
+	}
+	else
+	{
+		collider = (int) m_ColliderList.size();
+		m_ColliderList.push_back(Collider());
+	}
+
+	Collider& added = m_ColliderList[collider];
+	added.m_Type = body->getType();
+	added.m_Index = -1;
+	if (added.m_Type == typeSPHERE)
+	{
+		added.m_Index = (int) m_Spheres.m_Collider.size();
+		m_Spheres.m_X.push_back(0.0f);
+		m_Spheres.m_Y.push_back(0.0f);
+		m_Spheres.m_Z.push_back(0.0f);
+		m_Spheres.m_Radius.push_back(0.0f);
+		m_Spheres.m_Collider.push_back(collider);
+	}
+	else if (added.m_Type == typeAABB)
+	{
+		added.m_Index = (int) m_Boxes.m_Collider.size();
+		m_Boxes.m_MinX.push_back(0.0f);
+		m_Boxes.m_MinY.push_back(0.0f);
+		m_Boxes.m_MinZ.push_back(0.0f);
+		m_Boxes.m_MaxX.push_back(0.0f);
+		m_Boxes.m_MaxY.push_back(0.0f);
+		m_Boxes.m_MaxZ.push_back(0.0f);
+		m_Boxes.m_Collider.push_back(collider);
+	}
+
+	setShape(collider, body);
+	m_ColliderCount++;
+	return collider;
+}
+
+void ColliderStorage::removeCollider(int collider)
+{
+	const Collider& removed = m_ColliderList[collider];
+	int index = removed.m_Index;
+	if (removed.m_Type == typeSPHERE)
+	{
+		m_ColliderList[m_Spheres.m_Collider.back()].m_Index = index;
+		removeSwap(m_Spheres.m_X, index);
+		removeSwap(m_Spheres.m_Y, index);
+		removeSwap(m_Spheres.m_Z, index);
+		removeSwap(m_Spheres.m_Radius, index);
+		removeSwap(m_Spheres.m_Collider, index);
+	}
+	else if (removed.m_Type == typeAABB)
+	{
+		m_ColliderList[m_Boxes.m_Collider.back()].m_Index = index;
+		removeSwap(m_Boxes.m_MinX, index);
+		removeSwap(m_Boxes.m_MinY, index);
+		removeSwap(m_Boxes.m_MinZ, index);
+		removeSwap(m_Boxes.m_MaxX, index);
+		removeSwap(m_Boxes.m_MaxY, index);
+		removeSwap(m_Boxes.m_MaxZ, index);
+		removeSwap(m_Boxes.m_Collider, index);
+	}
+
+	m_ColliderList[collider].m_Type = -1;
+	m_ColliderList[collider].m_Index = -1;
+	m_FreeColliders.push_back(collider);
+	m_ColliderCount--;
+}
+
+void ColliderStorage::updateCollider(int collider, const Body* body)
+{
+	setShape(collider, body);
+}
+
+void ColliderStorage::setShape(int collider, const Body* body)
+{
+	int index = m_ColliderList[collider].m_Index;
+	if (m_ColliderList[collider].m_Type == typeSPHERE)
+	{
+		const Sphere* sphere = (const Sphere*) body;
+		Vector3 center = sphere->getCenter();
+		m_Spheres.m_X[index] = center.GetX();
+		m_Spheres.m_Y[index] = center.GetY();
+		m_Spheres.m_Z[index] = center.GetZ();
+		m_Spheres.m_Radius[index] = sphere->getRadius();
+	}
+	else if (m_ColliderList[collider].m_Type == typeAABB)
+	{
+		Vector3 min, max;
+		body->getBounds(min, max);
+		m_Boxes.m_MinX[index] = min.GetX();
+		m_Boxes.m_MinY[index] = min.GetY();
+		m_Boxes.m_MinZ[index] = min.GetZ();
+		m_Boxes.m_MaxX[index] = max.GetX();
+		m_Boxes.m_MaxY[index] = max.GetY();
+		m_Boxes.m_MaxZ[index] = max.GetZ();
+	}
+}
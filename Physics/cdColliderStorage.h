@@ -0,0 +1,69 @@
+#ifndef CDCOLLIDERSTORAGE_H
+#define CDCOLLIDERSTORAGE_H
+
+#include "../Memory/PoolAllocator.h"
+
+class Body;
+
+// The shapes of bodies kept by type as structure of arrays, for the batched narrow phase
+// Spheres and AABBs are each packed into their own arrays, removing one moves the last into its place
+// Other bodies are only given a collider so every body has one, their shape is tested by Collide
+class ColliderStorage
+{
+public:
+	struct SphereArrays
+	{
+		PoolVector<float>		m_X;
+		PoolVector<float>		m_Y;
+		PoolVector<float>		m_Z;
+		PoolVector<float>		m_Radius;
+		// the collider of each sphere
+		PoolVector<int>			m_Collider;
+	};
+
+	// the min and max are ordered by component, whichever way the AABB was given
+	struct BoxArrays
+	{
+		PoolVector<float>		m_MinX;
+		PoolVector<float>		m_MinY;
+		PoolVector<float>		m_MinZ;
+		PoolVector<float>		m_MaxX;
+		PoolVector<float>		m_MaxY;
+		PoolVector<float>		m_MaxZ;
+		PoolVector<int>			m_Collider;
+	};
+
+	ColliderStorage();
+
+	// add the shape of a body and return its collider, colliders of removed bodies are reused
+	int addCollider(const Body* body);
+	void removeCollider(int collider);
+
+	// copy the shape of the body again after it moved, the body must be of the same type
+	void updateCollider(int collider, const Body* body);
+
+	// the body type and the index in the arrays of that type, -1 for other types
+	int getType(int collider) const { return m_ColliderList[collider].m_Type; }
+	int getIndex(int collider) const { return m_ColliderList[collider].m_Index; }
+	int getColliderCount() const { return m_ColliderCount; }
+
+	const SphereArrays& getSpheres() const { return m_Spheres; }
+	const BoxArrays& getBoxes() const { return m_Boxes; }
+
+private:
+	struct Collider
+	{
+		int					m_Type;
+		int					m_Index;
+	};
+
+	void setShape(int collider, const Body* body);
+
+	PoolVector<Collider>				m_ColliderList;
+	PoolVector<int>						m_FreeColliders;
+	int									m_ColliderCount;
+	SphereArrays						m_Spheres;
+	BoxArrays							m_Boxes;
+};
+
+#endif
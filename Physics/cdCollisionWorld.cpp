@@ -1,4 +1,34 @@
 #include "cdCollisionWorld.h"
+#include "cdSweepAndPrune.h"
+#include "cdAabbTree.h"
+#include "cdSpatialHash.h"
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// objects refit and pairs tested by one job, a multiple of the widest batch of BatchCollide
+	const int OBJECT_JOB_SIZE = 1024;
+	const int PAIR_JOB_SIZE = 2048;
+
+	float getMilliseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	void toObjects(const BroadPhase* broadPhase, const PoolVector<int>& proxies, PoolVector<CollidableObject*>& objects)
+	{
+		objects.resize(proxies.size());
+		for (size_t i = 0; i < proxies.size(); ++i)
+		{
+			objects[i] = (CollidableObject*) broadPhase->getUserData(proxies[i]);
+		}
+	}
+}
 
 /**
 void CollisionWorld::addObject(const CollidableObject & object)
@@ -31,6 +61,33 @@ void CollisionWorld::computeCollision()
 }
 */
 
+CollisionWorld::CollisionWorld(BroadPhaseType type, float cellSize)
+{
+	m_pInstance = NULL;
+	m_pWorkerPool = NULL;
+	m_Timings = CollisionTimings();
+	if (type == BROADPHASE_AABB_TREE)
+		m_pBroadPhase = new AabbTree();
+	else if (type == BROADPHASE_SPATIAL_HASH)
+		m_pBroadPhase = new SpatialHash(cellSize);
+	else
+		m_pBroadPhase = new SweepAndPrune();
+}
+
+CollisionWorld::~CollisionWorld()
+{
+	delete m_pBroadPhase;
+	delete m_pWorkerPool;
+}
+
+void CollisionWorld::setThreadCount(int threadCount)
+{
+	m_pBroadPhase->setWorkerPool(NULL);
+	delete m_pWorkerPool;
+	m_pWorkerPool = threadCount > 1 ? new WorkerPool(threadCount) : NULL;
+	m_pBroadPhase->setWorkerPool(m_pWorkerPool);
+}
+
 CollisionWorld * CollisionWorld::GetInstance()
 {
 	if (!m_pInstance)
@@ -40,7 +97,251 @@ CollisionWorld * CollisionWorld::GetInstance()
 	return m_pInstance;
 }
 
-std::vector<CollidableObject*>& CollisionWorld::getObjectList()
+PoolVector<CollidableObject*>& CollisionWorld::getObjectList()
 {
 	return m_ObjectList;
 }
+
+void CollisionWorld::addObject(CollidableObject* object)
+{
+	Vector3 min, max;
+	object->getBody()->getBounds(min, max);
+	object->setProxyID(m_pBroadPhase->addProxy(min, max, object));
+	object->setColliderID(m_Colliders.addCollider(object->getBody()));
+	m_ObjectList.push_back(object);
+}
+
+void CollisionWorld::addObjects(CollidableObject* const* objects, int count)
+{
+	PoolVector<Vector3> mins(count);
+	PoolVector<Vector3> maxs(count);
+	PoolVector<void*> userData(count);
+	PoolVector<int> proxies(count);
+	for (int i = 0; i < count; ++i)
+	{
+		objects[i]->getBody()->getBounds(mins[i], maxs[i]);
+		userData[i] = objects[i];
+	}
+
+	m_pBroadPhase->addProxies(mins.data(), maxs.data(), userData.data(), count, proxies.data());
+	for (int i = 0; i < count; ++i)
+	{
+		objects[i]->setProxyID(proxies[i]);
+		objects[i]->setColliderID(m_Colliders.addCollider(objects[i]->getBody()));
+		m_ObjectList.push_back(objects[i]);
+	}
+}
+
+void CollisionWorld::removeObject(CollidableObject* object)
+{
+	m_pBroadPhase->removeProxy(object->getProxyID());
+	object->setProxyID(-1);
+	m_Colliders.removeCollider(object->getColliderID());
+	object->setColliderID(-1);
+	m_ObjectList.erase(std::find(m_ObjectList.begin(), m_ObjectList.end(), object));
+}
+
+void CollisionWorld::updatePairs()
+{
+	refit();
+	m_pBroadPhase->updatePairs();
+}
+
+// the bodies are read and the colliders written in jobs, the broad phase is moved in order
+void CollisionWorld::refit()
+{
+	m_BoundsMin.resize(m_ObjectList.size());
+	m_BoundsMax.resize(m_ObjectList.size());
+	runJobs(refitJob, this, WorkerPool::getJobCount((int) m_ObjectList.size(), OBJECT_JOB_SIZE));
+
+	for (size_t i = 0; i < m_ObjectList.size(); ++i)
+	{
+		m_pBroadPhase->moveProxy(m_ObjectList[i]->getProxyID(), m_BoundsMin[i], m_BoundsMax[i]);
+	}
+}
+
+void CollisionWorld::refitJob(void* pData, int job)
+{
+	CollisionWorld& world = *(CollisionWorld*) pData;
+	size_t first = (size_t) job * OBJECT_JOB_SIZE;
+	size_t last = std::min(first + OBJECT_JOB_SIZE, world.m_ObjectList.size());
+	for (size_t i = first; i < last; ++i)
+	{
+		const CollidableObject* object = world.m_ObjectList[i];
+		object->getBody()->getBounds(world.m_BoundsMin[i], world.m_BoundsMax[i]);
+		world.m_Colliders.updateCollider(object->getColliderID(), object->getBody());
+	}
+}
+
+void CollisionWorld::runJobs(WorkerPool::Job job, void* pData, int jobCount)
+{
+	if (m_pWorkerPool)
+	{
+		m_pWorkerPool->run(job, pData, jobCount);
+		return;
+	}
+
+	for (int i = 0; i < jobCount; ++i)
+	{
+		job(pData, i);
+	}
+}
+
+void CollisionWorld::queryAABB(const Vector3& min, const Vector3& max, PoolVector<CollidableObject*>& objects) const
+{
+	PoolVector<int> proxies;
+	m_pBroadPhase->queryAABB(min, max, proxies);
+	toObjects(m_pBroadPhase, proxies, objects);
+}
+
+void CollisionWorld::querySphere(const Vector3& center, float radius, PoolVector<CollidableObject*>& objects) const
+{
+	PoolVector<int> proxies;
+	m_pBroadPhase->querySphere(center, radius, proxies);
+	toObjects(m_pBroadPhase, proxies, objects);
+}
+
+// the broad phase measures the ray in lengths of dir
+void CollisionWorld::raycast(const Vector3& start, const Vector3& dir, float maxDistance, PoolVector<CollidableObject*>& objects) const
+{
+	// a ray without a direction hits nothing
+	float length = sqrtf(dir.Dot(dir));
+	if (length <= FLT_EPSILON)
+	{
+		objects.clear();
+		return;
+	}
+
+	PoolVector<int> proxies;
+	Vector3 unitDir = dir;
+	unitDir.Multiply(1.0f / length);
+	m_pBroadPhase->queryRay(start, unitDir, maxDistance, proxies);
+	toObjects(m_pBroadPhase, proxies, objects);
+}
+
+void CollisionWorld::computeCollision()
+{
+	Clock::time_point start = Clock::now();
+	refit();
+	Clock::time_point refitEnd = Clock::now();
+	m_pBroadPhase->updatePairs();
+	Clock::time_point broadPhaseEnd = Clock::now();
+	m_pBroadPhase->getPairs(m_PairList);
+	Clock::time_point pairListEnd = Clock::now();
+
+	// the groups of BatchCollide and the other pairs are split into jobs of whole batches
+	m_ColliderPairs.resize(m_PairList.size());
+	runJobs(colliderPairsJob, this, WorkerPool::getJobCount((int) m_PairList.size(), PAIR_JOB_SIZE));
+	m_BatchCollide.groupPairs(m_Colliders, m_ColliderPairs.data(), (int) m_ColliderPairs.size());
+
+	m_PairJobs.clear();
+	for (int group = 0; group <= BatchCollide::GROUP_COUNT; ++group)
+	{
+		int count = group < BatchCollide::GROUP_COUNT ?
+			m_BatchCollide.getGroupSize((BatchCollide::Group) group) : (int) m_BatchCollide.getOtherPairs().size();
+		for (int first = 0; first < count; first += PAIR_JOB_SIZE)
+		{
+			PairJob job;
+			job.m_Group = group;
+			job.m_First = first;
+			job.m_Count = std::min(count - first, PAIR_JOB_SIZE);
+			m_PairJobs.push_back(job);
+		}
+	}
+	int jobCount = (int) m_PairJobs.size();
+	if ((int) m_JobContacts.size() < jobCount)
+	{
+		m_JobContacts.resize(jobCount);
+		m_JobCollisions.resize(jobCount);
+	}
+	runJobs(narrowPhaseJob, this, jobCount);
+	Clock::time_point narrowPhaseEnd = Clock::now();
+
+	// the pairs with a contact, then the other pairs that Collide finds colliding, each in job order
+	int contactCount = 0;
+	for (int job = 0; job < jobCount; ++job)
+	{
+		m_PairJobs[job].m_ContactOffset = contactCount;
+		contactCount += (int) m_JobContacts[job].size();
+	}
+	int collideCount = contactCount;
+	for (int job = 0; job < jobCount; ++job)
+	{
+		m_PairJobs[job].m_CollideOffset = collideCount;
+		collideCount += (int) m_JobCollisions[job].size();
+	}
+	m_ContactList.resize(contactCount);
+	m_CollideList.resize(collideCount);
+	runJobs(mergeJob, this, jobCount);
+	Clock::time_point end = Clock::now();
+
+	m_Timings.m_Refit = getMilliseconds(start, refitEnd);
+	m_Timings.m_BroadPhase = getMilliseconds(refitEnd, broadPhaseEnd);
+	m_Timings.m_PairList = getMilliseconds(broadPhaseEnd, pairListEnd);
+	m_Timings.m_NarrowPhase = getMilliseconds(pairListEnd, narrowPhaseEnd);
+	m_Timings.m_Merge = getMilliseconds(narrowPhaseEnd, end);
+	m_Timings.m_Total = getMilliseconds(start, end);
+}
+
+void CollisionWorld::colliderPairsJob(void* pData, int job)
+{
+	CollisionWorld& world = *(CollisionWorld*) pData;
+	size_t first = (size_t) job * PAIR_JOB_SIZE;
+	size_t last = std::min(first + PAIR_JOB_SIZE, world.m_PairList.size());
+	for (size_t i = first; i < last; ++i)
+	{
+		world.m_ColliderPairs[i].m_ColliderA = world.getObject(world.m_PairList[i].m_ProxyA)->getColliderID();
+		world.m_ColliderPairs[i].m_ColliderB = world.getObject(world.m_PairList[i].m_ProxyB)->getColliderID();
+	}
+}
+
+void CollisionWorld::narrowPhaseJob(void* pData, int job)
+{
+	CollisionWorld& world = *(CollisionWorld*) pData;
+	const PairJob& pairJob = world.m_PairJobs[job];
+	PoolVector<Contact>& contacts = world.m_JobContacts[job];
+	PoolVector<CollisionPair>& collisions = world.m_JobCollisions[job];
+	contacts.clear();
+	collisions.clear();
+	if (pairJob.m_Group < BatchCollide::GROUP_COUNT)
+	{
+		world.m_BatchCollide.collide(world.m_Colliders, (BatchCollide::Group) pairJob.m_Group, pairJob.m_First, pairJob.m_Count, contacts);
+		return;
+	}
+
+	Collide collide;
+	const PoolVector<int>& otherPairs = world.m_BatchCollide.getOtherPairs();
+	for (int i = pairJob.m_First; i < pairJob.m_First + pairJob.m_Count; ++i)
+	{
+		const ProxyPair& proxies = world.m_PairList[otherPairs[i]];
+		CollisionPair pair;
+		pair.m_pObject1 = world.getObject(proxies.m_ProxyA);
+		pair.m_pObject2 = world.getObject(proxies.m_ProxyB);
+		collide.collision(pair.m_pObject1->getBody(), pair.m_pObject2->getBody());
+		// collide.getCollide() returns a boolean value, true means collide, false means not collide
+		if (collide.getCollide())
+		{
+			pair.m_Distance = collide.getDistance();
+			collisions.push_back(pair);
+		}
+	}
+}
+
+void CollisionWorld::mergeJob(void* pData, int job)
+{
+	CollisionWorld& world = *(CollisionWorld*) pData;
+	const PairJob& pairJob = world.m_PairJobs[job];
+	const PoolVector<Contact>& contacts = world.m_JobContacts[job];
+	for (size_t i = 0; i < contacts.size(); ++i)
+	{
+		const ProxyPair& proxies = world.m_PairList[contacts[i].m_Pair];
+		CollisionPair& pair = world.m_CollideList[pairJob.m_ContactOffset + i];
+		pair.m_pObject1 = world.getObject(proxies.m_ProxyA);
+		pair.m_pObject2 = world.getObject(proxies.m_ProxyB);
+		pair.m_Distance = -contacts[i].m_Depth;
+		world.m_ContactList[pairJob.m_ContactOffset + i] = contacts[i];
+	}
+
+	const PoolVector<CollisionPair>& collisions = world.m_JobCollisions[job];
+	std::copy(collisions.begin(), collisions.end(), world.m_CollideList.begin() + pairJob.m_CollideOffset);
+}
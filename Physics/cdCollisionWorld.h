@@ -1,27 +1,140 @@
 #ifndef CDCOLLISIONWORLD_H
 #define CDCOLLISIONWORLD_H
-#include <vector>
+#include "../Memory/PoolAllocator.h"
 #include "cdObject.h"
 #include "cdCollide.h"
+#include "cdBroadPhase.h"
+#include "cdBatchCollide.h"
+#include "cdWorkerPool.h"
 class CollidableObject;
 
 #pragma once
 
+// how a CollisionWorld finds the pairs to test, pick per scene
+enum BroadPhaseType
+{
+	// few moving boxes among many resting ones, pairs change only when ends pass
+	BROADPHASE_SWEEP_AND_PRUNE,
+	// boxes of mixed sizes, and raycasts and area queries of log n cost
+	BROADPHASE_AABB_TREE,
+	// many moving boxes of about the same size, the grid is rebuilt each update
+	BROADPHASE_SPATIAL_HASH
+};
+
+// two objects found colliding by computeCollision
+struct CollisionPair
+{
+	CollidableObject*	m_pObject1;
+	CollidableObject*	m_pObject2;
+	// overlap distance from Collide, minus the depth of a contact from BatchCollide
+	float				m_Distance;
+};
+
+// milliseconds each phase of the last computeCollision took
+struct CollisionTimings
+{
+	// the bounds and shapes of every body copied to the broad phase and the colliders
+	float				m_Refit;
+	// the broad phase finding the pairs that began or stopped overlapping
+	float				m_BroadPhase;
+	// listing and sorting every overlapping pair
+	float				m_PairList;
+	// grouping the pairs and testing their bodies
+	float				m_NarrowPhase;
+	// the contacts and collisions of every job gathered into the lists
+	float				m_Merge;
+	float				m_Total;
+};
+
 class CollisionWorld
 {
 public:
 	
 
-	CollisionWorld() {}
+	// cellSize is the grid of a spatial hash, about the size of the largest common body
+	CollisionWorld(BroadPhaseType type = BROADPHASE_SWEEP_AND_PRUNE, float cellSize = 1.0f);
+	~CollisionWorld();
 
 	CollisionWorld* GetInstance();
 
-	std::vector<CollidableObject*>& getObjectList();
+	PoolVector<CollidableObject*>& getObjectList();
+
+	// add objects to the world and its broad phase, addObjects sorts them in all at once
+	void addObject(CollidableObject* object);
+	void addObjects(CollidableObject* const* objects, int count);
+	void removeObject(CollidableObject* object);
+
+	// refit the broad phase to the bodies of every object, then the added and removed lists
+	// hold the pairs whose boxes began or stopped overlapping since the last update
+	void updatePairs();
+	const PoolVector<ProxyPair>& getAddedPairs() const { return m_pBroadPhase->getAddedPairs(); }
+	const PoolVector<ProxyPair>& getRemovedPairs() const { return m_pBroadPhase->getRemovedPairs(); }
+	CollidableObject* getObject(int proxy) const { return (CollidableObject*) m_pBroadPhase->getUserData(proxy); }
+	BroadPhase* getBroadPhase() const { return m_pBroadPhase; }
+
+	// objects whose bounds a box, a sphere or a ray touch as of the last update, the ray's nearest first
+	// the bodies are not tested, Collide does that
+	void queryAABB(const Vector3& min, const Vector3& max, PoolVector<CollidableObject*>& objects) const;
+	void querySphere(const Vector3& center, float radius, PoolVector<CollidableObject*>& objects) const;
+	void raycast(const Vector3& start, const Vector3& dir, float maxDistance, PoolVector<CollidableObject*>& objects) const;
+
+	// update the pairs and test the bodies of every overlapping pair, keeping those that collide
+	// spheres and AABBs are tested in batches by BatchCollide, other bodies one pair at a time by Collide
+	void computeCollision();
+	const PoolVector<CollisionPair>& getCollideList() const { return m_CollideList; }
+	// the contacts of the sphere and AABB pairs, m_Pair indexes the overlapping pairs of the broad phase
+	const PoolVector<Contact>& getContactList() const { return m_ContactList; }
+	const ColliderStorage& getColliders() const { return m_Colliders; }
+	const CollisionTimings& getTimings() const { return m_Timings; }
+
+	// threads to run computeCollision and updatePairs on, counting the calling thread
+	// the work is split into jobs of a fixed size whatever the count, each with its own lists that are
+	// gathered in job order, so every list is the same bit for bit for any number of threads
+	void setThreadCount(int threadCount);
+	int getThreadCount() const { return m_pWorkerPool ? m_pWorkerPool->getThreadCount() : 1; }
+
+	int getObjectSize() const { return (int) m_ObjectList.size(); }
+	int getCollideSize() const { return (int) m_CollideList.size(); }
 	
 
 private:
+	// a range of the pairs of one group of BatchCollide, or of its other pairs for GROUP_COUNT,
+	// and where its contacts and collisions go in the lists
+	struct PairJob
+	{
+		int					m_Group;
+		int					m_First;
+		int					m_Count;
+		int					m_ContactOffset;
+		int					m_CollideOffset;
+	};
+
+	void refit();
+	void runJobs(WorkerPool::Job job, void* pData, int jobCount);
+	static void refitJob(void* pData, int job);
+	static void colliderPairsJob(void* pData, int job);
+	static void narrowPhaseJob(void* pData, int job);
+	static void mergeJob(void* pData, int job);
+
 	CollisionWorld*						m_pInstance;
-	std::vector<CollidableObject*>		m_ObjectList;
+	PoolVector<CollidableObject*>		m_ObjectList;
+	BroadPhase*							m_pBroadPhase;
+	PoolVector<ProxyPair>				m_PairList;
+	PoolVector<CollisionPair>			m_CollideList;
+	ColliderStorage						m_Colliders;
+	BatchCollide						m_BatchCollide;
+	PoolVector<ColliderPair>			m_ColliderPairs;
+	PoolVector<Contact>					m_ContactList;
+
+	WorkerPool*							m_pWorkerPool;
+	CollisionTimings					m_Timings;
+	// the bounds of every object, in the order of the object list
+	PoolVector<Vector3>					m_BoundsMin;
+	PoolVector<Vector3>					m_BoundsMax;
+	PoolVector<PairJob>					m_PairJobs;
+	// what each pair job found, the contacts of a BatchCollide job or the collisions of another
+	PoolVector<PoolVector<Contact> >	m_JobContacts;
+	PoolVector<PoolVector<CollisionPair> >	m_JobCollisions;
 	
 };
 
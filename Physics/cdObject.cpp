@@ -6,6 +6,8 @@ CollidableObject::CollidableObject(Body * body, const Vector3& translate, const
 	m_pBody = body;
 	m_ObjectID = objectID;
 	m_Translate = translate;
+	m_ProxyID = -1;
+	m_ColliderID = -1;
 	//CollisionWorld::GetInstance()->getObjectList().push_back(this);
 }
 
@@ -3,8 +3,8 @@
 #define CDOBJECT_H
 
 #include "cdBody.h"
-#include "..\Math\simdmath.h"
-#include "..\Physics\cdCollisionWorld.h"
+#include "../Math/simdmath.h"
+#include "cdCollisionWorld.h"
 
 typedef SIMDVector3 Vector3;
 typedef SIMDMatrix4 Matrix4;
@@ -12,7 +12,7 @@ typedef SIMDMatrix4 Matrix4;
 class CollidableObject
 {
 public:
-	CollidableObject(){}
+	CollidableObject() { m_ProxyID = -1; m_ColliderID = -1; }
 
 	CollidableObject(Body* body, const Vector3& translate, const int objectID);
 
@@ -20,6 +20,12 @@ public:
 	Body* getBody() const;
 	void translate(Vector3& translate);
 	Vector3 getPosition() const { return m_pBody->getCenter(); }
+	// the object's proxy in the broad phase of its CollisionWorld, -1 when in none
+	int getProxyID() const { return m_ProxyID; }
+	void setProxyID(const int proxyID) { m_ProxyID = proxyID; }
+	// the object's shape in the collider storage of its CollisionWorld, -1 when in none
+	int getColliderID() const { return m_ColliderID; }
+	void setColliderID(const int colliderID) { m_ColliderID = colliderID; }
 
 	void update();
 
@@ -27,6 +33,8 @@ private:
 	Body*			m_pBody;
 	Vector3			m_Translate;
 	int				m_ObjectID;
+	int				m_ProxyID;
+	int				m_ColliderID;
 
 	// int EntityIO;
 };
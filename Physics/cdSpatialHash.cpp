@@ -0,0 +1,534 @@
+#include "cdSpatialHash.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+	// cells are clamped to this on each axis so far or infinite boxes stay in int range
+	const int CELL_LIMIT = 1 << 20;
+
+	// a box over more cells than this is tested against every box instead
+	const int64_t MAX_PROXY_CELLS = 64;
+
+	// buckets searched for pairs by one job
+	const int BUCKET_JOB_SIZE = 4096;
+
+	// m_State of a proxy
+	enum
+	{
+		PROXY_GRID,			// in the grid, or added since the last rebuild
+		PROXY_LARGE,		// too large for the grid at the last rebuild
+		PROXY_REMOVED,		// freed by the next updatePairs
+		PROXY_FREE
+	};
+
+	void getAxes(const Vector3& v, float axes[3])
+	{
+		axes[0] = v.GetX();
+		axes[1] = v.GetY();
+		axes[2] = v.GetZ();
+	}
+
+	bool isLive(int state)
+	{
+		return state == PROXY_GRID || state == PROXY_LARGE;
+	}
+
+	bool overlap(const float min0[3], const float max0[3], const float min1[3], const float max1[3])
+	{
+		return min0[0] <= max1[0] && min1[0] <= max0[0] &&
+			min0[1] <= max1[1] && min1[1] <= max0[1] &&
+			min0[2] <= max1[2] && min1[2] <= max0[2];
+	}
+
+	bool sameCell(const int cell0[3], const int cell1[3])
+	{
+		return cell0[0] == cell1[0] && cell0[1] == cell1[1] && cell0[2] == cell1[2];
+	}
+
+	// the cell of the min corner of the overlap of two ranges of cells, floor keeps the order of
+	// coordinates so it is the max of the two mins
+	bool isFirstCell(const int cell[3], const int cellMin0[3], const int cellMin1[3])
+	{
+		return cell[0] == std::max(cellMin0[0], cellMin1[0]) &&
+			cell[1] == std::max(cellMin0[1], cellMin1[1]) &&
+			cell[2] == std::max(cellMin0[2], cellMin1[2]);
+	}
+
+	int64_t getCellCount(const int cellMin[3], const int cellMax[3])
+	{
+		int64_t count = 1;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (cellMax[axis] < cellMin[axis])
+				return 0;
+			count *= (int64_t) (cellMax[axis] - cellMin[axis]) + 1;
+		}
+		return count;
+	}
+
+	// clip [tMin, tMax] to where the ray is inside the box
+	bool clipRay(const float start[3], const float invDir[3], const float min[3], const float max[3], float& tMin, float& tMax)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (fabsf(invDir[axis]) > FLT_MAX)
+			{
+				if (start[axis] < min[axis] || start[axis] > max[axis])
+					return false;
+				continue;
+			}
+
+			float t1 = (min[axis] - start[axis]) * invDir[axis];
+			float t2 = (max[axis] - start[axis]) * invDir[axis];
+			if (t1 > t2)
+				std::swap(t1, t2);
+			tMin = std::max(tMin, t1);
+			tMax = std::min(tMax, t2);
+			if (tMin > tMax)
+				return false;
+		}
+		return true;
+	}
+}
+
+SpatialHash::SpatialHash(float cellSize)
+{
+	m_ProxyCount = 0;
+	m_Dirty = false;
+	setCellSize(cellSize);
+
+	// an empty grid of one bucket
+	m_BucketStart.assign(2, 0);
+	m_BucketMask = 0;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_GridMin[axis] = CELL_LIMIT;
+		m_GridMax[axis] = -CELL_LIMIT;
+	}
+}
+
+void SpatialHash::setCellSize(float cellSize)
+{
+	m_CellSize = cellSize;
+	m_InvCellSize = 1.0f / cellSize;
+	m_Dirty = true;
+}
+
+int SpatialHash::addProxy(const Vector3& min, const Vector3& max, void* pUserData)
+{
+	int proxy;
+	if (!m_FreeProxies.empty())
+	{
+		proxy = m_FreeProxies.back();
+		m_FreeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (int) m_ProxyList.size();
+		m_ProxyList.push_back(Proxy());
+	}
+
+	Proxy& added = m_ProxyList[proxy];
+	getAxes(min, added.m_Min);
+	getAxes(max, added.m_Max);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		added.m_CellMin[axis] = 0;
+		added.m_CellMax[axis] = -1;
+	}
+	added.m_pUserData = pUserData;
+	added.m_State = PROXY_GRID;
+	m_ProxyCount++;
+	m_Dirty = true;
+	return proxy;
+}
+
+void SpatialHash::removeProxy(int proxy)
+{
+	m_ProxyList[proxy].m_State = PROXY_REMOVED;
+	m_RemovedProxies.push_back(proxy);
+	m_ProxyCount--;
+	m_Dirty = true;
+}
+
+void SpatialHash::moveProxy(int proxy, const Vector3& min, const Vector3& max)
+{
+	getAxes(min, m_ProxyList[proxy].m_Min);
+	getAxes(max, m_ProxyList[proxy].m_Max);
+	m_Dirty = true;
+}
+
+void SpatialHash::getAABB(int proxy, Vector3& min, Vector3& max) const
+{
+	const Proxy& box = m_ProxyList[proxy];
+	min.Set(box.m_Min[0], box.m_Min[1], box.m_Min[2]);
+	max.Set(box.m_Max[0], box.m_Max[1], box.m_Max[2]);
+}
+
+void SpatialHash::getCell(const float v[3], int cell[3]) const
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float c = floorf(v[axis] * m_InvCellSize);
+		if (!(c >= (float) -CELL_LIMIT))
+			c = (float) -CELL_LIMIT;
+		else if (c > (float) CELL_LIMIT)
+			c = (float) CELL_LIMIT;
+		cell[axis] = (int) c;
+	}
+}
+
+uint32_t SpatialHash::getBucket(const int cell[3]) const
+{
+	return ((uint32_t) cell[0] * 73856093u ^ (uint32_t) cell[1] * 19349663u ^ (uint32_t) cell[2] * 83492791u) & m_BucketMask;
+}
+
+void SpatialHash::rebuild()
+{
+	m_LargeProxies.clear();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		m_GridMin[axis] = CELL_LIMIT;
+		m_GridMax[axis] = -CELL_LIMIT;
+	}
+
+	size_t entryCount = 0;
+	for (size_t i = 0; i < m_ProxyList.size(); ++i)
+	{
+		Proxy& proxy = m_ProxyList[i];
+		if (!isLive(proxy.m_State))
+			continue;
+
+		getCell(proxy.m_Min, proxy.m_CellMin);
+		getCell(proxy.m_Max, proxy.m_CellMax);
+		int64_t cells = getCellCount(proxy.m_CellMin, proxy.m_CellMax);
+		if (cells > MAX_PROXY_CELLS)
+		{
+			proxy.m_State = PROXY_LARGE;
+			m_LargeProxies.push_back((int) i);
+			continue;
+		}
+
+		proxy.m_State = PROXY_GRID;
+		entryCount += (size_t) cells;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_GridMin[axis] = std::min(m_GridMin[axis], proxy.m_CellMin[axis]);
+			m_GridMax[axis] = std::max(m_GridMax[axis], proxy.m_CellMax[axis]);
+		}
+	}
+
+	// at most half the buckets in use
+	uint32_t bucketCount = 16;
+	while (bucketCount < entryCount * 2)
+	{
+		bucketCount <<= 1;
+	}
+	m_BucketMask = bucketCount - 1;
+
+	// count the entries of each bucket, then sum so each count becomes the end of its bucket
+	m_BucketStart.assign(bucketCount + 1, 0);
+	int cell[3];
+	for (size_t i = 0; i < m_ProxyList.size(); ++i)
+	{
+		const Proxy& proxy = m_ProxyList[i];
+		if (proxy.m_State != PROXY_GRID)
+			continue;
+
+		for (cell[2] = proxy.m_CellMin[2]; cell[2] <= proxy.m_CellMax[2]; ++cell[2])
+			for (cell[1] = proxy.m_CellMin[1]; cell[1] <= proxy.m_CellMax[1]; ++cell[1])
+				for (cell[0] = proxy.m_CellMin[0]; cell[0] <= proxy.m_CellMax[0]; ++cell[0])
+					m_BucketStart[getBucket(cell)]++;
+	}
+	for (uint32_t i = 1; i < bucketCount; ++i)
+	{
+		m_BucketStart[i] += m_BucketStart[i - 1];
+	}
+	m_BucketStart[bucketCount] = (uint32_t) entryCount;
+
+	// fill each bucket from its end, in reverse so a bucket lists its proxies in increasing order
+	m_CellEntries.resize(entryCount);
+	for (size_t i = m_ProxyList.size(); i-- > 0;)
+	{
+		const Proxy& proxy = m_ProxyList[i];
+		if (proxy.m_State != PROXY_GRID)
+			continue;
+
+		CellEntry entry;
+		entry.m_Proxy = (int) i;
+		for (cell[2] = proxy.m_CellMax[2]; cell[2] >= proxy.m_CellMin[2]; --cell[2])
+			for (cell[1] = proxy.m_CellMax[1]; cell[1] >= proxy.m_CellMin[1]; --cell[1])
+				for (cell[0] = proxy.m_CellMax[0]; cell[0] >= proxy.m_CellMin[0]; --cell[0])
+				{
+					entry.m_Cell[0] = cell[0];
+					entry.m_Cell[1] = cell[1];
+					entry.m_Cell[2] = cell[2];
+					m_CellEntries[--m_BucketStart[getBucket(cell)]] = entry;
+				}
+	}
+}
+
+// the buckets are searched in jobs that each list their pairs, then the pairs are added in job order
+void SpatialHash::findPairs()
+{
+	int jobCount = WorkerPool::getJobCount((int) m_BucketMask + 1, BUCKET_JOB_SIZE);
+	if ((int) m_JobPairs.size() < jobCount)
+		m_JobPairs.resize(jobCount);
+	runJobs(findPairsJob, this, jobCount);
+
+	for (int job = 0; job < jobCount; ++job)
+	{
+		const PoolVector<ProxyPair>& pairs = m_JobPairs[job];
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			addPair(pairs[i].m_ProxyA, pairs[i].m_ProxyB);
+		}
+	}
+
+	// large boxes against every box, two large boxes once
+	for (size_t i = 0; i < m_LargeProxies.size(); ++i)
+	{
+		int large = m_LargeProxies[i];
+		const Proxy& proxy0 = m_ProxyList[large];
+		for (size_t j = 0; j < m_ProxyList.size(); ++j)
+		{
+			const Proxy& proxy1 = m_ProxyList[j];
+			if (proxy1.m_State == PROXY_GRID || (proxy1.m_State == PROXY_LARGE && (int) j > large))
+			{
+				if (overlap(proxy0.m_Min, proxy0.m_Max, proxy1.m_Min, proxy1.m_Max))
+					addPair(large, (int) j);
+			}
+		}
+	}
+}
+
+void SpatialHash::findPairsJob(void* pData, int job)
+{
+	SpatialHash& hash = *(SpatialHash*) pData;
+	PoolVector<ProxyPair>& pairs = hash.m_JobPairs[job];
+	pairs.clear();
+
+	uint32_t first = (uint32_t) job * BUCKET_JOB_SIZE;
+	uint32_t last = std::min(first + BUCKET_JOB_SIZE, hash.m_BucketMask + 1);
+	for (uint32_t bucket = first; bucket < last; ++bucket)
+	{
+		uint32_t end = hash.m_BucketStart[bucket + 1];
+		for (uint32_t i = hash.m_BucketStart[bucket]; i < end; ++i)
+		{
+			const CellEntry& entry0 = hash.m_CellEntries[i];
+			const Proxy& proxy0 = hash.m_ProxyList[entry0.m_Proxy];
+			for (uint32_t j = i + 1; j < end; ++j)
+			{
+				// other cells of the bucket, then pairs that share an earlier cell
+				const CellEntry& entry1 = hash.m_CellEntries[j];
+				if (!sameCell(entry0.m_Cell, entry1.m_Cell))
+					continue;
+
+				const Proxy& proxy1 = hash.m_ProxyList[entry1.m_Proxy];
+				if (isFirstCell(entry0.m_Cell, proxy0.m_CellMin, proxy1.m_CellMin) &&
+					overlap(proxy0.m_Min, proxy0.m_Max, proxy1.m_Min, proxy1.m_Max))
+				{
+					ProxyPair pair;
+					pair.m_ProxyA = entry0.m_Proxy;
+					pair.m_ProxyB = entry1.m_Proxy;
+					pairs.push_back(pair);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::updatePairs()
+{
+	if (m_Dirty)
+	{
+		// pairs that came apart or lost a proxy, the rebuild finds every pair that still overlaps
+		listPairs(m_PairBuffer);
+		for (size_t i = 0; i < m_PairBuffer.size(); ++i)
+		{
+			const Proxy& proxy0 = m_ProxyList[m_PairBuffer[i].m_ProxyA];
+			const Proxy& proxy1 = m_ProxyList[m_PairBuffer[i].m_ProxyB];
+			if (!isLive(proxy0.m_State) || !isLive(proxy1.m_State) ||
+				!overlap(proxy0.m_Min, proxy0.m_Max, proxy1.m_Min, proxy1.m_Max))
+				removePair(m_PairBuffer[i].m_ProxyA, m_PairBuffer[i].m_ProxyB);
+		}
+
+		rebuild();
+		findPairs();
+		m_Dirty = false;
+	}
+
+	BroadPhase::updatePairs();
+
+	for (size_t i = 0; i < m_RemovedProxies.size(); ++i)
+	{
+		m_ProxyList[m_RemovedProxies[i]].m_State = PROXY_FREE;
+	}
+	m_FreeProxies.insert(m_FreeProxies.end(), m_RemovedProxies.begin(), m_RemovedProxies.end());
+	m_RemovedProxies.clear();
+}
+
+void SpatialHash::queryAll(const float min[3], const float max[3], PoolVector<int>& proxies) const
+{
+	for (size_t i = 0; i < m_ProxyList.size(); ++i)
+	{
+		const Proxy& proxy = m_ProxyList[i];
+		if (isLive(proxy.m_State) && overlap(min, max, proxy.m_Min, proxy.m_Max))
+			proxies.push_back((int) i);
+	}
+}
+
+void SpatialHash::queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const
+{
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+	proxies.clear();
+
+	int queryMin[3], queryMax[3], lower[3], upper[3];
+	getCell(minAxes, queryMin);
+	getCell(maxAxes, queryMax);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		lower[axis] = std::max(queryMin[axis], m_GridMin[axis]);
+		upper[axis] = std::min(queryMax[axis], m_GridMax[axis]);
+	}
+
+	// a query over more cells than there are entries is cheaper as a test of every box
+	if (m_Dirty || getCellCount(lower, upper) > (int64_t) m_CellEntries.size())
+	{
+		queryAll(minAxes, maxAxes, proxies);
+		return;
+	}
+
+	// a box in several cells of the query is found in the first
+	int cell[3];
+	for (cell[2] = lower[2]; cell[2] <= upper[2]; ++cell[2])
+		for (cell[1] = lower[1]; cell[1] <= upper[1]; ++cell[1])
+			for (cell[0] = lower[0]; cell[0] <= upper[0]; ++cell[0])
+			{
+				uint32_t bucket = getBucket(cell);
+				for (uint32_t i = m_BucketStart[bucket]; i < m_BucketStart[bucket + 1]; ++i)
+				{
+					const CellEntry& entry = m_CellEntries[i];
+					const Proxy& proxy = m_ProxyList[entry.m_Proxy];
+					if (sameCell(cell, entry.m_Cell) && isFirstCell(cell, queryMin, proxy.m_CellMin) &&
+						overlap(minAxes, maxAxes, proxy.m_Min, proxy.m_Max))
+						proxies.push_back(entry.m_Proxy);
+				}
+			}
+
+	for (size_t i = 0; i < m_LargeProxies.size(); ++i)
+	{
+		const Proxy& proxy = m_ProxyList[m_LargeProxies[i]];
+		if (overlap(minAxes, maxAxes, proxy.m_Min, proxy.m_Max))
+			proxies.push_back(m_LargeProxies[i]);
+	}
+}
+
+// step from cell to cell along the ray through the grid, crossing the nearest cell boundary each step
+void SpatialHash::queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const
+{
+	if (m_Dirty || m_CellEntries.empty())
+	{
+		BroadPhase::queryRay(start, dir, maxFraction, proxies);
+		return;
+	}
+
+	float s[3], d[3], invDir[3], gridMin[3], gridMax[3];
+	getAxes(start, s);
+	getAxes(dir, d);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		invDir[axis] = 1.0f / d[axis];
+		gridMin[axis] = m_GridMin[axis] * m_CellSize;
+		gridMax[axis] = (m_GridMax[axis] + 1) * m_CellSize;
+	}
+
+	proxies.clear();
+	float tEnter = 0.0f;
+	float tExit = maxFraction;
+	if (clipRay(s, invDir, gridMin, gridMax, tEnter, tExit))
+	{
+		int cell[3], endCell[3], step[3];
+		float enter[3], exit[3], tNext[3], tDelta[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			enter[axis] = s[axis] + d[axis] * tEnter;
+			exit[axis] = s[axis] + d[axis] * tExit;
+		}
+		getCell(enter, cell);
+		getCell(exit, endCell);
+
+		int64_t steps = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cell[axis] = std::min(std::max(cell[axis], m_GridMin[axis]), m_GridMax[axis]);
+			endCell[axis] = std::min(std::max(endCell[axis], m_GridMin[axis]), m_GridMax[axis]);
+			steps += abs(endCell[axis] - cell[axis]);
+
+			if (d[axis] > 0.0f)
+			{
+				step[axis] = 1;
+				tNext[axis] = ((cell[axis] + 1) * m_CellSize - s[axis]) * invDir[axis];
+				tDelta[axis] = m_CellSize * invDir[axis];
+			}
+			else if (d[axis] < 0.0f)
+			{
+				step[axis] = -1;
+				tNext[axis] = (cell[axis] * m_CellSize - s[axis]) * invDir[axis];
+				tDelta[axis] = -m_CellSize * invDir[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				tNext[axis] = FLT_MAX;
+				tDelta[axis] = 0.0f;
+			}
+		}
+
+		// a walk over more cells than there are entries is cheaper as a query of the ray's box
+		if (steps > (int64_t) m_CellEntries.size())
+		{
+			BroadPhase::queryRay(start, dir, maxFraction, proxies);
+			return;
+		}
+
+		for (;;)
+		{
+			uint32_t bucket = getBucket(cell);
+			for (uint32_t i = m_BucketStart[bucket]; i < m_BucketStart[bucket + 1]; ++i)
+			{
+				if (sameCell(cell, m_CellEntries[i].m_Cell))
+					proxies.push_back(m_CellEntries[i].m_Proxy);
+			}
+
+			int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+			if (tNext[axis] > tExit || step[axis] == 0)
+				break;
+			cell[axis] += step[axis];
+			if (cell[axis] < m_GridMin[axis] || cell[axis] > m_GridMax[axis])
+				break;
+			tNext[axis] += tDelta[axis];
+		}
+	}
+	proxies.insert(proxies.end(), m_LargeProxies.begin(), m_LargeProxies.end());
+
+	// a box in several cells along the ray is listed once for each
+	std::sort(proxies.begin(), proxies.end());
+	proxies.erase(std::unique(proxies.begin(), proxies.end()), proxies.end());
+
+	PoolVector<RayHit> hits;
+	for (size_t i = 0; i < proxies.size(); ++i)
+	{
+		const Proxy& proxy = m_ProxyList[proxies[i]];
+		RayHit hit;
+		hit.m_Proxy = proxies[i];
+		if (rayHitsAABB(s, invDir, maxFraction, proxy.m_Min, proxy.m_Max, hit.m_T))
+			hits.push_back(hit);
+	}
+	sortRayHits(hits, proxies);
+}
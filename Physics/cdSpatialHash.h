@@ -0,0 +1,89 @@
+#ifndef CDSPATIALHASH_H
+#define CDSPATIALHASH_H
+
+#include "cdBroadPhase.h"
+
+// Uniform grid broad phase hashed into buckets, for many boxes of about the same size
+// Every updatePairs after a change rebuilds the grid, a box is listed in every cell it touches and
+// the lists are counting sorted by bucket into one array, then the boxes sharing a cell are tested
+// A pair sharing several cells is tested only in the cell of the min corner of their overlap
+// Boxes over many cells are kept out of the grid and tested against every box
+class SpatialHash : public BroadPhase
+{
+public:
+	// a cell about the size of the largest common box keeps each box in at most eight cells
+	explicit SpatialHash(float cellSize = 1.0f);
+
+	virtual int addProxy(const Vector3& min, const Vector3& max, void* pUserData);
+	virtual void removeProxy(int proxy);
+	virtual void moveProxy(int proxy, const Vector3& min, const Vector3& max);
+
+	virtual void* getUserData(int proxy) const { return m_ProxyList[proxy].m_pUserData; }
+	virtual int getProxyCount() const { return m_ProxyCount; }
+	virtual void getAABB(int proxy, Vector3& min, Vector3& max) const;
+
+	// the cells of the query as of the last updatePairs, or every box after a change
+	virtual void queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const;
+
+	// walk the cells along the ray as of the last updatePairs, or every box after a change
+	virtual void queryRay(const Vector3& start, const Vector3& dir, float maxFraction, PoolVector<int>& proxies) const;
+
+	// rebuild the grid and test the boxes of each cell, nothing is done if no box changed
+	virtual void updatePairs();
+
+	// takes effect at the next updatePairs
+	void setCellSize(float cellSize);
+	float getCellSize() const { return m_CellSize; }
+
+	// boxes too large for the grid as of the last updatePairs
+	int getLargeProxyCount() const { return (int) m_LargeProxies.size(); }
+
+private:
+	struct Proxy
+	{
+		float				m_Min[3];
+		float				m_Max[3];
+		// the cells the box touched at the last rebuild
+		int					m_CellMin[3];
+		int					m_CellMax[3];
+		void*				m_pUserData;
+		int					m_State;
+	};
+
+	// a box listed in a cell, a bucket holds every cell that hashes to it
+	struct CellEntry
+	{
+		int					m_Cell[3];
+		int					m_Proxy;
+	};
+
+	void getCell(const float v[3], int cell[3]) const;
+	uint32_t getBucket(const int cell[3]) const;
+	void rebuild();
+	void findPairs();
+	static void findPairsJob(void* pData, int job);
+	void queryAll(const float min[3], const float max[3], PoolVector<int>& proxies) const;
+
+	PoolVector<Proxy>					m_ProxyList;
+	PoolVector<int>						m_FreeProxies;
+	// removed proxies keep their pair states until updatePairs reports them
+	PoolVector<int>						m_RemovedProxies;
+	int									m_ProxyCount;
+	float								m_CellSize;
+	float								m_InvCellSize;
+	// a box was added, moved or removed since the grid was built
+	bool								m_Dirty;
+
+	// the entries of bucket b are m_CellEntries[m_BucketStart[b]] to m_CellEntries[m_BucketStart[b + 1]]
+	PoolVector<CellEntry>				m_CellEntries;
+	PoolVector<uint32_t>				m_BucketStart;
+	uint32_t							m_BucketMask;
+	int									m_GridMin[3];
+	int									m_GridMax[3];
+	PoolVector<int>						m_LargeProxies;
+	PoolVector<ProxyPair>				m_PairBuffer;
+	// the pairs found by each job of findPairs
+	PoolVector<PoolVector<ProxyPair> >	m_JobPairs;
+};
+
+#endif
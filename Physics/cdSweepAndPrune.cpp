@@ -0,0 +1,352 @@
+#include "cdSweepAndPrune.h"
+#include <algorithm>
+
+namespace
+{
+	// x, y and z of a vector, indexed by axis
+	void getAxes(const Vector3& v, float axes[3])
+	{
+		axes[0] = v.GetX();
+		axes[1] = v.GetY();
+		axes[2] = v.GetZ();
+	}
+}
+
+SweepAndPrune::SweepAndPrune()
+{
+	m_ProxyCount = 0;
+}
+
+int SweepAndPrune::allocateProxy(void* pUserData)
+{
+	int proxy;
+	if (!m_FreeProxies.empty())
+	{
+		proxy = m_FreeProxies.back();
+		m_FreeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (int) m_ProxyList.size();
+		m_ProxyList.push_back(Proxy());
+	}
+
+	m_ProxyList[proxy].m_pUserData = pUserData;
+	m_ProxyCount++;
+	return proxy;
+}
+
+int SweepAndPrune::addProxy(const Vector3& min, const Vector3& max, void* pUserData)
+{
+	int proxy = allocateProxy(pUserData);
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+
+	// append the ends past every other end, where the box overlaps nothing
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		Endpoint endpoint;
+		uint32_t index = (uint32_t) m_Endpoints[axis].size();
+		endpoint.m_Value = minAxes[axis];
+		endpoint.m_Data = (uint32_t) proxy << 1;
+		m_Endpoints[axis].push_back(endpoint);
+		endpoint.m_Value = maxAxes[axis];
+		endpoint.m_Data |= 1;
+		m_Endpoints[axis].push_back(endpoint);
+		m_ProxyList[proxy].m_Min[axis] = index;
+		m_ProxyList[proxy].m_Max[axis] = index + 1;
+	}
+
+	// the box overlaps nothing until it is sorted into z, so x and y need no pair updates
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		bool updateOverlaps = axis == 2;
+		sortMinDown(axis, m_ProxyList[proxy].m_Min[axis], updateOverlaps);
+		sortMaxDown(axis, m_ProxyList[proxy].m_Max[axis], updateOverlaps);
+	}
+	return proxy;
+}
+
+void SweepAndPrune::addProxies(const Vector3* pMins, const Vector3* pMaxs, void* const* ppUserData, int count, int* pProxies)
+{
+	if (count <= 0)
+		return;
+
+	for (int i = 0; i < count; ++i)
+	{
+		pProxies[i] = allocateProxy(ppUserData[i]);
+
+		float minAxes[3], maxAxes[3];
+		getAxes(pMins[i], minAxes);
+		getAxes(pMaxs[i], maxAxes);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			Endpoint endpoint;
+			endpoint.m_Value = minAxes[axis];
+			endpoint.m_Data = (uint32_t) pProxies[i] << 1;
+			m_Endpoints[axis].push_back(endpoint);
+			endpoint.m_Value = maxAxes[axis];
+			endpoint.m_Data |= 1;
+			m_Endpoints[axis].push_back(endpoint);
+		}
+	}
+
+	// the same order the insertion sort keeps, a min goes before a max of the same value
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+		std::sort(endpoints.begin(), endpoints.end(), endpointLess);
+		for (uint32_t i = 0; i < endpoints.size(); ++i)
+		{
+			setEndpointIndex(axis, i);
+		}
+	}
+
+	// sweep along x keeping the boxes whose min has been passed and max has not,
+	// a new box is tested against every open box, old boxes already have their pairs
+	PoolVector<char> isNew(m_ProxyList.size(), 0);
+	for (int i = 0; i < count; ++i)
+	{
+		isNew[pProxies[i]] = 1;
+	}
+
+	PoolVector<uint32_t> open;
+	const PoolVector<Endpoint>& endpoints = m_Endpoints[0];
+	for (uint32_t i = 0; i < endpoints.size(); ++i)
+	{
+		uint32_t proxy = endpoints[i].m_Data >> 1;
+		if (endpoints[i].m_Data & 1)
+		{
+			open.erase(std::find(open.begin(), open.end(), proxy));
+			continue;
+		}
+
+		for (size_t j = 0; j < open.size(); ++j)
+		{
+			if ((isNew[proxy] || isNew[open[j]]) && overlap2D(m_ProxyList[proxy], m_ProxyList[open[j]], 0))
+				addPair(proxy, open[j]);
+		}
+		open.push_back(proxy);
+	}
+}
+
+void SweepAndPrune::removeProxy(int proxy)
+{
+	// every box overlapping on x has its min before this max and its max after this min
+	const Proxy& removed = m_ProxyList[proxy];
+	const PoolVector<Endpoint>& xEndpoints = m_Endpoints[0];
+	for (uint32_t i = 0; i < removed.m_Max[0]; ++i)
+	{
+		uint32_t other = xEndpoints[i].m_Data >> 1;
+		if (!(xEndpoints[i].m_Data & 1) && other != (uint32_t) proxy && m_ProxyList[other].m_Max[0] > removed.m_Min[0] &&
+			overlap2D(removed, m_ProxyList[other], 0))
+			removePair(proxy, other);
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+		uint32_t min = m_ProxyList[proxy].m_Min[axis];
+		endpoints.erase(endpoints.begin() + m_ProxyList[proxy].m_Max[axis]);
+		endpoints.erase(endpoints.begin() + min);
+		for (uint32_t i = min; i < endpoints.size(); ++i)
+		{
+			setEndpointIndex(axis, i);
+		}
+	}
+
+	m_RemovedProxies.push_back(proxy);
+	m_ProxyCount--;
+}
+
+void SweepAndPrune::moveProxy(int proxy, const Vector3& min, const Vector3& max)
+{
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		Proxy& moved = m_ProxyList[proxy];
+		Endpoint& minEndpoint = m_Endpoints[axis][moved.m_Min[axis]];
+		Endpoint& maxEndpoint = m_Endpoints[axis][moved.m_Max[axis]];
+		float dmin = minAxes[axis] - minEndpoint.m_Value;
+		float dmax = maxAxes[axis] - maxEndpoint.m_Value;
+		minEndpoint.m_Value = minAxes[axis];
+		maxEndpoint.m_Value = maxAxes[axis];
+
+		// grow before shrinking so the min never passes its own max
+		if (dmin < 0.0f)
+			sortMinDown(axis, moved.m_Min[axis], true);
+		if (dmax > 0.0f)
+			sortMaxUp(axis, moved.m_Max[axis], true);
+		if (dmin > 0.0f)
+			sortMinUp(axis, moved.m_Min[axis], true);
+		if (dmax < 0.0f)
+			sortMaxDown(axis, moved.m_Max[axis], true);
+	}
+}
+
+void SweepAndPrune::getAABB(int proxy, Vector3& min, Vector3& max) const
+{
+	const Proxy& box = m_ProxyList[proxy];
+	min.Set(m_Endpoints[0][box.m_Min[0]].m_Value, m_Endpoints[1][box.m_Min[1]].m_Value, m_Endpoints[2][box.m_Min[2]].m_Value);
+	max.Set(m_Endpoints[0][box.m_Max[0]].m_Value, m_Endpoints[1][box.m_Max[1]].m_Value, m_Endpoints[2][box.m_Max[2]].m_Value);
+}
+
+void SweepAndPrune::queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const
+{
+	float minAxes[3], maxAxes[3];
+	getAxes(min, minAxes);
+	getAxes(max, maxAxes);
+	proxies.clear();
+
+	// the first x endpoint past the end of the query
+	const PoolVector<Endpoint>& xEndpoints = m_Endpoints[0];
+	uint32_t lower = 0;
+	uint32_t upper = (uint32_t) xEndpoints.size();
+	while (lower < upper)
+	{
+		uint32_t middle = (lower + upper) / 2;
+		if (xEndpoints[middle].m_Value <= maxAxes[0])
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	for (uint32_t i = 0; i < lower; ++i)
+	{
+		if (xEndpoints[i].m_Data & 1)
+			continue;
+
+		uint32_t proxy = xEndpoints[i].m_Data >> 1;
+		const Proxy& box = m_ProxyList[proxy];
+		if (xEndpoints[box.m_Max[0]].m_Value >= minAxes[0] &&
+			m_Endpoints[1][box.m_Min[1]].m_Value <= maxAxes[1] && m_Endpoints[1][box.m_Max[1]].m_Value >= minAxes[1] &&
+			m_Endpoints[2][box.m_Min[2]].m_Value <= maxAxes[2] && m_Endpoints[2][box.m_Max[2]].m_Value >= minAxes[2])
+			proxies.push_back((int) proxy);
+	}
+}
+
+void SweepAndPrune::updatePairs()
+{
+	BroadPhase::updatePairs();
+
+	// the removed proxies have no pairs left to report
+	m_FreeProxies.insert(m_FreeProxies.end(), m_RemovedProxies.begin(), m_RemovedProxies.end());
+	m_RemovedProxies.clear();
+}
+
+bool SweepAndPrune::endpointLess(const Endpoint& endpoint0, const Endpoint& endpoint1)
+{
+	return endpoint0.m_Value < endpoint1.m_Value ||
+		(endpoint0.m_Value == endpoint1.m_Value && (endpoint0.m_Data & 1) < (endpoint1.m_Data & 1));
+}
+
+// a min moving down begins an overlap when it passes a max
+void SweepAndPrune::sortMinDown(int axis, uint32_t endpoint, bool updateOverlaps)
+{
+	PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+	while (endpoint > 0)
+	{
+		const Endpoint& prev = endpoints[endpoint - 1];
+		bool prevIsMax = (prev.m_Data & 1) != 0;
+		if (!(endpoints[endpoint].m_Value < prev.m_Value || (endpoints[endpoint].m_Value == prev.m_Value && prevIsMax)))
+			break;
+
+		if (prevIsMax && updateOverlaps)
+		{
+			uint32_t proxy = endpoints[endpoint].m_Data >> 1;
+			uint32_t other = prev.m_Data >> 1;
+			if (overlap2D(m_ProxyList[proxy], m_ProxyList[other], axis))
+				addPair(proxy, other);
+		}
+		swapEndpoints(axis, endpoint - 1);
+		endpoint--;
+	}
+}
+
+// a min moving up ends an overlap when it passes a max
+void SweepAndPrune::sortMinUp(int axis, uint32_t endpoint, bool updateOverlaps)
+{
+	PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+	while (endpoint + 1 < endpoints.size())
+	{
+		const Endpoint& next = endpoints[endpoint + 1];
+		if (!(next.m_Value < endpoints[endpoint].m_Value))
+			break;
+
+		if ((next.m_Data & 1) && updateOverlaps)
+			removePair(endpoints[endpoint].m_Data >> 1, next.m_Data >> 1);
+		swapEndpoints(axis, endpoint);
+		endpoint++;
+	}
+}
+
+// a max moving down ends an overlap when it passes a min
+void SweepAndPrune::sortMaxDown(int axis, uint32_t endpoint, bool updateOverlaps)
+{
+	PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+	while (endpoint > 0)
+	{
+		const Endpoint& prev = endpoints[endpoint - 1];
+		if (!(endpoints[endpoint].m_Value < prev.m_Value))
+			break;
+
+		if (!(prev.m_Data & 1) && updateOverlaps)
+			removePair(endpoints[endpoint].m_Data >> 1, prev.m_Data >> 1);
+		swapEndpoints(axis, endpoint - 1);
+		endpoint--;
+	}
+}
+
+// a max moving up begins an overlap when it passes a min
+void SweepAndPrune::sortMaxUp(int axis, uint32_t endpoint, bool updateOverlaps)
+{
+	PoolVector<Endpoint>& endpoints = m_Endpoints[axis];
+	while (endpoint + 1 < endpoints.size())
+	{
+		const Endpoint& next = endpoints[endpoint + 1];
+		bool nextIsMin = !(next.m_Data & 1);
+		if (!(next.m_Value < endpoints[endpoint].m_Value || (next.m_Value == endpoints[endpoint].m_Value && nextIsMin)))
+			break;
+
+		if (nextIsMin && updateOverlaps)
+		{
+			uint32_t proxy = endpoints[endpoint].m_Data >> 1;
+			uint32_t other = next.m_Data >> 1;
+			if (overlap2D(m_ProxyList[proxy], m_ProxyList[other], axis))
+				addPair(proxy, other);
+		}
+		swapEndpoints(axis, endpoint);
+		endpoint++;
+	}
+}
+
+// swap an endpoint with the one above it
+void SweepAndPrune::swapEndpoints(int axis, uint32_t endpoint)
+{
+	std::swap(m_Endpoints[axis][endpoint], m_Endpoints[axis][endpoint + 1]);
+	setEndpointIndex(axis, endpoint);
+	setEndpointIndex(axis, endpoint + 1);
+}
+
+void SweepAndPrune::setEndpointIndex(int axis, uint32_t endpoint)
+{
+	uint32_t data = m_Endpoints[axis][endpoint].m_Data;
+	Proxy& proxy = m_ProxyList[data >> 1];
+	if (data & 1)
+		proxy.m_Max[axis] = endpoint;
+	else
+		proxy.m_Min[axis] = endpoint;
+}
+
+// overlap on the two axes other than axis, compared by index since the endpoints are sorted
+bool SweepAndPrune::overlap2D(const Proxy& proxy0, const Proxy& proxy1, int axis) const
+{
+	int axis1 = (1 << axis) & 3;
+	int axis2 = (1 << axis1) & 3;
+	return proxy0.m_Min[axis1] < proxy1.m_Max[axis1] && proxy1.m_Min[axis1] < proxy0.m_Max[axis1] &&
+		proxy0.m_Min[axis2] < proxy1.m_Max[axis2] && proxy1.m_Min[axis2] < proxy0.m_Max[axis2];
+}
@@ -0,0 +1,68 @@
+#ifndef CDSWEEPANDPRUNE_H
+#define CDSWEEPANDPRUNE_H
+
+#include "cdBroadPhase.h"
+
+// Incremental sweep and prune broad phase
+// The min and max of every box are kept sorted along x, y and z, a moved box is insertion sorted
+// from where it was, so a box that moved a little costs a few swaps and its pairs change only
+// when one of its ends passes the end of another box
+class SweepAndPrune : public BroadPhase
+{
+public:
+	SweepAndPrune();
+
+	// add a box and return its proxy, proxies of removed boxes are reused after the next updatePairs
+	virtual int addProxy(const Vector3& min, const Vector3& max, void* pUserData);
+
+	// add count boxes by sorting all endpoints at once rather than one box at a time,
+	// for loading a level of many boxes
+	virtual void addProxies(const Vector3* pMins, const Vector3* pMaxs, void* const* ppUserData, int count, int* pProxies);
+
+	virtual void removeProxy(int proxy);
+	virtual void moveProxy(int proxy, const Vector3& min, const Vector3& max);
+
+	virtual void* getUserData(int proxy) const { return m_ProxyList[proxy].m_pUserData; }
+	virtual int getProxyCount() const { return m_ProxyCount; }
+	virtual void getAABB(int proxy, Vector3& min, Vector3& max) const;
+
+	// a binary search along x, then every box that begins before the end of the query
+	virtual void queryAABB(const Vector3& min, const Vector3& max, PoolVector<int>& proxies) const;
+
+	virtual void updatePairs();
+
+private:
+	// m_Data is the proxy shifted left by one with the low bit set for a max
+	struct Endpoint
+	{
+		float				m_Value;
+		uint32_t			m_Data;
+	};
+
+	struct Proxy
+	{
+		// index of the min and max in the endpoints of each axis
+		uint32_t			m_Min[3];
+		uint32_t			m_Max[3];
+		void*				m_pUserData;
+	};
+
+	static bool endpointLess(const Endpoint& endpoint0, const Endpoint& endpoint1);
+	int allocateProxy(void* pUserData);
+	void sortMinDown(int axis, uint32_t endpoint, bool updateOverlaps);
+	void sortMinUp(int axis, uint32_t endpoint, bool updateOverlaps);
+	void sortMaxDown(int axis, uint32_t endpoint, bool updateOverlaps);
+	void sortMaxUp(int axis, uint32_t endpoint, bool updateOverlaps);
+	void swapEndpoints(int axis, uint32_t endpoint);
+	void setEndpointIndex(int axis, uint32_t endpoint);
+	bool overlap2D(const Proxy& proxy0, const Proxy& proxy1, int axis) const;
+
+	PoolVector<Endpoint>				m_Endpoints[3];
+	PoolVector<Proxy>					m_ProxyList;
+	PoolVector<int>						m_FreeProxies;
+	// removed proxies keep their pair states until updatePairs reports them
+	PoolVector<int>						m_RemovedProxies;
+	int									m_ProxyCount;
+};
+
+#endif
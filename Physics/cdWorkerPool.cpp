@@ -0,0 +1,107 @@
+#include "cdWorkerPool.h"
+
+WorkerPool::WorkerPool(int threadCount)
+{
+	m_Job = NULL;
+	m_pData = NULL;
+	m_JobCount = 0;
+	m_Generation = 0;
+	m_NextJob = 0;
+	m_Working = 0;
+	m_Quit = false;
+	for (int i = 1; i < threadCount; ++i)
+	{
+		m_Threads.push_back(std::thread(&WorkerPool::work, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_Start.notify_all();
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+	{
+		m_Threads[i].join();
+	}
+}
+
+void WorkerPool::run(Job job, void* pData, int jobCount)
+{
+	if (m_Threads.empty() || jobCount <= 1)
+	{
+		for (int i = 0; i < jobCount; ++i)
+		{
+			job(pData, i);
+		}
+		return;
+	}
+
+	{
+		// a thread late for the last run may still be taking a job number, let it see none are left
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (m_Working > 0)
+		{
+			m_Done.wait(lock);
+		}
+		m_Job = job;
+		m_pData = pData;
+		m_JobCount = jobCount;
+		m_NextJob = 0;
+		m_Generation++;
+	}
+	m_Start.notify_all();
+
+	runJobs(job, pData, jobCount);
+
+	// every job is taken, wait for the threads still running one
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (m_Working > 0)
+	{
+		m_Done.wait(lock);
+	}
+}
+
+void WorkerPool::work()
+{
+	unsigned int generation = 0;
+	for (;;)
+	{
+		Job job;
+		void* pData;
+		int jobCount;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			while (!m_Quit && m_Generation == generation)
+			{
+				m_Start.wait(lock);
+			}
+			if (m_Quit)
+				return;
+
+			generation = m_Generation;
+			job = m_Job;
+			pData = m_pData;
+			jobCount = m_JobCount;
+			m_Working++;
+		}
+
+		runJobs(job, pData, jobCount);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Working--;
+		}
+		m_Done.notify_all();
+	}
+}
+
+void WorkerPool::runJobs(Job job, void* pData, int jobCount)
+{
+	for (int i = m_NextJob++; i < jobCount; i = m_NextJob++)
+	{
+		job(pData, i);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef CDWORKERPOOL_H
+#define CDWORKERPOOL_H
+
+#include "../Memory/PoolAllocator.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Threads kept waiting to run the jobs of a phase, the thread that calls run works on them too
+// Jobs are taken in order by whichever thread is free, so for a result that is the same for any
+// number of threads a job must write only what is kept by its job index, never by its thread
+class WorkerPool
+{
+public:
+	typedef void (*Job)(void* pData, int job);
+
+	// threadCount counts the calling thread, 1 or less runs every job on the caller
+	explicit WorkerPool(int threadCount);
+	~WorkerPool();
+
+	int getThreadCount() const { return (int) m_Threads.size() + 1; }
+
+	// run jobs 0 to jobCount - 1 and return when every one is done
+	void run(Job job, void* pData, int jobCount);
+
+	// the jobs of at most jobSize items that cover count items
+	static int getJobCount(int count, int jobSize) { return (count + jobSize - 1) / jobSize; }
+
+private:
+	void work();
+	void runJobs(Job job, void* pData, int jobCount);
+
+	PoolVector<std::thread>				m_Threads;
+	std::mutex							m_Mutex;
+	std::condition_variable				m_Start;
+	std::condition_variable				m_Done;
+	// the jobs of the last run, m_Generation counts the runs
+	Job									m_Job;
+	void*								m_pData;
+	int									m_JobCount;
+	unsigned int						m_Generation;
+	std::atomic<int>					m_NextJob;
+	// threads between taking the jobs of a run and finishing them
+	int									m_Working;
+	bool								m_Quit;
+};
+
+#endif
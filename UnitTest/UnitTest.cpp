@@ -7,11 +7,27 @@
 #include <Windows.h>
 #include "gtest\gtest.h"
 #include "..\Math\simdmath.h"
+#include "..\Math\simdstream.h"
+#include "..\Math\simdwide.h"
+#include "..\Math\simdtransform.h"
+#include "..\Math\simdtranscendental.h"
+#include "..\Math\simdfrustum.h"
+#include "..\Math\simdbounds.h"
+#include "..\Math\simdquantize.h"
+#include <DirectXMath.h>
 #include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
 #include <algorithm>
 #include <fstream>
+#include <random>
+#include <limits>
 #include <sstream>
 #include "..\Memory\MemoryManager.h"
+#include "..\Memory\DoubleBufferedAllocator.h"
+#include "..\Memory\PoolAllocator.h"
+#include "..\Memory\ObjectPool.h"
 #include "..\Physics\cdSphere.h"
 #include "..\Physics\cdAabb.h"
 #include "..\Physics\cdBody.h"
@@ -20,6 +36,10 @@
 #include "..\Physics\cdRay.h"
 #include "..\Physics\cdCollide.h"
 #include "..\Physics\cdCollisionWorld.h"
+#include "..\Physics\cdSweepAndPrune.h"
+#include "..\Physics\cdAabbTree.h"
+#include "..\Physics\cdSpatialHash.h"
+#include "..\Physics\cdBatchCollide.h"
 
 
 #pragma warning(disable : 4996)
@@ -349,78 +369,3225 @@ TEST(Matrix, getMatrix)
 
 }
 
+// Every backend compiled in for this target, the maths classes use SIMDBackend
+template <typename Backend>
+class SIMDBackendTest : public ::testing::Test
+{
+};
+
+typedef ::testing::Types<SIMDScalar
+#ifdef SIMD_HAS_SSE41
+	, SIMDSSE41
+#endif
+#ifdef SIMD_HAS_AVX2
+	, SIMDAVX2
+#endif
+> SIMDBackends;
+
+TYPED_TEST_CASE(SIMDBackendTest, SIMDBackends);
+
+TYPED_TEST(SIMDBackendTest, Lanes)
+{
+	typename TypeParam::Vec4 v = TypeParam::Set(1.0f, 2.0f, 3.0f, 4.0f);
+	EXPECT_EQ(1.0f, TypeParam::GetX(v));
+	EXPECT_EQ(2.0f, TypeParam::GetY(v));
+	EXPECT_EQ(3.0f, TypeParam::GetZ(v));
+	EXPECT_EQ(4.0f, TypeParam::GetW(v));
+
+	v = TypeParam::SetY(TypeParam::SetW(v, 8.0f), 6.0f);
+	SIMD_ALIGN(16) float stored[4];
+	TypeParam::Store(stored, v);
+	EXPECT_EQ(1.0f, stored[0]);
+	EXPECT_EQ(6.0f, stored[1]);
+	EXPECT_EQ(3.0f, stored[2]);
+	EXPECT_EQ(8.0f, stored[3]);
+
+	float unaligned[5] = { 0.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+	EXPECT_EQ(8.0f, TypeParam::GetW(TypeParam::LoadUnaligned(unaligned + 1)));
+
+	v = TypeParam::template Swizzle<3, 2, 1, 0>(TypeParam::Load(stored));
+	EXPECT_EQ(8.0f, TypeParam::GetX(v));
+	EXPECT_EQ(1.0f, TypeParam::GetW(v));
+}
+
+TYPED_TEST(SIMDBackendTest, Arithmetic)
+{
+	typename TypeParam::Vec4 a = TypeParam::Set(1.0f, -2.0f, 3.0f, 4.0f);
+	typename TypeParam::Vec4 b = TypeParam::Set(2.0f, 2.0f, -1.0f, 0.5f);
+	EXPECT_EQ(0.0f, TypeParam::GetY(TypeParam::Add(a, b)));
+	EXPECT_EQ(4.0f, TypeParam::GetZ(TypeParam::Sub(a, b)));
+	EXPECT_EQ(2.0f, TypeParam::GetW(TypeParam::Mul(a, b)));
+	EXPECT_EQ(8.0f, TypeParam::GetW(TypeParam::Div(a, b)));
+	EXPECT_EQ(2.0f + 4.0f, TypeParam::GetX(TypeParam::MulAdd(a, b, TypeParam::Splat(4.0f))));
+	EXPECT_EQ(-2.0f, TypeParam::GetY(TypeParam::Min(a, b)));
+	EXPECT_EQ(3.0f, TypeParam::GetZ(TypeParam::Max(a, b)));
+	EXPECT_EQ(2.0f, TypeParam::GetW(TypeParam::Sqrt(a)));
+	EXPECT_NEAR(0.5f, TypeParam::GetW(TypeParam::Rsqrt(a)), 0.001f);
+}
+
+TYPED_TEST(SIMDBackendTest, DotProducts)
+{
+	typename TypeParam::Vec4 a = TypeParam::Set(1.0f, 2.0f, 3.0f, 4.0f);
+	typename TypeParam::Vec4 b = TypeParam::Set(5.0f, 6.0f, 7.0f, 8.0f);
+	EXPECT_EQ(38.0f, TypeParam::GetX(TypeParam::Dot3(a, b)));
+	EXPECT_EQ(38.0f, TypeParam::GetW(TypeParam::Dot3(a, b)));
+	EXPECT_EQ(70.0f, TypeParam::GetZ(TypeParam::Dot4(a, b)));
+
+	typename TypeParam::Vec4 r0 = TypeParam::Set(1.0f, 0.0f, 0.0f, 0.0f);
+	typename TypeParam::Vec4 r1 = TypeParam::Set(0.0f, 0.0f, 0.0f, 1.0f);
+	typename TypeParam::Vec4 r2 = TypeParam::Set(1.0f, 1.0f, 1.0f, 1.0f);
+	typename TypeParam::Vec4 r3 = TypeParam::Set(0.0f, 2.0f, 0.0f, 0.0f);
+	TypeParam::Transpose(r0, r1, r2, r3);
+	EXPECT_EQ(1.0f, TypeParam::GetY(r3));
+	EXPECT_EQ(2.0f, TypeParam::GetW(r1));
+	EXPECT_EQ(1.0f, TypeParam::GetZ(r0));
+}
+
+TYPED_TEST(SIMDBackendTest, Masks)
+{
+	typename TypeParam::Vec4 a = TypeParam::Set(1.0f, -2.0f, 3.0f, 4.0f);
+	typename TypeParam::Vec4 b = TypeParam::Set(2.0f, -2.0f, 1.0f, 8.0f);
+	EXPECT_EQ(0x9, TypeParam::MoveMask(TypeParam::CmpLT(a, b)));
+	EXPECT_EQ(0xB, TypeParam::MoveMask(TypeParam::CmpLE(a, b)));
+	EXPECT_EQ(0x4, TypeParam::MoveMask(TypeParam::CmpGT(a, b)));
+	EXPECT_EQ(0x6, TypeParam::MoveMask(TypeParam::CmpGE(a, b)));
+	EXPECT_EQ(0x2, TypeParam::MoveMask(TypeParam::CmpEQ(a, b)));
+	EXPECT_EQ(0x9, TypeParam::MoveMask(TypeParam::And(TypeParam::CmpLT(a, b), TypeParam::CmpGT(b, TypeParam::Splat(0.0f)))));
+	EXPECT_EQ(0xD, TypeParam::MoveMask(TypeParam::Or(TypeParam::CmpLT(a, b), TypeParam::CmpGT(a, b))));
+
+	typename TypeParam::Vec4 selected = TypeParam::Select(TypeParam::CmpLT(a, b), a, b);
+	EXPECT_EQ(1.0f, TypeParam::GetX(selected));
+	EXPECT_EQ(1.0f, TypeParam::GetZ(selected));
+	EXPECT_EQ(4.0f, TypeParam::GetW(selected));
+	EXPECT_EQ(2.0f, TypeParam::GetY(TypeParam::Abs(a)));
+}
+
+TYPED_TEST(SIMDBackendTest, RoundAndExponent)
+{
+	typename TypeParam::Vec4 v = TypeParam::Set(1.4f, -2.5f, 2.5f, -0.6f);
+	typename TypeParam::Vec4 rounded = TypeParam::Round(v);
+	EXPECT_EQ(1.0f, TypeParam::GetX(rounded));
+	EXPECT_EQ(-2.0f, TypeParam::GetY(rounded));
+	EXPECT_EQ(2.0f, TypeParam::GetZ(rounded));
+	EXPECT_EQ(-1.0f, TypeParam::GetW(rounded));
+
+	typename TypeParam::Vec4 powers = TypeParam::Pow2(TypeParam::Set(0.0f, 3.0f, -126.0f, 127.0f));
+	EXPECT_EQ(1.0f, TypeParam::GetX(powers));
+	EXPECT_EQ(8.0f, TypeParam::GetY(powers));
+	EXPECT_EQ(ldexpf(1.0f, -126), TypeParam::GetZ(powers));
+	EXPECT_EQ(ldexpf(1.0f, 127), TypeParam::GetW(powers));
+
+	v = TypeParam::Set(12.0f, -0.375f, 1.0f, 3.0e-30f);
+	typename TypeParam::Vec4 exponent = TypeParam::Exponent(v);
+	typename TypeParam::Vec4 mantissa = TypeParam::Mantissa(v);
+	EXPECT_EQ(3.0f, TypeParam::GetX(exponent));
+	EXPECT_EQ(1.5f, TypeParam::GetX(mantissa));
+	EXPECT_EQ(-2.0f, TypeParam::GetY(exponent));
+	EXPECT_EQ(1.5f, TypeParam::GetY(mantissa));
+	EXPECT_EQ(0.0f, TypeParam::GetZ(exponent));
+	EXPECT_EQ(1.0f, TypeParam::GetZ(mantissa));
+	EXPECT_EQ(3.0e-30f, ldexpf(TypeParam::GetW(mantissa), (int) TypeParam::GetW(exponent)));
+
+	EXPECT_EQ(-12.0f, TypeParam::GetX(TypeParam::Xor(v, TypeParam::Splat(-0.0f))));
+	EXPECT_EQ(0.375f, TypeParam::GetY(TypeParam::Xor(v, TypeParam::Splat(-0.0f))));
+}
+
+// The approximations on every 4 and 8 lane backend compiled in for this target
+template <typename Functions>
+class SIMDTranscendentalTest : public ::testing::Test
+{
+};
+
+typedef ::testing::Types<SIMDTranscendental<SIMDScalar>, SIMDTranscendental<SIMDPair<SIMDScalar> >
+#ifdef SIMD_HAS_SSE41
+	, SIMDTranscendental<SIMDSSE41>, SIMDTranscendental<SIMDPair<SIMDSSE41> >
+#endif
+#ifdef SIMD_HAS_AVX2
+	, SIMDTranscendental<SIMDAVX2>, SIMDTranscendental<SIMDAVX2x8>
+#endif
+> SIMDTranscendentals;
+
+TYPED_TEST_CASE(SIMDTranscendentalTest, SIMDTranscendentals);
+
+// Largest error of a function over count samples from first to last
+// The error is relative to the result when relative is set, otherwise it is relative to results larger than 1
+template <typename Functions, typename Function, typename Reference>
+double maxTranscendentalError(double first, double last, int count, bool relative, Function function, Reference reference)
+{
+	const int width = sizeof(typename Functions::Vec) / sizeof(float);
+	double maxError = 0.0;
+	for (int i = 0; i < count; i += width)
+	{
+		float in[8];
+		float out[8];
+		for (int j = 0; j < width; ++j)
+		{
+			in[j] = (float) (first + (last - first) * (i + j) / (count - 1));
+		}
+		typename Functions::Vec v;
+		memcpy(&v, in, sizeof(v));
+		v = function(v);
+		memcpy(out, &v, sizeof(v));
+		for (int j = 0; j < width; ++j)
+		{
+			double expected = reference((double) in[j]);
+			double error = fabs(out[j] - expected);
+			if (relative || fabs(expected) > 1.0)
+				error /= fabs(expected);
+			maxError = error > maxError ? error : maxError;
+		}
+	}
+	return maxError;
+}
+
+TYPED_TEST(SIMDTranscendentalTest, MaxError)
+{
+	typedef typename TypeParam::Backend B;
+	typedef typename TypeParam::Vec Vec;
+	const int samples = 100000;
+
+	EXPECT_GT(1.5e-7, (maxTranscendentalError<TypeParam>(-8192.0, 8192.0, samples, false,
+		[](const Vec& x) { return TypeParam::Sin(x); }, [](double x) { return sin(x); })));
+	EXPECT_GT(1.5e-7, (maxTranscendentalError<TypeParam>(-8192.0, 8192.0, samples, false,
+		[](const Vec& x) { return TypeParam::Cos(x); }, [](double x) { return cos(x); })));
+	EXPECT_GT(1.5e-7, (maxTranscendentalError<TypeParam>(-7.0, 7.0, samples, false,
+		[](const Vec& x) { return TypeParam::Cos(x); }, [](double x) { return cos(x); })));
+	EXPECT_GT(2e-7, (maxTranscendentalError<TypeParam>(-87.3, 88.0, samples, true,
+		[](const Vec& x) { return TypeParam::Exp(x); }, [](double x) { return exp(x); })));
+	EXPECT_GT(1.5e-7, (maxTranscendentalError<TypeParam>(1e-30, 1e30, samples, false,
+		[](const Vec& x) { return TypeParam::Log(x); }, [](double x) { return log(x); })));
+	EXPECT_GT(1.5e-7, (maxTranscendentalError<TypeParam>(0.001, 10.0, samples, false,
+		[](const Vec& x) { return TypeParam::Log(x); }, [](double x) { return log(x); })));
+
+	// atan2 around the whole circle and at every ratio
+	for (int quadrant = 0; quadrant < 4; ++quadrant)
+	{
+		double sx = quadrant & 1 ? -1.0 : 1.0;
+		double sy = quadrant & 2 ? -1.0 : 1.0;
+		EXPECT_GT(3e-7, (maxTranscendentalError<TypeParam>(-20.0, 20.0, samples, false,
+			[=](const Vec& t) { return TypeParam::Atan2(t, B::Splat((float) sx)); },
+			[=](double t) { return atan2(t, sx); })));
+		EXPECT_GT(3e-7, (maxTranscendentalError<TypeParam>(-20.0, 20.0, samples, false,
+			[=](const Vec& t) { return TypeParam::Atan2(B::Splat((float) sy), t); },
+			[=](double t) { return atan2(sy, t); })));
+	}
+}
+
+// The first lane of a 4 or 8 float vector
+template <typename Vec>
+float firstLane(Vec v)
+{
+	float lane;
+	memcpy(&lane, &v, sizeof(lane));
+	return lane;
+}
+
+TYPED_TEST(SIMDTranscendentalTest, SpecialValues)
+{
+	typedef typename TypeParam::Backend B;
+	typename TypeParam::Vec zero = B::Splat(0.0f);
+	EXPECT_EQ(0.0f, firstLane(TypeParam::Atan2(zero, zero)));
+	EXPECT_NEAR(3.14159265f, firstLane(TypeParam::Atan2(zero, B::Splat(-1.0f))), 0.000001f);
+	EXPECT_EQ(0.0f, firstLane(TypeParam::Sin(zero)));
+	EXPECT_EQ(1.0f, firstLane(TypeParam::Cos(zero)));
+	EXPECT_EQ(1.0f, firstLane(TypeParam::Exp(zero)));
+	EXPECT_EQ(0.0f, firstLane(TypeParam::Log(B::Splat(1.0f))));
+
+	float logZero = firstLane(TypeParam::Log(zero));
+	EXPECT_TRUE(isinf(logZero) && logZero < 0.0f);
+	EXPECT_TRUE(isnan(firstLane(TypeParam::Log(B::Splat(-1.0f)))));
+	EXPECT_TRUE(isfinite(firstLane(TypeParam::Exp(B::Splat(1000.0f)))));
+	EXPECT_LT(0.0f, firstLane(TypeParam::Exp(B::Splat(-1000.0f))));
+}
+
+TEST(Transcendental, BatchedRotations)
+{
+	// 11 angles so both the full batch and the tail are covered
+	const int count = 11;
+	float x[count], y[count], z[count];
+	for (int i = 0; i < count; ++i)
+	{
+		x[i] = -3.0f + 0.55f * i;
+		y[i] = 2.0f - 0.3f * i;
+		z[i] = 0.17f * i * i;
+	}
+
+	float sines[count], cosines[count];
+	SinCos(x, sines, cosines, count);
+	Matrix4 matrices[3][count];
+	CreateRotationsX(x, matrices[0], count);
+	CreateRotationsY(y, matrices[1], count);
+	CreateRotationsZ(z, matrices[2], count);
+	Quat quats[4][count];
+	CreateQuaternionsX(x, quats[0], count);
+	CreateQuaternionsY(y, quats[1], count);
+	CreateQuaternionsZ(z, quats[2], count);
+	CreateQuaternionsFromEuler(x, y, z, quats[3], count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		EXPECT_NEAR(sinf(x[i]), sines[i], 0.000001f);
+		EXPECT_NEAR(cosf(x[i]), cosines[i], 0.000001f);
+
+		Matrix4 expected[3];
+		expected[0].CreateRotationX(x[i]);
+		expected[1].CreateRotationY(y[i]);
+		expected[2].CreateRotationZ(z[i]);
+		for (int k = 0; k < 3; ++k)
+		{
+			float a[4][4], b[4][4];
+			expected[k].Get(a);
+			matrices[k][i].Get(b);
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					EXPECT_NEAR(a[r][c], b[r][c], 0.000001f);
+				}
+			}
+		}
+
+		Quat qx, qy, qz;
+		qx.CreateRotationX(x[i]);
+		qy.CreateRotationY(y[i]);
+		qz.CreateRotationZ(z[i]);
+		EXPECT_NEAR(1.0f, quats[0][i].Dot(qx), 0.000001f);
+		EXPECT_NEAR(1.0f, quats[1][i].Dot(qy), 0.000001f);
+		EXPECT_NEAR(1.0f, quats[2][i].Dot(qz), 0.000001f);
+
+		Quat euler = qx;
+		euler.Multiply(qy);
+		euler.Multiply(qz);
+		EXPECT_NEAR(euler.GetX(), quats[3][i].GetX(), 0.000001f);
+		EXPECT_NEAR(euler.GetY(), quats[3][i].GetY(), 0.000001f);
+		EXPECT_NEAR(euler.GetZ(), quats[3][i].GetZ(), 0.000001f);
+		EXPECT_NEAR(euler.GetW(), quats[3][i].GetW(), 0.000001f);
+	}
+}
+
+// SIMDVector3x4 and SIMDVector3x8 on every backend compiled in for this target
+template <typename Vector>
+class SIMDWideTest : public ::testing::Test
+{
+};
+
+typedef ::testing::Types<SIMDVector3xN<SIMDScalar>, SIMDVector3xN<SIMDPair<SIMDScalar> >
+#ifdef SIMD_HAS_SSE41
+	, SIMDVector3xN<SIMDSSE41>, SIMDVector3xN<SIMDPair<SIMDSSE41> >
+#endif
+#ifdef SIMD_HAS_AVX2
+	, SIMDVector3xN<SIMDAVX2x8>
+#endif
+> SIMDWideVectors;
+
+TYPED_TEST_CASE(SIMDWideTest, SIMDWideVectors);
+
+TYPED_TEST(SIMDWideTest, MatchesSIMDVector3)
+{
+	Vector3 a[8];
+	Vector3 b[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		a[i] = Vector3(1.0f + i, 2.0f - i, 0.5f * i);
+		b[i] = Vector3(-1.0f, 3.0f + i, 2.0f);
+	}
+	TypeParam wideA = TypeParam::Gather(a);
+	TypeParam wideB = TypeParam::Gather(b);
+
+	SIMD_ALIGN(32) float dot[8];
+	SIMD_ALIGN(32) float length[8];
+	typename TypeParam::Lanes scalars = wideA.Dot(wideB);
+	memcpy(dot, &scalars, sizeof(scalars));
+	scalars = wideA.Length();
+	memcpy(length, &scalars, sizeof(scalars));
+	TypeParam sum = wideA + wideB;
+	TypeParam cross = CrossProduct(wideA, wideB);
+	TypeParam scaled = wideA * 2.0f;
+
+	for (int i = 0; i < TypeParam::Width; ++i)
+	{
+		EXPECT_NEAR(a[i].Dot(b[i]), dot[i], 0.0001f);
+		EXPECT_NEAR(a[i].Length(), length[i], 0.0001f);
+		EXPECT_NEAR((a[i] + b[i]).GetY(), sum.GetLane(i).GetY(), 0.0001f);
+		EXPECT_NEAR(CrossProduct(a[i], b[i]).GetX(), cross.GetLane(i).GetX(), 0.0001f);
+		EXPECT_NEAR(CrossProduct(a[i], b[i]).GetZ(), cross.GetLane(i).GetZ(), 0.0001f);
+		EXPECT_NEAR(2.0f * a[i].GetZ(), scaled.GetLane(i).GetZ(), 0.0001f);
+	}
+
+	wideA.Normalize();
+	for (int i = 0; i < TypeParam::Width; ++i)
+	{
+		EXPECT_NEAR(1.0f, wideA.GetLane(i).Length(), 0.001f);
+	}
+}
+
+TYPED_TEST(SIMDWideTest, CompareAndSelect)
+{
+	// Points against a box from (0, 0, 0) to (1, 1, 1), inside in the even lanes
+	SIMD_ALIGN(32) float x[8] = { 0.5f, 2.0f, 0.0f, 0.5f, 1.0f, -1.0f, 0.2f, 0.5f };
+	SIMD_ALIGN(32) float y[8] = { 0.5f, 0.5f, 0.0f, 1.5f, 1.0f, 0.5f, 0.9f, 0.5f };
+	SIMD_ALIGN(32) float z[8] = { 0.5f, 0.5f, 0.0f, 0.5f, 1.0f, 0.5f, 0.3f, -0.1f };
+	TypeParam points = TypeParam::Load(x, y, z);
+	TypeParam boxMin(0.0f, 0.0f, 0.0f);
+	TypeParam boxMax(1.0f, 1.0f, 1.0f);
+
+	int lanes = (1 << TypeParam::Width) - 1;
+	int inside = TypeParam::MoveMask(AllLessEqual(boxMin, points)) & TypeParam::MoveMask(AllLessEqual(points, boxMax));
+	EXPECT_EQ(0x55 & lanes, inside);
+	EXPECT_EQ(0x04 & lanes, TypeParam::MoveMask(Equal(points, boxMin)));
+	EXPECT_EQ(0x41 & lanes, TypeParam::MoveMask(AllLess(boxMin, points)) & TypeParam::MoveMask(AllLess(points, boxMax)));
+
+	// Clamp to the box, then keep the original points where they were inside
+	TypeParam clamped = Min(Max(points, boxMin), boxMax);
+	TypeParam selected = Select(AllLessEqual(points, boxMax), points, clamped);
+	for (int i = 0; i < TypeParam::Width; ++i)
+	{
+		EXPECT_EQ(x[i] < 0.0f ? 0.0f : (x[i] > 1.0f ? 1.0f : x[i]), clamped.GetLane(i).GetX());
+		EXPECT_EQ(y[i] > 1.0f ? 1.0f : y[i], selected.GetLane(i).GetY());
+		EXPECT_EQ(z[i], selected.GetLane(i).GetZ());
+	}
+}
+
+TEST(Matrix, LookAt)
+{
+	// Looking down +z from z = -5, the eye ends at the origin and the target on +z
+	Matrix4 view;
+	view.CreateLookAt(Vector3(0.0f, 0.0f, -5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3::UnitY);
+	Vector3 v(0.0f, 0.0f, 0.0f);
+	v.Transform(view);
+	EXPECT_NEAR(0.0f, v.GetX(), 0.0001f);
+	EXPECT_NEAR(5.0f, v.GetZ(), 0.0001f);
+
+	// Looking along +x, world +z is on the left of a left-handed view
+	view.CreateLookAt(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 0.0f, 0.0f), Vector3::UnitY);
+	v = Vector3(0.0f, 0.0f, 1.0f);
+	v.Transform(view);
+	EXPECT_NEAR(-1.0f, v.GetX(), 0.0001f);
+	EXPECT_NEAR(0.0f, v.GetZ(), 0.0001f);
+}
+
+TEST(Quaternion, MultiplicationOrder)
+{
+	// A quarter turn about z after a quarter turn about x
+	Vector3 axisX(1.0f, 0.0f, 0.0f);
+	Vector3 axisZ(0.0f, 0.0f, 1.0f);
+	Quat q(axisZ, PI / 2.0f);
+	Quat p(axisX, PI / 2.0f);
+	q.Multiply(p);
+
+	EXPECT_NEAR(0.5f, q.GetX(), 0.001f);
+	EXPECT_NEAR(0.5f, q.GetY(), 0.001f);
+	EXPECT_NEAR(0.5f, q.GetZ(), 0.001f);
+	EXPECT_NEAR(0.5f, q.GetW(), 0.001f);
+}
+
+TEST(Vector, LERPBothEnds)
+{
+	Vector3 v1(1.0f, 10.0f, 100.0f);
+	Vector3 v2(3.0f, 20.0f, 200.0f);
+	Vector3 v3 = Lerp(v1, v2, 0.5f);
+	EXPECT_NEAR(2.0f, v3.GetX(), 0.001f);
+	EXPECT_NEAR(150.0f, v3.GetZ(), 0.001f);
+}
+
+TEST(Stream, TransformSoA)
+{
+	Matrix4 mat;
+	mat.CreateRotationY(0.7f);
+	Matrix4 scale;
+	scale.CreateScale(2.0f);
+	mat.Multiply(scale);
+	mat.setTranslate(1.0f, -2.0f, 3.0f);
+
+	// Every count up to a few batches of 8, from aligned and unaligned starts
+	SIMD_ALIGN(32) float in[3][40];
+	SIMD_ALIGN(32) float out[3][40];
+	for (int i = 0; i < 40; ++i)
+	{
+		in[0][i] = (float) i;
+		in[1][i] = (float) (i % 7) - 3.0f;
+		in[2][i] = 0.5f * i;
+	}
+	for (int offset = 0; offset < 2; ++offset)
+	{
+		for (size_t count = 0; count <= 37; ++count)
+		{
+			for (int point = 0; point < 2; ++point)
+			{
+				memset(out, 0, sizeof(out));
+				if (point)
+					TransformPoints(mat, in[0] + offset, in[1] + offset, in[2] + offset, out[0] + offset, out[1] + offset, out[2] + offset, count);
+				else
+					TransformVectors(mat, in[0] + offset, in[1] + offset, in[2] + offset, out[0] + offset, out[1] + offset, out[2] + offset, count);
+
+				for (size_t i = offset; i < offset + count; ++i)
+				{
+					Vector3 v(in[0][i], in[1][i], in[2][i]);
+					if (point)
+						v.Transform(mat);
+					else
+						v.TransformAsVector(mat);
+					EXPECT_NEAR(v.GetX(), out[0][i], 0.001f);
+					EXPECT_NEAR(v.GetY(), out[1][i], 0.001f);
+					EXPECT_NEAR(v.GetZ(), out[2][i], 0.001f);
+				}
+				// Nothing past the end is written
+				EXPECT_EQ(0.0f, out[0][offset + count]);
+			}
+		}
+	}
+}
+
+TEST(Stream, TransformAoS)
+{
+	Matrix4 mat;
+	mat.CreateRotationZ(0.3f);
+	mat.setTranslate(5.0f, 0.0f, -1.0f);
+
+	struct Vertex
+	{
+		Vector3 m_pos;
+		Vector3 m_norm;
+	};
+	Vertex vertices[11];
+	for (int i = 0; i < 11; ++i)
+	{
+		vertices[i].m_pos = Vector3((float) i, 1.0f, -2.0f * i);
+		vertices[i].m_norm = Vector3(0.0f, 1.0f, 0.0f);
+	}
+
+	// Positions in place, normals into a packed array
+	Vector3 normals[11];
+	TransformPoints(mat, &vertices[0].m_pos, sizeof(Vertex), &vertices[0].m_pos, sizeof(Vertex), 11);
+	TransformVectors(mat, &vertices[0].m_norm, sizeof(Vertex), normals, sizeof(Vector3), 11);
+
+	for (int i = 0; i < 11; ++i)
+	{
+		Vector3 pos((float) i, 1.0f, -2.0f * i);
+		pos.Transform(mat);
+		EXPECT_NEAR(pos.GetX(), vertices[i].m_pos.GetX(), 0.001f);
+		EXPECT_NEAR(pos.GetY(), vertices[i].m_pos.GetY(), 0.001f);
+		EXPECT_NEAR(pos.GetZ(), vertices[i].m_pos.GetZ(), 0.001f);
+		EXPECT_NEAR(-sinf(0.3f), normals[i].GetX(), 0.001f);
+		EXPECT_NEAR(cosf(0.3f), normals[i].GetY(), 0.001f);
+		EXPECT_NEAR(0.0f, normals[i].GetZ(), 0.001f);
+		// The untouched normals keep their values
+		EXPECT_EQ(1.0f, vertices[i].m_norm.GetY());
+	}
+}
+
+TEST(Matrix, Invert)
+{
+	Matrix4 mat;
+	mat.CreateRotationX(0.4f);
+	Matrix4 other;
+	other.CreatePerspectiveFOV(0.785398163f, 1.5f, 1.0f, 1000.0f);
+	mat.Multiply(other);
+	mat.setTranslate(3.0f, -1.0f, 2.0f);
+
+	Matrix4 inverse = mat;
+	EXPECT_TRUE(inverse.Invert());
+	inverse.Multiply(mat);
+	float m[4][4];
+	inverse.Get(m);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			EXPECT_NEAR(i == j ? 1.0f : 0.0f, m[i][j], 0.0001f);
+		}
+	}
+
+	// A singular matrix is left alone
+	Matrix4 singular;
+	singular.CreateScale(0.0f);
+	EXPECT_FALSE(singular.Invert());
+	singular.Get(m);
+	EXPECT_EQ(1.0f, m[3][3]);
+}
+
+TEST(Quaternion, MatrixConversion)
+{
+	Vector3 axis(1.0f, -2.0f, 0.5f);
+	Quat q(axis, 2.5f);
+	Matrix4 mat;
+	mat.CreateRotationFromQuaternion(q);
+
+	// Rotating by the matrix and by the quaternion agree
+	Vector3 v1(0.3f, 1.0f, -4.0f);
+	Vector3 v2 = v1;
+	v1.Transform(mat);
+	v2.Rotate(q);
+	EXPECT_NEAR(v1.GetX(), v2.GetX(), 0.0001f);
+	EXPECT_NEAR(v1.GetY(), v2.GetY(), 0.0001f);
+	EXPECT_NEAR(v1.GetZ(), v2.GetZ(), 0.0001f);
+
+	// The same as the rotation matrices about the axes
+	Quat qz;
+	qz.CreateRotationZ(0.6f);
+	Matrix4 rz;
+	rz.CreateRotationZ(0.6f);
+	mat.CreateRotationFromQuaternion(qz);
+	float a[4][4], b[4][4];
+	mat.Get(a);
+	rz.Get(b);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			EXPECT_NEAR(b[i][j], a[i][j], 0.0001f);
+		}
+	}
+
+	// Back to a quaternion from every branch, q and -q are the same rotation
+	float angles[4] = { 0.3f, 2.9f, -3.0f, 3.1f };
+	Vector3 axes[4] = { Vector3(0.0f, 1.0f, 0.0f), Vector3(1.0f, 0.1f, 0.0f), Vector3(0.1f, 1.0f, 0.2f), Vector3(0.0f, 0.2f, 1.0f) };
+	for (int i = 0; i < 4; ++i)
+	{
+		Quat expected(axes[i], angles[i]);
+		mat.CreateRotationFromQuaternion(expected);
+		Quat result;
+		result.CreateFromMatrix(mat);
+		EXPECT_NEAR(1.0f, fabsf(result.Dot(expected)), 0.001f);
+	}
+}
+
+TEST(Quaternion, Interpolation)
+{
+	Quat a;
+	a.CreateRotationY(0.0f);
+	Quat b;
+	b.CreateRotationY(1.2f);
+	Quat half;
+	half.CreateRotationY(0.6f);
+	Quat quarter;
+	quarter.CreateRotationY(0.3f);
+
+	EXPECT_NEAR(1.0f, Slerp(a, b, 0.5f).Dot(half), 0.0001f);
+	EXPECT_NEAR(1.0f, Slerp(a, b, 0.25f).Dot(quarter), 0.0001f);
+	EXPECT_NEAR(1.0f, Nlerp(a, b, 0.5f).Dot(half), 0.0001f);
+	EXPECT_NEAR(1.0f, Slerp(a, b, 1.0f).Dot(b), 0.0001f);
+
+	// -b is the same rotation, both take the shorter arc
+	Quat negB(-b.GetX(), -b.GetY(), -b.GetZ(), -b.GetW());
+	EXPECT_NEAR(1.0f, Slerp(a, negB, 0.5f).Dot(half), 0.0001f);
+	EXPECT_NEAR(1.0f, Nlerp(a, negB, 0.5f).Dot(half), 0.0001f);
+}
+
+TEST(Transform, AffineInverse)
+{
+	Vector3 axis(0.0f, 1.0f, 1.0f);
+	// The axis is normalized with the approximate reciprocal square root
+	Quat rotation(axis, 0.8f);
+	SIMDAffine rigid(Vector3(1.0f, 2.0f, 3.0f), rotation, Vector3(1.0f, 1.0f, 1.0f));
+	SIMDAffine scaled(Vector3(-4.0f, 0.0f, 2.0f), rotation, Vector3(2.0f, 0.5f, 3.0f));
+
+	Vector3 point(5.0f, -1.0f, 0.5f);
+	Vector3 result = point;
+	SIMDAffine inverse = rigid;
+	inverse.InvertRigid();
+	rigid.TransformPoint(result);
+	inverse.TransformPoint(result);
+	EXPECT_NEAR(point.GetX(), result.GetX(), 0.001f);
+	EXPECT_NEAR(point.GetY(), result.GetY(), 0.001f);
+	EXPECT_NEAR(point.GetZ(), result.GetZ(), 0.001f);
+
+	inverse = scaled;
+	EXPECT_TRUE(inverse.Invert());
+	inverse.Multiply(scaled);
+	result = point;
+	inverse.TransformPoint(result);
+	EXPECT_NEAR(point.GetX(), result.GetX(), 0.001f);
+	EXPECT_NEAR(point.GetY(), result.GetY(), 0.001f);
+	EXPECT_NEAR(point.GetZ(), result.GetZ(), 0.001f);
+
+	// The same as the general 4x4 inverse
+	Matrix4 mat = scaled.ToMatrix4();
+	mat.Invert();
+	inverse = scaled;
+	inverse.Invert();
+	float a[4][4], b[4][4];
+	mat.Get(a);
+	inverse.ToMatrix4().Get(b);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			EXPECT_NEAR(a[i][j], b[i][j], 0.001f);
+		}
+	}
+}
+
+TEST(Transform, Decompose)
+{
+	Vector3 axis(1.0f, 1.0f, 0.0f);
+	Quat rotation(axis, -1.3f);
+	SIMDAffine affine(Vector3(7.0f, -2.0f, 1.0f), rotation, Vector3(2.0f, 3.0f, 0.5f));
+
+	Vector3 translation, scale;
+	Quat decomposedRotation;
+	EXPECT_TRUE(affine.Decompose(translation, decomposedRotation, scale));
+	EXPECT_NEAR(7.0f, translation.GetX(), 0.001f);
+	EXPECT_NEAR(1.0f, translation.GetZ(), 0.001f);
+	EXPECT_NEAR(2.0f, scale.GetX(), 0.001f);
+	EXPECT_NEAR(3.0f, scale.GetY(), 0.001f);
+	EXPECT_NEAR(0.5f, scale.GetZ(), 0.001f);
+	EXPECT_NEAR(1.0f, fabsf(decomposedRotation.Dot(rotation)), 0.001f);
+
+	// A mirror comes back as a negative x scale
+	SIMDAffine mirror(Vector3(0.0f, 0.0f, 0.0f), rotation, Vector3(-1.0f, 1.0f, 1.0f));
+	EXPECT_TRUE(mirror.Decompose(translation, decomposedRotation, scale));
+	EXPECT_NEAR(-1.0f, scale.GetX(), 0.001f);
+	EXPECT_NEAR(1.0f, fabsf(decomposedRotation.Dot(rotation)), 0.001f);
+}
+
+TEST(Transform, ComposeAndInvert)
+{
+	Vector3 axisA(0.0f, 0.0f, 1.0f);
+	Vector3 axisB(1.0f, 0.0f, 0.0f);
+	SIMDTransform a(Vector3(1.0f, 0.0f, 0.0f), Quat(axisA, 0.5f), Vector3(2.0f, 2.0f, 2.0f));
+	SIMDTransform b(Vector3(0.0f, 3.0f, -1.0f), Quat(axisB, -0.7f), Vector3(1.5f, 1.5f, 1.5f));
+
+	// Composition matches the product of the matrices
+	SIMDTransform ab = a;
+	ab.Multiply(b);
+	Matrix4 mat = a.ToMatrix4();
+	mat.Multiply(b.ToMatrix4());
+	Vector3 p1(0.2f, -0.4f, 1.0f);
+	Vector3 p2 = p1;
+	ab.TransformPoint(p1);
+	p2.Transform(mat);
+	EXPECT_NEAR(p2.GetX(), p1.GetX(), 0.0001f);
+	EXPECT_NEAR(p2.GetY(), p1.GetY(), 0.0001f);
+	EXPECT_NEAR(p2.GetZ(), p1.GetZ(), 0.0001f);
+
+	// The inverse undoes it
+	SIMDTransform inverse = ab;
+	inverse.Invert();
+	inverse.TransformPoint(p1);
+	EXPECT_NEAR(0.2f, p1.GetX(), 0.0001f);
+	EXPECT_NEAR(-0.4f, p1.GetY(), 0.0001f);
+	EXPECT_NEAR(1.0f, p1.GetZ(), 0.0001f);
+
+	// Interpolating the transforms interpolates translation and scale
+	SIMDTransform middle = Lerp(a, b, 0.5f);
+	EXPECT_NEAR(0.5f, middle.GetTranslation().GetX(), 0.0001f);
+	EXPECT_NEAR(1.75f, middle.GetScale().GetY(), 0.0001f);
+	EXPECT_NEAR(1.0f, middle.GetRotation().Dot(Slerp(a.GetRotation(), b.GetRotation(), 0.5f)), 0.0001f);
+}
+
+// The frustum of the projection in MeshData with the camera at eye looking along +z
+SIMDFrustum makeTestFrustum(const Vector3& eye)
+{
+	Matrix4 view;
+	Vector3 at = eye + Vector3(0.0f, 0.0f, 1.0f);
+	view.CreateLookAt(eye, at, Vector3(0.0f, 1.0f, 0.0f));
+	Matrix4 viewProjection;
+	viewProjection.CreatePerspectiveFOV(0.785398163f, 1042.0f / 768.0f, 1.0f, 1000.0f);
+	viewProjection.Multiply(view);
+	return SIMDFrustum(viewProjection);
+}
+
+TEST(Frustum, Extract)
+{
+	SIMDFrustum frustum = makeTestFrustum(Vector3(0.0f, 0.0f, 0.0f));
+	Vector3 nearPlane = frustum.GetPlane(SIMDFrustum::NEAR_PLANE);
+	EXPECT_NEAR(1.0f, nearPlane.GetZ(), 0.0001f);
+	EXPECT_NEAR(-1.0f, nearPlane.GetW(), 0.0001f);
+	Vector3 farPlane = frustum.GetPlane(SIMDFrustum::FAR_PLANE);
+	EXPECT_NEAR(-1.0f, farPlane.GetZ(), 0.0001f);
+	EXPECT_NEAR(1000.0f, farPlane.GetW(), 0.01f);
+	// The side planes go through the eye at half the field of view
+	Vector3 topPlane = frustum.GetPlane(SIMDFrustum::TOP);
+	EXPECT_NEAR(0.0f, topPlane.GetW(), 0.0001f);
+	EXPECT_NEAR(-cosf(0.785398163f / 2.0f), topPlane.GetY(), 0.0001f);
+
+	EXPECT_EQ(SIMDFrustum::INSIDE, frustum.ClassifySphere(Vector3(0.0f, 0.0f, 10.0f), 1.0f));
+	EXPECT_EQ(SIMDFrustum::INSIDE, frustum.ClassifySphere(Vector3(0.0f, 0.0f, 500.0f), 50.0f));
+	EXPECT_EQ(SIMDFrustum::OUTSIDE, frustum.ClassifySphere(Vector3(0.0f, 0.0f, -10.0f), 1.0f));
+	EXPECT_EQ(SIMDFrustum::OUTSIDE, frustum.ClassifySphere(Vector3(0.0f, 0.0f, 1100.0f), 50.0f));
+	EXPECT_EQ(SIMDFrustum::OUTSIDE, frustum.ClassifySphere(Vector3(-100.0f, 0.0f, 10.0f), 1.0f));
+	EXPECT_EQ(SIMDFrustum::INTERSECT, frustum.ClassifySphere(Vector3(0.0f, 0.0f, 1.0f), 0.5f));
+	EXPECT_EQ(SIMDFrustum::INTERSECT, frustum.ClassifySphere(Vector3(0.0f, 4.14f, 10.0f), 0.5f));
+
+	EXPECT_EQ(SIMDFrustum::INSIDE, frustum.ClassifyAABB(Vector3(-1.0f, -1.0f, 9.0f), Vector3(1.0f, 1.0f, 11.0f)));
+	EXPECT_EQ(SIMDFrustum::INTERSECT, frustum.ClassifyAABB(Vector3(-1.0f, -1.0f, -1.0f), Vector3(1.0f, 1.0f, 11.0f)));
+	EXPECT_EQ(SIMDFrustum::OUTSIDE, frustum.ClassifyAABB(Vector3(-1.0f, 10.0f, 9.0f), Vector3(1.0f, 12.0f, 11.0f)));
+
+	// Moving the camera moves the frustum
+	frustum = makeTestFrustum(Vector3(100.0f, 0.0f, 0.0f));
+	EXPECT_EQ(SIMDFrustum::OUTSIDE, frustum.ClassifySphere(Vector3(0.0f, 0.0f, 10.0f), 1.0f));
+	EXPECT_EQ(SIMDFrustum::INSIDE, frustum.ClassifySphere(Vector3(100.0f, 0.0f, 10.0f), 1.0f));
+}
+
+TEST(Frustum, BatchesMatchClassify)
+{
+	SIMDFrustum frustum = makeTestFrustum(Vector3(0.0f, 2.0f, -5.0f));
+
+	SIMD_ALIGN(32) float x[8] = { 0.0f, 0.0f, -100.0f, 3.0f, 0.0f, 40.0f, -6.0f, 0.0f };
+	SIMD_ALIGN(32) float y[8] = { 2.0f, 2.0f, 2.0f, 6.5f, -50.0f, 2.0f, 0.0f, 2.0f };
+	SIMD_ALIGN(32) float z[8] = { 10.0f, -20.0f, 10.0f, 5.0f, 100.0f, 60.0f, 8.0f, 1200.0f };
+	SIMD_ALIGN(32) float r[8] = { 1.0f, 2.0f, 1.0f, 1.5f, 10.0f, 20.0f, 0.5f, 150.0f };
+
+	SIMD_ALIGN(32) float minX[8], minY[8], minZ[8], maxX[8], maxY[8], maxZ[8];
+	int expectedSpheres = 0, expectedSpheresInside = 0, expectedAABBs = 0, expectedAABBsInside = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		minX[i] = x[i] - r[i]; minY[i] = y[i] - 0.5f * r[i]; minZ[i] = z[i] - r[i];
+		maxX[i] = x[i] + r[i]; maxY[i] = y[i] + 0.5f * r[i]; maxZ[i] = z[i] + r[i];
+
+		SIMDFrustum::Containment sphere = frustum.ClassifySphere(Vector3(x[i], y[i], z[i]), r[i]);
+		expectedSpheres |= sphere != SIMDFrustum::OUTSIDE ? 1 << i : 0;
+		expectedSpheresInside |= sphere == SIMDFrustum::INSIDE ? 1 << i : 0;
+		SIMDFrustum::Containment aabb = frustum.ClassifyAABB(Vector3(minX[i], minY[i], minZ[i]), Vector3(maxX[i], maxY[i], maxZ[i]));
+		expectedAABBs |= aabb != SIMDFrustum::OUTSIDE ? 1 << i : 0;
+		expectedAABBsInside |= aabb == SIMDFrustum::INSIDE ? 1 << i : 0;
+	}
+	// Every case is covered
+	EXPECT_NE(0, expectedSpheresInside);
+	EXPECT_NE(expectedSpheres, expectedSpheresInside);
+	EXPECT_NE(0xFF, expectedSpheres);
+
+	int inside = 0;
+	EXPECT_EQ(expectedSpheres, frustum.TestSpheres(SIMDVector3x8::Load(x, y, z), SIMDBackend8::Load(r), &inside));
+	EXPECT_EQ(expectedSpheresInside, inside);
+	EXPECT_EQ(expectedAABBs, frustum.TestAABBs(SIMDVector3x8::Load(minX, minY, minZ), SIMDVector3x8::Load(maxX, maxY, maxZ), &inside));
+	EXPECT_EQ(expectedAABBsInside, inside);
+
+	for (int half = 0; half < 8; half += 4)
+	{
+		EXPECT_EQ((expectedSpheres >> half) & 0xF, frustum.TestSpheres(SIMDVector3x4::Load(x + half, y + half, z + half),
+			SIMDBackend::Load(r + half), &inside));
+		EXPECT_EQ((expectedSpheresInside >> half) & 0xF, inside);
+		EXPECT_EQ((expectedAABBs >> half) & 0xF, frustum.TestAABBs(SIMDVector3x4::Load(minX + half, minY + half, minZ + half),
+			SIMDVector3x4::Load(maxX + half, maxY + half, maxZ + half), &inside));
+		EXPECT_EQ((expectedAABBsInside >> half) & 0xF, inside);
+	}
+}
+
+// Position and texture coordinate, as in Vertex1P1UV
+struct BoundsTestVertex
+{
+	Vector3 m_pos;
+	float m_UV[2];
+};
+
+// Points of a box of half extents (3, 1, 0.5) turned about z and y and moved to (5, -2, 1)
+std::vector<BoundsTestVertex> makeBoundsTestVertices(int count)
+{
+	Matrix4 rotation, rotationY;
+	rotation.CreateRotationZ(0.6f);
+	rotationY.CreateRotationY(0.3f);
+	rotation.Multiply(rotationY);
+
+	std::vector<BoundsTestVertex> vertices(count);
+	for (int i = 0; i < count; ++i)
+	{
+		// The corners first, then points spread through the box
+		float x = i < 8 ? (i & 1 ? 3.0f : -3.0f) : 3.0f * sinf(i * 1.7f);
+		float y = i < 8 ? (i & 2 ? 1.0f : -1.0f) : cosf(i * 2.3f);
+		float z = i < 8 ? (i & 4 ? 0.5f : -0.5f) : 0.5f * sinf(i * 0.9f + 1.0f);
+		vertices[i].m_pos = Vector3(x, y, z);
+		vertices[i].m_pos.Transform(rotation);
+		vertices[i].m_pos += Vector3(5.0f, -2.0f, 1.0f, 0.0f);
+		vertices[i].m_UV[0] = vertices[i].m_UV[1] = (float) i;
+	}
+	return vertices;
+}
+
+TEST(Bounds, AABB)
+{
+	for (int count = 1; count <= 21; count += 5)
+	{
+		std::vector<BoundsTestVertex> vertices = makeBoundsTestVertices(count);
+		Vector3 min, max;
+		ComputeAABB(&vertices[0].m_pos, sizeof(BoundsTestVertex), count, min, max);
+
+		float expectedMin[3] = { vertices[0].m_pos.GetX(), vertices[0].m_pos.GetY(), vertices[0].m_pos.GetZ() };
+		float expectedMax[3] = { expectedMin[0], expectedMin[1], expectedMin[2] };
+		for (int i = 1; i < count; ++i)
+		{
+			float p[3] = { vertices[i].m_pos.GetX(), vertices[i].m_pos.GetY(), vertices[i].m_pos.GetZ() };
+			for (int j = 0; j < 3; ++j)
+			{
+				expectedMin[j] = std::min(expectedMin[j], p[j]);
+				expectedMax[j] = std::max(expectedMax[j], p[j]);
+			}
+		}
+		EXPECT_EQ(expectedMin[0], min.GetX());
+		EXPECT_EQ(expectedMin[1], min.GetY());
+		EXPECT_EQ(expectedMin[2], min.GetZ());
+		EXPECT_EQ(expectedMax[0], max.GetX());
+		EXPECT_EQ(expectedMax[1], max.GetY());
+		EXPECT_EQ(expectedMax[2], max.GetZ());
+	}
+}
+
+TEST(Bounds, Sphere)
+{
+	// Points on a unit sphere about (1, 2, 3), the smallest sphere around them is the sphere itself
+	std::vector<Vector3> points;
+	for (int i = 0; i < 12; ++i)
+	{
+		for (int j = 0; j <= 12; ++j)
+		{
+			float theta = i * 0.5235988f;
+			float phi = j * 0.2617994f;
+			points.push_back(Vector3(1.0f + sinf(phi) * cosf(theta), 2.0f + sinf(phi) * sinf(theta), 3.0f + cosf(phi)));
+		}
+	}
+	Vector3 center;
+	float radius;
+	ComputeBoundingSphere(&points[0], sizeof(Vector3), points.size(), center, radius);
+	EXPECT_NEAR(1.0f, radius, 0.05f);
+	EXPECT_NEAR(3.0f, center.GetZ(), 0.05f);
+
+	std::vector<BoundsTestVertex> vertices = makeBoundsTestVertices(37);
+	ComputeBoundingSphere(&vertices[0].m_pos, sizeof(BoundsTestVertex), vertices.size(), center, radius);
+	// Every point is inside, the half diagonal of the box is the smallest radius possible
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		EXPECT_LE((vertices[i].m_pos - center).Length(), radius * 1.000001f);
+	}
+	EXPECT_LT(radius, sqrtf(9.0f + 1.0f + 0.25f) * 1.05f);
+
+	// One point
+	ComputeBoundingSphere(&vertices[0].m_pos, sizeof(BoundsTestVertex), 1, center, radius);
+	EXPECT_EQ(0.0f, radius);
+	EXPECT_EQ(vertices[0].m_pos.GetX(), center.GetX());
+}
+
+TEST(Bounds, OrientedBox)
+{
+	std::vector<BoundsTestVertex> vertices = makeBoundsTestVertices(200);
+	SIMDBounds bounds;
+	ComputeBounds(&vertices[0].m_pos, sizeof(BoundsTestVertex), vertices.size(), bounds);
+
+	// Close to the box of the points, whichever way its axes point, the principal axes of the points are not quite its axes
+	float halfExtents[3] = { bounds.m_boxHalfExtents.GetX(), bounds.m_boxHalfExtents.GetY(), bounds.m_boxHalfExtents.GetZ() };
+	std::sort(halfExtents, halfExtents + 3);
+	EXPECT_NEAR(0.5f, halfExtents[0], 0.05f);
+	EXPECT_NEAR(1.0f, halfExtents[1], 0.05f);
+	EXPECT_NEAR(3.0f, halfExtents[2], 0.05f);
+	EXPECT_NEAR(5.0f, bounds.m_boxCenter.GetX(), 0.05f);
+	EXPECT_NEAR(-2.0f, bounds.m_boxCenter.GetY(), 0.05f);
+	EXPECT_NEAR(1.0f, bounds.m_boxCenter.GetZ(), 0.05f);
+
+	// The axes are orthonormal and right-handed
+	EXPECT_NEAR(0.0f, bounds.m_boxAxes[0].Dot(bounds.m_boxAxes[1]), 0.0001f);
+	EXPECT_NEAR(0.0f, bounds.m_boxAxes[0].Dot(bounds.m_boxAxes[2]), 0.0001f);
+	EXPECT_NEAR(1.0f, bounds.m_boxAxes[1].LengthSquared(), 0.0001f);
+	EXPECT_NEAR(1.0f, CrossProduct(bounds.m_boxAxes[0], bounds.m_boxAxes[1]).Dot(bounds.m_boxAxes[2]), 0.0001f);
+
+	// Every point is inside the box, which is smaller than the AABB
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		Vector3 offset = vertices[i].m_pos - bounds.m_boxCenter;
+		EXPECT_LE(fabsf(offset.Dot(bounds.m_boxAxes[0])), bounds.m_boxHalfExtents.GetX() + 0.0001f);
+		EXPECT_LE(fabsf(offset.Dot(bounds.m_boxAxes[1])), bounds.m_boxHalfExtents.GetY() + 0.0001f);
+		EXPECT_LE(fabsf(offset.Dot(bounds.m_boxAxes[2])), bounds.m_boxHalfExtents.GetZ() + 0.0001f);
+	}
+	Vector3 size = bounds.m_max - bounds.m_min;
+	EXPECT_LT(8.0f * halfExtents[0] * halfExtents[1] * halfExtents[2], size.GetX() * size.GetY() * size.GetZ());
+
+	// The AABB is kept for points along the axes
+	BoundsTestVertex box[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		box[i].m_pos = Vector3(i & 1 ? 2.0f : 0.0f, i & 2 ? 1.0f : 0.0f, i & 4 ? 3.0f : 0.0f);
+	}
+	ComputeBounds(&box[0].m_pos, sizeof(BoundsTestVertex), 8, bounds);
+	EXPECT_EQ(1.0f, bounds.m_boxAxes[0].GetX());
+	EXPECT_EQ(1.0f, bounds.m_boxHalfExtents.GetX());
+	EXPECT_EQ(1.5f, bounds.m_boxCenter.GetZ());
+
+	// No points
+	ComputeBounds(&box[0].m_pos, sizeof(BoundsTestVertex), 0, bounds);
+	EXPECT_EQ(0.0f, bounds.m_radius);
+	EXPECT_EQ(0.0f, bounds.m_max.GetX());
+}
+
+// Position and normal, as in Vertex1P1N
+struct QuantizeTestVertex
+{
+	Vector3 m_pos;
+	Vector3 m_normal;
+};
+
+// Directions spread over the sphere, as the normals of a vertex buffer
+std::vector<QuantizeTestVertex> makeQuantizeTestNormals(int count)
+{
+	std::vector<QuantizeTestVertex> vertices(count);
+	for (int i = 0; i < count; ++i)
+	{
+		float z = 1.0f - 2.0f * (i + 0.5f) / count;
+		float r = sqrtf(1.0f - z * z);
+		vertices[i].m_pos = Vector3((float) i, 0.0f, 0.0f);
+		vertices[i].m_normal = Vector3(r * cosf(i * 2.4f), r * sinf(i * 2.4f), z, 0.0f);
+	}
+	// The axes and a diagonal
+	vertices[0].m_normal = Vector3(0.0f, 0.0f, -1.0f, 0.0f);
+	vertices[1].m_normal = Vector3(1.0f, 0.0f, 0.0f, 0.0f);
+	vertices[2].m_normal = Vector3(-0.57735f, 0.57735f, -0.57735f, 0.0f);
+	return vertices;
+}
+
+TEST(Quantize, Sizes)
+{
+	EXPECT_EQ(6u, sizeof(SIMDHalf3));
+	EXPECT_EQ(6u, sizeof(SIMDSnorm16x3));
+	EXPECT_EQ(4u, sizeof(SIMDOctNormal));
+	EXPECT_EQ(4u, sizeof(SIMDPacked1010102));
+	EXPECT_EQ(4u, sizeof(SIMDPackedQuaternion));
+}
+
+TEST(Quantize, Half3)
+{
+	Vector3 in[11] = {
+		Vector3(1.0f, -2.5f, 0.0f), Vector3(0.1f, 3.14159f, -1000.0f), Vector3(65504.0f, -65504.0f, 1e5f),
+		Vector3(6.1035156e-5f, 5.9604645e-8f, 1e-9f), Vector3(1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f, 2049.0f),
+		Vector3(-0.0f, 0.333f, 12.75f), Vector3(7.0f, 8.0f, 9.0f), Vector3(-10.0f, 11.0f, -12.0f),
+		Vector3(1e-3f, 1e-4f, 1e-5f), Vector3(100.5f, 200.25f, 300.125f), Vector3(-1e6f, 2.0e-6f, 0.5f)
+	};
+	SIMDHalf3 packed[11];
+	Vector3 out[11];
+	PackHalf3(in, sizeof(Vector3), packed, 11);
+	UnpackHalf3(packed, out, sizeof(Vector3), 11);
+
+	for (int i = 0; i < 11; ++i)
+	{
+		float expected[3] = { in[i].GetX(), in[i].GetY(), in[i].GetZ() };
+		float actual[3] = { out[i].GetX(), out[i].GetY(), out[i].GetZ() };
+		for (int j = 0; j < 3; ++j)
+		{
+			if (fabsf(expected[j]) > 65520.0f)
+				EXPECT_EQ(expected[j] > 0.0f ? INFINITY : -INFINITY, actual[j]);
+			else
+				EXPECT_NEAR(expected[j], actual[j], std::max(fabsf(expected[j]) / 2048.0f, 2.98e-8f));
+		}
+		EXPECT_EQ(1.0f, out[i].GetW());
+	}
+
+	// Exact values stay exact and halfway cases round to even
+	EXPECT_EQ(0x3C00, packed[0].m_x);
+	EXPECT_EQ(0x7BFF, packed[2].m_x);
+	EXPECT_EQ(0x0400, packed[3].m_x);
+	EXPECT_EQ(0x0001, packed[3].m_y);
+	EXPECT_EQ(0x0000, packed[3].m_z);
+	EXPECT_EQ(0x3C00, packed[4].m_x);
+	EXPECT_EQ(0x3C02, packed[4].m_y);
+	EXPECT_EQ(0x6800, packed[4].m_z);
+	EXPECT_EQ(0x8000, packed[5].m_x);
+	EXPECT_EQ(12.75f, out[5].GetZ());
+}
+
+TEST(Quantize, Snorm16And1010102)
+{
+	std::vector<QuantizeTestVertex> vertices = makeQuantizeTestNormals(21);
+	vertices[3].m_normal = Vector3(2.0f, -3.0f, 0.5f, -1.0f);
+
+	std::vector<SIMDSnorm16x3> snorm(vertices.size());
+	std::vector<SIMDPacked1010102> packed(vertices.size());
+	std::vector<Vector3> out(vertices.size());
+	PackSnorm16(&vertices[0].m_normal, sizeof(QuantizeTestVertex), &snorm[0], vertices.size());
+	UnpackSnorm16(&snorm[0], &out[0], sizeof(Vector3), vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		Vector3 expected = vertices[i].m_normal;
+		EXPECT_NEAR(std::min(std::max(expected.GetX(), -1.0f), 1.0f), out[i].GetX(), 0.5f / 32767.0f);
+		EXPECT_NEAR(std::min(std::max(expected.GetY(), -1.0f), 1.0f), out[i].GetY(), 0.5f / 32767.0f);
+		EXPECT_NEAR(expected.GetZ(), out[i].GetZ(), 0.5f / 32767.0f);
+		EXPECT_EQ(0.0f, out[i].GetW());
+	}
+	EXPECT_EQ(32767, snorm[3].m_x);
+	EXPECT_EQ(-32767, snorm[3].m_y);
+
+	Pack1010102(&vertices[0].m_normal, sizeof(QuantizeTestVertex), &packed[0], vertices.size());
+	Unpack1010102(&packed[0], &out[0], sizeof(Vector3), vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		Vector3 expected = vertices[i].m_normal;
+		EXPECT_NEAR(std::min(std::max(expected.GetX(), -1.0f), 1.0f), out[i].GetX(), 1.0f / 1023.0f);
+		EXPECT_NEAR(std::min(std::max(expected.GetY(), -1.0f), 1.0f), out[i].GetY(), 1.0f / 1023.0f);
+		EXPECT_NEAR(expected.GetZ(), out[i].GetZ(), 1.0f / 1023.0f);
+	}
+	// w of a direction is 0, between the nearest two levels
+	EXPECT_NEAR(1.0f / 3.0f, fabsf(out[0].GetW()), 0.0001f);
+	EXPECT_EQ(-1.0f, out[3].GetW());
+	EXPECT_EQ(0x3FFu, packed[3].m_value & 0x3FF);
+	EXPECT_EQ(0u, packed[3].m_value >> 30);
+}
+
+TEST(Quantize, OctNormals)
+{
+	std::vector<QuantizeTestVertex> vertices = makeQuantizeTestNormals(203);
+	vertices[5].m_normal = Vector3(0.0f, 0.0f, 3.0f, 0.0f);
+
+	std::vector<SIMDOctNormal> packed(vertices.size());
+	std::vector<QuantizeTestVertex> out(vertices.size());
+	PackOctNormals(&vertices[0].m_normal, sizeof(QuantizeTestVertex), &packed[0], vertices.size());
+	UnpackOctNormals(&packed[0], &out[0].m_normal, sizeof(QuantizeTestVertex), vertices.size());
+
+	float maxAngle = 0.0f;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		Vector3 expected = vertices[i].m_normal;
+		expected = expected * (1.0f / expected.Length());
+		Vector3 actual = out[i].m_normal;
+		EXPECT_NEAR(1.0f, actual.LengthSquared(), 0.000001f);
+		maxAngle = std::max(maxAngle, CrossProduct(expected, actual).Length());
+		EXPECT_EQ(0.0f, actual.GetW());
+	}
+	EXPECT_LT(maxAngle, 0.0001f);
+	EXPECT_EQ(1.0f, out[5].m_normal.GetZ());
+}
+
+TEST(Quantize, Quaternions)
+{
+	const int count = 101;
+	std::vector<float> x(count), y(count), z(count);
+	for (int i = 0; i < count; ++i)
+	{
+		x[i] = sinf(i * 1.3f) * 3.0f;
+		y[i] = cosf(i * 0.7f) * 3.0f;
+		z[i] = sinf(i * 2.9f + 0.5f) * 3.0f;
+	}
+	std::vector<SIMDQuaternion> in(count), out(count);
+	CreateQuaternionsFromEuler(&x[0], &y[0], &z[0], &in[0], count);
+	in[0] = SIMDQuaternion(0.0f, 0.0f, 0.0f, 1.0f);
+	in[1] = SIMDQuaternion(0.0f, -1.0f, 0.0f, 0.0f);
+	in[2] = SIMDQuaternion(0.5f, -0.5f, 0.5f, -0.5f);
+
+	std::vector<SIMDPackedQuaternion> packed(count);
+	PackQuaternions(&in[0], &packed[0], count);
+	UnpackQuaternions(&packed[0], &out[0], count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		// The same rotation, either sign
+		float sign = in[i].Dot(out[i]) < 0.0f ? -1.0f : 1.0f;
+		EXPECT_NEAR(in[i].GetX(), sign * out[i].GetX(), 0.0015f);
+		EXPECT_NEAR(in[i].GetY(), sign * out[i].GetY(), 0.0015f);
+		EXPECT_NEAR(in[i].GetZ(), sign * out[i].GetZ(), 0.0015f);
+		EXPECT_NEAR(in[i].GetW(), sign * out[i].GetW(), 0.0015f);
+		EXPECT_NEAR(1.0f, out[i].Dot(out[i]), 0.000001f);
+	}
+	EXPECT_EQ(1.0f, out[0].GetW());
+	EXPECT_EQ(1.0f, fabsf(out[1].GetY()));
+}
+
+// Conformance: randomized differential tests of the maths against a double precision reference
+// An error is in ULPs of the magnitude of the terms of the result, so cancellation is not counted against an operation,
+// e.g. the ULP of a dot product is that of |a.x * b.x| + |a.y * b.y| + |a.z * b.z|
+// The classes use SIMDBackend, build with SIMD_FORCE_SCALAR, SIMD_FORCE_SSE41 and for AVX2 to cover every backend
+
+// The spacing of floats at x
+double ulpOf(double x)
+{
+	int exponent;
+	frexp((float) fabs(x), &exponent);
+	return ldexp(1.0, std::max(exponent - 24, -149));
+}
+
+// Distribution of the errors of one operation
+class ULPErrors
+{
+public:
+	explicit ULPErrors(const char* name) : m_name(name), m_max(0.0), m_sum(0.0), m_count(0)
+	{
+		memset(m_buckets, 0, sizeof(m_buckets));
+	}
+
+	// Add one result, scale is the magnitude of its terms, NaN where the reference is not counts as infinitely wrong
+	void Add(float actual, double expected, double scale)
+	{
+		double error = actual == expected ? 0.0 : fabs(actual - expected) / ulpOf(std::max(fabs(expected), scale));
+		if (actual != actual)
+			error = expected != expected ? 0.0 : INFINITY;
+		m_max = std::max(m_max, error);
+		m_sum += error;
+		++m_count;
+		int bucket = 0;
+		while (bucket < BUCKET_COUNT - 1 && error > Limits()[bucket])
+		{
+			++bucket;
+		}
+		++m_buckets[bucket];
+	}
+
+	void Add(float actual, double expected)
+	{
+		Add(actual, expected, fabs(expected));
+	}
+
+	double Max() const
+	{
+		return m_max;
+	}
+
+	// Print the largest and mean error and the share of results within each limit
+	void Print(const char* backend) const
+	{
+		std::cout << backend << " " << m_name << ": max " << m_max << " ULP, mean " << m_sum / std::max(m_count, 1) << " ULP,";
+		for (int i = 0; i < BUCKET_COUNT; ++i)
+		{
+			std::cout << (i < BUCKET_COUNT - 1 ? " <=" : " >") << Limits()[std::min(i, BUCKET_COUNT - 2)] << ": ";
+			std::cout << 100.0 * m_buckets[i] / std::max(m_count, 1) << "%";
+		}
+		std::cout << "\n";
+	}
+
+private:
+	enum { BUCKET_COUNT = 7 };
+
+	static const double* Limits()
+	{
+		static const double limits[BUCKET_COUNT - 1] = { 0.0, 0.5, 1.0, 2.0, 4.0, 16.0 };
+		return limits;
+	}
+
+	const char* m_name;
+	double m_max;
+	double m_sum;
+	int m_count;
+	int m_buckets[BUCKET_COUNT];
+};
+
+// Values of random sign with exponents from -8 to 8, so the errors of every magnitude are seen
+class ConformanceRandom
+{
+public:
+	ConformanceRandom() : m_engine(20240601) {}
+
+	float Value()
+	{
+		float mantissa = std::uniform_real_distribution<float>(1.0f, 2.0f)(m_engine);
+		int exponent = std::uniform_int_distribution<int>(-8, 8)(m_engine);
+		return ldexpf(m_engine() & 1 ? mantissa : -mantissa, exponent);
+	}
+
+	float Unit()
+	{
+		return std::uniform_real_distribution<float>(-1.0f, 1.0f)(m_engine);
+	}
+
+	Vector3 Vector()
+	{
+		return Vector3(Value(), Value(), Value());
+	}
+
+	// A unit quaternion rounded to float
+	Quat Rotation()
+	{
+		double q[4], length = 0.0;
+		for (int i = 0; i < 4; ++i)
+		{
+			q[i] = Unit();
+			length += q[i] * q[i];
+		}
+		length = sqrt(std::max(length, 1e-6));
+		return Quat((float) (q[0] / length), (float) (q[1] / length), (float) (q[2] / length), (float) (q[3] / length));
+	}
+
+private:
+	std::mt19937 m_engine;
+};
+
+void getVector(const Vector3& v, double out[4])
+{
+	out[0] = v.GetX(); out[1] = v.GetY(); out[2] = v.GetZ(); out[3] = v.GetW();
+}
+
+void getQuat(const Quat& q, double out[4])
+{
+	out[0] = q.GetX(); out[1] = q.GetY(); out[2] = q.GetZ(); out[3] = q.GetW();
+}
+
+void addVector(ULPErrors& errors, const Vector3& actual, const double expected[3], const double scale[3])
+{
+	errors.Add(actual.GetX(), expected[0], scale[0]);
+	errors.Add(actual.GetY(), expected[1], scale[1]);
+	errors.Add(actual.GetZ(), expected[2], scale[2]);
+}
+
+void addQuat(ULPErrors& errors, const Quat& actual, const double expected[4], const double scale[4])
+{
+	errors.Add(actual.GetX(), expected[0], scale[0]);
+	errors.Add(actual.GetY(), expected[1], scale[1]);
+	errors.Add(actual.GetZ(), expected[2], scale[2]);
+	errors.Add(actual.GetW(), expected[3], scale[3]);
+}
+
+// a * b with the magnitude of the terms of each component, quaternions are x, y, z, w
+void referenceQuatMultiply(const double a[4], const double b[4], double out[4], double scale[4])
+{
+	out[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+	out[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+	out[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+	out[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	scale[0] = fabs(a[3] * b[0]) + fabs(a[0] * b[3]) + fabs(a[1] * b[2]) + fabs(a[2] * b[1]);
+	scale[1] = fabs(a[3] * b[1]) + fabs(a[0] * b[2]) + fabs(a[1] * b[3]) + fabs(a[2] * b[0]);
+	scale[2] = fabs(a[3] * b[2]) + fabs(a[0] * b[1]) + fabs(a[1] * b[0]) + fabs(a[2] * b[3]);
+	scale[3] = fabs(a[3] * b[3]) + fabs(a[0] * b[0]) + fabs(a[1] * b[1]) + fabs(a[2] * b[2]);
+}
+
+const int conformanceSamples = 20000;
+
+// Every operation of every backend, the approximate reciprocal square root is within 1.5 * 2^-12 relative on x86
+TYPED_TEST(SIMDBackendTest, Conformance)
+{
+	typedef typename TypeParam::Vec4 Vec4;
+	ULPErrors add("Add"), sub("Sub"), mul("Mul"), div("Div"), mulAdd("MulAdd"), sqrt4("Sqrt"), rsqrt("Rsqrt");
+	ULPErrors dot3("Dot3"), dot4("Dot4");
+
+	ConformanceRandom random;
+	for (int i = 0; i < conformanceSamples; ++i)
+	{
+		SIMD_ALIGN(16) float a[4], b[4], c[4], out[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			a[j] = random.Value(); b[j] = random.Value(); c[j] = random.Value();
+		}
+		Vec4 va = TypeParam::Load(a), vb = TypeParam::Load(b), vc = TypeParam::Load(c);
+
+		TypeParam::Store(out, TypeParam::Add(va, vb));
+		for (int j = 0; j < 4; ++j) add.Add(out[j], (double) a[j] + b[j]);
+		TypeParam::Store(out, TypeParam::Sub(va, vb));
+		for (int j = 0; j < 4; ++j) sub.Add(out[j], (double) a[j] - b[j]);
+		TypeParam::Store(out, TypeParam::Mul(va, vb));
+		for (int j = 0; j < 4; ++j) mul.Add(out[j], (double) a[j] * b[j]);
+		TypeParam::Store(out, TypeParam::Div(va, vb));
+		for (int j = 0; j < 4; ++j) div.Add(out[j], (double) a[j] / b[j]);
+		TypeParam::Store(out, TypeParam::MulAdd(va, vb, vc));
+		for (int j = 0; j < 4; ++j) mulAdd.Add(out[j], (double) a[j] * b[j] + c[j], fabs((double) a[j] * b[j]) + fabs(c[j]));
+		TypeParam::Store(out, TypeParam::Sqrt(TypeParam::Abs(va)));
+		for (int j = 0; j < 4; ++j) sqrt4.Add(out[j], sqrt(fabs((double) a[j])));
+		TypeParam::Store(out, TypeParam::Rsqrt(TypeParam::Abs(va)));
+		for (int j = 0; j < 4; ++j) rsqrt.Add(out[j], 1.0 / sqrt(fabs((double) a[j])));
+
+		double expected3 = 0.0, scale3 = 0.0;
+		for (int j = 0; j < 3; ++j)
+		{
+			expected3 += (double) a[j] * b[j];
+			scale3 += fabs((double) a[j] * b[j]);
+		}
+		double expected4 = expected3 + (double) a[3] * b[3];
+		double scale4 = scale3 + fabs((double) a[3] * b[3]);
+		TypeParam::Store(out, TypeParam::Dot3(va, vb));
+		for (int j = 0; j < 4; ++j) dot3.Add(out[j], expected3, scale3);
+		TypeParam::Store(out, TypeParam::Dot4(va, vb));
+		for (int j = 0; j < 4; ++j) dot4.Add(out[j], expected4, scale4);
+	}
+
+	// Correctly rounded
+	EXPECT_LE(add.Max(), 0.5);
+	EXPECT_LE(sub.Max(), 0.5);
+	EXPECT_LE(mul.Max(), 0.5);
+	EXPECT_LE(div.Max(), 0.5);
+	EXPECT_LE(sqrt4.Max(), 0.5);
+	// Fused or not
+	EXPECT_LE(mulAdd.Max(), 1.0);
+	// One rounding per term
+	EXPECT_LE(dot3.Max(), 3.0);
+	EXPECT_LE(dot4.Max(), 4.0);
+	EXPECT_LE(rsqrt.Max(), 6144.0);
+
+	const ULPErrors* all[] = { &add, &sub, &mul, &div, &mulAdd, &sqrt4, &rsqrt, &dot3, &dot4 };
+	for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+	{
+		all[i]->Print(TypeParam::Name());
+	}
+}
+
+TEST(Conformance, Vector)
+{
+	ULPErrors add("Vector3 +"), sub("Vector3 -"), mul("Vector3 * float"), dot("Vector3 Dot"), cross("CrossProduct");
+	ULPErrors length("Vector3 Length"), normalize("Vector3 Normalize"), lerp("Vector3 Lerp");
+	ULPErrors transform("Vector3 Transform"), transformVector("Vector3 TransformAsVector"), rotate("Vector3 Rotate");
+
+	ConformanceRandom random;
+	for (int i = 0; i < conformanceSamples; ++i)
+	{
+		Vector3 a = random.Vector(), b = random.Vector();
+		float s = random.Value();
+		double da[4], db[4], expected[3], scale[3];
+		getVector(a, da);
+		getVector(b, db);
+
+		for (int j = 0; j < 3; ++j) { expected[j] = da[j] + db[j]; scale[j] = fabs(expected[j]); }
+		addVector(add, a + b, expected, scale);
+		for (int j = 0; j < 3; ++j) { expected[j] = da[j] - db[j]; scale[j] = fabs(expected[j]); }
+		addVector(sub, a - b, expected, scale);
+		for (int j = 0; j < 3; ++j) { expected[j] = da[j] * s; scale[j] = fabs(expected[j]); }
+		addVector(mul, a * s, expected, scale);
+
+		double expectedDot = da[0] * db[0] + da[1] * db[1] + da[2] * db[2];
+		dot.Add(a.Dot(b), expectedDot, fabs(da[0] * db[0]) + fabs(da[1] * db[1]) + fabs(da[2] * db[2]));
+
+		expected[0] = da[1] * db[2] - da[2] * db[1];
+		expected[1] = da[2] * db[0] - da[0] * db[2];
+		expected[2] = da[0] * db[1] - da[1] * db[0];
+		scale[0] = fabs(da[1] * db[2]) + fabs(da[2] * db[1]);
+		scale[1] = fabs(da[2] * db[0]) + fabs(da[0] * db[2]);
+		scale[2] = fabs(da[0] * db[1]) + fabs(da[1] * db[0]);
+		addVector(cross, CrossProduct(a, b), expected, scale);
+
+		double expectedLength = sqrt(da[0] * da[0] + da[1] * da[1] + da[2] * da[2]);
+		length.Add(a.Length(), expectedLength);
+
+		// The components of a unit vector are measured against its length of 1
+		Vector3 unit = a;
+		unit.Normalize();
+		for (int j = 0; j < 3; ++j) { expected[j] = da[j] / expectedLength; scale[j] = 1.0; }
+		addVector(normalize, unit, expected, scale);
+
+		float t = random.Unit() * 0.5f + 0.5f;
+		for (int j = 0; j < 3; ++j)
+		{
+			expected[j] = da[j] * (1.0 - t) + db[j] * t;
+			scale[j] = fabs(da[j] * (1.0 - t)) + fabs(db[j] * t);
+		}
+		addVector(lerp, Lerp(a, b, t), expected, scale);
+
+		// An affine matrix, the rows are those of the column vector convention
+		float m[4][4];
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				m[r][c] = r < 3 ? random.Value() : (c == 3 ? 1.0f : 0.0f);
+			}
+		}
+		Matrix4 mat(m);
+		Vector3 point = a;
+		point.Transform(mat);
+		Vector3 vector = a;
+		vector.TransformAsVector(mat);
+		double expectedVector[3], scaleVector[3];
+		for (int r = 0; r < 3; ++r)
+		{
+			expectedVector[r] = m[r][0] * da[0] + m[r][1] * da[1] + m[r][2] * da[2];
+			scaleVector[r] = fabs(m[r][0] * da[0]) + fabs(m[r][1] * da[1]) + fabs(m[r][2] * da[2]);
+			expected[r] = expectedVector[r] + m[r][3];
+			scale[r] = scaleVector[r] + fabs(m[r][3]);
+		}
+		addVector(transform, point, expected, scale);
+		addVector(transformVector, vector, expectedVector, scaleVector);
+
+		// v + 2w (u x v) + 2u x (u x v), measured against the length of v
+		Quat q = random.Rotation();
+		double dq[4];
+		getQuat(q, dq);
+		double uv[3] = { dq[1] * da[2] - dq[2] * da[1], dq[2] * da[0] - dq[0] * da[2], dq[0] * da[1] - dq[1] * da[0] };
+		double uuv[3] = { dq[1] * uv[2] - dq[2] * uv[1], dq[2] * uv[0] - dq[0] * uv[2], dq[0] * uv[1] - dq[1] * uv[0] };
+		for (int j = 0; j < 3; ++j)
+		{
+			expected[j] = da[j] + 2.0 * dq[3] * uv[j] + 2.0 * uuv[j];
+			scale[j] = expectedLength;
+		}
+		Vector3 rotated = a;
+		rotated.Rotate(q);
+		addVector(rotate, rotated, expected, scale);
+	}
+
+	EXPECT_LE(add.Max(), 0.5);
+	EXPECT_LE(sub.Max(), 0.5);
+	EXPECT_LE(mul.Max(), 0.5);
+	EXPECT_LE(dot.Max(), 3.0);
+	EXPECT_LE(cross.Max(), 2.0);
+	EXPECT_LE(length.Max(), 4.0);
+	EXPECT_LE(normalize.Max(), 3072.0);
+	EXPECT_LE(lerp.Max(), 3.0);
+	EXPECT_LE(transform.Max(), 4.0);
+	EXPECT_LE(transformVector.Max(), 3.0);
+	EXPECT_LE(rotate.Max(), 16.0);
+
+	const ULPErrors* all[] = { &add, &sub, &mul, &dot, &cross, &length, &normalize, &lerp, &transform, &transformVector, &rotate };
+	for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+	{
+		all[i]->Print(SIMDBackend::Name());
+	}
+}
+
+TEST(Conformance, Matrix)
+{
+	ULPErrors multiply("Matrix4 Multiply"), lerp("Matrix4 Lerp"), invert("Matrix4 Invert"), rotation("Matrix4 CreateRotationX/Y/Z");
+
+	ConformanceRandom random;
+	for (int i = 0; i < conformanceSamples / 4; ++i)
+	{
+		float a[4][4], b[4][4], out[4][4];
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				a[r][c] = random.Value();
+				b[r][c] = random.Value();
+			}
+		}
+
+		Matrix4 product(a);
+		product.Multiply(Matrix4(b));
+		product.Get(out);
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				double expected = 0.0, scale = 0.0;
+				for (int k = 0; k < 4; ++k)
+				{
+					expected += (double) a[r][k] * b[k][c];
+					scale += fabs((double) a[r][k] * b[k][c]);
+				}
+				multiply.Add(out[r][c], expected, scale);
+			}
+		}
+
+		float t = random.Unit() * 0.5f + 0.5f;
+		Lerp(Matrix4(a), Matrix4(b), t).Get(out);
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				lerp.Add(out[r][c], a[r][c] * (1.0 - t) + b[r][c] * t, fabs(a[r][c] * (1.0 - t)) + fabs(b[r][c] * t));
+			}
+		}
+
+		// A rotation, a scale from 0.5 to 2 and a translation, well conditioned so the inverse is accurate
+		// The inverse is R^T / s and -R^T t / s, each element is measured against the largest of its row
+		// as the cofactors mix the translation into every element
+		float angle = random.Unit() * 3.14159265f;
+		float s = ldexpf(1.0f, (int) (random.Unit() * 1.5f)) * (1.0f + 0.25f * random.Unit());
+		Matrix4 affine;
+		affine.CreateRotationX(angle);
+		Matrix4 turn;
+		turn.CreateRotationZ(angle * 0.7f);
+		affine.Multiply(turn);
+		float m[4][4];
+		affine.Get(m);
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				m[r][c] *= s;
+			}
+			m[r][3] = random.Value();
+		}
+		Matrix4 inverse(m);
+		EXPECT_TRUE(inverse.Invert());
+		inverse.Get(out);
+
+		// Solve m x = e_c in double by Gauss-Jordan elimination
+		double work[4][8];
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				work[r][c] = m[r][c];
+				work[r][c + 4] = r == c ? 1.0 : 0.0;
+			}
+		}
+		for (int p = 0; p < 4; ++p)
+		{
+			int pivot = p;
+			for (int r = p + 1; r < 4; ++r)
+			{
+				pivot = fabs(work[r][p]) > fabs(work[pivot][p]) ? r : pivot;
+			}
+			for (int c = 0; c < 8; ++c)
+			{
+				std::swap(work[p][c], work[pivot][c]);
+			}
+			for (int r = 0; r < 4; ++r)
+			{
+				if (r == p)
+					continue;
+				double factor = work[r][p] / work[p][p];
+				for (int c = 0; c < 8; ++c)
+				{
+					work[r][c] -= factor * work[p][c];
+				}
+			}
+		}
+		for (int r = 0; r < 4; ++r)
+		{
+			double rowScale = 0.0;
+			for (int c = 0; c < 4; ++c)
+			{
+				rowScale = std::max(rowScale, fabs(work[r][c + 4] / work[r][r]));
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				invert.Add(out[r][c], work[r][c + 4] / work[r][r], rowScale);
+			}
+		}
+
+		// Against sin and cos of the float angle
+		Matrix4 rotations[3];
+		rotations[0].CreateRotationX(angle);
+		rotations[1].CreateRotationY(angle);
+		rotations[2].CreateRotationZ(angle);
+		const int sinRow[3][2] = { { 2, 1 }, { 0, 2 }, { 1, 0 } };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			rotations[axis].Get(out);
+			int r = sinRow[axis][0], c = sinRow[axis][1];
+			rotation.Add(out[r][c], sin((double) angle), 1.0);
+			rotation.Add(out[c][r], -sin((double) angle), 1.0);
+			rotation.Add(out[r][r], cos((double) angle), 1.0);
+			rotation.Add(out[c][c], cos((double) angle), 1.0);
+		}
+	}
+
+	EXPECT_LE(multiply.Max(), 4.0);
+	EXPECT_LE(lerp.Max(), 3.0);
+	EXPECT_LE(invert.Max(), 512.0);
+	EXPECT_LE(rotation.Max(), 1.0);
+
+	const ULPErrors* all[] = { &multiply, &lerp, &invert, &rotation };
+	for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+	{
+		all[i]->Print(SIMDBackend::Name());
+	}
+}
+
+TEST(Conformance, Quaternion)
+{
+	ULPErrors multiply("Quaternion Multiply"), dot("Quaternion Dot"), conjugate("Quaternion Conjugate");
+	ULPErrors normalize("Quaternion Normalize"), slerp("Quaternion Slerp"), nlerp("Quaternion Nlerp");
+	ULPErrors toMatrix("Matrix4 CreateRotationFromQuaternion"), fromMatrix("Quaternion CreateFromMatrix");
+
+	ConformanceRandom random;
+	for (int i = 0; i < conformanceSamples; ++i)
+	{
+		Quat a = random.Rotation(), b = random.Rotation();
+		double da[4], db[4], expected[4], scale[4];
+		getQuat(a, da);
+		getQuat(b, db);
+
+		Quat product = a;
+		product.Multiply(b);
+		referenceQuatMultiply(da, db, expected, scale);
+		addQuat(multiply, product, expected, scale);
+
+		dot.Add(a.Dot(b), da[0] * db[0] + da[1] * db[1] + da[2] * db[2] + da[3] * db[3],
+			fabs(da[0] * db[0]) + fabs(da[1] * db[1]) + fabs(da[2] * db[2]) + fabs(da[3] * db[3]));
+
+		Quat conjugated = a;
+		conjugated.Conjugate();
+		double negated[4] = { -da[0], -da[1], -da[2], da[3] };
+		addQuat(conjugate, conjugated, negated, scale);
+
+		// Scaled off unit length, the components are measured against the unit length
+		float s = random.Value();
+		Quat scaled(a.GetX() * s, a.GetY() * s, a.GetZ() * s, a.GetW() * s);
+		double ds[4];
+		getQuat(scaled, ds);
+		double length = sqrt(ds[0] * ds[0] + ds[1] * ds[1] + ds[2] * ds[2] + ds[3] * ds[3]);
+		double unit[4] = { ds[0] / length, ds[1] / length, ds[2] / length, ds[3] / length };
+		const double one[4] = { 1.0, 1.0, 1.0, 1.0 };
+		scaled.Normalize();
+		addQuat(normalize, scaled, unit, one);
+
+		// Along the shorter arc, b is moved near a half of the time to cover the nearly parallel case
+		if (i & 1)
+		{
+			double d[3] = { random.Unit() * 0.02, random.Unit() * 0.02, random.Unit() * 0.02 };
+			double stepLength = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2] + 1.0);
+			Quat step((float) (d[0] / stepLength), (float) (d[1] / stepLength), (float) (d[2] / stepLength), (float) (1.0 / stepLength));
+			b = a;
+			b.Multiply(step);
+			getQuat(b, db);
+		}
+		float t = random.Unit() * 0.5f + 0.5f;
+		double cosTheta = da[0] * db[0] + da[1] * db[1] + da[2] * db[2] + da[3] * db[3];
+		double sign = cosTheta < 0.0 ? -1.0 : 1.0;
+		double theta = acos(std::min(fabs(cosTheta), 1.0));
+		double weightA = theta > 1e-9 ? sin((1.0 - t) * theta) / sin(theta) : 1.0 - t;
+		double weightB = (theta > 1e-9 ? sin(t * theta) / sin(theta) : t) * sign;
+		for (int j = 0; j < 4; ++j)
+		{
+			expected[j] = da[j] * weightA + db[j] * weightB;
+		}
+		addQuat(slerp, Slerp(a, b, t), expected, one);
+
+		double blended[4], blendedLength = 0.0;
+		for (int j = 0; j < 4; ++j)
+		{
+			blended[j] = da[j] * (1.0 - t) + db[j] * t * sign;
+			blendedLength += blended[j] * blended[j];
+		}
+		for (int j = 0; j < 4; ++j)
+		{
+			blended[j] /= sqrt(blendedLength);
+		}
+		addQuat(nlerp, Nlerp(a, b, t), blended, one);
+
+		// The rotation matrix of a unit quaternion, then back, q and -q are the same rotation
+		double x = da[0], y = da[1], z = da[2], w = da[3];
+		double expectedMatrix[3][3] = {
+			{ 1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y - z * w), 2.0 * (x * z + y * w) },
+			{ 2.0 * (x * y + z * w), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z - x * w) },
+			{ 2.0 * (x * z - y * w), 2.0 * (y * z + x * w), 1.0 - 2.0 * (x * x + y * y) } };
+		Matrix4 mat;
+		mat.CreateRotationFromQuaternion(a);
+		float out[4][4];
+		mat.Get(out);
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				toMatrix.Add(out[r][c], expectedMatrix[r][c], 1.0);
+			}
+		}
+
+		Quat back;
+		back.CreateFromMatrix(mat);
+		double backSign = back.Dot(a) < 0.0f ? -1.0 : 1.0;
+		for (int j = 0; j < 4; ++j)
+		{
+			expected[j] = da[j] * backSign;
+		}
+		addQuat(fromMatrix, back, expected, one);
+	}
+
+	EXPECT_LE(multiply.Max(), 4.0);
+	EXPECT_LE(dot.Max(), 4.0);
+	EXPECT_EQ(0.0, conjugate.Max());
+	EXPECT_LE(normalize.Max(), 3072.0);
+	EXPECT_LE(slerp.Max(), 16.0);
+	EXPECT_LE(nlerp.Max(), 8.0);
+	EXPECT_LE(toMatrix.Max(), 8.0);
+	EXPECT_LE(fromMatrix.Max(), 64.0);
+
+	const ULPErrors* all[] = { &multiply, &dot, &conjugate, &normalize, &slerp, &nlerp, &toMatrix, &fromMatrix };
+	for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+	{
+		all[i]->Print(SIMDBackend::Name());
+	}
+}
+
+// NaN and infinity propagate, denormals are kept or flushed to zero but never become anything else
+TEST(Conformance, SpecialValues)
+{
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float denormal = ldexpf(1.0f, -140);
+
+	Vector3 a(nan, 1.0f, 2.0f);
+	Vector3 b(1.0f, 2.0f, 3.0f);
+	Vector3 sum = a + b;
+	EXPECT_NE(sum.GetX(), sum.GetX());
+	EXPECT_EQ(3.0f, sum.GetY());
+	EXPECT_NE(a.Dot(b), a.Dot(b));
+	EXPECT_NE(a.Length(), a.Length());
+	Vector3 cross = CrossProduct(a, b);
+	EXPECT_EQ(1.0f * 3.0f - 2.0f * 2.0f, cross.GetX());
+	EXPECT_NE(cross.GetY(), cross.GetY());
+	EXPECT_NE(cross.GetZ(), cross.GetZ());
+
+	float m[4][4] = { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, nan, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } };
+	Vector3 point = b;
+	point.Transform(Matrix4(m));
+	EXPECT_EQ(1.0f, point.GetX());
+	EXPECT_NE(point.GetY(), point.GetY());
+	EXPECT_EQ(3.0f, point.GetZ());
+
+	Quat q(0.0f, nan, 0.0f, 1.0f);
+	q.Multiply(Quat(0.0f, 0.0f, 0.0f, 1.0f));
+	EXPECT_NE(q.GetX(), q.GetX());
+	EXPECT_NE(q.GetW(), q.GetW());
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	Vector3 large(infinity, -infinity, 1.0f);
+	Vector3 largeSum = large + b;
+	EXPECT_EQ(infinity, largeSum.GetX());
+	EXPECT_EQ(-infinity, largeSum.GetY());
+	EXPECT_EQ(infinity, large.LengthSquared());
+	EXPECT_EQ(infinity, (b * 1e30f).Dot(b * 1e30f));
+
+	// Denormal inputs and results
+	Vector3 tiny(denormal, -denormal, 1e-20f);
+	Vector3 tinySum = tiny + tiny;
+	EXPECT_TRUE(tinySum.GetX() == 2.0f * denormal || tinySum.GetX() == 0.0f);
+	EXPECT_TRUE(tinySum.GetY() == -2.0f * denormal || tinySum.GetY() == 0.0f);
+	Vector3 tinyProduct = tiny * 1e-20f;
+	float expected = 1e-20f * 1e-20f;
+	EXPECT_TRUE(tinyProduct.GetZ() == expected || tinyProduct.GetZ() == 0.0f);
+	EXPECT_TRUE(tinyProduct.GetX() == 0.0f);
+	float tinyDot = tiny.Dot(Vector3(1.0f, 0.0f, 0.0f));
+	EXPECT_TRUE(tinyDot == denormal || tinyDot == 0.0f);
+	float tinyLength = Vector3(denormal, 0.0f, 0.0f).Length();
+	EXPECT_TRUE(tinyLength == 0.0f || tinyLength < 1e-20f);
+}
+
 // Collision Testing Start
 
-TEST(collideWorld, box2box)
+TEST(collideWorld, box2box)
+{
+	Vector3 p1(1.0f, -1.0f, 1.0f);
+	Vector3 p2(-1.01f, 1.01f, -1.01f);
+	Vector3 p3(-1.0f, 1.0f, -1.0f);
+	Vector3 p4(-3.0f, 3.0f, -3.0f);
+	AABB aabb1(p1, p2);
+	AABB aabb2(p3, p4);
+	CollidableObject object1(&aabb1, p1, 0);
+	CollidableObject object2(&aabb2, p1, 1);
+	Collide collide;
+
+	collide.collision(&aabb1, &aabb2);
+
+	EXPECT_TRUE(collide.getCollide());
+
+	CollisionWorld world;
+	world.addObject(&object1);
+	world.addObject(&object2);
+	world.computeCollision();
+
+	EXPECT_EQ(2, world.getObjectSize());
+	EXPECT_EQ(1, world.getCollideSize());
+}
+
+TEST(collideWorld, sphere2sphere)
+{
+	Vector3 p1(0.0f, 0.0f, 0.0f);
+	Vector3 p2(1.0f, 0.0f, 0.0f);
+	float r1 = 0.5f;
+	float r2 = 0.51f;
+	Sphere sphere1(p1, r1);
+	Sphere sphere2(p2, r2);
+	CollidableObject object1(&sphere1, p1, 0);
+	CollidableObject object2(&sphere2, p1, 1);
+
+	CollisionWorld world;
+	world.addObject(&object1);
+	world.addObject(&object2);
+	world.computeCollision();
+
+	EXPECT_EQ(2, world.getObjectSize());
+	EXPECT_EQ(1, world.getCollideSize());
+}
+
+TEST(collideWorld, ray2sphere)
+{
+	Vector3 p1(0.0f, 0.0f, 0.0f);
+	Vector3 p2(0.0f, 4.0f, 0.0f);
+	Vector3 vecDir(0.0f, 2.0f, 0.0f);
+	float r = 2.0f;
+	Sphere sphere(p2, r);
+	Ray ray(p1, vecDir);
+	CollidableObject object1(&ray, p1, 0);
+	CollidableObject object2(&sphere, p1, 1);
+
+	CollisionWorld world;
+	world.addObject(&object1);
+	world.addObject(&object2);
+	world.computeCollision();
+
+	EXPECT_EQ(2, world.getObjectSize());
+	EXPECT_EQ(1, world.getCollideSize());
+}
+
+// Every pair of boxes that overlap, boxes that touch overlap
+PoolVector<ProxyPair> bruteForcePairs(const std::vector<Vector3>& mins, const std::vector<Vector3>& maxs, const std::vector<int>& proxies)
+{
+	PoolVector<ProxyPair> pairs;
+	for (size_t i = 0; i < proxies.size(); ++i)
+	{
+		for (size_t j = 0; j < proxies.size(); ++j)
+		{
+			if (proxies[i] < 0 || proxies[j] < 0 || proxies[i] >= proxies[j])
+				continue;
+			if (mins[i].GetX() <= maxs[j].GetX() && mins[j].GetX() <= maxs[i].GetX() &&
+				mins[i].GetY() <= maxs[j].GetY() && mins[j].GetY() <= maxs[i].GetY() &&
+				mins[i].GetZ() <= maxs[j].GetZ() && mins[j].GetZ() <= maxs[i].GetZ())
+			{
+				ProxyPair pair = { proxies[i], proxies[j] };
+				pairs.push_back(pair);
+			}
+		}
+	}
+	std::sort(pairs.begin(), pairs.end(), [](const ProxyPair& a, const ProxyPair& b)
+	{
+		return a.m_ProxyA < b.m_ProxyA || (a.m_ProxyA == b.m_ProxyA && a.m_ProxyB < b.m_ProxyB);
+	});
+	return pairs;
+}
+
+bool samePairs(const PoolVector<ProxyPair>& pairs0, const PoolVector<ProxyPair>& pairs1)
+{
+	if (pairs0.size() != pairs1.size())
+		return false;
+	for (size_t i = 0; i < pairs0.size(); ++i)
+	{
+		if (pairs0[i].m_ProxyA != pairs1[i].m_ProxyA || pairs0[i].m_ProxyB != pairs1[i].m_ProxyB)
+			return false;
+	}
+	return true;
+}
+
+// Pairs in pairs0 and not in pairs1, both sorted
+PoolVector<ProxyPair> pairDifference(const PoolVector<ProxyPair>& pairs0, const PoolVector<ProxyPair>& pairs1)
+{
+	PoolVector<ProxyPair> difference;
+	size_t j = 0;
+	for (size_t i = 0; i < pairs0.size(); ++i)
+	{
+		while (j < pairs1.size() && (pairs1[j].m_ProxyA < pairs0[i].m_ProxyA ||
+			(pairs1[j].m_ProxyA == pairs0[i].m_ProxyA && pairs1[j].m_ProxyB < pairs0[i].m_ProxyB)))
+			++j;
+		if (j == pairs1.size() || pairs1[j].m_ProxyA != pairs0[i].m_ProxyA || pairs1[j].m_ProxyB != pairs0[i].m_ProxyB)
+			difference.push_back(pairs0[i]);
+	}
+	return difference;
+}
+
+void randomBox(std::mt19937& random, float extent, Vector3& min, Vector3& max)
+{
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	min = Vector3(position(random), position(random), position(random));
+	max = min + Vector3(size(random), size(random), size(random));
+}
+
+TEST(SweepAndPrune, TouchingBoxes)
+{
+	SweepAndPrune broadPhase;
+	int proxy0 = broadPhase.addProxy(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), NULL);
+	int proxy1 = broadPhase.addProxy(Vector3(1.0f, 0.0f, 0.0f), Vector3(2.0f, 1.0f, 1.0f), NULL);
+	broadPhase.updatePairs();
+	ASSERT_EQ(1, broadPhase.getAddedPairs().size());
+	EXPECT_EQ(proxy0, broadPhase.getAddedPairs()[0].m_ProxyA);
+	EXPECT_EQ(proxy1, broadPhase.getAddedPairs()[0].m_ProxyB);
+
+	broadPhase.moveProxy(proxy1, Vector3(1.01f, 0.0f, 0.0f), Vector3(2.01f, 1.0f, 1.0f));
+	broadPhase.updatePairs();
+	EXPECT_EQ(0, broadPhase.getAddedPairs().size());
+	EXPECT_EQ(1, broadPhase.getRemovedPairs().size());
+	EXPECT_EQ(0, broadPhase.getPairCount());
+
+	// passing through and out again in one update changes nothing
+	broadPhase.moveProxy(proxy1, Vector3(0.5f, 0.0f, 0.0f), Vector3(1.5f, 1.0f, 1.0f));
+	broadPhase.moveProxy(proxy1, Vector3(-3.0f, 0.0f, 0.0f), Vector3(-2.0f, 1.0f, 1.0f));
+	broadPhase.updatePairs();
+	EXPECT_EQ(0, broadPhase.getAddedPairs().size());
+	EXPECT_EQ(0, broadPhase.getRemovedPairs().size());
+
+	// a removed proxy's pairs are removed and its proxy is reused after the update
+	broadPhase.moveProxy(proxy1, Vector3(0.5f, 0.5f, 0.5f), Vector3(1.5f, 1.5f, 1.5f));
+	broadPhase.updatePairs();
+	EXPECT_EQ(1, broadPhase.getPairCount());
+	broadPhase.removeProxy(proxy1);
+	EXPECT_NE(proxy1, broadPhase.addProxy(Vector3(0.5f, 0.5f, 0.5f), Vector3(1.5f, 1.5f, 1.5f), NULL));
+	broadPhase.updatePairs();
+	EXPECT_EQ(1, broadPhase.getAddedPairs().size());
+	EXPECT_EQ(1, broadPhase.getRemovedPairs().size());
+	EXPECT_EQ(proxy1, broadPhase.addProxy(Vector3(5.0f, 5.0f, 5.0f), Vector3(6.0f, 6.0f, 6.0f), NULL));
+	EXPECT_EQ(3, broadPhase.getProxyCount());
+}
+
+TEST(SweepAndPrune, MatchesBruteForce)
+{
+	const int count = 400;
+	const float extent = 10.0f;
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> step(-0.3f, 0.3f);
+	std::uniform_int_distribution<int> pick(0, count - 1);
+
+	SweepAndPrune broadPhase;
+	std::vector<Vector3> mins(count), maxs(count);
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; ++i)
+	{
+		randomBox(random, extent, mins[i], maxs[i]);
+		proxies[i] = broadPhase.addProxy(mins[i], maxs[i], &proxies[i]);
+	}
+	broadPhase.updatePairs();
+
+	PoolVector<ProxyPair> pairs;
+	PoolVector<ProxyPair> previous = bruteForcePairs(mins, maxs, proxies);
+	broadPhase.getPairs(pairs);
+	ASSERT_TRUE(samePairs(previous, pairs));
+	ASSERT_TRUE(samePairs(previous, broadPhase.getAddedPairs()));
+	EXPECT_GT(previous.size(), 0);
+
+	for (int frame = 0; frame < 30; ++frame)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (proxies[i] < 0)
+				continue;
+			Vector3 offset(step(random), step(random), step(random));
+			mins[i] += offset;
+			maxs[i] += offset;
+			broadPhase.moveProxy(proxies[i], mins[i], maxs[i]);
+		}
+
+		// some boxes come and go, teleport or change size
+		for (int i = 0; i < 5; ++i)
+		{
+			int box = pick(random);
+			if (proxies[box] >= 0)
+			{
+				broadPhase.removeProxy(proxies[box]);
+				proxies[box] = -1;
+			}
+			else
+			{
+				randomBox(random, extent, mins[box], maxs[box]);
+				proxies[box] = broadPhase.addProxy(mins[box], maxs[box], &proxies[box]);
+			}
+
+			box = pick(random);
+			if (proxies[box] >= 0)
+			{
+				randomBox(random, extent, mins[box], maxs[box]);
+				broadPhase.moveProxy(proxies[box], mins[box], maxs[box]);
+			}
+		}
+		broadPhase.updatePairs();
+
+		PoolVector<ProxyPair> current = bruteForcePairs(mins, maxs, proxies);
+		broadPhase.getPairs(pairs);
+		ASSERT_TRUE(samePairs(current, pairs)) << "frame " << frame;
+		EXPECT_EQ(current.size(), broadPhase.getPairCount());
+		EXPECT_TRUE(samePairs(pairDifference(current, previous), broadPhase.getAddedPairs()));
+		EXPECT_TRUE(samePairs(pairDifference(previous, current), broadPhase.getRemovedPairs()));
+		previous = current;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (proxies[i] >= 0)
+		{
+			EXPECT_EQ(&proxies[i], broadPhase.getUserData(proxies[i]));
+		}
+	}
+}
+
+TEST(SweepAndPrune, AddProxies)
+{
+	const int count = 1000;
+	std::mt19937 random(11);
+	std::vector<Vector3> mins(count), maxs(count);
+	std::vector<void*> userData(count, NULL);
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; ++i)
+	{
+		randomBox(random, 15.0f, mins[i], maxs[i]);
+	}
+
+	// half one at a time, then the rest at once
+	SweepAndPrune broadPhase;
+	const int half = count / 2;
+	for (int i = 0; i < half; ++i)
+	{
+		proxies[i] = broadPhase.addProxy(mins[i], maxs[i], NULL);
+	}
+	broadPhase.updatePairs();
+	broadPhase.addProxies(&mins[half], &maxs[half], &userData[half], count - half, &proxies[half]);
+	broadPhase.updatePairs();
+
+	PoolVector<ProxyPair> pairs;
+	broadPhase.getPairs(pairs);
+	EXPECT_TRUE(samePairs(bruteForcePairs(mins, maxs, proxies), pairs));
+	EXPECT_EQ(count, broadPhase.getProxyCount());
+
+	// the sorted endpoints keep working incrementally
+	for (int i = 0; i < count; ++i)
+	{
+		Vector3 offset(0.25f, -0.5f, 0.125f);
+		mins[i] += offset;
+		maxs[i] += offset;
+		broadPhase.moveProxy(proxies[i], mins[i], maxs[i]);
+	}
+	broadPhase.updatePairs();
+	broadPhase.getPairs(pairs);
+	EXPECT_TRUE(samePairs(bruteForcePairs(mins, maxs, proxies), pairs));
+}
+
+bool boxesOverlap(const Vector3& min0, const Vector3& max0, const Vector3& min1, const Vector3& max1)
+{
+	return min0.GetX() <= max1.GetX() && min1.GetX() <= max0.GetX() &&
+		min0.GetY() <= max1.GetY() && min1.GetY() <= max0.GetY() &&
+		min0.GetZ() <= max1.GetZ() && min1.GetZ() <= max0.GetZ();
+}
+
+// Where the ray start + t * dir enters the box, if it does for t in [0, maxFraction]
+bool rayEntersBox(const Vector3& start, const Vector3& dir, float maxFraction, const Vector3& min, const Vector3& max, float& t)
+{
+	float s[3] = { start.GetX(), start.GetY(), start.GetZ() };
+	float d[3] = { dir.GetX(), dir.GetY(), dir.GetZ() };
+	float lower[3] = { min.GetX(), min.GetY(), min.GetZ() };
+	float upper[3] = { max.GetX(), max.GetY(), max.GetZ() };
+	double tMin = 0.0, tMax = maxFraction;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (d[axis] == 0.0f)
+		{
+			if (s[axis] < lower[axis] || s[axis] > upper[axis])
+				return false;
+			continue;
+		}
+		double t1 = (lower[axis] - s[axis]) / (double) d[axis];
+		double t2 = (upper[axis] - s[axis]) / (double) d[axis];
+		tMin = std::max(tMin, std::min(t1, t2));
+		tMax = std::min(tMax, std::max(t1, t2));
+	}
+	t = (float) tMin;
+	return tMin <= tMax;
+}
+
+TEST(AabbTree, MatchesBruteForce)
+{
+	const int count = 400;
+	const float extent = 10.0f;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> step(-0.3f, 0.3f);
+	std::uniform_int_distribution<int> pick(0, count - 1);
+
+	AabbTree tree(0.2f);
+	std::vector<Vector3> mins(count), maxs(count);
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; ++i)
+	{
+		randomBox(random, extent, mins[i], maxs[i]);
+		proxies[i] = tree.addProxy(mins[i], maxs[i], &proxies[i]);
+	}
+
+	PoolVector<ProxyPair> previous;
+	for (int frame = 0; frame < 30; ++frame)
+	{
+		tree.updatePairs();
+
+		// every pair of boxes that overlap and only pairs of enlarged boxes that do
+		PoolVector<ProxyPair> pairs;
+		tree.getPairs(pairs);
+		EXPECT_EQ(0, pairDifference(bruteForcePairs(mins, maxs, proxies), pairs).size()) << "frame " << frame;
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			Vector3 min0, max0, min1, max1;
+			tree.getAABB(pairs[i].m_ProxyA, min0, max0);
+			tree.getAABB(pairs[i].m_ProxyB, min1, max1);
+			EXPECT_TRUE(boxesOverlap(min0, max0, min1, max1));
+		}
+		EXPECT_EQ(pairs.size(), tree.getPairCount());
+		EXPECT_TRUE(samePairs(pairDifference(pairs, previous), tree.getAddedPairs()));
+		EXPECT_TRUE(samePairs(pairDifference(previous, pairs), tree.getRemovedPairs()));
+		previous = pairs;
+
+		// an AVL tree is at most 1.44 log2 n high
+		EXPECT_LE(tree.getHeight(), 1.44f * log2f((float) tree.getProxyCount()) + 1.0f);
+
+		for (int i = 0; i < count; ++i)
+		{
+			if (proxies[i] < 0)
+				continue;
+			Vector3 offset(step(random), step(random), step(random));
+			mins[i] += offset;
+			maxs[i] += offset;
+			tree.moveProxy(proxies[i], mins[i], maxs[i]);
+		}
+
+		for (int i = 0; i < 5; ++i)
+		{
+			int box = pick(random);
+			if (proxies[box] >= 0)
+			{
+				tree.removeProxy(proxies[box]);
+				proxies[box] = -1;
+			}
+			else
+			{
+				randomBox(random, extent, mins[box], maxs[box]);
+				proxies[box] = tree.addProxy(mins[box], maxs[box], &proxies[box]);
+			}
+		}
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (proxies[i] >= 0)
+		{
+			EXPECT_EQ(&proxies[i], tree.getUserData(proxies[i]));
+		}
+	}
+	EXPECT_LT(tree.getAreaRatio(), 100.0f);
+}
+
+// Queries of every broad phase against testing every box it keeps
+TEST(BroadPhase, Queries)
+{
+	const int count = 500;
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> position(-12.0f, 12.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+	AabbTree tree;
+	SweepAndPrune sweepAndPrune;
+	SpatialHash spatialHash(2.0f);
+	BroadPhase* broadPhases[] = { &tree, &sweepAndPrune, &spatialHash };
+	std::vector<int> proxies[3];
+	for (int i = 0; i < count; ++i)
+	{
+		Vector3 min, max;
+		randomBox(random, 10.0f, min, max);
+		for (int j = 0; j < 3; ++j)
+		{
+			proxies[j].push_back(broadPhases[j]->addProxy(min, max, NULL));
+		}
+	}
+
+	for (int j = 0; j < 3; ++j)
+	{
+		BroadPhase* broadPhase = broadPhases[j];
+		broadPhase->updatePairs();
+		for (int query = 0; query < 50; ++query)
+		{
+			Vector3 center(position(random), position(random), position(random));
+			Vector3 extent(2.0f, 1.0f, 3.0f);
+			float radius = 2.5f;
+			Vector3 dir(direction(random), direction(random), direction(random));
+			if (query == 0)
+				dir = Vector3(0.0f, 0.0f, 1.0f);
+
+			std::vector<int> boxes, spheres;
+			std::vector<std::pair<float, int> > rays;
+			for (int i = 0; i < count; ++i)
+			{
+				Vector3 min, max;
+				broadPhase->getAABB(proxies[j][i], min, max);
+				if (boxesOverlap(center - extent, center + extent, min, max))
+					boxes.push_back(proxies[j][i]);
+
+				float dx = std::max(std::max(min.GetX() - center.GetX(), center.GetX() - max.GetX()), 0.0f);
+				float dy = std::max(std::max(min.GetY() - center.GetY(), center.GetY() - max.GetY()), 0.0f);
+				float dz = std::max(std::max(min.GetZ() - center.GetZ(), center.GetZ() - max.GetZ()), 0.0f);
+				if (dx * dx + dy * dy + dz * dz <= radius * radius)
+					spheres.push_back(proxies[j][i]);
+
+				float t;
+				if (rayEntersBox(center, dir, 10.0f, min, max, t))
+					rays.push_back(std::make_pair(t, proxies[j][i]));
+			}
+			std::sort(boxes.begin(), boxes.end());
+			std::sort(spheres.begin(), spheres.end());
+			std::sort(rays.begin(), rays.end());
+
+			PoolVector<int> found;
+			broadPhase->queryAABB(center - extent, center + extent, found);
+			std::sort(found.begin(), found.end());
+			EXPECT_TRUE(std::equal(boxes.begin(), boxes.end(), found.begin()) && boxes.size() == found.size());
+
+			broadPhase->querySphere(center, radius, found);
+			std::sort(found.begin(), found.end());
+			EXPECT_TRUE(std::equal(spheres.begin(), spheres.end(), found.begin()) && spheres.size() == found.size());
+
+			// nearest first, boxes the ray enters at almost the same distance may swap
+			broadPhase->queryRay(center, dir, 10.0f, found);
+			ASSERT_EQ(rays.size(), found.size());
+			for (size_t i = 0; i < rays.size(); ++i)
+			{
+				Vector3 min, max;
+				broadPhase->getAABB(found[i], min, max);
+				float t;
+				ASSERT_TRUE(rayEntersBox(center, dir, 10.0f, min, max, t));
+				EXPECT_NEAR(rays[i].first, t, 1e-4f);
+			}
+		}
+	}
+
+	// a ray without a direction hits nothing, even from inside a box
+	const BroadPhaseType types[] = { BROADPHASE_SWEEP_AND_PRUNE, BROADPHASE_AABB_TREE, BROADPHASE_SPATIAL_HASH };
+	for (int type = 0; type < 3; ++type)
+	{
+		Sphere sphere(Vector3(0.0f, 0.0f, 0.0f), 1.0f);
+		CollidableObject object(&sphere, Vector3(), 0);
+		CollisionWorld world(types[type]);
+		world.addObject(&object);
+		world.computeCollision();
+
+		PoolVector<CollidableObject*> hits;
+		world.raycast(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 0.0f, 0.0f), 2.0f, hits);
+		ASSERT_EQ(1, hits.size());
+		world.raycast(Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 0.0f), 2.0f, hits);
+		EXPECT_EQ(0, hits.size());
+	}
+}
+
+TEST(SpatialHash, MatchesBruteForce)
+{
+	const int count = 400;
+	const float extent = 10.0f;
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> step(-0.3f, 0.3f);
+	std::uniform_int_distribution<int> pick(0, count - 1);
+
+	SpatialHash broadPhase(1.0f);
+	std::vector<Vector3> mins(count), maxs(count);
+	std::vector<int> proxies(count);
+	for (int i = 0; i < count; ++i)
+	{
+		randomBox(random, extent, mins[i], maxs[i]);
+		// a few boxes too large for the grid
+		if (i % 100 == 0)
+			maxs[i] += Vector3(6.0f, 6.0f, 6.0f);
+		proxies[i] = broadPhase.addProxy(mins[i], maxs[i], &proxies[i]);
+	}
+	broadPhase.updatePairs();
+	EXPECT_EQ(4, broadPhase.getLargeProxyCount());
+
+	PoolVector<ProxyPair> pairs;
+	PoolVector<ProxyPair> previous = bruteForcePairs(mins, maxs, proxies);
+	broadPhase.getPairs(pairs);
+	ASSERT_TRUE(samePairs(previous, pairs));
+	ASSERT_TRUE(samePairs(previous, broadPhase.getAddedPairs()));
+
+	for (int frame = 0; frame < 30; ++frame)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (proxies[i] < 0)
+				continue;
+			Vector3 offset(step(random), step(random), step(random));
+			mins[i] += offset;
+			maxs[i] += offset;
+			broadPhase.moveProxy(proxies[i], mins[i], maxs[i]);
+		}
+
+		for (int i = 0; i < 5; ++i)
+		{
+			int box = pick(random);
+			if (proxies[box] >= 0)
+			{
+				broadPhase.removeProxy(proxies[box]);
+				proxies[box] = -1;
+			}
+			else
+			{
+				randomBox(random, extent, mins[box], maxs[box]);
+				proxies[box] = broadPhase.addProxy(mins[box], maxs[box], &proxies[box]);
+			}
+		}
+
+		// the pairs do not depend on the cells
+		if (frame == 10)
+			broadPhase.setCellSize(2.5f);
+		broadPhase.updatePairs();
+
+		PoolVector<ProxyPair> current = bruteForcePairs(mins, maxs, proxies);
+		broadPhase.getPairs(pairs);
+		ASSERT_TRUE(samePairs(current, pairs)) << "frame " << frame;
+		EXPECT_EQ(current.size(), broadPhase.getPairCount());
+		EXPECT_TRUE(samePairs(pairDifference(current, previous), broadPhase.getAddedPairs()));
+		EXPECT_TRUE(samePairs(pairDifference(previous, current), broadPhase.getRemovedPairs()));
+		previous = current;
+	}
+
+	// nothing moved, nothing changes
+	broadPhase.updatePairs();
+	EXPECT_EQ(0, broadPhase.getAddedPairs().size());
+	EXPECT_EQ(0, broadPhase.getRemovedPairs().size());
+
+	// boxes that touch overlap, even across a cell boundary
+	SpatialHash touching(1.0f);
+	touching.addProxy(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), NULL);
+	touching.addProxy(Vector3(1.0f, 0.5f, 0.5f), Vector3(1.5f, 1.5f, 1.5f), NULL);
+	touching.updatePairs();
+	EXPECT_EQ(1, touching.getPairCount());
+}
+
+TEST(collideWorld, broadPhase)
+{
+	const BroadPhaseType types[] = { BROADPHASE_SWEEP_AND_PRUNE, BROADPHASE_AABB_TREE, BROADPHASE_SPATIAL_HASH };
+	for (int type = 0; type < 3; ++type)
+	{
+		std::vector<Sphere> spheres;
+		for (int i = 0; i < 10; ++i)
+		{
+			spheres.push_back(Sphere(Vector3(1.5f * i, 0.0f, 0.0f), 1.0f));
+		}
+		std::vector<CollidableObject> objects;
+		for (int i = 0; i < 10; ++i)
+		{
+			objects.push_back(CollidableObject(&spheres[i], Vector3(), i));
+		}
+		std::vector<CollidableObject*> objectPointers;
+		for (int i = 0; i < 10; ++i)
+		{
+			objectPointers.push_back(&objects[i]);
+		}
+
+		CollisionWorld world(types[type]);
+		world.addObjects(&objectPointers[0], 5);
+		for (int i = 5; i < 10; ++i)
+		{
+			world.addObject(objectPointers[i]);
+		}
+		world.computeCollision();
+
+		// only neighbours overlap
+		EXPECT_EQ(10, world.getObjectSize());
+		EXPECT_EQ(9, world.getCollideSize());
+		EXPECT_EQ(9, world.getAddedPairs().size());
+		for (int i = 0; i < world.getCollideSize(); ++i)
+		{
+			const CollisionPair& pair = world.getCollideList()[i];
+			EXPECT_EQ(1, abs(pair.m_pObject1->getObjectID() - pair.m_pObject2->getObjectID()));
+		}
+
+		// the ray starts in the box of sphere 2 and passes through those of 3 and 4
+		PoolVector<CollidableObject*> hits;
+		world.raycast(Vector3(3.0f, 0.0f, 0.0f), Vector3(2.0f, 0.0f, 0.0f), 3.0f, hits);
+		ASSERT_EQ(3, hits.size());
+		EXPECT_EQ(&objects[2], hits[0]);
+		EXPECT_EQ(&objects[3], hits[1]);
+		EXPECT_EQ(&objects[4], hits[2]);
+		world.querySphere(Vector3(6.0f, 2.0f, 0.0f), 1.5f, hits);
+		EXPECT_EQ(3, hits.size());
+		world.queryAABB(Vector3(-5.0f, -5.0f, -5.0f), Vector3(-1.5f, 5.0f, 5.0f), hits);
+		EXPECT_EQ(0, hits.size());
+
+		// pull the last sphere away
+		spheres[9].update(1.0f, Vector3(10.0f, 0.0f, 0.0f));
+		world.updatePairs();
+		ASSERT_EQ(1, world.getRemovedPairs().size());
+		EXPECT_TRUE(&objects[9] == world.getObject(world.getRemovedPairs()[0].m_ProxyA) ||
+			&objects[9] == world.getObject(world.getRemovedPairs()[0].m_ProxyB));
+
+		world.removeObject(&objects[0]);
+		world.computeCollision();
+		EXPECT_EQ(9, world.getObjectSize());
+		EXPECT_EQ(7, world.getCollideSize());
+		EXPECT_EQ(-1, objects[0].getProxyID());
+	}
+}
+
+// The contact of two shapes in double precision, a sphere is x, y, z and radius, a box its min then its max
+bool referenceContact(int typeA, const double* a, int typeB, const double* b, double point[3], double normal[3], double& depth)
+{
+	if (typeA == typeAABB && typeB == typeSPHERE)
+	{
+		bool touch = referenceContact(typeB, b, typeA, a, point, normal, depth);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			normal[axis] = -normal[axis];
+		}
+		return touch;
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		normal[axis] = 0.0;
+	}
+
+	if (typeA == typeSPHERE && typeB == typeSPHERE)
+	{
+		double distance = sqrt((b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]));
+		depth = a[3] + b[3] - distance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			normal[axis] = (b[axis] - a[axis]) / distance;
+			point[axis] = a[axis] + normal[axis] * (a[3] - depth * 0.5);
+		}
+		return depth >= 0.0;
+	}
+
+	if (typeA == typeSPHERE && typeB == typeAABB)
+	{
+		double distanceSquared = 0.0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			point[axis] = std::min(std::max(a[axis], b[axis]), b[axis + 3]);
+			distanceSquared += (point[axis] - a[axis]) * (point[axis] - a[axis]);
+		}
+		double distance = sqrt(distanceSquared);
+		if (distance > 0.0)
+		{
+			depth = a[3] - distance;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				normal[axis] = (point[axis] - a[axis]) / distance;
+			}
+			return depth >= 0.0;
+		}
+
+		// inside, out through the nearest face
+		int nearest = 0;
+		double face = std::numeric_limits<double>::max();
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			double toFace = std::min(a[axis] - b[axis], b[axis + 3] - a[axis]);
+			if (toFace < face)
+			{
+				face = toFace;
+				nearest = axis;
+			}
+		}
+		normal[nearest] = a[nearest] - b[nearest] <= b[nearest + 3] - a[nearest] ? 1.0 : -1.0;
+		point[nearest] = a[nearest] - normal[nearest] * face;
+		depth = a[3] + face;
+		return true;
+	}
+
+	// the axis of least overlap
+	int least = 0;
+	depth = std::numeric_limits<double>::max();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		double lower = std::max(a[axis], b[axis]);
+		double upper = std::min(a[axis + 3], b[axis + 3]);
+		point[axis] = (lower + upper) * 0.5;
+		if (upper - lower < depth)
+		{
+			depth = upper - lower;
+			least = axis;
+		}
+	}
+	normal[least] = a[least] + a[least + 3] <= b[least] + b[least + 3] ? 1.0 : -1.0;
+	return depth >= 0.0;
+}
+
+TEST(BatchCollide, MatchesScalar)
+{
+	const int count = 150;
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> size(0.2f, 1.5f);
+	std::uniform_int_distribution<int> coin(0, 1);
+
+	std::vector<Sphere> spheres;
+	std::vector<AABB> boxes;
+	std::vector<Point> points;
+	for (int i = 0; i < count; ++i)
+	{
+		Vector3 center(position(random), position(random), position(random));
+		spheres.push_back(Sphere(center, size(random)));
+		Vector3 corner = center + Vector3(size(random), size(random), size(random));
+		// some AABBs are given max first
+		if (coin(random))
+			boxes.push_back(AABB(center, corner));
+		else
+			boxes.push_back(AABB(corner, center));
+	}
+	for (int i = 0; i < 5; ++i)
+	{
+		points.push_back(Point(Vector3(position(random), position(random), position(random))));
+	}
+
+	std::vector<const Body*> bodies;
+	for (int i = 0; i < count; ++i)
+	{
+		bodies.push_back(&spheres[i]);
+		bodies.push_back(&boxes[i]);
+	}
+	for (int i = 0; i < 5; ++i)
+	{
+		bodies.push_back(&points[i]);
+	}
+
+	ColliderStorage colliders;
+	std::vector<int> colliderIDs;
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		colliderIDs.push_back(colliders.addCollider(bodies[i]));
+	}
+
+	// removing moves the last shape of a type into the hole, moving a body is copied again
+	std::uniform_int_distribution<int> pick(0, (int) bodies.size() - 1);
+	for (int i = 0; i < 20; ++i)
+	{
+		int body = pick(random);
+		if (colliderIDs[body] >= 0)
+		{
+			colliders.removeCollider(colliderIDs[body]);
+			colliderIDs[body] = -1;
+		}
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		spheres[i].update(1.0f, Vector3(0.1f, 0.0f, -0.1f));
+		if (colliderIDs[2 * i] >= 0)
+			colliders.updateCollider(colliderIDs[2 * i], &spheres[i]);
+	}
+
+	std::vector<int> live;
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		if (colliderIDs[i] >= 0)
+			live.push_back((int) i);
+	}
+	EXPECT_EQ((int) live.size(), colliders.getColliderCount());
+
+	PoolVector<ColliderPair> pairs;
+	std::vector<std::pair<int, int> > pairBodies;
+	for (size_t i = 0; i < live.size(); ++i)
+	{
+		for (size_t j = i + 1; j < live.size(); ++j)
+		{
+			int a = live[i];
+			int b = live[j];
+			if (coin(random))
+				std::swap(a, b);
+			ColliderPair pair;
+			pair.m_ColliderA = colliderIDs[a];
+			pair.m_ColliderB = colliderIDs[b];
+			pairs.push_back(pair);
+			pairBodies.push_back(std::make_pair(a, b));
+		}
+	}
+
+	BatchCollide batchCollide;
+	batchCollide.groupPairs(colliders, pairs.data(), (int) pairs.size());
+	PoolVector<Contact> contacts;
+	batchCollide.collide(colliders, contacts);
+
+	// group after group, each in the order of its pairs
+	std::stable_sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b) { return a.m_Pair < b.m_Pair; });
+
+	size_t contact = 0;
+	size_t other = 0;
+	int grouped = 0;
+	for (size_t i = 0; i < pairs.size(); ++i)
+	{
+		double shapes[2][6];
+		int types[2];
+		for (int k = 0; k < 2; ++k)
+		{
+			const Body* body = bodies[k == 0 ? pairBodies[i].first : pairBodies[i].second];
+			types[k] = body->getType();
+			Vector3 min, max;
+			body->getBounds(min, max);
+			if (types[k] == typeSPHERE)
+			{
+				const Sphere* sphere = (const Sphere*) body;
+				min = sphere->getCenter();
+				max = Vector3(sphere->getRadius(), 0.0f, 0.0f);
+			}
+			shapes[k][0] = min.GetX(); shapes[k][1] = min.GetY(); shapes[k][2] = min.GetZ();
+			shapes[k][3] = max.GetX(); shapes[k][4] = max.GetY(); shapes[k][5] = max.GetZ();
+		}
+
+		if (types[0] == typePOINT || types[1] == typePOINT)
+		{
+			ASSERT_LT(other, batchCollide.getOtherPairs().size());
+			EXPECT_EQ((int) i, batchCollide.getOtherPairs()[other++]);
+			continue;
+		}
+		grouped++;
+
+		double point[3], normal[3], depth;
+		if (!referenceContact(types[0], shapes[0], types[1], shapes[1], point, normal, depth))
+		{
+			EXPECT_TRUE(contact == contacts.size() || contacts[contact].m_Pair != (int) i) << "pair " << i;
+			continue;
+		}
+
+		ASSERT_LT(contact, contacts.size());
+		const Contact& found = contacts[contact++];
+		ASSERT_EQ((int) i, found.m_Pair);
+		EXPECT_NEAR(depth, found.m_Depth, 1e-4);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			EXPECT_NEAR(point[axis], found.m_Point[axis], 1e-4) << "pair " << i;
+			EXPECT_NEAR(normal[axis], found.m_Normal[axis], 1e-4) << "pair " << i;
+		}
+	}
+	EXPECT_EQ(contacts.size(), contact);
+	EXPECT_EQ(batchCollide.getOtherPairs().size(), other);
+	EXPECT_EQ(grouped, batchCollide.getGroupSize(BatchCollide::GROUP_SPHERE_SPHERE) +
+		batchCollide.getGroupSize(BatchCollide::GROUP_SPHERE_BOX) + batchCollide.getGroupSize(BatchCollide::GROUP_BOX_BOX));
+	EXPECT_GT(contacts.size(), 100);
+}
+
+// A sphere whose center is inside a box leaves through the nearest face
+TEST(BatchCollide, SphereInsideBox)
+{
+	Sphere sphere(Vector3(0.2f, 0.5f, 0.5f), 0.1f);
+	AABB box(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+	ColliderStorage colliders;
+	ColliderPair pair;
+	pair.m_ColliderA = colliders.addCollider(&box);
+	pair.m_ColliderB = colliders.addCollider(&sphere);
+
+	BatchCollide batchCollide;
+	batchCollide.groupPairs(colliders, &pair, 1);
+	PoolVector<Contact> contacts;
+	batchCollide.collide(colliders, contacts);
+	ASSERT_EQ(1, contacts.size());
+	EXPECT_FLOAT_EQ(-1.0f, contacts[0].m_Normal[0]);
+	EXPECT_FLOAT_EQ(0.3f, contacts[0].m_Depth);
+	EXPECT_FLOAT_EQ(0.0f, contacts[0].m_Point[0]);
+}
+
+// The lists computeCollision gives are the same bit for bit on any number of threads, for every broad phase
+TEST(collideWorld, threads)
+{
+	const int count = 3000;
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+	std::uniform_real_distribution<float> size(0.25f, 1.0f);
+	std::vector<Vector3> centers;
+	std::vector<float> sizes;
+	for (int i = 0; i < count; ++i)
+	{
+		centers.push_back(Vector3(position(random), position(random), position(random)));
+		sizes.push_back(size(random));
+	}
+
+	const BroadPhaseType types[] = { BROADPHASE_SWEEP_AND_PRUNE, BROADPHASE_AABB_TREE, BROADPHASE_SPATIAL_HASH };
+	const int threadCounts[] = { 1, 2, 3, 8 };
+	for (int type = 0; type < 3; ++type)
+	{
+		std::vector<Contact> firstContacts;
+		std::vector<int> firstIDs;
+		std::vector<float> firstDistances;
+		for (int run = 0; run < 4; ++run)
+		{
+			// a sphere and a box at each center, and points on a grid too sparse for two to pair
+			// that go through Collide
+			std::vector<Sphere> spheres;
+			std::vector<AABB> boxes;
+			std::vector<Point> points;
+			for (int i = 0; i < count; ++i)
+			{
+				spheres.push_back(Sphere(centers[i], sizes[i]));
+				boxes.push_back(AABB(centers[i] - Vector3(sizes[i], 0.5f, 0.5f), centers[i] + Vector3(0.5f, sizes[i], sizes[i])));
+			}
+			for (int i = 0; i < 512; ++i)
+			{
+				points.push_back(Point(Vector3(2.0f * (i % 8) - 7.0f, 2.0f * (i / 8 % 8) - 7.0f, 2.0f * (i / 64) - 7.0f)));
+			}
+			std::vector<CollidableObject> objects;
+			for (int i = 0; i < count; ++i)
+			{
+				objects.push_back(CollidableObject(&spheres[i], Vector3(), 2 * i));
+				objects.push_back(CollidableObject(&boxes[i], Vector3(), 2 * i + 1));
+			}
+			for (int i = 0; i < 512; ++i)
+			{
+				objects.push_back(CollidableObject(&points[i], Vector3(), 2 * count + i));
+			}
+			std::vector<CollidableObject*> objectPointers;
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				objectPointers.push_back(&objects[i]);
+			}
+
+			CollisionWorld world(types[type], 2.0f);
+			world.setThreadCount(threadCounts[run]);
+			EXPECT_EQ(threadCounts[run], world.getThreadCount());
+			world.addObjects(&objectPointers[0], (int) objectPointers.size());
+			world.computeCollision();
+
+			// move the spheres so the broad phase updates its pairs
+			for (int i = 0; i < count; ++i)
+			{
+				spheres[i].update(1.0f, Vector3(0.25f * (i % 3), -0.25f * (i % 5), 0.0f));
+			}
+			world.computeCollision();
+
+			const CollisionTimings& timings = world.getTimings();
+			EXPECT_GE(timings.m_Total, timings.m_NarrowPhase);
+			EXPECT_GE(timings.m_Refit, 0.0f);
+			EXPECT_GE(timings.m_Merge, 0.0f);
+
+			std::vector<int> ids;
+			std::vector<float> distances;
+			for (int i = 0; i < world.getCollideSize(); ++i)
+			{
+				const CollisionPair& pair = world.getCollideList()[i];
+				ids.push_back(pair.m_pObject1->getObjectID());
+				ids.push_back(pair.m_pObject2->getObjectID());
+				distances.push_back(pair.m_Distance);
+			}
+			const PoolVector<Contact>& contacts = world.getContactList();
+			if (run == 0)
+			{
+				// enough pairs for several jobs and a sort in runs
+				EXPECT_GT(world.getBroadPhase()->getPairCount(), 20000);
+				EXPECT_LT(contacts.size(), ids.size() / 2);
+				firstContacts.assign(contacts.begin(), contacts.end());
+				firstIDs = ids;
+				firstDistances = distances;
+				continue;
+			}
+
+			ASSERT_EQ(firstContacts.size(), contacts.size()) << threadCounts[run] << " threads";
+			EXPECT_EQ(0, memcmp(&firstContacts[0], &contacts[0], contacts.size() * sizeof(Contact))) << threadCounts[run] << " threads";
+			EXPECT_TRUE(firstIDs == ids) << threadCounts[run] << " threads";
+			ASSERT_EQ(firstDistances.size(), distances.size());
+			EXPECT_EQ(0, memcmp(&firstDistances[0], &distances[0], distances.size() * sizeof(float))) << threadCounts[run] << " threads";
+		}
+	}
+}
+
+// Collision Test End
+
+// Memory Testing Start
+
+TEST(Memory, RecycleFreedBlock)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	Handle hle1 = MemoryManager::GetInstance()->Allocate(sizeof(Vector3));
+	void* address1 = MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle1);
+	MemoryManager::GetInstance()->Free(hle1);
+
+	Handle hle2 = MemoryManager::GetInstance()->Allocate(sizeof(Vector3));
+	EXPECT_EQ(address1, MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle2));
+	EXPECT_NE(hle1.m_counter, hle2.m_counter);
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+TEST(Memory, StaleHandle)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	Handle hle = MemoryManager::GetInstance()->Allocate(100);
+	EXPECT_TRUE(MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle) != NULL);
+	MemoryManager::GetInstance()->Free(hle);
+	EXPECT_TRUE(MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle) == NULL);
+	EXPECT_FALSE(MemoryManager::GetInstance()->IsValidHandle(Handle()));
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+TEST(Memory, PoolExhaustion)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	// The largest pool only holds one block
+	Handle hle1 = MemoryManager::GetInstance()->Allocate(4194304);
+	Handle hle2 = MemoryManager::GetInstance()->Allocate(4194304);
+	EXPECT_TRUE(hle1.IsValid());
+	EXPECT_FALSE(hle2.IsValid());
+
+	// A double free must not put the block on the free list twice
+	MemoryManager::GetInstance()->Free(hle1);
+	MemoryManager::GetInstance()->Free(hle1);
+	hle1 = MemoryManager::GetInstance()->Allocate(4194304);
+	hle2 = MemoryManager::GetInstance()->Allocate(4194304);
+	EXPECT_TRUE(hle1.IsValid());
+	EXPECT_FALSE(hle2.IsValid());
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+TEST(Memory, ThreadCacheConcurrent)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	const unsigned int numThreads = 4;
+	const unsigned int numBlocks = 1000;
+	bool corrupted[numThreads] = { false };
+	std::vector<std::thread> threads;
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+	{
+		threads.push_back(std::thread([t, &corrupted]()
+		{
+			std::vector<Handle> handles(numBlocks);
+			for (int round = 0; round < 10; ++round)
+			{
+				for (unsigned int i = 0; i < numBlocks; ++i)
+				{
+					handles[i] = MemoryManager::GetInstance()->Allocate(16);
+					*(unsigned int*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(handles[i]) = t * numBlocks + i;
+				}
+				for (unsigned int i = 0; i < numBlocks; ++i)
+				{
+					// Another thread writing to the same block would change the value
+					if (*(unsigned int*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(handles[i]) != t * numBlocks + i)
+						corrupted[t] = true;
+					MemoryManager::GetInstance()->Free(handles[i]);
+				}
+			}
+		}));
+	}
+	for (unsigned int t = 0; t < numThreads; ++t)
+	{
+		threads[t].join();
+		EXPECT_FALSE(corrupted[t]);
+	}
+
+	// Exited threads returned their caches to the pool
+	MemoryManager::GetInstance()->FlushThreadCache();
+	EXPECT_EQ(MEMORY_POOL_CONFIG[0][1], MemoryManager::GetInstance()->GetFreeBlockNum(0));
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+void RelocationCounter(void* oldAddress, void* newAddress, void* userData)
+{
+	EXPECT_NE(oldAddress, newAddress);
+	(*(int*) userData)++;
+}
+
+TEST(Memory, Defragment)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	const unsigned int numBlocks = 1000;
+	std::vector<Handle> handles(numBlocks);
+	for (unsigned int i = 0; i < numBlocks; ++i)
+	{
+		handles[i] = MemoryManager::GetInstance()->Allocate(16);
+		*(unsigned int*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(handles[i]) = i;
+	}
+
+	// Leave a hole in every other block
+	for (unsigned int i = 0; i < numBlocks; i += 2)
+	{
+		MemoryManager::GetInstance()->Free(handles[i]);
+	}
+	MemoryManager::GetInstance()->FlushThreadCache();
+	int relocations = 0;
+	MemoryManager::GetInstance()->SetRelocationCallback(handles[numBlocks - 1], RelocationCounter, &relocations);
+
+	MemoryManager::GetInstance()->Defragment(1000.0f);
+
+	// Handles still find their data, which is now packed at the front of the pool
+	char* lowest = NULL;
+	char* highest = NULL;
+	for (unsigned int i = 1; i < numBlocks; i += 2)
+	{
+		EXPECT_TRUE(MemoryManager::GetInstance()->IsValidHandle(handles[i]));
+		char* address = (char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(handles[i]);
+		EXPECT_EQ(i, *(unsigned int*) address);
+		if (!lowest || address < lowest)
+			lowest = address;
+		if (!highest || address > highest)
+			highest = address;
+	}
+	EXPECT_EQ((numBlocks / 2 - 1) * 16, highest - lowest);
+	EXPECT_EQ(1, relocations);
+
+	// New allocations come from the front too, a thread cache takes a few blocks at a time
+	char* address = (char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(MemoryManager::GetInstance()->Allocate(16));
+	EXPECT_GT(address, highest);
+	EXPECT_LE(address, highest + 16 * MEMORY_CACHE_CAPACITY);
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+TEST(Memory, LinearAllocator)
 {
-	Vector3 p1(1.0f, -1.0f, 1.0f);
-	Vector3 p2(-1.01f, 1.01f, -1.01f);
-	Vector3 p3(-1.0f, 1.0f, -1.0f);
-	Vector3 p4(-3.0f, 3.0f, -3.0f);
-	AABB aabb1(p1, p2);
-	AABB aabb2(p3, p4);
-	CollidableObject object1(&aabb1, p1, 0);
-	CollidableObject object2(&aabb2, p1, 1);
-	Collide collide;
+	LinearAllocator allocator;
+	allocator.Construct(256);
 
-	collide.collision(&object1, &object2);
+	char* first = (char*) allocator.Allocate(1, 1);
+	char* second = (char*) allocator.Allocate(16);
+	EXPECT_EQ(0, (uintptr_t) second % MEMORY_ALIGNMENT);
+	EXPECT_GT(second, first);
 
-	EXPECT_TRUE(collide.getCollide());
-/**
-	CollisionWorld world;
-	world.addObject(object1);
-	world.addObject(object2);
-	world.computeCollision();
+	// Everything after the marker is freed
+	size_t marker = allocator.GetMarker();
+	allocator.Allocate(64);
+	allocator.FreeToMarker(marker);
+	EXPECT_EQ(marker, allocator.GetUsedSize());
+
+	EXPECT_EQ(NULL, allocator.Allocate(512));
 
-	printf("# of objects: %d\n", world.getObjectSize());
-	printf("# of collides: %d\n", world.getCollideSize());
-*/
+	allocator.Reset();
+	EXPECT_EQ(first, allocator.Allocate(1, 1));
+
+	allocator.Destruct();
 }
 
-TEST(collideWorld, sphere2sphere)
+TEST(Memory, DoubleBufferedAllocator)
 {
-	Vector3 p1(0.0f, 0.0f, 0.0f);
-	Vector3 p2(1.0f, 0.0f, 0.0f);
-	float r1 = 0.5f;
-	float r2 = 0.51f;
-	Sphere sphere1(p1, r1);
-	Sphere sphere2(p2, r2);
-	CollidableObject object1(&sphere1, p1, 0);
-	CollidableObject object2(&sphere2, p1, 1);
-	Collide collide;
-/**
-	CollisionWorld world;
-	world.addObject(object1);
-	world.addObject(object2);
-	world.computeCollision();
+	DoubleBufferedAllocator allocator;
+	allocator.Construct(64);
+
+	int* frame0 = allocator.AllocateArray<int>(4);
+	frame0[0] = 42;
+	allocator.SwapBuffers();
 
-	printf("# of objects: %d\n", world.getObjectSize());
-	printf("# of collides: %d\n", world.getCollideSize());
-*/
+	// Last frame's data survives this frame
+	int* frame1 = allocator.AllocateArray<int>(4);
+	EXPECT_NE(frame0, frame1);
+	EXPECT_EQ(42, frame0[0]);
+	allocator.SwapBuffers();
+
+	// The first buffer is reused
+	EXPECT_EQ(frame0, allocator.AllocateArray<int>(4));
+
+	allocator.Destruct();
 }
 
-TEST(collideWorld, ray2sphere)
+TEST(Memory, LazyCommit)
 {
-	Vector3 p1(0.0f, 0.0f, 0.0f);
-	Vector3 p2(0.0f, 4.0f, 0.0f);
-	Vector3 vecDir(0.0f, 2.0f, 0.0f);
-	float r = 2.0f;
-	Sphere sphere(p2, r);
-	Ray ray(p1, vecDir);
-	CollidableObject object1(&ray, p1, 0);
-	CollidableObject object2(&sphere, p1, 1);
-/*
-	CollisionWorld world;
-	world.addObject(object1);
-	world.addObject(object2);
-	world.computeCollision();
+	EXPECT_TRUE(MemoryManager::GetInstance()->Construct());
+	EXPECT_EQ(0, MemoryManager::GetInstance()->GetCommittedSize());
+
+	// The first block of a pool commits one chunk, later blocks reuse it
+	Handle hle1 = MemoryManager::GetInstance()->Allocate(16);
+	EXPECT_EQ(MEMORY_COMMIT_SIZE, MemoryManager::GetInstance()->GetCommittedSize());
+	Handle hle2 = MemoryManager::GetInstance()->Allocate(16);
+	EXPECT_EQ(MEMORY_COMMIT_SIZE, MemoryManager::GetInstance()->GetCommittedSize());
+
+	// 64-bit addresses survive the handle lookup
+	char* address1 = (char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle1);
+	char* address2 = (char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle2);
+	address1[0] = 1;
+	address2[15] = 2;
+	EXPECT_EQ(0, (uintptr_t) address1 % MEMORY_ALIGNMENT);
+	EXPECT_EQ(16, abs(address2 - address1));
+
+	// The largest pool commits its single block only when asked
+	Handle large = MemoryManager::GetInstance()->Allocate(4194304);
+	EXPECT_EQ(MEMORY_COMMIT_SIZE + 4194304, MemoryManager::GetInstance()->GetCommittedSize());
+	((char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(large))[4194303] = 3;
 
-	printf("# of objects: %d\n", world.getObjectSize());
-	printf("# of collides: %d\n", world.getCollideSize());
-	*/
+	MemoryManager::GetInstance()->Destruct();
 }
 
-// Collision Test End
+TEST(Memory, Telemetry)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	Handle hle1 = MemoryManager::GetInstance()->Allocate(10, MEMORY_TAG_PHYSICS);
+	Handle hle2 = MemoryManager::GetInstance()->Allocate(12, MEMORY_TAG_RENDER);
+	MemoryManager::GetInstance()->Allocate(5000000);
+	EXPECT_EQ(MEMORY_TAG_PHYSICS, MemoryManager::GetInstance()->GetTag(hle1));
+
+	MemoryPoolStats pool = MemoryManager::GetInstance()->GetPoolStats(0);
+	EXPECT_EQ(2, pool.m_iLiveBlocks);
+	EXPECT_EQ(22, pool.m_iRequestedBytes);
+	EXPECT_EQ(0, pool.m_iFrameAllocations);
+
+	MemoryManager::GetInstance()->EndFrame();
+	MemoryManager::GetInstance()->Free(hle1);
+	MemoryManager::GetInstance()->EndFrame();
+
+	// The peak and the busiest frame outlive the allocations
+	pool = MemoryManager::GetInstance()->GetPoolStats(0);
+	EXPECT_EQ(1, pool.m_iLiveBlocks);
+	EXPECT_EQ(2, pool.m_iPeakBlocks);
+	EXPECT_EQ(12, pool.m_iRequestedBytes);
+	EXPECT_EQ(0, pool.m_iFrameAllocations);
+	EXPECT_EQ(2, pool.m_iPeakFrameAllocations);
+
+	MemoryTagStats physics = MemoryManager::GetInstance()->GetTagStats(MEMORY_TAG_PHYSICS);
+	MemoryTagStats render = MemoryManager::GetInstance()->GetTagStats(MEMORY_TAG_RENDER);
+	EXPECT_EQ(0, physics.m_iLiveBlocks);
+	EXPECT_EQ(1, render.m_iLiveBlocks);
+	EXPECT_EQ(16, render.m_iLiveBytes);
+
+	std::stringstream json;
+	MemoryManager::GetInstance()->DumpJson(json);
+	EXPECT_NE(std::string::npos, json.str().find("\"oversizeFailed\": 1"));
+	EXPECT_NE(std::string::npos, json.str().find("\"RENDER\": { \"live\": 1"));
+
+	MemoryManager::GetInstance()->Free(hle2);
+	MemoryManager::GetInstance()->Destruct();
+}
+
+TEST(Memory, ProfileGuidedConfig)
+{
+	MemoryManager::GetInstance()->Construct();
+	MemoryManager::GetInstance()->StartRecording();
+
+	// Two sizes in the 16 byte class and a lone 300 byte size
+	std::vector<Handle> handles;
+	for (int i = 0; i < 10; ++i)
+		handles.push_back(MemoryManager::GetInstance()->Allocate(8));
+	for (int i = 0; i < 4; ++i)
+		handles.push_back(MemoryManager::GetInstance()->Allocate(40));
+	handles.push_back(MemoryManager::GetInstance()->Allocate(300));
+	for (size_t i = 0; i < handles.size(); ++i)
+		MemoryManager::GetInstance()->Free(handles[i]);
+	handles.push_back(MemoryManager::GetInstance()->Allocate(8));
+
+	EXPECT_TRUE(MemoryManager::GetInstance()->StopRecording("memory_profile.txt"));
+	EXPECT_EQ(11, MemoryManager::GetInstance()->GetProfile().GetAllocations(0));
+	EXPECT_EQ(10, MemoryManager::GetInstance()->GetProfile().GetPeakLive(0));
+	MemoryManager::GetInstance()->Destruct();
+
+	// With enough classes every recorded size gets its own pool
+	EXPECT_TRUE(MemoryProfile::GeneratePoolConfig("memory_profile.txt", "memory_pools.txt", 8, 1.0f));
+	EXPECT_TRUE(MemoryManager::GetInstance()->Construct("memory_pools.txt"));
+	EXPECT_EQ(3, MemoryManager::GetInstance()->GetPoolNum());
+	EXPECT_EQ(16, MemoryManager::GetInstance()->GetPoolBlockSize(0));
+	EXPECT_EQ(10, MemoryManager::GetInstance()->GetPoolBlockNum(0));
+	EXPECT_EQ(48, MemoryManager::GetInstance()->GetPoolBlockSize(1));
+	EXPECT_EQ(304, MemoryManager::GetInstance()->GetPoolBlockSize(2));
+	EXPECT_FALSE(MemoryManager::GetInstance()->Allocate(400).IsValid());
+	MemoryManager::GetInstance()->Destruct();
+
+	// With two classes the small sizes share the cheaper merge
+	EXPECT_TRUE(MemoryProfile::GeneratePoolConfig("memory_profile.txt", "memory_pools.txt", 2, 1.0f));
+	EXPECT_TRUE(MemoryManager::GetInstance()->Construct("memory_pools.txt"));
+	EXPECT_EQ(2, MemoryManager::GetInstance()->GetPoolNum());
+	EXPECT_EQ(48, MemoryManager::GetInstance()->GetPoolBlockSize(0));
+	EXPECT_EQ(14, MemoryManager::GetInstance()->GetPoolBlockNum(0));
+	MemoryManager::GetInstance()->Destruct();
+
+	EXPECT_FALSE(MemoryManager::GetInstance()->Construct("missing_pools.txt"));
+}
+
+TEST(Memory, PoolAllocator)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	// Containers are destroyed before the manager
+	{
+		PoolVector<int> numbers;
+		for (int i = 0; i < 100; ++i)
+			numbers.push_back(i);
+		EXPECT_TRUE(MemoryManager::GetInstance()->OwnsAddress(numbers.data()));
+		EXPECT_EQ(99, numbers[99]);
+
+		PoolUnorderedMap<PoolString, int> map;
+		map[PoolString("shader.hlsl")] = 1;
+		map[PoolString("texture.dds")] = 2;
+		EXPECT_EQ(2, map.find(PoolString("texture.dds"))->second);
+		EXPECT_TRUE(map.find(PoolString("missing")) == map.end());
+	}
+
+	// Sizes larger than every pool fall back to the heap
+	void* large = MemoryManager::GetInstance()->AllocateRaw(5000000);
+	EXPECT_NE((void*) NULL, large);
+	EXPECT_FALSE(MemoryManager::GetInstance()->OwnsAddress(large));
+	EXPECT_EQ(0, (uintptr_t) large % MEMORY_ALIGNMENT);
+	MemoryManager::GetInstance()->FreeRaw(large);
+
+	// An arena-backed vector stays inside the arena
+	LinearAllocator arena;
+	arena.Construct(1024);
+	{
+		PoolVector<int> scratch((PoolAllocator<int>(&arena)));
+		scratch.push_back(1);
+		scratch.push_back(2);
+		EXPECT_FALSE(MemoryManager::GetInstance()->OwnsAddress(scratch.data()));
+		EXPECT_LT(0, arena.GetUsedSize());
+	}
+	arena.Destruct();
+
+	// A container that outlives the pools leaves its memory behind
+	PoolVector<int>* late = new PoolVector<int>(100, 1);
+	EXPECT_TRUE(MemoryManager::GetInstance()->OwnsAddress(late->data()));
+	MemoryManager::GetInstance()->Destruct();
+	delete late;
+}
+
+TEST(Memory, PinnedBlock)
+{
+	MemoryManager::GetInstance()->Construct();
+
+	std::vector<Handle> handles;
+	for (int i = 0; i < 4; ++i)
+		handles.push_back(MemoryManager::GetInstance()->Allocate(16));
+	int* pinned = (int*) MemoryManager::GetInstance()->AllocateRaw(16);
+	*pinned = 42;
+	Handle moving = MemoryManager::GetInstance()->Allocate(16);
+	*(int*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(moving) = 7;
+	for (size_t i = 0; i < handles.size(); ++i)
+		MemoryManager::GetInstance()->Free(handles[i]);
+
+	// Handle blocks move into the holes, the raw block keeps its address
+	void* before = MemoryManager::GetInstance()->GetMemoryAddressFromHandle(moving);
+	MemoryManager::GetInstance()->FlushThreadCache();
+	MemoryManager::GetInstance()->Defragment(100.0f);
+	EXPECT_LT(MemoryManager::GetInstance()->GetMemoryAddressFromHandle(moving), before);
+	EXPECT_EQ(7, *(int*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(moving));
+	EXPECT_EQ(42, *pinned);
+
+	MemoryManager::GetInstance()->FreeRaw(pinned);
+	MemoryManager::GetInstance()->Free(moving);
+	MemoryManager::GetInstance()->Destruct();
+}
+
+// Counts its live instances to check the pool constructs and destroys in place
+struct PooledObject
+{
+	static int								s_iLive;
+	int										m_iValue;
+
+	PooledObject(int value) : m_iValue(value) { ++s_iLive; }
+	PooledObject(const PooledObject& other) : m_iValue(other.m_iValue) { ++s_iLive; }
+	~PooledObject() { --s_iLive; }
+};
+
+int PooledObject::s_iLive = 0;
+
+TEST(Memory, ObjectPool)
+{
+	ObjectPool<PooledObject> pool;
+	EXPECT_TRUE(pool.Construct(4));
+
+	Handle hle[4];
+	for (int i = 0; i < 4; ++i)
+		hle[i] = pool.Create(i);
+	EXPECT_FALSE(pool.Create(4).IsValid());
+	EXPECT_EQ(4, PooledObject::s_iLive);
+
+	// The last object fills the hole, its handle follows it
+	EXPECT_TRUE(pool.Destroy(hle[1]));
+	EXPECT_FALSE(pool.Destroy(hle[1]));
+	EXPECT_EQ(NULL, pool.Get(hle[1]));
+	EXPECT_EQ(3, pool.GetCount());
+	EXPECT_EQ(3, PooledObject::s_iLive);
+	EXPECT_EQ(3, pool[1].m_iValue);
+	EXPECT_EQ(&pool[1], pool.Get(hle[3]));
+	EXPECT_EQ(hle[3], pool.GetHandle(1));
+
+	// New objects are appended to the packed range
+	Handle added = pool.Create(5);
+	EXPECT_EQ(&pool[3], pool.Get(added));
+
+	int sum = 0;
+	for (PooledObject* object = pool.begin(); object != pool.end(); ++object)
+		sum += object->m_iValue;
+	EXPECT_EQ(0 + 3 + 2 + 5, sum);
+
+	pool.Clear();
+	EXPECT_EQ(0, PooledObject::s_iLive);
+	EXPECT_EQ(NULL, pool.Get(hle[0]));
+	EXPECT_EQ(&pool[0], pool.Get(pool.Create(6)));
+
+	pool.Destruct();
+	EXPECT_EQ(0, PooledObject::s_iLive);
+}
+
+// Reference for the size class tables, the first pool whose blocks hold size bytes
+unsigned int linearSizeClass(size_t size)
+{
+	unsigned int i = 0;
+	while (i < MemoryManager::GetInstance()->GetPoolNum() && size > MemoryManager::GetInstance()->GetPoolBlockSize(i))
+		++i;
+	return i;
+}
+
+TEST(Memory, SizeClass)
+{
+	MemoryManager::GetInstance()->Construct();
+	for (size_t size = 0; size <= 70000; ++size)
+		EXPECT_EQ(linearSizeClass(size), MemoryManager::GetInstance()->GetSizeClass(size));
+	for (size_t size = 1024; size <= 8388608; size *= 2)
+	{
+		EXPECT_EQ(linearSizeClass(size - 1), MemoryManager::GetInstance()->GetSizeClass(size - 1));
+		EXPECT_EQ(linearSizeClass(size), MemoryManager::GetInstance()->GetSizeClass(size));
+		EXPECT_EQ(linearSizeClass(size + 1), MemoryManager::GetInstance()->GetSizeClass(size + 1));
+	}
+	EXPECT_EQ(22, MemoryManager::GetInstance()->GetSizeClass(4194304));
+	EXPECT_EQ(MEMORY_POOL_NUM, MemoryManager::GetInstance()->GetSizeClass(4194305));
+	MemoryManager::GetInstance()->Destruct();
+
+	// Several pools inside one power of two range
+	std::ofstream file("memory_pools.txt");
+	file << "16 8\n48 8\n1040 8\n1536 8\n2000 8\n2048 8\n";
+	file.close();
+	EXPECT_TRUE(MemoryManager::GetInstance()->Construct("memory_pools.txt"));
+	for (size_t size = 0; size <= 2100; ++size)
+		EXPECT_EQ(linearSizeClass(size), MemoryManager::GetInstance()->GetSizeClass(size));
+	MemoryManager::GetInstance()->Destruct();
+
+	EXPECT_FALSE(MemoryManager::GetInstance()->Allocate(16).IsValid());
+}
+
+// Memory Test End
 
 #endif
 #ifdef NDEBUG
@@ -450,19 +3617,19 @@ void TEST_SPEED_QUAT_MUL()
 	}
 	QueryPerformanceCounter(&perf_end);
 	float elapsedSIMD = (perf_end.QuadPart - perf_start.QuadPart) / freqms;
-	std::cout << "SSE SIMD multiplication\n";
+	std::cout << SIMDBackend::Name() << " SIMD multiplication\n";
 	std::cout << "Total duration for 10000 = " << elapsedSIMD << "ms\n";
 	std::cout << "Average duration = " << elapsedSIMD / 10000.0f << "ms\n";
 
 	// DirectX
 	QueryPerformanceCounter(&perf_start);
-	Vector3 DXqv(1.0f, 2.0f, 3.0f);
-	Quat DXq1(DXqv, 3);
+	DirectX::XMVECTOR DXqv = DirectX::XMVectorSet(1.0f, 2.0f, 3.0f, 0.0f);
+	DirectX::XMVECTOR DXq1 = DirectX::XMQuaternionRotationAxis(DirectX::XMVector3Normalize(DXqv), 3);
 	for (int i = 0; i < 10000; i++)
 	{
-		DXqv.Multiply(i);
-		Quat DXq2(DXqv, 3);
-		DXq1.MultiplyDX(DXq2);
+		DXqv = DirectX::XMVectorScale(DXqv, (float) i);
+		DirectX::XMVECTOR DXq2 = DirectX::XMQuaternionRotationAxis(DirectX::XMVector3Normalize(DXqv), 3);
+		DXq1 = DirectX::XMQuaternionMultiply(DXq2, DXq1);
 	}
 	QueryPerformanceCounter(&perf_end);
 
@@ -543,13 +3710,13 @@ void TEST_SPEED_FILE_IO()
 
 void TEST_POOL_MEMORY()
 {
-	MemoryManager::getInstance()->Construct();
-	MemoryManager::getInstance()->Print();
+	MemoryManager::GetInstance()->Construct();
+	MemoryManager::GetInstance()->Print();
 
-	Handle hle1 = MemoryManager::getInstance()->Allocate(sizeof(Vector3));
-	Handle hle2 = MemoryManager::getInstance()->Allocate(sizeof(Vector3));
+	Handle hle1 = MemoryManager::GetInstance()->Allocate(sizeof(Vector3));
+	Handle hle2 = MemoryManager::GetInstance()->Allocate(sizeof(Vector3));
 
-	MemoryManager::getInstance()->Print();
+	MemoryManager::GetInstance()->Print();
 
 	Vector3* temp1 = new(hle1) Vector3(0, 0, 0);
 	Vector3* temp2 = new(hle2) Vector3(0, 0, 0);
@@ -558,17 +3725,729 @@ void TEST_POOL_MEMORY()
 	std::cout << "handle 1: " << (uint32_t)hle1 << " ";
 	std::cout << "handle 2: " << (uint32_t)hle2 << "\n";
 
-	MemoryManager::getInstance()->Free(hle1);
-	MemoryManager::getInstance()->Print();
+	MemoryManager::GetInstance()->Free(hle1);
+	MemoryManager::GetInstance()->Print();
 
-	Handle hle3 = MemoryManager::getInstance()->Allocate(sizeof(Vector3));
+	Handle hle3 = MemoryManager::GetInstance()->Allocate(sizeof(Vector3));
 	Vector3* temp3 = new(hle3) Vector3(0, 0, 0);
 
-	MemoryManager::getInstance()->Print();
+	MemoryManager::GetInstance()->Print();
 
 	std::cout << '\n' << temp3 << " " << temp2 << "\n";
 
-	MemoryManager::getInstance()->Destruct();
+	MemoryManager::GetInstance()->Destruct();
+}
+
+// Each thread keeps a small working set of mixed small sizes and replaces one entry per iteration
+void TEST_SPEED_MT_ALLOC()
+{
+	const unsigned int threadCounts[] = { 1, 4, 16, 64 };
+	const unsigned int sizes[] = { 8, 16, 24, 40, 64 };
+	const int iterations = 200000;
+	const int workingSet = 16;
+
+	std::cout << "Testing multi-threaded allocation of small blocks" << '\n';
+	MemoryManager::GetInstance()->Construct();
+
+	for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+	{
+		unsigned int numThreads = threadCounts[t];
+		std::atomic<unsigned int> failed(0);
+
+		// Pool
+		std::vector<std::thread> threads;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numThreads; ++i)
+		{
+			threads.push_back(std::thread([&sizes, &failed]()
+			{
+				Handle handles[workingSet];
+				for (int j = 0; j < iterations; ++j)
+				{
+					int slot = j % workingSet;
+					if (handles[slot].IsValid())
+						MemoryManager::GetInstance()->Free(handles[slot]);
+					handles[slot] = MemoryManager::GetInstance()->Allocate(sizes[j % 5]);
+					if (!handles[slot].IsValid())
+						failed++;
+				}
+				for (int j = 0; j < workingSet; ++j)
+				{
+					if (handles[j].IsValid())
+						MemoryManager::GetInstance()->Free(handles[j]);
+				}
+			}));
+		}
+		for (unsigned int i = 0; i < numThreads; ++i)
+			threads[i].join();
+		double elapsedPool = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// malloc
+		threads.clear();
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numThreads; ++i)
+		{
+			threads.push_back(std::thread([&sizes]()
+			{
+				void* ptrs[workingSet] = { NULL };
+				for (int j = 0; j < iterations; ++j)
+				{
+					int slot = j % workingSet;
+					free(ptrs[slot]);
+					ptrs[slot] = malloc(sizes[j % 5]);
+				}
+				for (int j = 0; j < workingSet; ++j)
+					free(ptrs[j]);
+			}));
+		}
+		for (unsigned int i = 0; i < numThreads; ++i)
+			threads[i].join();
+		double elapsedMalloc = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Wall time over all operations of all threads, an operation is one free plus one allocation
+		double ops = (double) numThreads * iterations;
+		std::cout << numThreads << " threads\n";
+		std::cout << "MemoryManager = " << elapsedPool / ops << "ns/op, failed allocations = " << failed << "\n";
+		std::cout << "malloc = " << elapsedMalloc / ops << "ns/op\n";
+	}
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+// One step of an allocation trace, a size of 0 frees the slot
+struct AllocatorOp
+{
+	unsigned int							m_iSlot;
+	unsigned int							m_iSize;
+};
+
+// Replay a trace on the MemoryManager and on malloc, an operation is one allocation or one free
+void speedAllocatorTrace(const char* name, const std::vector<AllocatorOp>& trace, unsigned int slotNum)
+{
+	unsigned int failed = 0;
+	std::vector<Handle> handles(slotNum);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < trace.size(); ++i)
+	{
+		Handle& hle = handles[trace[i].m_iSlot];
+		if (trace[i].m_iSize == 0)
+		{
+			MemoryManager::GetInstance()->Free(hle);
+			continue;
+		}
+		hle = MemoryManager::GetInstance()->Allocate(trace[i].m_iSize);
+		if (hle.IsValid())
+			*(char*) MemoryManager::GetInstance()->GetMemoryAddressFromHandle(hle) = 1;
+		else
+			failed++;
+	}
+	double elapsedPool = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::vector<void*> ptrs(slotNum, (void*) NULL);
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < trace.size(); ++i)
+	{
+		void*& ptr = ptrs[trace[i].m_iSlot];
+		if (trace[i].m_iSize == 0)
+		{
+			free(ptr);
+			ptr = NULL;
+			continue;
+		}
+		ptr = malloc(trace[i].m_iSize);
+		*(char*) ptr = 1;
+	}
+	double elapsedMalloc = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::cout << name << "\n";
+	std::cout << "MemoryManager = " << elapsedPool / trace.size() << "ns/op, failed allocations = " << failed << "\n";
+	std::cout << "malloc = " << elapsedMalloc / trace.size() << "ns/op\n";
+}
+
+// Single-size storms, mixed sizes, alloc/free ping-pong and a fragmenting trace, each against malloc
+void TEST_SPEED_ALLOCATOR()
+{
+	std::cout << "Testing allocation patterns" << '\n';
+	MemoryManager::GetInstance()->Construct();
+	unsigned int seed = 12345;
+	std::vector<AllocatorOp> trace;
+
+	// Fill a pool, then empty it
+	const unsigned int stormBlocks = 50000;
+	for (int round = 0; round < 10; ++round)
+	{
+		for (unsigned int i = 0; i < stormBlocks; ++i)
+		{
+			AllocatorOp op = { i, 16 };
+			trace.push_back(op);
+		}
+		for (unsigned int i = 0; i < stormBlocks; ++i)
+		{
+			AllocatorOp op = { i, 0 };
+			trace.push_back(op);
+		}
+	}
+	speedAllocatorTrace("Single-size storm", trace, stormBlocks);
+
+	// Replace a random entry of a working set with a random size, mostly small
+	const unsigned int workingSet = 256;
+	trace.clear();
+	for (unsigned int i = 0; i < workingSet; ++i)
+	{
+		AllocatorOp op = { i, 16 };
+		trace.push_back(op);
+	}
+	for (int i = 0; i < 500000; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		unsigned int slot = (seed >> 16) % workingSet;
+		seed = seed * 1103515245 + 12345;
+		unsigned int size = (seed >> 16) % 16 ? 8 + (seed >> 20) % 1024 : 2048 + (seed >> 20) % 14336;
+		AllocatorOp freeOp = { slot, 0 };
+		AllocatorOp allocOp = { slot, size };
+		trace.push_back(freeOp);
+		trace.push_back(allocOp);
+	}
+	for (unsigned int i = 0; i < workingSet; ++i)
+	{
+		AllocatorOp op = { i, 0 };
+		trace.push_back(op);
+	}
+	speedAllocatorTrace("Mixed sizes", trace, workingSet);
+
+	// The same block over and over
+	trace.clear();
+	for (int i = 0; i < 1000000; ++i)
+	{
+		AllocatorOp allocOp = { 0, 64 };
+		AllocatorOp freeOp = { 0, 0 };
+		trace.push_back(allocOp);
+		trace.push_back(freeOp);
+	}
+	speedAllocatorTrace("Ping-pong", trace, 1);
+
+	// Free every other block and fill the holes with other sizes
+	const unsigned int fragmentBlocks = 4000;
+	trace.clear();
+	for (int round = 0; round < 20; ++round)
+	{
+		for (unsigned int i = 0; i < fragmentBlocks; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			AllocatorOp op = { i, 16 + (seed >> 16) % 112 };
+			trace.push_back(op);
+		}
+		for (unsigned int i = 0; i < fragmentBlocks; i += 2)
+		{
+			AllocatorOp op = { i, 0 };
+			trace.push_back(op);
+		}
+		for (unsigned int i = 0; i < fragmentBlocks; i += 2)
+		{
+			seed = seed * 1103515245 + 12345;
+			AllocatorOp op = { i, 128 + (seed >> 16) % 896 };
+			trace.push_back(op);
+		}
+		for (unsigned int i = 0; i < fragmentBlocks; ++i)
+		{
+			AllocatorOp op = { i, 0 };
+			trace.push_back(op);
+		}
+	}
+	speedAllocatorTrace("Fragmentation", trace, fragmentBlocks);
+
+	MemoryManager::GetInstance()->Destruct();
+}
+
+// Plain C++ versions of the maths kernels, the baseline for TEST_SPEED_MATH
+struct ScalarMatrix4
+{
+	float m[4][4];
+};
+
+void scalarMultiply(ScalarMatrix4& a, const ScalarMatrix4& b)
+{
+	ScalarMatrix4 result;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+		}
+	}
+	a = result;
+}
+
+void scalarTransform(float v[3], const ScalarMatrix4& mat)
+{
+	float result[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		result[i] = mat.m[i][0] * v[0] + mat.m[i][1] * v[1] + mat.m[i][2] * v[2] + mat.m[i][3];
+	}
+	v[0] = result[0]; v[1] = result[1]; v[2] = result[2];
+}
+
+void scalarNormalize(float v[3])
+{
+	float inv = 1.0f / sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	v[0] *= inv; v[1] *= inv; v[2] *= inv;
+}
+
+void scalarCross(float a[3], const float b[3])
+{
+	float result[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+	a[0] = result[0]; a[1] = result[1]; a[2] = result[2];
+}
+
+// a = a * b, quaternions are x, y, z, w
+void scalarQuatMultiply(float a[4], const float b[4])
+{
+	float result[4] = {
+		a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1],
+		a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0],
+		a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3],
+		a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2] };
+	a[0] = result[0]; a[1] = result[1]; a[2] = result[2]; a[3] = result[3];
+}
+
+// Time iterations of a kernel, each iteration depends on the last one as the transforms in MeshData::Transform do
+template <typename Kernel>
+double speedMathKernel(int iterations, Kernel kernel)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; ++i)
+	{
+		kernel();
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+}
+
+void printMathSpeed(const char* name, double simd, double dx, double scalar, float sink)
+{
+	std::cout << name << "\n";
+	std::cout << SIMDBackend::Name() << " = " << simd << "ns/op, DirectXMath = " << dx << "ns/op, scalar = " << scalar << "ns/op";
+	std::cout << " (" << sink << ")\n";
+}
+
+// Time one operation of a backend on 8 independent chains, so its throughput is measured rather than its latency
+template <typename Vec, typename Operation>
+double speedBackendOperation(Vec chains[8], Operation operation)
+{
+	const int iterations = 100000;
+	const int repeats = 64;
+	return speedMathKernel(iterations, [&]() {
+		Vec v[8];
+		memcpy(v, chains, sizeof(v));
+		for (int k = 0; k < repeats; ++k)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				v[i] = operation(v[i]);
+			}
+		}
+		memcpy(chains, v, sizeof(v));
+	}) / (8 * repeats);
+}
+
+// Throughput of the operations of one backend in ns for one operation on all lanes
+template <typename B>
+void speedBackend()
+{
+	typedef decltype(B::Splat(0.0f)) Vec;
+
+	// Operands that keep the chains bounded and away from denormals
+	Vec chains[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		chains[i] = B::Splat(1.0f + i * 0.01f);
+	}
+	Vec up = B::Splat(1.0000001f), one = B::Splat(1.0f), step = B::Splat(0.0001f);
+
+	double add = speedBackendOperation(chains, [&](Vec v) { return B::Add(v, step); });
+	double mul = speedBackendOperation(chains, [&](Vec v) { return B::Mul(v, up); });
+	double mulAdd = speedBackendOperation(chains, [&](Vec v) { return B::MulAdd(v, up, step); });
+	double div = speedBackendOperation(chains, [&](Vec v) { return B::Div(v, up); });
+	double sqrt4 = speedBackendOperation(chains, [&](Vec v) { return B::Sqrt(v); });
+	double rsqrt = speedBackendOperation(chains, [&](Vec v) { return B::Rsqrt(v); });
+	double select = speedBackendOperation(chains, [&](Vec v) { return B::Select(B::CmpLT(v, one), B::Add(v, one), v); });
+
+	float lanes[sizeof(Vec) / sizeof(float)];
+	memcpy(lanes, &chains[0], sizeof(lanes));
+	std::cout << B::Name() << " x" << sizeof(Vec) / sizeof(float) << ": add = " << add << ", mul = " << mul;
+	std::cout << ", mul-add = " << mulAdd << ", div = " << div << ", sqrt = " << sqrt4;
+	std::cout << ", rsqrt = " << rsqrt << ", compare and select = " << select << " (" << lanes[0] << ")\n";
+}
+
+// Matrix multiply, transform, normalize, cross product and quaternion multiply against DirectXMath and plain C++
+void TEST_SPEED_MATH()
+{
+	std::cout << "Testing maths kernels" << '\n';
+	const int iterations = 1000000;
+
+	// Rotations keep the chained products bounded
+	Matrix4 rotation;
+	rotation.CreateRotationY(0.3f);
+	Matrix4 rotationX;
+	rotationX.CreateRotationX(0.2f);
+	rotation.Multiply(rotationX);
+	rotation.setTranslate(0.1f, 0.2f, 0.3f);
+	ScalarMatrix4 scalarRotation;
+	DirectX::XMFLOAT4X4 dxRotation;
+	for (int i = 0; i < 4; ++i)
+	{
+		Vector3 row(i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f);
+		row.TransformAsVector(rotation);
+		scalarRotation.m[i][0] = dxRotation.m[i][0] = i < 3 ? row.GetX() : 0.0f;
+		scalarRotation.m[i][1] = dxRotation.m[i][1] = i < 3 ? row.GetY() : 0.0f;
+		scalarRotation.m[i][2] = dxRotation.m[i][2] = i < 3 ? row.GetZ() : 0.0f;
+	}
+	scalarRotation.m[0][3] = dxRotation.m[0][3] = rotation.getTranslateX();
+	scalarRotation.m[1][3] = dxRotation.m[1][3] = rotation.getTranslateY();
+	scalarRotation.m[2][3] = dxRotation.m[2][3] = rotation.getTranslateZ();
+	scalarRotation.m[3][3] = dxRotation.m[3][3] = 1.0f;
+	DirectX::XMMATRIX dxMat = DirectX::XMLoadFloat4x4(&dxRotation);
+
+	// Matrix * matrix
+	Matrix4 simdResult = rotation;
+	double simd = speedMathKernel(iterations, [&]() { simdResult.Multiply(rotation); });
+	DirectX::XMMATRIX dxResult = dxMat;
+	double dx = speedMathKernel(iterations, [&]() { dxResult = DirectX::XMMatrixMultiply(dxResult, dxMat); });
+	ScalarMatrix4 scalarResult = scalarRotation;
+	double scalar = speedMathKernel(iterations, [&]() { scalarMultiply(scalarResult, scalarRotation); });
+	printMathSpeed("Matrix * matrix", simd, dx, scalar,
+		simdResult.getTranslateX() + DirectX::XMVectorGetW(dxResult.r[0]) + scalarResult.m[0][3]);
+
+	// Matrix * point
+	Vector3 simdVector(1.0f, 2.0f, 3.0f);
+	simd = speedMathKernel(iterations, [&]() { simdVector.Transform(rotation); });
+	DirectX::XMVECTOR dxVector = DirectX::XMVectorSet(1.0f, 2.0f, 3.0f, 1.0f);
+	DirectX::XMMATRIX dxColumns = DirectX::XMMatrixTranspose(dxMat); // DirectXMath transforms row vectors
+	dx = speedMathKernel(iterations, [&]() { dxVector = DirectX::XMVector3Transform(dxVector, dxColumns); });
+	float scalarVector[3] = { 1.0f, 2.0f, 3.0f };
+	scalar = speedMathKernel(iterations, [&]() { scalarTransform(scalarVector, scalarRotation); });
+	printMathSpeed("Matrix * point", simd, dx, scalar,
+		simdVector.GetX() + DirectX::XMVectorGetX(dxVector) + scalarVector[0]);
+
+	// Normalize
+	Vector3 offset(0.01f, 0.02f, 0.03f);
+	simd = speedMathKernel(iterations, [&]() { simdVector.Add(offset); simdVector.Normalize(); });
+	DirectX::XMVECTOR dxOffset = DirectX::XMVectorSet(0.01f, 0.02f, 0.03f, 0.0f);
+	dx = speedMathKernel(iterations, [&]() { dxVector = DirectX::XMVector3Normalize(DirectX::XMVectorAdd(dxVector, dxOffset)); });
+	scalar = speedMathKernel(iterations, [&]() {
+		scalarVector[0] += 0.01f; scalarVector[1] += 0.02f; scalarVector[2] += 0.03f;
+		scalarNormalize(scalarVector);
+	});
+	printMathSpeed("Normalize", simd, dx, scalar,
+		simdVector.GetX() + DirectX::XMVectorGetX(dxVector) + scalarVector[0]);
+
+	// Cross product, the unit axis keeps the length bounded
+	simd = speedMathKernel(iterations, [&]() { simdVector = CrossProduct(simdVector, Vector3::UnitY); });
+	DirectX::XMVECTOR dxAxis = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	dx = speedMathKernel(iterations, [&]() { dxVector = DirectX::XMVector3Cross(dxVector, dxAxis); });
+	const float scalarAxis[3] = { 0.0f, 1.0f, 0.0f };
+	scalar = speedMathKernel(iterations, [&]() { scalarCross(scalarVector, scalarAxis); });
+	printMathSpeed("Cross product", simd, dx, scalar,
+		simdVector.GetX() + DirectX::XMVectorGetX(dxVector) + scalarVector[0]);
+
+	// Quaternion * quaternion, unit quaternions keep the chained products bounded
+	Vector3 axisZ(0.0f, 0.0f, 1.0f);
+	Vector3 axisX(1.0f, 0.0f, 0.0f);
+	Quat simdQuat(axisZ, 0.1f);
+	Quat simdStep(axisX, 0.2f);
+	simd = speedMathKernel(iterations, [&]() { simdQuat.Multiply(simdStep); });
+	DirectX::XMVECTOR dxQuat = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), 0.1f);
+	DirectX::XMVECTOR dxStep = DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.2f);
+	dx = speedMathKernel(iterations, [&]() { dxQuat = DirectX::XMQuaternionMultiply(dxStep, dxQuat); });
+	float scalarQuat[4] = { 0.0f, 0.0f, sinf(0.05f), cosf(0.05f) };
+	const float scalarStep[4] = { sinf(0.1f), 0.0f, 0.0f, cosf(0.1f) };
+	scalar = speedMathKernel(iterations, [&]() { scalarQuatMultiply(scalarQuat, scalarStep); });
+	printMathSpeed("Quaternion * quaternion", simd, dx, scalar,
+		simdQuat.GetW() + DirectX::XMVectorGetW(dxQuat) + scalarQuat[3]);
+
+	// Streams of points against one Transform per point
+	const int streamSize = 4096;
+	std::vector<float> streamX(streamSize, 1.0f), streamY(streamSize, 2.0f), streamZ(streamSize, 3.0f);
+	std::vector<Vector3> streamPoints(streamSize, Vector3(1.0f, 2.0f, 3.0f));
+	double soa = speedMathKernel(iterations / streamSize, [&]() {
+		TransformPoints(rotation, &streamX[0], &streamY[0], &streamZ[0], &streamX[0], &streamY[0], &streamZ[0], streamSize);
+	}) / streamSize;
+	double aos = speedMathKernel(iterations / streamSize, [&]() {
+		TransformPoints(rotation, &streamPoints[0], sizeof(Vector3), &streamPoints[0], sizeof(Vector3), streamSize);
+	}) / streamSize;
+	double single = speedMathKernel(iterations / streamSize, [&]() {
+		for (int i = 0; i < streamSize; ++i)
+		{
+			streamPoints[i].Transform(rotation);
+		}
+	}) / streamSize;
+	std::cout << "Point streams\n";
+	std::cout << "SoA = " << soa << "ns/point, AoS = " << aos << "ns/point, one at a time = " << single << "ns/point";
+	std::cout << " (" << streamX[0] + streamPoints[0].GetX() << ")\n";
+
+	// Batched sin/cos and rotations against the C library one angle at a time
+	std::vector<float> angles(streamSize), sines(streamSize), cosines(streamSize);
+	for (int i = 0; i < streamSize; ++i)
+	{
+		angles[i] = 0.01f * i - 20.0f;
+	}
+	double batched = speedMathKernel(iterations / streamSize, [&]() {
+		SinCos(&angles[0], &sines[0], &cosines[0], streamSize);
+	}) / streamSize;
+	double libm = speedMathKernel(iterations / streamSize, [&]() {
+		for (int i = 0; i < streamSize; ++i)
+		{
+			sines[i] = sinf(angles[i]);
+			cosines[i] = cosf(angles[i]);
+		}
+	}) / streamSize;
+	std::cout << "Sin and cos\n";
+	std::cout << "Batched = " << batched << "ns/angle, sinf and cosf = " << libm << "ns/angle (" << sines[1] + cosines[1] << ")\n";
+
+	std::vector<Matrix4> rotations(streamSize);
+	batched = speedMathKernel(iterations / streamSize, [&]() {
+		CreateRotationsZ(&angles[0], &rotations[0], streamSize);
+	}) / streamSize;
+	single = speedMathKernel(iterations / streamSize, [&]() {
+		for (int i = 0; i < streamSize; ++i)
+		{
+			rotations[i].CreateRotationZ(angles[i]);
+		}
+	}) / streamSize;
+	std::cout << "Rotation matrices\n";
+	std::cout << "Batched = " << batched << "ns/matrix, one at a time = " << single << "ns/matrix (" << rotations[1].getTranslateX() << ")\n";
+
+	// Every backend compiled in, in ns for one operation on all lanes
+	std::cout << "Backend throughput\n";
+	speedBackend<SIMDScalar>();
+	speedBackend<SIMDPair<SIMDScalar> >();
+#ifdef SIMD_HAS_SSE41
+	speedBackend<SIMDSSE41>();
+	speedBackend<SIMDPair<SIMDSSE41> >();
+#endif
+#ifdef SIMD_HAS_AVX2
+	speedBackend<SIMDAVX2>();
+	speedBackend<SIMDAVX2x8>();
+#endif
+}
+
+// Sweep and prune over a world of mostly resting boxes against testing every pair
+// Build, move one box in ten a little each frame and cast rays, the same boxes and moves for every broad phase
+void speedBroadPhase(const char* name, BroadPhase& broadPhase, std::vector<Vector3> mins, std::vector<Vector3> maxs)
+{
+	const int count = (int) mins.size();
+	const int frames = 100;
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+	std::vector<void*> userData(count, NULL);
+	std::vector<int> proxies(count);
+	double build = speedMathKernel(1, [&]() {
+		broadPhase.addProxies(&mins[0], &maxs[0], &userData[0], count, &proxies[0]);
+		broadPhase.updatePairs();
+	});
+
+	size_t changes = 0;
+	double update = speedMathKernel(frames, [&]() {
+		for (int i = 0; i < count; i += 10)
+		{
+			Vector3 offset(step(random), step(random), step(random));
+			mins[i] += offset;
+			maxs[i] += offset;
+			broadPhase.moveProxy(proxies[i], mins[i], maxs[i]);
+		}
+		broadPhase.updatePairs();
+		changes += broadPhase.getAddedPairs().size() + broadPhase.getRemovedPairs().size();
+	});
+
+	size_t hits = 0;
+	PoolVector<int> found;
+	double rays = speedMathKernel(1000, [&]() {
+		Vector3 start(position(random), 0.0f, position(random));
+		Vector3 dir(position(random), 0.0f, position(random));
+		broadPhase.queryRay(start, dir.Normalize(), 50.0f, found);
+		hits += found.size();
+	});
+
+	std::cout << name << " build = " << build / 1000000.0 << "ms, update = " << update / 1000000.0 << "ms/frame";
+	std::cout << " (" << changes << " pair changes), ray = " << rays / 1000.0 << "us (" << hits << " hits), ";
+	std::cout << broadPhase.getPairCount() << " pairs\n";
+}
+
+void TEST_SPEED_BROADPHASE()
+{
+	std::cout << "Testing broad phase" << '\n';
+	const int count = 20000;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+	std::vector<Vector3> mins(count), maxs(count);
+	for (int i = 0; i < count; ++i)
+	{
+		mins[i] = Vector3(position(random), position(random) * 0.1f, position(random));
+		maxs[i] = mins[i] + Vector3(size(random), size(random), size(random));
+	}
+
+	size_t bruteForceCount = 0;
+	double bruteForce = speedMathKernel(1, [&]() {
+		for (int i = 0; i < count; ++i)
+		{
+			for (int j = i + 1; j < count; ++j)
+			{
+				if (mins[i].GetX() <= maxs[j].GetX() && mins[j].GetX() <= maxs[i].GetX() &&
+					mins[i].GetY() <= maxs[j].GetY() && mins[j].GetY() <= maxs[i].GetY() &&
+					mins[i].GetZ() <= maxs[j].GetZ() && mins[j].GetZ() <= maxs[i].GetZ())
+					bruteForceCount++;
+			}
+		}
+	});
+	std::cout << count << " boxes, every pair = " << bruteForce / 1000000.0 << "ms (" << bruteForceCount << " pairs)\n";
+
+	SweepAndPrune sweepAndPrune;
+	speedBroadPhase("Sweep and prune", sweepAndPrune, mins, maxs);
+	AabbTree tree;
+	speedBroadPhase("AABB tree", tree, mins, maxs);
+	std::cout << "AABB tree height = " << tree.getHeight() << ", area ratio = " << tree.getAreaRatio() << '\n';
+	// cells the size of the largest box
+	SpatialHash spatialHash(2.0f);
+	speedBroadPhase("Spatial hash", spatialHash, mins, maxs);
+}
+
+// Collide one pair at a time against BatchCollide, over the pairs a broad phase finds among spheres and AABBs
+void TEST_SPEED_NARROWPHASE()
+{
+	std::cout << "Testing narrow phase" << '\n';
+	const int count = 10000;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> size(0.25f, 1.0f);
+
+	std::vector<Sphere> spheres;
+	std::vector<AABB> boxes;
+	for (int i = 0; i < count; ++i)
+	{
+		Vector3 center(position(random), position(random), position(random));
+		spheres.push_back(Sphere(center, size(random)));
+		boxes.push_back(AABB(center, center + Vector3(size(random), size(random), size(random)) * 2.0f));
+	}
+
+	std::vector<const Body*> bodies;
+	ColliderStorage colliders;
+	SpatialHash broadPhase(2.0f);
+	for (int i = 0; i < count; ++i)
+	{
+		bodies.push_back(&spheres[i]);
+		bodies.push_back(&boxes[i]);
+	}
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		Vector3 min, max;
+		bodies[i]->getBounds(min, max);
+		broadPhase.addProxy(min, max, NULL);
+		colliders.addCollider(bodies[i]);
+	}
+	broadPhase.updatePairs();
+
+	// a collider is the same index as its proxy
+	PoolVector<ProxyPair> proxyPairs;
+	broadPhase.getPairs(proxyPairs);
+	PoolVector<ColliderPair> pairs(proxyPairs.size());
+	for (size_t i = 0; i < proxyPairs.size(); ++i)
+	{
+		pairs[i].m_ColliderA = proxyPairs[i].m_ProxyA;
+		pairs[i].m_ColliderB = proxyPairs[i].m_ProxyB;
+	}
+
+	const int iterations = 20;
+	size_t scalarHits = 0;
+	double scalar = speedMathKernel(iterations, [&]() {
+		Collide collide;
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			collide.collision(bodies[pairs[i].m_ColliderA], bodies[pairs[i].m_ColliderB]);
+			scalarHits += collide.getCollide();
+		}
+	});
+
+	BatchCollide batchCollide;
+	PoolVector<Contact> contacts;
+	double batch = speedMathKernel(iterations, [&]() {
+		batchCollide.groupPairs(colliders, pairs.data(), (int) pairs.size());
+		batchCollide.collide(colliders, contacts);
+	});
+
+	std::cout << pairs.size() << " pairs, Collide = " << scalar / 1000000.0 << "ms (" << scalarHits / iterations << " collide), ";
+	std::cout << "BatchCollide x" << BatchCollide::getBatchWidth() << " = " << batch / 1000000.0 << "ms (" << contacts.size() << " contacts)\n";
+}
+
+// The phases of computeCollision on a growing number of threads
+void TEST_SPEED_COLLISION_THREADS()
+{
+	std::cout << "Testing collision threads" << '\n';
+	const int count = 10000;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> size(0.25f, 1.0f);
+	std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+
+	std::vector<Sphere> spheres;
+	std::vector<AABB> boxes;
+	for (int i = 0; i < count; ++i)
+	{
+		Vector3 center(position(random), position(random), position(random));
+		spheres.push_back(Sphere(center, size(random)));
+		boxes.push_back(AABB(center, center + Vector3(size(random), size(random), size(random)) * 2.0f));
+	}
+	std::vector<CollidableObject> objects;
+	for (int i = 0; i < count; ++i)
+	{
+		objects.push_back(CollidableObject(&spheres[i], Vector3(), 2 * i));
+		objects.push_back(CollidableObject(&boxes[i], Vector3(), 2 * i + 1));
+	}
+	std::vector<CollidableObject*> objectPointers;
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		objectPointers.push_back(&objects[i]);
+	}
+
+	CollisionWorld world(BROADPHASE_SPATIAL_HASH, 2.0f);
+	world.addObjects(&objectPointers[0], (int) objectPointers.size());
+	int maxThreads = std::max(1, (int) std::thread::hardware_concurrency());
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+	{
+		world.setThreadCount(threads);
+		world.computeCollision();
+
+		// every body moves a little each frame
+		const int frames = 10;
+		CollisionTimings total = CollisionTimings();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				Vector3 move(step(random), step(random), step(random));
+				spheres[i].update(1.0f, move);
+				boxes[i].update(1.0f, move);
+			}
+			world.computeCollision();
+			const CollisionTimings& timings = world.getTimings();
+			total.m_Refit += timings.m_Refit;
+			total.m_BroadPhase += timings.m_BroadPhase;
+			total.m_PairList += timings.m_PairList;
+			total.m_NarrowPhase += timings.m_NarrowPhase;
+			total.m_Merge += timings.m_Merge;
+			total.m_Total += timings.m_Total;
+		}
+
+		std::cout << threads << " threads: refit = " << total.m_Refit / frames << "ms, broad phase = " << total.m_BroadPhase / frames;
+		std::cout << "ms, pair list = " << total.m_PairList / frames << "ms, narrow phase = " << total.m_NarrowPhase / frames;
+		std::cout << "ms, merge = " << total.m_Merge / frames << "ms, total = " << total.m_Total / frames << "ms (";
+		std::cout << world.getCollideSize() << " collide)\n";
+		if (threads == maxThreads)
+			break;
+	}
 }
 
 int main(int argc, char* argv[])
@@ -579,6 +4458,18 @@ int main(int argc, char* argv[])
 	TEST_SPEED_FILE_IO();
 	// Pool memory
 	//TEST_POOL_MEMORY();
+	// Multi-threaded allocation
+	TEST_SPEED_MT_ALLOC();
+	// Allocation patterns
+	TEST_SPEED_ALLOCATOR();
+	// Maths kernels
+	TEST_SPEED_MATH();
+	// Broad phase
+	TEST_SPEED_BROADPHASE();
+	// Narrow phase
+	TEST_SPEED_NARROWPHASE();
+	// Collision on worker threads
+	TEST_SPEED_COLLISION_THREADS();
 
 	std::cin.getline(new char, 1);
 }